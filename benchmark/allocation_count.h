@@ -0,0 +1,12 @@
+#pragma once
+
+// This component provides a function, `allocation_count`, that returns the
+// number of calls made so far to the global `operator new`.
+//
+// `allocation_count.cpp` replaces the global `operator new` in order to count
+// allocations.  The replacement lives in its own translation unit so that
+// callers never see it inlined next to the matching `operator delete`.
+
+#include <cstdint>
+
+std::uint64_t allocation_count();
@@ -1,19 +1,47 @@
 #include <benchmark/benchmark.h>
+#include <datadog/clock.h>
 #include <datadog/collector.h>
+#include <datadog/config_manager.h>
+#include <datadog/datadog_agent.h>
+#include <datadog/datadog_agent_config.h>
+#include <datadog/default_http_client.h>
+#include <datadog/dict_reader.h>
+#include <datadog/dict_writer.h>
+#include <datadog/http_client.h>
 #include <datadog/logger.h>
+#include <datadog/random.h>
+#include <datadog/runtime_id.h>
+#include <datadog/socket_http_client.h>
 #include <datadog/span_data.h>
 #include <datadog/tracer.h>
 #include <datadog/tracer_config.h>
+#include <datadog/tracer_signature.h>
+#include <datadog/tracer_telemetry.h>
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <datadog/json.hpp>
 #include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <variant>
+#include <vector>
 
+#include "allocation_count.h"
 #include "hasher.h"
+#include "local_agent.h"
 
 namespace {
 
 namespace dd = datadog::tracing;
 
+// `span_count` is the number of spans serialized by `SerializingCollector`.
+// Together with `allocation_count()`, it yields the "allocations_per_span"
+// benchmark counter.
+std::uint64_t span_count = 0;
+
 // `NullLogger` doesn't log. It avoids `log_startup` spam in the benchmark.
 struct NullLogger : public dd::Logger {
   void log_error(const LogFunc&) override {}
@@ -29,6 +57,7 @@ struct SerializingCollector : public dd::Collector {
   dd::Expected<void> send(
       std::vector<std::unique_ptr<dd::SpanData>>&& spans,
       const std::shared_ptr<dd::TraceSampler>& /*response_handler*/) override {
+    span_count += spans.size();
     std::string buffer;
     return dd::msgpack_encode(buffer, spans);
   }
@@ -41,7 +70,13 @@ struct SerializingCollector : public dd::Collector {
 // The benchmark `BM_TraceTinyCCSource`, for each iteration over `state`,
 // creates a trace whose shape is the same as the file system tree under
 // `./tinycc`. It's similar to what is done in `../example`.
+//
+// The "allocations_per_span" counter is the average number of heap allocations
+// made while tracing, per span.  It includes allocations made by the hashing
+// itself, which are the same for every iteration.
 void BM_TraceTinyCCSource(benchmark::State& state) {
+  std::uint64_t allocations = 0;
+  span_count = 0;
   for (auto _ : state) {
     dd::TracerConfig config;
     config.service = "benchmark";
@@ -49,12 +84,308 @@ void BM_TraceTinyCCSource(benchmark::State& state) {
     config.collector = std::make_shared<SerializingCollector>();
     const auto valid_config = dd::finalize_config(config);
     dd::Tracer tracer{*valid_config};
+    const auto allocations_before = allocation_count();
     // Note: This assumes that the benchmark is run from the repository root.
     sha256_traced("benchmark/tinycc", tracer);
+    allocations += allocation_count() - allocations_before;
+  }
+  if (span_count) {
+    state.counters["allocations_per_span"] =
+        double(allocations) / double(span_count);
   }
 }
 BENCHMARK(BM_TraceTinyCCSource);
 
+// The benchmark `BM_ParallelChildSpans`, for each iteration over `state`,
+// creates a trace whose root span has children created and finished
+// concurrently by `state.range(0)` threads.  It measures contention within the
+// trace segment.
+void BM_ParallelChildSpans(benchmark::State& state) {
+  const auto num_threads = state.range(0);
+  const int children_per_thread = 1000;
+  dd::TracerConfig config;
+  config.service = "benchmark";
+  config.logger = std::make_shared<NullLogger>();
+  config.collector = std::make_shared<SerializingCollector>();
+  const auto valid_config = dd::finalize_config(config);
+  dd::Tracer tracer{*valid_config};
+
+  for (auto _ : state) {
+    auto root = tracer.create_span();
+    std::vector<std::thread> threads;
+    for (std::int64_t i = 0; i < num_threads; ++i) {
+      threads.emplace_back([&]() {
+        for (int j = 0; j < children_per_thread; ++j) {
+          auto child = root.create_child();
+          child.set_tag("iteration", "child");
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * num_threads *
+                          children_per_thread);
+}
+BENCHMARK(BM_ParallelChildSpans)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime();
+
+// The benchmark `BM_ClockMode`, for each iteration over `state`, creates a
+// trace whose root span has 1000 children, using the `ClockMode` whose integer
+// value is `state.range(0)`.  It measures the cost of reading span times.
+void BM_ClockMode(benchmark::State& state) {
+  const int num_children = 1000;
+  dd::TracerConfig config;
+  config.service = "benchmark";
+  config.logger = std::make_shared<NullLogger>();
+  config.collector = std::make_shared<SerializingCollector>();
+  config.clock_mode = static_cast<dd::ClockMode>(state.range(0));
+  const auto valid_config = dd::finalize_config(config);
+  dd::Tracer tracer{*valid_config};
+
+  for (auto _ : state) {
+    auto root = tracer.create_span();
+    for (int i = 0; i < num_children; ++i) {
+      root.create_child();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * num_children);
+}
+BENCHMARK(BM_ClockMode)
+    ->Arg(int(dd::ClockMode::DEFAULT))
+    ->Arg(int(dd::ClockMode::SEGMENT_ANCHORED))
+    ->Arg(int(dd::ClockMode::TSC));
+
+// The benchmark `BM_RandomUint64` measures the pseudo-random number generator
+// that dd-trace-cpp uses for trace IDs and span IDs.
+void BM_RandomUint64(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(dd::random_uint64());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RandomUint64);
+
+// The benchmark `BM_Mt19937_64` is a reference for `BM_RandomUint64`.  It
+// measures a thread-local `std::mt19937_64`, which dd-trace-cpp used
+// previously.
+void BM_Mt19937_64(benchmark::State& state) {
+  thread_local std::mt19937_64 generator{std::random_device{}()};
+  std::uniform_int_distribution<std::uint64_t> distribution;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(distribution(generator));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Mt19937_64);
+
+// Return a span that resembles a span produced by an instrumented HTTP server:
+// interned names, a handful of string tags, a few metrics, and tags shared
+// with the other spans in its trace segment.
+std::unique_ptr<dd::SpanData> make_realistic_span(
+    const std::shared_ptr<const dd::SharedTags>& shared_tags) {
+  auto span = std::make_unique<dd::SpanData>();
+  span->service = dd::Symbol("checkout-service");
+  span->service_type = dd::Symbol("web");
+  span->name = dd::Symbol("http.request");
+  span->resource = dd::Symbol("POST /api/v2/orders/{order_id}/items");
+  span->trace_id = dd::TraceID(dd::random_uint64());
+  span->span_id = dd::random_uint64();
+  span->parent_id = dd::random_uint64();
+  span->duration = std::chrono::microseconds(1234);
+  span->tags.emplace("component", "nginx");
+  span->tags.emplace("span.kind", "server");
+  span->tags.emplace("http.method", "POST");
+  span->tags.emplace("http.status_code", "201");
+  span->tags.emplace("http.url",
+                     "https://shop.example.com/api/v2/orders/8412/items");
+  span->tags.emplace("http.useragent",
+                     "Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36");
+  span->tags.emplace("peer.hostname", "10.0.14.7");
+  span->numeric_tags.emplace("_dd.measured", 1);
+  span->numeric_tags.emplace("_dd.top_level", 1);
+  span->shared_tags = shared_tags;
+  return span;
+}
+
+std::shared_ptr<const dd::SharedTags> make_realistic_shared_tags() {
+  auto shared = std::make_shared<dd::SharedTags>();
+  shared->tags.emplace("env", "prod");
+  shared->tags.emplace("version", "1.42.0");
+  shared->tags.emplace("language", "cpp");
+  shared->tags.emplace("runtime-id", "3e8a2d3c-6c1b-4a57-9a0e-2f6f1d7c5b44");
+  shared->tags.emplace("_dd.p.dm", "-0");
+  shared->numeric_tags.emplace("process_id", 4242);
+  shared->numeric_tags.emplace("_sampling_priority_v1", 1);
+  (void)shared->encode();
+  return shared;
+}
+
+// The benchmark `BM_MsgpackEncodeSpan` measures the MessagePack encoding of a
+// single realistic span into a reused buffer.
+void BM_MsgpackEncodeSpan(benchmark::State& state) {
+  const auto span = make_realistic_span(make_realistic_shared_tags());
+  std::string buffer;
+  for (auto _ : state) {
+    buffer.clear();
+    benchmark::DoNotOptimize(dd::msgpack_encode(buffer, *span));
+    benchmark::DoNotOptimize(buffer.data());
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * buffer.size());
+}
+BENCHMARK(BM_MsgpackEncodeSpan);
+
+// The benchmark `BM_MsgpackEncodeTraceChunk` measures the MessagePack encoding
+// of a trace chunk of `state.range(0)` realistic spans into a new buffer.  If
+// `state.range(1)` is nonzero, then the buffer first reserves the exact size
+// of the encoding, as `DatadogAgent` does.
+void BM_MsgpackEncodeTraceChunk(benchmark::State& state) {
+  const auto shared = make_realistic_shared_tags();
+  std::vector<std::unique_ptr<dd::SpanData>> spans;
+  for (std::int64_t i = 0; i < state.range(0); ++i) {
+    spans.push_back(make_realistic_span(shared));
+  }
+  const bool reserve = state.range(1) != 0;
+  std::size_t size = 0;
+  for (auto _ : state) {
+    std::string buffer;
+    if (reserve) {
+      buffer.reserve(dd::msgpack_encoded_size(spans));
+    }
+    benchmark::DoNotOptimize(dd::msgpack_encode(buffer, spans));
+    size = buffer.size();
+  }
+  state.SetItemsProcessed(state.iterations() * spans.size());
+  state.SetBytesProcessed(state.iterations() * size);
+}
+BENCHMARK(BM_MsgpackEncodeTraceChunk)
+    ->ArgNames({"spans", "reserve"})
+    ->ArgsProduct({{1, 10, 100, 1000}, {0, 1}});
+
+// `NullHTTPClient` discards requests without responding to them.
+struct NullHTTPClient : public dd::HTTPClient {
+  dd::Expected<void> post(const URL&, HeadersSetter, std::string,
+                          ResponseHandler, ErrorHandler,
+                          std::chrono::steady_clock::time_point) override {
+    return {};
+  }
+
+  void drain(std::chrono::steady_clock::time_point) override {}
+
+  nlohmann::json config_json() const override {
+    return nlohmann::json::object({{"type", "NullHTTPClient"}});
+  }
+};
+
+// `agent` is shared by the threads of `BM_DatadogAgentSend`.
+std::unique_ptr<dd::DatadogAgent> agent;
+
+// The benchmark `BM_DatadogAgentSend` measures contention in
+// `DatadogAgent::send` among `state.threads()` threads, each sending trace
+// chunks of one small span.  Meanwhile, the agent flushes every 10
+// milliseconds on its own thread, to a `NullHTTPClient`.  If `state.range(0)`
+// is nonzero, then the trace chunks are encoded eagerly.
+void BM_DatadogAgentSend(benchmark::State& state) {
+  if (state.thread_index() == 0) {
+    dd::TracerConfig config;
+    config.service = "benchmark";
+    config.logger = std::make_shared<NullLogger>();
+    config.report_telemetry = false;
+    config.agent.http_client = std::make_shared<NullHTTPClient>();
+    config.agent.flush_interval_milliseconds = 10;
+    config.agent.eager_encoding = state.range(0) != 0;
+    const auto finalized = dd::finalize_config(config);
+    const dd::TracerSignature signature(dd::RuntimeID::generate(), "benchmark",
+                                        "production");
+    agent = std::make_unique<dd::DatadogAgent>(
+        std::get<dd::FinalizedDatadogAgentConfig>(finalized->collector),
+        std::make_shared<dd::TracerTelemetry>(
+            false, finalized->clock, finalized->logger, signature, "", ""),
+        finalized->logger, signature,
+        std::make_shared<dd::ConfigManager>(*finalized));
+  }
+
+  for (auto _ : state) {
+    std::vector<std::unique_ptr<dd::SpanData>> spans;
+    auto span = std::make_unique<dd::SpanData>();
+    span->name = dd::Symbol("send");
+    spans.push_back(std::move(span));
+    benchmark::DoNotOptimize(agent->send(std::move(spans), nullptr));
+  }
+  state.SetItemsProcessed(state.iterations());
+
+  if (state.thread_index() == 0) {
+    agent.reset();
+  }
+}
+BENCHMARK(BM_DatadogAgentSend)
+    ->ArgName("eager")
+    ->Arg(0)
+    ->Arg(1)
+    ->ThreadRange(1, 8)
+    ->UseRealTime();
+
+void set_trace_count(dd::DictWriter& headers) {
+  headers.set("Content-Type", "application/msgpack");
+  headers.set("X-Datadog-Trace-Count", "1");
+}
+
+// The benchmark `BM_HTTPClientPost` compares `HTTPClient` implementations by
+// posting to a `LocalAgent`, a stand-in for the Datadog Agent.  Each iteration
+// posts `state.range(2)` requests concurrently, each having a body of
+// `state.range(1)` bytes, and then waits for their responses.  If
+// `state.range(0)` is zero, then the client is the default client, i.e.
+// `Curl`.  Otherwise, it's `SocketHTTPClient`.  If `state.range(3)` is zero,
+// then the agent listens on the loopback interface.  Otherwise, it listens on
+// a unix domain socket.
+void BM_HTTPClientPost(benchmark::State& state) {
+  const auto logger = std::make_shared<NullLogger>();
+  const std::shared_ptr<dd::HTTPClient> client =
+      state.range(0) == 0
+          ? dd::default_http_client(logger, dd::default_clock)
+          : std::make_shared<dd::SocketHTTPClient>(logger, dd::default_clock);
+  if (!client) {
+    state.SkipWithError("No default HTTP client is available.");
+    return;
+  }
+  const bool unix_socket = state.range(3) != 0;
+  const auto agent =
+      unix_socket ? std::make_unique<LocalAgent>(
+                        "/tmp/dd_trace_cpp-benchmark-" +
+                        std::to_string(std::random_device{}()) + ".sock")
+                  : std::make_unique<LocalAgent>();
+  auto url = dd::HTTPClient::URL::parse(agent->url());
+  url->path = "/v0.4/traces";
+  const std::string body(std::size_t(state.range(1)), 'x');
+  const auto batch = state.range(2);
+  std::atomic<std::int64_t> errors{0};
+
+  for (auto _ : state) {
+    for (std::int64_t i = 0; i < batch; ++i) {
+      const auto deadline =
+          std::chrono::steady_clock::now() + std::chrono::seconds(10);
+      auto result = client->post(
+          *url, set_trace_count, body,
+          [](int, const dd::DictReader&, std::string) {},
+          [&errors](dd::Error) { ++errors; }, deadline);
+      if (result.if_error()) {
+        ++errors;
+      }
+    }
+    client->drain(std::chrono::steady_clock::now() + std::chrono::seconds(10));
+  }
+  if (errors != 0) {
+    state.SkipWithError("Some requests failed.");
+  }
+  state.SetItemsProcessed(state.iterations() * batch);
+  state.SetBytesProcessed(state.iterations() * batch * state.range(1));
+}
+BENCHMARK(BM_HTTPClientPost)
+    ->ArgNames({"socket_client", "body", "batch", "unix"})
+    ->ArgsProduct({{0, 1}, {1024, 256 * 1024}, {1, 16}, {0, 1}})
+    ->UseRealTime();
+
 }  // namespace
 
 BENCHMARK_MAIN();
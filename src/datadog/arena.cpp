@@ -0,0 +1,269 @@
+#include "arena.h"
+
+#include <algorithm>
+
+#include "platform_util.h"
+
+namespace datadog {
+namespace tracing {
+namespace {
+
+// The first block is large enough for a small trace segment: a handful of
+// spans with a handful of tags each.  Subsequent blocks double in size, up to
+// a limit.
+constexpr std::size_t initial_block_capacity = 4096;
+constexpr std::size_t max_block_capacity = 64 * 1024;
+
+// Recycled blocks are cached per thread, up to `thread_cache_capacity` blocks
+// per thread, and in a process-wide depot, up to `depot_capacity` blocks.
+constexpr std::size_t thread_cache_capacity = 8;
+constexpr std::size_t depot_capacity = 64;
+
+constexpr std::size_t round_up(std::size_t size) {
+  constexpr std::size_t alignment = alignof(std::max_align_t);
+  return (size + alignment - 1) & ~(alignment - 1);
+}
+
+// `SpinLock` is used instead of `std::mutex` to protect the depot of recycled
+// blocks, because the child process can reset a `SpinLock` after `fork`, even
+// if some other thread held the lock at the time of the fork.  The lock is
+// held only briefly.
+class SpinLock {
+  std::atomic<bool> locked_{false};
+
+ public:
+  void lock() {
+    while (locked_.exchange(true, std::memory_order_acquire)) {
+    }
+  }
+  void unlock() { locked_.store(false, std::memory_order_release); }
+  void reset() { locked_.store(false, std::memory_order_relaxed); }
+};
+
+}  // namespace
+
+struct alignas(alignof(std::max_align_t)) Arena::Block {
+  Block* next;
+  std::size_t capacity;
+  std::atomic<std::size_t> used;
+
+  char* data() { return reinterpret_cast<char*>(this + 1); }
+
+  static Block* create(std::size_t capacity, Block* next) {
+    void* memory = ::operator new(sizeof(Block) + capacity);
+    return new (memory) Block{next, capacity, {0}};
+  }
+
+  static void destroy(Block* block) {
+    block->~Block();
+    ::operator delete(block);
+  }
+};
+
+class Arena::BlockPool {
+  // `Stack` is a bounded stack of blocks.
+  template <std::size_t Capacity>
+  struct Stack {
+    Block* blocks[Capacity];
+    std::size_t size;
+
+    bool full() const { return size == Capacity; }
+    bool empty() const { return size == 0; }
+    void push(Block* block) { blocks[size++] = block; }
+    Block* pop() { return blocks[--size]; }
+    void clear() {
+      while (!empty()) {
+        Block::destroy(pop());
+      }
+    }
+  };
+
+  struct Depot {
+    SpinLock lock;
+    Stack<depot_capacity> stack;
+  };
+
+  // `ThreadCache` returns its blocks to the depot when its thread exits.
+  struct ThreadCache {
+    Stack<thread_cache_capacity> stack{};
+
+    ThreadCache();
+    ~ThreadCache();
+  };
+
+  enum class ThreadCacheState : char { UNINITIALIZED, ALIVE, DESTROYED };
+
+  static Depot depot;
+  static thread_local ThreadCacheState thread_cache_state;
+
+  // Return the calling thread's cache, or return null if the cache has already
+  // been destroyed, which happens during thread exit.
+  static Stack<thread_cache_capacity>* thread_cache() {
+    if (thread_cache_state == ThreadCacheState::DESTROYED) {
+      return nullptr;
+    }
+    static thread_local ThreadCache cache;
+    return &cache.stack;
+  }
+
+  static void on_fork_in_child();
+
+ public:
+  // Return a recycled block, or return null if there are none.
+  static Block* take();
+  // Keep the specified `block` for reuse, or free it if the pool is full.
+  static void give(Block* block);
+};
+
+Arena::BlockPool::Depot Arena::BlockPool::depot;
+
+thread_local Arena::BlockPool::ThreadCacheState
+    Arena::BlockPool::thread_cache_state =
+        Arena::BlockPool::ThreadCacheState::UNINITIALIZED;
+
+Arena::BlockPool::ThreadCache::ThreadCache() {
+  static const int registered = at_fork_in_child(&on_fork_in_child);
+  (void)registered;
+  thread_cache_state = ThreadCacheState::ALIVE;
+}
+
+Arena::BlockPool::ThreadCache::~ThreadCache() {
+  thread_cache_state = ThreadCacheState::DESTROYED;
+  while (!stack.empty()) {
+    give(stack.pop());
+  }
+}
+
+void Arena::BlockPool::on_fork_in_child() {
+  // Only the thread that called `fork` exists in the child, so the blocks
+  // cached by other threads are unreachable.  They are leaked.
+  depot.lock.reset();
+  depot.stack.clear();
+  if (auto* cache = thread_cache()) {
+    cache->clear();
+  }
+}
+
+Arena::Block* Arena::BlockPool::take() {
+  auto* const cache = thread_cache();
+  if (cache && !cache->empty()) {
+    return cache->pop();
+  }
+
+  Block* block = nullptr;
+  std::lock_guard<SpinLock> lock(depot.lock);
+  if (!depot.stack.empty()) {
+    block = depot.stack.pop();
+  }
+  // Take a few more blocks while we hold the lock.
+  while (cache && !depot.stack.empty() &&
+         cache->size < thread_cache_capacity / 2) {
+    cache->push(depot.stack.pop());
+  }
+  return block;
+}
+
+void Arena::BlockPool::give(Block* block) {
+  block->next = nullptr;
+  block->used.store(0, std::memory_order_relaxed);
+
+  auto* const cache = thread_cache();
+  if (cache && !cache->full()) {
+    cache->push(block);
+    return;
+  }
+
+  {
+    std::lock_guard<SpinLock> lock(depot.lock);
+    if (!depot.stack.full()) {
+      depot.stack.push(block);
+      return;
+    }
+  }
+  Block::destroy(block);
+}
+
+Arena::Arena(Block* first) : current_(first), reference_count_(1) {}
+
+Arena::~Arena() = default;
+
+Arena* Arena::create() {
+  Block* first = BlockPool::take();
+  if (!first) {
+    first = Block::create(initial_block_capacity, nullptr);
+  }
+  // The arena lives at the front of its own first block.
+  first->used.store(round_up(sizeof(Arena)), std::memory_order_relaxed);
+  return new (first->data()) Arena(first);
+}
+
+void Arena::acquire() {
+  reference_count_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Arena::release() {
+  if (reference_count_.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+    return;
+  }
+
+  Block* block = current_.load(std::memory_order_acquire);
+  // `this` is stored in the last block of the list, so don't touch any data
+  // members after the destructor runs.
+  this->~Arena();
+
+  // Keep the largest block that isn't oversized, and free the others.  When
+  // the same shape of trace repeats, the recycled block soon becomes large
+  // enough to hold the entire trace segment.
+  Block* kept = nullptr;
+  while (block) {
+    Block* const next = block->next;
+    if (block->capacity <= max_block_capacity &&
+        (!kept || block->capacity > kept->capacity)) {
+      std::swap(kept, block);
+    }
+    if (block) {
+      Block::destroy(block);
+    }
+    block = next;
+  }
+  if (kept) {
+    BlockPool::give(kept);
+  }
+}
+
+void* Arena::allocate(std::size_t size) {
+  size = round_up(size);
+  for (;;) {
+    Block* const block = current_.load(std::memory_order_acquire);
+    const std::size_t offset =
+        block->used.fetch_add(size, std::memory_order_relaxed);
+    if (offset + size <= block->capacity) {
+      return block->data() + offset;
+    }
+    grow(block, size);
+  }
+}
+
+void Arena::grow(Block* full, std::size_t size) {
+  std::lock_guard<std::mutex> lock(grow_mutex_);
+  if (current_.load(std::memory_order_relaxed) != full) {
+    // Some other thread already grew the arena.
+    return;
+  }
+
+  const std::size_t capacity =
+      std::max(std::min(full->capacity * 2, max_block_capacity), size);
+  current_.store(Block::create(capacity, full), std::memory_order_release);
+}
+
+std::size_t Arena::capacity() const {
+  std::size_t total = 0;
+  for (Block* block = current_.load(std::memory_order_acquire); block;
+       block = block->next) {
+    total += block->capacity;
+  }
+  return total;
+}
+
+}  // namespace tracing
+}  // namespace datadog
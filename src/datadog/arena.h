@@ -0,0 +1,135 @@
+#pragma once
+
+// This component provides a class, `Arena`, that is a monotonic memory
+// allocator, and a class template, `ArenaAllocator`, that adapts `Arena` to the
+// standard library's allocator interface.
+//
+// Each `TraceSegment` owns an `Arena`.  The `SpanData` of every span in the
+// segment, as well as the nodes of each span's tag containers, are allocated
+// from the segment's arena.  Memory allocated from an `Arena` is never freed
+// individually.  Instead, the arena releases all of its memory at once when
+// its reference count drops to zero.
+//
+// An `Arena` is reference counted manually.  `Arena::create` returns an arena
+// having one reference.  `acquire` adds a reference, and `release` removes a
+// reference, destroying the arena if there are no references remaining.
+// `ArenaPtr` is a `std::unique_ptr` that releases a reference when destroyed.
+//
+// Allocation from an `Arena` is thread-safe, since the spans of a trace segment
+// might be created on different threads.
+//
+// When an arena is destroyed, its largest block is kept for reuse as the first
+// block of a subsequently created arena.  Recycled blocks are cached per
+// thread, with a bounded, process-wide depot behind the per-thread caches, so
+// that blocks released by the thread that flushes traces can be reused by the
+// threads that create them.  In steady state, when the same shapes of traces
+// repeat, creating an arena and allocating spans from it does not allocate
+// from the global heap.  The recycled blocks are freed in the child process
+// after `fork`.
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+
+namespace datadog {
+namespace tracing {
+
+class Arena {
+  struct Block;
+  class BlockPool;
+
+  std::atomic<Block*> current_;
+  std::mutex grow_mutex_;
+  std::atomic<std::size_t> reference_count_;
+
+  explicit Arena(Block* first);
+  ~Arena();
+
+  // Allocate and install a new block having at least the specified `size`
+  // bytes of capacity, unless another thread has already replaced the
+  // specified `full` block.
+  void grow(Block* full, std::size_t size);
+
+ public:
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  // Return a new arena having a reference count of one.
+  static Arena* create();
+
+  // Increment this arena's reference count.
+  void acquire();
+  // Decrement this arena's reference count.  If the count becomes zero, then
+  // free all memory allocated from this arena, and this arena itself.
+  void release();
+
+  // Return a pointer to the beginning of a region of memory having at least
+  // the specified `size` bytes, suitably aligned for any fundamental type.
+  void* allocate(std::size_t size);
+
+  // Return the total number of bytes of block storage obtained by this arena
+  // from the global heap.
+  std::size_t capacity() const;
+};
+
+struct ArenaReleaser {
+  void operator()(Arena* arena) const { arena->release(); }
+};
+
+using ArenaPtr = std::unique_ptr<Arena, ArenaReleaser>;
+
+// `ArenaAllocator` allocates from an `Arena` if it has one, and from the global
+// heap otherwise.  Deallocation of memory that came from an `Arena` does
+// nothing.
+template <typename T>
+class ArenaAllocator {
+  template <typename U>
+  friend class ArenaAllocator;
+
+  Arena* arena_;
+
+ public:
+  using value_type = T;
+
+  ArenaAllocator() noexcept : arena_(nullptr) {}
+  explicit ArenaAllocator(Arena* arena) noexcept : arena_(arena) {}
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U>& other) noexcept
+      : arena_(other.arena_) {}
+
+  T* allocate(std::size_t count) {
+    if (arena_) {
+      return static_cast<T*>(arena_->allocate(count * sizeof(T)));
+    }
+    return static_cast<T*>(::operator new(count * sizeof(T)));
+  }
+
+  void deallocate(T* pointer, std::size_t) noexcept {
+    if (!arena_) {
+      ::operator delete(pointer);
+    }
+  }
+
+  Arena* arena() const noexcept { return arena_; }
+
+  template <typename U>
+  bool operator==(const ArenaAllocator<U>& other) const noexcept {
+    return arena_ == other.arena_;
+  }
+
+  template <typename U>
+  bool operator!=(const ArenaAllocator<U>& other) const noexcept {
+    return arena_ != other.arena_;
+  }
+};
+
+// `ArenaString` is a string whose characters, if they do not fit within the
+// string object itself, are allocated by an `ArenaAllocator`.
+using ArenaString =
+    std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>>;
+
+}  // namespace tracing
+}  // namespace datadog
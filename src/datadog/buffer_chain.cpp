@@ -0,0 +1,140 @@
+#include "buffer_chain.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace datadog {
+namespace tracing {
+
+BufferChain::BufferChain(std::size_t segment_capacity)
+    : segment_capacity_(std::max(segment_capacity, std::size_t(1))) {}
+
+std::string& BufferChain::writable_segment() {
+  if (segments_.empty() || segments_.back().size() >= segment_capacity_) {
+    segments_.emplace_back();
+    segments_.back().reserve(segment_capacity_);
+  }
+  return segments_.back();
+}
+
+std::string& BufferChain::writable_segment(std::size_t size) {
+  if (segments_.empty() ||
+      segments_.back().capacity() - segments_.back().size() < size) {
+    segments_.emplace_back();
+    segments_.back().reserve(std::max(size, segment_capacity_));
+  }
+  return segments_.back();
+}
+
+void BufferChain::append(StringView bytes) {
+  while (!bytes.empty()) {
+    std::string& segment = writable_segment();
+    const std::size_t count =
+        std::min(bytes.size(), segment_capacity_ - segment.size());
+    segment.append(bytes.data(), count);
+    bytes.remove_prefix(count);
+  }
+}
+
+void BufferChain::append_segment(std::string segment) {
+  segments_.push_back(std::move(segment));
+}
+
+void BufferChain::append(BufferChain&& other) {
+  for (auto& segment : other.segments_) {
+    segments_.push_back(std::move(segment));
+  }
+  other.segments_.clear();
+  other.read_position_ = ReadPosition{};
+}
+
+BufferChain BufferChain::take_front(std::size_t size) {
+  BufferChain front{segment_capacity_};
+  while (size != 0 && !segments_.empty() && segments_.front().size() <= size) {
+    size -= segments_.front().size();
+    front.segments_.push_back(std::move(segments_.front()));
+    segments_.pop_front();
+  }
+  if (size != 0 && !segments_.empty()) {
+    std::string& segment = segments_.front();
+    front.segments_.emplace_back(segment, 0, size);
+    segment.erase(0, size);
+  }
+  read_position_ = ReadPosition{};
+  return front;
+}
+
+void BufferChain::prepend(std::string segment) {
+  if (read_position_.segment != 0 || read_position_.offset != 0) {
+    ++read_position_.segment;
+  }
+  segments_.push_front(std::move(segment));
+}
+
+const std::deque<std::string>& BufferChain::segments() const {
+  return segments_;
+}
+
+std::size_t BufferChain::segment_capacity() const { return segment_capacity_; }
+
+std::size_t BufferChain::size() const {
+  std::size_t total = 0;
+  for (const auto& segment : segments_) {
+    total += segment.size();
+  }
+  return total;
+}
+
+bool BufferChain::empty() const { return size() == 0; }
+
+std::string BufferChain::flatten() const {
+  std::string result;
+  result.reserve(size());
+  for (const auto& segment : segments_) {
+    result += segment;
+  }
+  return result;
+}
+
+std::size_t BufferChain::read(char* destination, std::size_t size) {
+  return read(read_position_, destination, size);
+}
+
+bool BufferChain::seek(std::size_t offset) {
+  return seek(read_position_, offset);
+}
+
+std::size_t BufferChain::read(ReadPosition& position, char* destination,
+                              std::size_t size) const {
+  std::size_t copied = 0;
+  while (copied < size && position.segment < segments_.size()) {
+    const std::string& segment = segments_[position.segment];
+    const std::size_t count =
+        std::min(size - copied, segment.size() - position.offset);
+    std::copy_n(segment.data() + position.offset, count, destination + copied);
+    copied += count;
+    position.offset += count;
+    if (position.offset == segment.size()) {
+      ++position.segment;
+      position.offset = 0;
+    }
+  }
+  return copied;
+}
+
+bool BufferChain::seek(ReadPosition& position, std::size_t offset) const {
+  std::size_t segment = 0;
+  while (segment < segments_.size() && offset >= segments_[segment].size()) {
+    offset -= segments_[segment].size();
+    ++segment;
+  }
+  if (segment == segments_.size() && offset != 0) {
+    return false;
+  }
+  position.segment = segment;
+  position.offset = offset;
+  return true;
+}
+
+}  // namespace tracing
+}  // namespace datadog
@@ -0,0 +1,117 @@
+#pragma once
+
+// This component provides a class, `BufferChain`, that is a sequence of bytes
+// stored in a chain of separately allocated segments.
+//
+// `DatadogAgent` encodes trace chunks into a `BufferChain` instead of into one
+// `std::string`.  A single string would be reallocated and copied repeatedly
+// as it grows, and a flush can produce tens of megabytes.  A `BufferChain`
+// instead starts a new segment once the current segment is full, so bytes that
+// have already been written are never moved.
+//
+// Each segment is a `std::string` whose capacity is reserved up front.  Writers
+// append directly to the segment returned by `writable_segment()`, e.g. using
+// the functions in `msgpack.h`.  A segment can exceed its reserved capacity if
+// a single write is larger than the remaining room, e.g. a very large trace
+// chunk.  Only that segment is then reallocated.
+//
+// `BufferChain` also has a read position, so that an `HTTPClient` can send the
+// bytes in pieces, e.g. from a libcurl read callback, without first copying
+// them into contiguous storage.  A chain that is shared, and so is `const`, is
+// read using a separate `ReadPosition` that belongs to the reader.
+
+#include <cstddef>
+#include <deque>
+#include <string>
+
+#include "string_view.h"
+
+namespace datadog {
+namespace tracing {
+
+class BufferChain {
+ public:
+  // A `ReadPosition` is the byte at `offset` within the segment at `segment`.
+  struct ReadPosition {
+    std::size_t segment = 0;
+    std::size_t offset = 0;
+  };
+
+ private:
+  std::deque<std::string> segments_;
+  std::size_t segment_capacity_;
+  ReadPosition read_position_;
+
+ public:
+  static constexpr std::size_t default_segment_capacity = 64 * 1024;
+
+  // Create an empty chain whose segments each reserve the specified
+  // `segment_capacity` bytes.
+  explicit BufferChain(
+      std::size_t segment_capacity = default_segment_capacity);
+
+  // Return the segment to which the caller should append bytes.  If the last
+  // segment is full, then first add a new segment to the end of the chain.
+  std::string& writable_segment();
+
+  // Return a segment to which the caller can append the specified `size` bytes
+  // without the segment being reallocated.  If the last segment lacks room for
+  // `size` more bytes, then first add a new segment to the end of the chain,
+  // reserving the greater of `size` and `segment_capacity()` bytes.
+  std::string& writable_segment(std::size_t size);
+
+  // Append a copy of the specified `bytes` to the end of this chain, filling
+  // the last segment before adding new segments.
+  void append(StringView bytes);
+
+  // Add the specified `segment` to the end of this chain, without copying its
+  // bytes.
+  void append_segment(std::string segment);
+
+  // Move the segments of the specified `other` chain to the end of this chain,
+  // without copying their bytes.  `other` is left empty.
+  void append(BufferChain&& other);
+
+  // Remove the specified first `size` bytes of this chain, and return them as
+  // a new chain having the same segment capacity.  Whole segments are moved
+  // rather than copied, so at most one segment, the one that straddles
+  // `size`, is copied in part.  The read positions of both chains are at
+  // their beginnings afterward.  The behavior is undefined if `size` is
+  // greater than `this->size()`.
+  BufferChain take_front(std::size_t size);
+
+  // Insert the specified `segment` at the beginning of this chain.  If the
+  // read position is at the beginning of the chain, then it remains there, and
+  // so precedes `segment`.
+  void prepend(std::string segment);
+
+  const std::deque<std::string>& segments() const;
+  std::size_t segment_capacity() const;
+
+  // Return the total number of bytes in this chain.
+  std::size_t size() const;
+  bool empty() const;
+
+  // Return a copy of the bytes in this chain, concatenated.
+  std::string flatten() const;
+
+  // Copy at most the specified `size` bytes from the read position into the
+  // specified `destination`, and advance the read position past them.  Return
+  // the number of bytes copied, which is zero if and only if `size` is zero or
+  // the read position is at the end of the chain.
+  std::size_t read(char* destination, std::size_t size);
+
+  // Move the read position to the specified `offset` bytes from the beginning
+  // of the chain.  Return whether `offset` is within the chain, i.e. not
+  // greater than `size()`.  If it isn't, then the read position is unchanged.
+  bool seek(std::size_t offset);
+
+  // Read and seek as above, but using the specified `position` instead of
+  // this chain's read position.
+  std::size_t read(ReadPosition& position, char* destination,
+                   std::size_t size) const;
+  bool seek(ReadPosition& position, std::size_t offset) const;
+};
+
+}  // namespace tracing
+}  // namespace datadog
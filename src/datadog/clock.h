@@ -18,6 +18,9 @@
 // `Clock` is an alias for `std::function<TimePoint()>`, and the default
 // `Clock`, `default_clock`, gives a `TimePoint` using the
 // `std::chrono::system_clock` and `std::chrono::steady_clock`.
+//
+// `ClockMode` selects how a `Tracer` measures the start times and durations of
+// spans.  See `segment_clock.h`.
 
 #include <chrono>
 #include <functional>
@@ -56,5 +59,17 @@ using Clock = std::function<TimePoint()>;
 
 extern const Clock default_clock;
 
+enum class ClockMode : char {
+  // Call the `Clock` whenever a span starts or finishes.
+  DEFAULT,
+  // Read the system clock once per trace segment.  Derive the start time of
+  // each span in the segment from the steady clock's offset from that reading.
+  SEGMENT_ANCHORED,
+  // As `SEGMENT_ANCHORED`, but measure offsets using the processor's time
+  // stamp counter (TSC), calibrated against the steady clock at startup.  If
+  // the processor lacks an invariant TSC, then use `SEGMENT_ANCHORED` instead.
+  TSC,
+};
+
 }  // namespace tracing
 }  // namespace datadog
@@ -1,18 +1,23 @@
 #include "curl.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cctype>
 #include <chrono>
 #include <condition_variable>
 #include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
 #include <iterator>
 #include <list>
 #include <memory>
 #include <mutex>
 #include <system_error>
-#include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
+#include "buffer_chain.h"
 #include "clock.h"
 #include "dict_reader.h"
 #include "dict_writer.h"
@@ -20,6 +25,7 @@
 #include "json.hpp"
 #include "logger.h"
 #include "parse_util.h"
+#include "string_util.h"
 #include "string_view.h"
 
 namespace datadog {
@@ -36,6 +42,10 @@ CURL *CurlLibrary::easy_init() { return curl_easy_init(); }
 
 void CurlLibrary::easy_cleanup(CURL *handle) { curl_easy_cleanup(handle); }
 
+CURLcode CurlLibrary::easy_getinfo_num_connects(CURL *curl, long *count) {
+  return curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, count);
+}
+
 CURLcode CurlLibrary::easy_getinfo_private(CURL *curl, char **user_data) {
   return curl_easy_getinfo(curl, CURLINFO_PRIVATE, user_data);
 }
@@ -44,6 +54,8 @@ CURLcode CurlLibrary::easy_getinfo_response_code(CURL *curl, long *code) {
   return curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, code);
 }
 
+void CurlLibrary::easy_reset(CURL *handle) { curl_easy_reset(handle); }
+
 CURLcode CurlLibrary::easy_setopt_errorbuffer(CURL *handle, char *buffer) {
   return curl_easy_setopt(handle, CURLOPT_ERRORBUFFER, buffer);
 }
@@ -78,6 +90,24 @@ CURLcode CurlLibrary::easy_setopt_private(CURL *handle, void *pointer) {
   return curl_easy_setopt(handle, CURLOPT_PRIVATE, pointer);
 }
 
+CURLcode CurlLibrary::easy_setopt_readdata(CURL *handle, void *data) {
+  return curl_easy_setopt(handle, CURLOPT_READDATA, data);
+}
+
+CURLcode CurlLibrary::easy_setopt_readfunction(CURL *handle,
+                                               ReadCallback on_read) {
+  return curl_easy_setopt(handle, CURLOPT_READFUNCTION, on_read);
+}
+
+CURLcode CurlLibrary::easy_setopt_seekdata(CURL *handle, void *data) {
+  return curl_easy_setopt(handle, CURLOPT_SEEKDATA, data);
+}
+
+CURLcode CurlLibrary::easy_setopt_seekfunction(CURL *handle,
+                                               SeekCallback on_seek) {
+  return curl_easy_setopt(handle, CURLOPT_SEEKFUNCTION, on_seek);
+}
+
 CURLcode CurlLibrary::easy_setopt_unix_socket_path(CURL *handle,
                                                    const char *path) {
   return curl_easy_setopt(handle, CURLOPT_UNIX_SOCKET_PATH, path);
@@ -164,6 +194,10 @@ using ResponseHandler = HTTPClient::ResponseHandler;
 using URL = HTTPClient::URL;
 
 class CurlImpl {
+  struct Hash {
+    std::size_t operator()(StringView text) const;
+  };
+
   std::mutex mutex_;
   CurlLibrary &curl_;
   const std::shared_ptr<Logger> logger_;
@@ -176,44 +210,100 @@ class CurlImpl {
   std::condition_variable no_requests_;
   std::thread event_loop_;
 
+  // The following are guarded by `pool_mutex_` rather than by `mutex_`, which
+  // the event loop holds while libcurl is performing requests.
+  //
+  // `idle_handles_` are easy handles that finished a request and were reset,
+  // ready to be used by another request.
+  //
+  // `header_lines_` are request header lines, e.g. "Datadog-Meta-Lang: cpp",
+  // that were set as constant (see `DictWriter::set_constant`), and that
+  // later requests point to instead of copying.  Its keys refer to the
+  // elements of `header_line_storage_`, which is a `deque` so that its
+  // elements are never moved.  Other lines, such as those whose values vary
+  // from request to request, are stored in their request, as are constant
+  // lines beyond the first `max_header_lines`.
+  std::mutex pool_mutex_;
+  std::vector<CURL *> idle_handles_;
+  std::deque<std::string> header_line_storage_;
+  std::unordered_set<StringView, Hash> header_lines_;
+
+  std::atomic<std::uint64_t> new_connections_;
+  std::atomic<std::uint64_t> reused_connections_;
+
+  static constexpr std::size_t max_idle_handles = 16;
+  static constexpr std::size_t max_header_lines = 256;
+
   struct Request {
-    CurlLibrary *curl = nullptr;
-    curl_slist *request_headers = nullptr;
+    // `header_nodes` is the request's header list, linked in order.  Each
+    // node's data is either in `CurlImpl::header_line_storage_` or in
+    // `header_storage`.
+    std::vector<curl_slist> header_nodes;
+    std::string header_storage;
     std::string request_body;
+    // If `streamed`, then the request body is `request_stream` instead of
+    // `request_body`.  `request_stream` is shared, so it is read from
+    // `request_stream_position` rather than from its own read position.
+    bool streamed = false;
+    std::shared_ptr<const BufferChain> request_stream;
+    BufferChain::ReadPosition request_stream_position;
     ResponseHandler on_response;
     ErrorHandler on_error;
     char error_buffer[CURL_ERROR_SIZE] = "";
-    std::unordered_map<std::string, std::string> response_headers_lower;
+    // `response_headers` are the response's header lines as received, which
+    // are parsed only if they are looked up.
+    std::string response_headers;
     std::string response_body;
     std::chrono::steady_clock::time_point deadline;
-
-    ~Request();
   };
 
+  // `HeaderWriter` formats each header as a line, e.g. "Foo: bar", and
+  // appends it, followed by a null character, to `lines()`.  The element of
+  // `constants()` corresponding to each line is whether the line was set
+  // by `set_constant`.
   class HeaderWriter : public DictWriter {
-    curl_slist *list_ = nullptr;
-    std::string buffer_;
-    CurlLibrary &curl_;
+    std::string lines_;
+    std::vector<bool> constants_;
 
    public:
-    explicit HeaderWriter(CurlLibrary &curl);
-    ~HeaderWriter();
-    curl_slist *release();
+    const std::string &lines() const;
+    const std::vector<bool> &constants() const;
     void set(StringView key, StringView value) override;
+    void set_constant(StringView key, StringView value) override;
   };
 
+  // `HeaderReader` finds headers in response header lines, ignoring the case
+  // of their keys.  If a key appears more than once, then only its first
+  // value is found.
   class HeaderReader : public DictReader {
-    std::unordered_map<std::string, std::string> *response_headers_lower_;
+    const std::string *response_headers_;
     mutable std::string buffer_;
 
+    // Call the specified `visitor` with the key and value of each header in
+    // `*response_headers_`, in order, until `visitor` returns `true`.
+    template <typename Visitor>
+    void scan(Visitor &&visitor) const;
+
    public:
-    explicit HeaderReader(
-        std::unordered_map<std::string, std::string> *response_headers_lower);
+    explicit HeaderReader(const std::string *response_headers);
     Optional<StringView> lookup(StringView key) const override;
     void visit(const std::function<void(StringView key, StringView value)>
                    &visitor) const override;
   };
 
+  // Add the specified `request`, whose body is already set, to the event loop.
+  Expected<void> start(const URL &url, HeadersSetter set_headers,
+                       std::unique_ptr<Request> request,
+                       ResponseHandler on_response, ErrorHandler on_error,
+                       std::chrono::steady_clock::time_point deadline);
+  // Set the header list of the specified `request` to the lines of the
+  // specified `writer`.
+  void set_header_list(Request &request, const HeaderWriter &writer);
+  // Return an easy handle from the pool, or a new one if the pool is empty.
+  CURL *acquire_handle();
+  // Reset the specified `handle` and return it to the pool, or clean it up if
+  // the pool is full.
+  void release_handle(CURL *handle);
   void run();
   void handle_message(const CURLMsg &, std::unique_lock<std::mutex> &);
   CURLcode log_on_error(CURLcode result);
@@ -223,6 +313,9 @@ class CurlImpl {
                                     void *user_data);
   static std::size_t on_read_body(char *data, std::size_t, std::size_t length,
                                   void *user_data);
+  static std::size_t on_send_body(char *data, std::size_t size,
+                                  std::size_t count, void *user_data);
+  static int on_seek_body(void *user_data, curl_off_t offset, int origin);
   static bool is_non_whitespace(unsigned char);
   static char to_lower(unsigned char);
 
@@ -236,7 +329,15 @@ class CurlImpl {
                       ErrorHandler on_error,
                       std::chrono::steady_clock::time_point deadline);
 
+  Expected<void> post_stream(const URL &url, HeadersSetter set_headers,
+                             std::shared_ptr<const BufferChain> body,
+                             ResponseHandler on_response,
+                             ErrorHandler on_error,
+                             std::chrono::steady_clock::time_point deadline);
+
   void drain(std::chrono::steady_clock::time_point deadline);
+
+  HTTPClient::ConnectionStats connection_stats() const;
 };
 
 namespace {
@@ -270,10 +371,23 @@ Expected<void> Curl::post(const URL &url, HeadersSetter set_headers,
   return impl_->post(url, set_headers, body, on_response, on_error, deadline);
 }
 
+Expected<void> Curl::post_stream(
+    const URL &url, HeadersSetter set_headers,
+    std::shared_ptr<const BufferChain> body, ResponseHandler on_response,
+    ErrorHandler on_error, std::chrono::steady_clock::time_point deadline) {
+  return impl_->post_stream(url, std::move(set_headers), std::move(body),
+                            std::move(on_response), std::move(on_error),
+                            deadline);
+}
+
 void Curl::drain(std::chrono::steady_clock::time_point deadline) {
   impl_->drain(deadline);
 }
 
+HTTPClient::ConnectionStats Curl::connection_stats() const {
+  return impl_->connection_stats();
+}
+
 nlohmann::json Curl::config_json() const {
   return nlohmann::json::object({{"type", "datadog::tracing::Curl"}});
 }
@@ -284,7 +398,9 @@ CurlImpl::CurlImpl(const std::shared_ptr<Logger> &logger, const Clock &clock,
       logger_(logger),
       clock_(clock),
       shutting_down_(false),
-      num_active_handles_(0) {
+      num_active_handles_(0),
+      new_connections_(0),
+      reused_connections_(0) {
   curl_.global_init(CURL_GLOBAL_ALL);
   multi_handle_ = curl_.multi_init();
   if (multi_handle_ == nullptr) {
@@ -323,6 +439,9 @@ CurlImpl::~CurlImpl() {
   log_on_error(curl_.multi_wakeup(multi_handle_));
   event_loop_.join();
 
+  for (CURL *const handle : idle_handles_) {
+    curl_.easy_cleanup(handle);
+  }
   log_on_error(curl_.multi_cleanup(multi_handle_));
   curl_.global_cleanup();
 }
@@ -330,6 +449,28 @@ CurlImpl::~CurlImpl() {
 Expected<void> CurlImpl::post(
     const HTTPClient::URL &url, HeadersSetter set_headers, std::string body,
     ResponseHandler on_response, ErrorHandler on_error,
+    std::chrono::steady_clock::time_point deadline) {
+  auto request = std::make_unique<Request>();
+  request->request_body = std::move(body);
+  return start(url, std::move(set_headers), std::move(request),
+               std::move(on_response), std::move(on_error), deadline);
+}
+
+Expected<void> CurlImpl::post_stream(
+    const HTTPClient::URL &url, HeadersSetter set_headers,
+    std::shared_ptr<const BufferChain> body, ResponseHandler on_response,
+    ErrorHandler on_error, std::chrono::steady_clock::time_point deadline) {
+  auto request = std::make_unique<Request>();
+  request->streamed = true;
+  request->request_stream = std::move(body);
+  return start(url, std::move(set_headers), std::move(request),
+               std::move(on_response), std::move(on_error), deadline);
+}
+
+Expected<void> CurlImpl::start(
+    const HTTPClient::URL &url, HeadersSetter set_headers,
+    std::unique_ptr<Request> request, ResponseHandler on_response,
+    ErrorHandler on_error,
     std::chrono::steady_clock::time_point deadline) try {
   if (multi_handle_ == nullptr) {
     return Error{Error::CURL_HTTP_CLIENT_NOT_RUNNING,
@@ -337,40 +478,53 @@ Expected<void> CurlImpl::post(
                  "failed to start."};
   }
 
-  HeaderWriter writer{curl_};
+  HeaderWriter writer;
   set_headers(writer);
-  auto cleanup_list = [&](auto list) { curl_.slist_free_all(list); };
-  std::unique_ptr<curl_slist, decltype(cleanup_list)> headers{
-      writer.release(), std::move(cleanup_list)};
-
-  auto request = std::make_unique<Request>();
+  if (request->streamed) {
+    // libcurl would otherwise send "Expect: 100-continue" for a large body of
+    // known size that isn't in `CURLOPT_POSTFIELDS`, and then wait for the
+    // server's interim response before sending the body.
+    writer.set_constant("Expect", "");
+  }
+  set_header_list(*request, writer);
 
-  request->curl = &curl_;
-  request->request_headers = headers.get();
-  request->request_body = std::move(body);
   request->on_response = std::move(on_response);
   request->on_error = std::move(on_error);
   request->deadline = std::move(deadline);
 
-  auto cleanup_handle = [&](auto handle) { curl_.easy_cleanup(handle); };
+  auto cleanup_handle = [&](auto handle) { release_handle(handle); };
   std::unique_ptr<CURL, decltype(cleanup_handle)> handle{
-      curl_.easy_init(), std::move(cleanup_handle)};
+      acquire_handle(), std::move(cleanup_handle)};
 
   if (!handle) {
     return Error{Error::CURL_REQUEST_SETUP_FAILED,
                  "unable to initialize a curl handle for request sending"};
   }
 
-  throw_on_error(
-      curl_.easy_setopt_httpheader(handle.get(), request->request_headers));
+  throw_on_error(curl_.easy_setopt_httpheader(
+      handle.get(), request->header_nodes.empty()
+                        ? nullptr
+                        : request->header_nodes.data()));
   throw_on_error(curl_.easy_setopt_private(handle.get(), request.get()));
   throw_on_error(
       curl_.easy_setopt_errorbuffer(handle.get(), request->error_buffer));
   throw_on_error(curl_.easy_setopt_post(handle.get(), 1));
-  throw_on_error(curl_.easy_setopt_postfieldsize(handle.get(),
-                                                 request->request_body.size()));
-  throw_on_error(
-      curl_.easy_setopt_postfields(handle.get(), request->request_body.data()));
+  if (request->streamed) {
+    throw_on_error(curl_.easy_setopt_postfieldsize(
+        handle.get(), request->request_stream->size()));
+    throw_on_error(
+        curl_.easy_setopt_readfunction(handle.get(), &on_send_body));
+    throw_on_error(curl_.easy_setopt_readdata(handle.get(), request.get()));
+    // libcurl rewinds the body if it has to send the request again, e.g. when
+    // a reused connection turns out to have been closed by the server.
+    throw_on_error(curl_.easy_setopt_seekfunction(handle.get(), &on_seek_body));
+    throw_on_error(curl_.easy_setopt_seekdata(handle.get(), request.get()));
+  } else {
+    throw_on_error(curl_.easy_setopt_postfieldsize(
+        handle.get(), request->request_body.size()));
+    throw_on_error(curl_.easy_setopt_postfields(handle.get(),
+                                                request->request_body.data()));
+  }
   throw_on_error(
       curl_.easy_setopt_headerfunction(handle.get(), &on_read_header));
   throw_on_error(curl_.easy_setopt_headerdata(handle.get(), request.get()));
@@ -395,7 +549,6 @@ Expected<void> CurlImpl::post(
     std::lock_guard<std::mutex> lock(mutex_);
     new_handles_.splice(new_handles_.end(), node);
 
-    (void)headers.release();
     (void)handle.release();
     (void)request.release();
   }
@@ -407,6 +560,69 @@ Expected<void> CurlImpl::post(
   return Error{Error::CURL_REQUEST_SETUP_FAILED, curl_.easy_strerror(error)};
 }
 
+void CurlImpl::set_header_list(Request &request, const HeaderWriter &writer) {
+  const std::string &lines = writer.lines();
+  // Reserve enough that `header_storage` is never reallocated, since nodes
+  // refer to its contents.
+  request.header_storage.reserve(lines.size());
+  std::lock_guard<std::mutex> lock(pool_mutex_);
+  std::size_t index = 0;
+  for (std::size_t begin = 0; begin < lines.size(); ++index) {
+    const std::size_t end = lines.find('\0', begin);
+    const StringView line{lines.data() + begin, end - begin};
+    begin = end + 1;
+
+    const char *data;
+    const auto found = writer.constants()[index] ? header_lines_.find(line)
+                                                 : header_lines_.end();
+    if (found != header_lines_.end()) {
+      data = found->data();
+    } else if (writer.constants()[index] &&
+               header_lines_.size() < max_header_lines) {
+      const std::string &stored = header_line_storage_.emplace_back(line);
+      header_lines_.insert(stored);
+      data = stored.c_str();
+    } else {
+      data = request.header_storage.data() + request.header_storage.size();
+      request.header_storage.append(line.data(), line.size());
+      request.header_storage += '\0';
+    }
+    // libcurl doesn't modify the header list.
+    request.header_nodes.push_back(
+        curl_slist{const_cast<char *>(data), nullptr});
+  }
+
+  for (std::size_t i = 1; i < request.header_nodes.size(); ++i) {
+    request.header_nodes[i - 1].next = &request.header_nodes[i];
+  }
+}
+
+CURL *CurlImpl::acquire_handle() {
+  {
+    std::lock_guard<std::mutex> lock(pool_mutex_);
+    if (!idle_handles_.empty()) {
+      CURL *const handle = idle_handles_.back();
+      idle_handles_.pop_back();
+      return handle;
+    }
+  }
+  return curl_.easy_init();
+}
+
+void CurlImpl::release_handle(CURL *handle) {
+  // Resetting a handle clears its options, but keeps its caches, e.g. of DNS
+  // lookups.
+  curl_.easy_reset(handle);
+  {
+    std::lock_guard<std::mutex> lock(pool_mutex_);
+    if (idle_handles_.size() < max_idle_handles) {
+      idle_handles_.push_back(handle);
+      return;
+    }
+  }
+  curl_.easy_cleanup(handle);
+}
+
 void CurlImpl::drain(std::chrono::steady_clock::time_point deadline) {
   std::unique_lock<std::mutex> lock(mutex_);
   no_requests_.wait_until(lock, deadline, [this]() {
@@ -417,36 +633,13 @@ void CurlImpl::drain(std::chrono::steady_clock::time_point deadline) {
 std::size_t CurlImpl::on_read_header(char *data, std::size_t,
                                      std::size_t length, void *user_data) {
   const auto request = static_cast<Request *>(user_data);
-  // The idea is:
-  //
-  //         "    Foo-Bar  :   thingy, thingy, thing   \r\n"
-  //    -> {"foo-bar", "thingy, thingy, thing"}
-  //
-  // There isn't always a colon.  Inputs without a colon can be ignored:
-  //
-  // > For an HTTP transfer, the status line and the blank line preceding the
-  // > response body are both included as headers and passed to this
-  // > function.
-  //
-  // https://curl.se/libcurl/c/CURLOPT_HEADERFUNCTION.html
-  //
-
-  const char *const begin = data;
-  const char *const end = begin + length;
-  const char *const colon = std::find(begin, end, ':');
-  if (colon == end) {
-    return length;
+  // Keep the line as is.  `HeaderReader` parses it if it's looked up.  libcurl
+  // passes one line per call, but the line might not end with "\n", e.g. in
+  // unit tests, so add one to be sure.
+  request->response_headers.append(data, length);
+  if (length == 0 || data[length - 1] != '\n') {
+    request->response_headers += '\n';
   }
-
-  const auto key = strip(range(begin, colon));
-  const auto value = strip(range(colon + 1, end));
-
-  std::string key_lower;
-  key_lower.reserve(key.size());
-  std::transform(key.begin(), key.end(), std::back_inserter(key_lower),
-                 &to_lower);
-
-  request->response_headers_lower.emplace(std::move(key_lower), value);
   return length;
 }
 
@@ -461,6 +654,23 @@ std::size_t CurlImpl::on_read_body(char *data, std::size_t, std::size_t length,
   return length;
 }
 
+std::size_t CurlImpl::on_send_body(char *data, std::size_t size,
+                                   std::size_t count, void *user_data) {
+  const auto request = static_cast<Request *>(user_data);
+  return request->request_stream->read(request->request_stream_position, data,
+                                       size * count);
+}
+
+int CurlImpl::on_seek_body(void *user_data, curl_off_t offset, int origin) {
+  const auto request = static_cast<Request *>(user_data);
+  if (origin != SEEK_SET || offset < 0 ||
+      !request->request_stream->seek(request->request_stream_position,
+                                     static_cast<std::size_t>(offset))) {
+    return CURL_SEEKFUNC_CANTSEEK;
+  }
+  return CURL_SEEKFUNC_OK;
+}
+
 CURLcode CurlImpl::log_on_error(CURLcode result) {
   if (result != CURLE_OK) {
     logger_->log_error(
@@ -526,8 +736,8 @@ void CurlImpl::run() {
             Error{Error::CURL_DEADLINE_EXCEEDED_BEFORE_REQUEST_START,
                   std::move(message)});
 
-        curl_.easy_cleanup(handle);
         delete request;
+        release_handle(handle);
 
         continue;
       }
@@ -583,8 +793,10 @@ void CurlImpl::handle_message(const CURLMsg &message,
     error_message += "): ";
     error_message += request.error_buffer;
     lock.unlock();
-    request.on_error(
-        Error{Error::CURL_REQUEST_FAILURE, std::move(error_message)});
+    request.on_error(Error{result == CURLE_OPERATION_TIMEDOUT
+                               ? Error::CURL_REQUEST_TIMEOUT
+                               : Error::CURL_REQUEST_FAILURE,
+                           std::move(error_message)});
     lock.lock();
   } else {
     long status;
@@ -592,7 +804,12 @@ void CurlImpl::handle_message(const CURLMsg &message,
                                                       &status)) != CURLE_OK) {
       status = -1;
     }
-    HeaderReader reader(&request.response_headers_lower);
+    long num_connects;
+    if (curl_.easy_getinfo_num_connects(request_handle, &num_connects) ==
+        CURLE_OK) {
+      ++(num_connects == 0 ? reused_connections_ : new_connections_);
+    }
+    HeaderReader reader(&request.response_headers);
     lock.unlock();
     request.on_response(static_cast<int>(status), reader,
                         std::move(request.response_body));
@@ -600,54 +817,103 @@ void CurlImpl::handle_message(const CURLMsg &message,
   }
 
   log_on_error(curl_.multi_remove_handle(multi_handle_, request_handle));
-  curl_.easy_cleanup(request_handle);
   request_handles_.erase(request_handle);
   delete &request;
+  release_handle(request_handle);
 }
 
-CurlImpl::Request::~Request() { curl->slist_free_all(request_headers); }
+HTTPClient::ConnectionStats CurlImpl::connection_stats() const {
+  HTTPClient::ConnectionStats stats;
+  stats.new_connections = new_connections_.load(std::memory_order_relaxed);
+  stats.reused_connections =
+      reused_connections_.load(std::memory_order_relaxed);
+  return stats;
+}
 
-CurlImpl::HeaderWriter::HeaderWriter(CurlLibrary &curl) : curl_(curl) {}
+std::size_t CurlImpl::Hash::operator()(StringView text) const {
+  return static_cast<std::size_t>(fnv1a_hash(text));
+}
 
-CurlImpl::HeaderWriter::~HeaderWriter() { curl_.slist_free_all(list_); }
+const std::string &CurlImpl::HeaderWriter::lines() const { return lines_; }
 
-curl_slist *CurlImpl::HeaderWriter::release() {
-  auto list = list_;
-  list_ = nullptr;
-  return list;
+const std::vector<bool> &CurlImpl::HeaderWriter::constants() const {
+  return constants_;
 }
 
 void CurlImpl::HeaderWriter::set(StringView key, StringView value) {
-  buffer_.clear();
-  buffer_ += key;
-  buffer_ += ": ";
-  buffer_ += value;
-
-  list_ = curl_.slist_append(list_, buffer_.c_str());
+  lines_ += key;
+  lines_ += ": ";
+  lines_ += value;
+  lines_ += '\0';
+  constants_.push_back(false);
 }
 
-CurlImpl::HeaderReader::HeaderReader(
-    std::unordered_map<std::string, std::string> *response_headers_lower)
-    : response_headers_lower_(response_headers_lower) {}
+void CurlImpl::HeaderWriter::set_constant(StringView key, StringView value) {
+  set(key, value);
+  constants_.back() = true;
+}
 
-Optional<StringView> CurlImpl::HeaderReader::lookup(StringView key) const {
-  buffer_.clear();
-  std::transform(key.begin(), key.end(), std::back_inserter(buffer_),
-                 &to_lower);
+CurlImpl::HeaderReader::HeaderReader(const std::string *response_headers)
+    : response_headers_(response_headers) {}
 
-  const auto found = response_headers_lower_->find(buffer_);
-  if (found == response_headers_lower_->end()) {
-    return nullopt;
+template <typename Visitor>
+void CurlImpl::HeaderReader::scan(Visitor &&visitor) const {
+  // The idea is:
+  //
+  //         "    Foo-Bar  :   thingy, thingy, thing   \r\n"
+  //    -> {"Foo-Bar", "thingy, thingy, thing"}
+  //
+  // There isn't always a colon.  Lines without a colon can be ignored:
+  //
+  // > For an HTTP transfer, the status line and the blank line preceding the
+  // > response body are both included as headers and passed to this
+  // > function.
+  //
+  // https://curl.se/libcurl/c/CURLOPT_HEADERFUNCTION.html
+  //
+  const char *begin = response_headers_->data();
+  const char *const end = begin + response_headers_->size();
+  while (begin != end) {
+    const char *const line_end = std::find(begin, end, '\n');
+    const char *const colon = std::find(begin, line_end, ':');
+    if (colon != line_end && visitor(strip(range(begin, colon)),
+                                     strip(range(colon + 1, line_end)))) {
+      return;
+    }
+    begin = line_end == end ? end : line_end + 1;
   }
-  return found->second;
+}
+
+Optional<StringView> CurlImpl::HeaderReader::lookup(StringView key) const {
+  Optional<StringView> result;
+  scan([&](StringView line_key, StringView value) {
+    if (line_key.size() != key.size() ||
+        !std::equal(line_key.begin(), line_key.end(), key.begin(),
+                    [](unsigned char left, unsigned char right) {
+                      return to_lower(left) == to_lower(right);
+                    })) {
+      return false;
+    }
+    result = value;
+    return true;
+  });
+  return result;
 }
 
 void CurlImpl::HeaderReader::visit(
     const std::function<void(StringView key, StringView value)> &visitor)
     const {
-  for (const auto &[key, value] : *response_headers_lower_) {
-    visitor(key, value);
-  }
+  // Visit each key once, in lower case, with its first value.
+  std::unordered_set<std::string> visited;
+  scan([&](StringView key, StringView value) {
+    buffer_.clear();
+    std::transform(key.begin(), key.end(), std::back_inserter(buffer_),
+                   &to_lower);
+    if (visited.insert(buffer_).second) {
+      visitor(buffer_, value);
+    }
+    return false;
+  });
 }
 
 }  // namespace tracing
@@ -4,6 +4,12 @@
 // interface in terms of [libcurl][1].  `class Curl` manages a thread that is
 // used as the event loop for libcurl.
 //
+// `Curl` keeps the easy handles of finished requests, reset, in a pool from
+// which later requests take theirs.  Request header lines that repeat across
+// requests, such as those that `DatadogAgent` sends with every payload, are
+// kept by `Curl` and shared by the requests' header lists.  Response headers
+// are kept as received, and parsed only when looked up.
+//
 // If this library was built in a mode that does not include libcurl, then this
 // file and its implementation, `curl.cpp`, will not be included.
 //
@@ -41,13 +47,18 @@ class CurlLibrary {
                                   void *userdata);
   typedef size_t (*HeaderCallback)(char *buffer, size_t size, size_t nitems,
                                    void *userdata);
+  typedef size_t (*ReadCallback)(char *buffer, size_t size, size_t nitems,
+                                 void *userdata);
+  typedef int (*SeekCallback)(void *userdata, curl_off_t offset, int origin);
 
   virtual ~CurlLibrary() = default;
 
   virtual void easy_cleanup(CURL *handle);
   virtual CURL *easy_init();
+  virtual CURLcode easy_getinfo_num_connects(CURL *curl, long *count);
   virtual CURLcode easy_getinfo_private(CURL *curl, char **user_data);
   virtual CURLcode easy_getinfo_response_code(CURL *curl, long *code);
+  virtual void easy_reset(CURL *handle);
   virtual CURLcode easy_setopt_errorbuffer(CURL *handle, char *buffer);
   virtual CURLcode easy_setopt_headerdata(CURL *handle, void *data);
   virtual CURLcode easy_setopt_headerfunction(CURL *handle, HeaderCallback);
@@ -56,6 +67,10 @@ class CurlLibrary {
   virtual CURLcode easy_setopt_postfields(CURL *handle, const char *data);
   virtual CURLcode easy_setopt_postfieldsize(CURL *handle, long size);
   virtual CURLcode easy_setopt_private(CURL *handle, void *pointer);
+  virtual CURLcode easy_setopt_readdata(CURL *handle, void *data);
+  virtual CURLcode easy_setopt_readfunction(CURL *handle, ReadCallback);
+  virtual CURLcode easy_setopt_seekdata(CURL *handle, void *data);
+  virtual CURLcode easy_setopt_seekfunction(CURL *handle, SeekCallback);
   virtual CURLcode easy_setopt_unix_socket_path(CURL *handle, const char *path);
   virtual CURLcode easy_setopt_url(CURL *handle, const char *url);
   virtual CURLcode easy_setopt_writedata(CURL *handle, void *data);
@@ -101,8 +116,20 @@ class Curl : public HTTPClient {
                       ErrorHandler on_error,
                       std::chrono::steady_clock::time_point deadline) override;
 
+  // Send the segments of `body` from a libcurl read callback, so that they are
+  // never concatenated.
+  Expected<void> post_stream(
+      const URL &url, HeadersSetter set_headers,
+      std::shared_ptr<const BufferChain> body, ResponseHandler on_response,
+      ErrorHandler on_error,
+      std::chrono::steady_clock::time_point deadline) override;
+
   void drain(std::chrono::steady_clock::time_point deadline) override;
 
+  // Count each successful request as sent on a new connection if libcurl had
+  // to open one for it, and as sent on a reused connection otherwise.
+  ConnectionStats connection_stats() const override;
+
   nlohmann::json config_json() const override;
 };
 
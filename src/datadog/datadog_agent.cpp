@@ -1,21 +1,29 @@
 #include "datadog_agent.h"
 
+#include <algorithm>
 #include <cassert>
 #include <chrono>
+#include <iterator>
 #include <string>
 #include <typeinfo>
 #include <unordered_map>
 #include <unordered_set>
 
+#include "buffer_chain.h"
 #include "collector_response.h"
 #include "datadog_agent_config.h"
 #include "dict_writer.h"
+#include "encoder_pool.h"
 #include "http_client.h"
 #include "json.hpp"
 #include "logger.h"
 #include "msgpack.h"
+#include "shared_memory_ring.h"
 #include "span_data.h"
+#include "spool.h"
+#include "string_table.h"
 #include "string_view.h"
+#include "tags.h"
 #include "trace_sampler.h"
 #include "tracer.h"
 #include "version.h"
@@ -25,19 +33,36 @@ namespace tracing {
 namespace {
 
 constexpr StringView traces_api_path = "/v0.4/traces";
+constexpr StringView traces_v05_api_path = "/v0.5/traces";
+constexpr StringView stats_api_path = "/v0.6/stats";
 constexpr StringView telemetry_v2_path = "/telemetry/proxy/api/v2/apmtelemetry";
 constexpr StringView remote_configuration_path = "/v0.7/config";
 
+// `cplusplus_version` is the value of the "Datadog-Meta-Lang-Version" header
+// sent with traces, formatted once rather than for every request.
+const std::string cplusplus_version = std::to_string(__cplusplus);
+
 void set_content_type_json(DictWriter& headers) {
-  headers.set("Content-Type", "application/json");
+  headers.set_constant("Content-Type", "application/json");
 }
 
-HTTPClient::URL traces_endpoint(const HTTPClient::URL& agent_url) {
+HTTPClient::URL traces_endpoint(const HTTPClient::URL& agent_url,
+                                StringView path) {
   auto traces_url = agent_url;
-  append(traces_url.path, traces_api_path);
+  append(traces_url.path, path);
   return traces_url;
 }
 
+StringView to_string(TracesAPIVersion version) {
+  switch (version) {
+    case TracesAPIVersion::V0_4:
+      return "v0.4";
+    case TracesAPIVersion::V0_5:
+      return "v0.5";
+  }
+  return "";
+}
+
 HTTPClient::URL telemetry_endpoint(const HTTPClient::URL& agent_url) {
   auto telemetry_v2_url = agent_url;
   append(telemetry_v2_url.path, telemetry_v2_path);
@@ -51,13 +76,126 @@ HTTPClient::URL remote_configuration_endpoint(
   return remote_configuration;
 }
 
+// Append the specified `payload` to the specified `spool`, and log any trace
+// chunks that are thereby discarded using the specified `logger`.
+void spool_payload(Spool& spool, Logger& logger,
+                   const ResendBuffer::Payload& payload) {
+  auto result =
+      spool.append(*payload.body, payload.num_chunks, payload.version);
+  if (auto* error = result.if_error()) {
+    logger.log_error(error->with_prefix("Unable to spool traces: "));
+    return;
+  }
+  if (*result != 0) {
+    logger.log_error([&](auto& stream) {
+      stream << "Discarded " << *result << " trace chunks from the spool "
+             << spool.path() << ", because it is full.";
+    });
+  }
+}
+
+using TraceChunkIterator =
+    std::vector<DatadogAgent::TraceChunk>::const_iterator;
+
+// Append the MessagePack encoding of each trace chunk in the specified range
+// `[begin, end)` to the specified `destination`, and store the size of each
+// chunk's encoding in the corresponding element of the specified `sizes`.
+// Each trace chunk is appended to a segment of `destination` that has room for
+// the chunk's exact encoded size, so a chunk is never split across segments,
+// and no segment is reallocated.  Note that the enclosing array header is not
+// encoded.
+Expected<void> msgpack_encode(BufferChain& destination,
+                              TraceChunkIterator begin, TraceChunkIterator end,
+                              std::size_t* sizes) {
+  Expected<void> result;
+  for (auto chunk = begin; chunk != end; ++chunk) {
+    const std::size_t size = msgpack_encoded_size(chunk->spans);
+    std::string& segment = destination.writable_segment(size);
+    [[maybe_unused]] const std::size_t before = segment.size();
+    result = msgpack_encode(segment, chunk->spans);
+    if (!result) {
+      break;
+    }
+    assert(segment.size() - before == size);
+    *sizes++ = size;
+  }
+  return result;
+}
+
+// A flush encodes trace chunks in parallel only if there are at least this many
+// trace chunks for each thread.  Otherwise, waking the worker threads costs
+// more than it saves.
+constexpr std::size_t min_chunks_per_encoder = 8;
+
+// Append the MessagePack encoding of each of the specified `trace_chunks` to
+// the specified `destination`, and store their sizes in the specified
+// `sizes`, as above.  If the specified `pool` is not null and there are enough
+// trace chunks, then divide them into contiguous ranges, encode the ranges in
+// parallel using `pool`, and then append the encoded ranges in order.
 Expected<void> msgpack_encode(
-    std::string& destination,
-    const std::vector<DatadogAgent::TraceChunk>& trace_chunks) {
-  return msgpack::pack_array(destination, trace_chunks,
-                             [](auto& destination, const auto& chunk) {
-                               return msgpack_encode(destination, chunk.spans);
-                             });
+    BufferChain& destination,
+    const std::vector<DatadogAgent::TraceChunk>& trace_chunks,
+    std::size_t* sizes, EncoderPool* pool) {
+  const std::size_t num_ranges =
+      pool ? std::min(pool->num_workers() + 1,
+                      trace_chunks.size() / min_chunks_per_encoder)
+           : 0;
+  if (num_ranges < 2) {
+    return msgpack_encode(destination, trace_chunks.begin(),
+                          trace_chunks.end(), sizes);
+  }
+
+  std::vector<BufferChain> encoded_ranges(num_ranges);
+  std::vector<Expected<void>> results(num_ranges);
+  pool->run(num_ranges, [&](std::size_t i) {
+    const std::size_t size = trace_chunks.size();
+    const std::size_t begin = i * size / num_ranges;
+    const std::size_t end = (i + 1) * size / num_ranges;
+    results[i] = msgpack_encode(encoded_ranges[i], trace_chunks.begin() + begin,
+                                trace_chunks.begin() + end, sizes + begin);
+  });
+
+  for (std::size_t i = 0; i < num_ranges; ++i) {
+    if (!results[i]) {
+      return results[i];
+    }
+    destination.append(std::move(encoded_ranges[i]));
+  }
+  return {};
+}
+
+// Append to the specified `destination` the version 0.5 MessagePack encoding
+// of each trace chunk in the specified range `[begin, end)`, adding strings to
+// the specified `strings`.  As above, the enclosing array header is not
+// encoded.
+Expected<void> msgpack_encode(BufferChain& destination,
+                              TraceChunkIterator begin, TraceChunkIterator end,
+                              StringTable& strings) {
+  Expected<void> result;
+  for (auto chunk = begin; chunk != end; ++chunk) {
+    result =
+        msgpack_encode(destination.writable_segment(), chunk->spans, strings);
+    if (!result) {
+      break;
+    }
+  }
+  return result;
+}
+
+// Return the number of elements at the beginning of the specified `sizes`
+// whose sum, plus the specified `overhead`, does not exceed the specified
+// `max_size`.  Return at least one, unless `sizes` is empty, so that an element
+// larger than `max_size` is sent by itself rather than never sent.
+std::size_t count_within(const std::size_t* sizes, std::size_t num_sizes,
+                         std::size_t overhead, std::size_t max_size) {
+  std::size_t total = overhead;
+  std::size_t count = 0;
+  while (count < num_sizes &&
+         (count == 0 || total + sizes[count] <= max_size)) {
+    total += sizes[count];
+    ++count;
+  }
+  return count;
 }
 
 std::variant<CollectorResponse, std::string> parse_agent_traces_response(
@@ -155,13 +293,57 @@ DatadogAgent::DatadogAgent(
     : tracer_telemetry_(tracer_telemetry),
       clock_(config.clock),
       logger_(logger),
-      traces_endpoint_(traces_endpoint(config.url)),
+      eager_encoding_(config.eager_encoding),
+      max_buffered_spans_(config.max_buffered_spans),
+      max_buffered_bytes_(config.max_buffered_bytes),
+      buffered_spans_(0),
+      buffered_bytes_(0),
+      collected_spans_(0),
+      collected_bytes_(0),
+      droppable_spans_(0),
+      droppable_bytes_(0),
+      early_flush_spans_(config.early_flush_spans),
+      early_flush_bytes_(config.early_flush_bytes),
+      early_flush_requested_(false),
+      adaptive_flush_interval_(config.adaptive_flush_interval),
+      current_flush_interval_(config.flush_interval),
+      min_flush_interval_(config.flush_interval / 4),
+      max_flush_interval_(config.flush_interval * 4),
+      max_payload_size_(config.max_payload_size),
+      max_retries_(config.max_retries),
+      retry_backoff_(config.retry_backoff),
+      resend_buffer_(
+          std::make_shared<ResendBuffer>(config.max_resend_buffer_size)),
+      spool_(config.spool_path.empty()
+                 ? nullptr
+                 : std::make_shared<Spool>(config.spool_path,
+                                           config.max_spool_size)),
+      agent_available_(std::make_shared<std::atomic<bool>>(true)),
+      shared_memory_ring_(config.shared_memory_ring),
+      shared_memory_ring_claim_failed_(false),
+      shared_memory_ring_dropped_chunks_(0),
+      encoder_pool_(config.encoder_threads > 1
+                        ? std::make_unique<EncoderPool>(
+                              config.encoder_threads - 1)
+                        : nullptr),
+      traces_endpoint_(traces_endpoint(config.url, traces_api_path)),
+      traces_v05_endpoint_(traces_endpoint(config.url, traces_v05_api_path)),
+      traces_api_version_(std::make_shared<std::atomic<TracesAPIVersion>>(
+          config.traces_api_version)),
+      stats_concentrator_(
+          config.stats_computation_enabled
+              ? std::make_unique<StatsConcentrator>(tracer_signature)
+              : nullptr),
+      stats_endpoint_(traces_endpoint(config.url, stats_api_path)),
       telemetry_endpoint_(telemetry_endpoint(config.url)),
       remote_configuration_endpoint_(remote_configuration_endpoint(config.url)),
       http_client_(config.http_client),
       event_scheduler_(config.event_scheduler),
-      cancel_scheduled_flush_(event_scheduler_->schedule_recurring_event(
-          config.flush_interval, [this]() { flush(); })),
+      scheduled_flush_(event_scheduler_->schedule_adjustable_event(
+          config.flush_interval, [this]() {
+            flush();
+            replay_spool();
+          })),
       flush_interval_(config.flush_interval),
       request_timeout_(config.request_timeout),
       shutdown_timeout_(config.shutdown_timeout),
@@ -197,6 +379,7 @@ DatadogAgent::DatadogAgent(
     cancel_telemetry_timer_ = event_scheduler_->schedule_recurring_event(
         std::chrono::seconds(10), [this, n = 0]() mutable {
           n++;
+          count_connections();
           tracer_telemetry_->capture_metrics();
           if (n % 6 == 0) {
             send_heartbeat_and_telemetry();
@@ -204,6 +387,11 @@ DatadogAgent::DatadogAgent(
         });
   }
 
+  if (stats_concentrator_) {
+    cancel_stats_timer_ = event_scheduler_->schedule_recurring_event(
+        StatsConcentrator::bucket_duration, [this]() { flush_stats(false); });
+  }
+
   cancel_remote_configuration_task_ =
       event_scheduler_->schedule_recurring_event(
           config.remote_configuration_poll_interval,
@@ -212,12 +400,22 @@ DatadogAgent::DatadogAgent(
 
 DatadogAgent::~DatadogAgent() {
   const auto deadline = clock_().tick + shutdown_timeout_;
-  cancel_scheduled_flush_();
+  scheduled_flush_.cancel();
   flush();
+  // This is the last chance to send requests that are awaiting retry, so
+  // don't wait for their backoff to elapse.
+  for (auto& payload : resend_buffer_->take_all()) {
+    send_traces(std::move(payload));
+  }
+  if (stats_concentrator_) {
+    cancel_stats_timer_();
+    flush_stats(true);
+  }
   cancel_remote_configuration_task_();
   if (tracer_telemetry_->enabled()) {
     // This action only needs to occur if tracer telemetry is enabled.
     cancel_telemetry_timer_();
+    count_connections();
     tracer_telemetry_->capture_metrics();
     // The app-closing message is bundled with a message containing the
     // final metric values.
@@ -229,22 +427,215 @@ DatadogAgent::~DatadogAgent() {
 Expected<void> DatadogAgent::send(
     std::vector<std::unique_ptr<SpanData>>&& spans,
     const std::shared_ptr<TraceSampler>& response_handler) {
-  std::lock_guard<std::mutex> lock(mutex_);
-  trace_chunks_.push_back(TraceChunk{std::move(spans), response_handler});
+  if (stats_concentrator_) {
+    stats_concentrator_->add(spans);
+  }
+  PendingChunk chunk;
+  chunk.num_spans = spans.size();
+  chunk.size = msgpack_encoded_size(spans);
+  chunk.keep = is_kept(spans);
+  chunk.response_handler = response_handler;
+  if (eager_encoding_ && traces_api_version_->load(std::memory_order_relaxed) ==
+                             TracesAPIVersion::V0_4) {
+    chunk.encoded.reserve(chunk.size);
+    auto result = msgpack_encode(chunk.encoded, spans);
+    if (!result) {
+      return result;
+    }
+    // The spans are no longer needed.
+    spans.clear();
+  } else {
+    chunk.spans = std::move(spans);
+  }
+  enqueue(std::move(chunk));
   return nullopt;
 }
 
+void DatadogAgent::enqueue(PendingChunk&& chunk) {
+  // Usually there's room in the buffer, and the chunk is queued without
+  // locking `mutex_`.
+  const std::size_t num_spans = chunk.num_spans;
+  const std::size_t size = chunk.size;
+  const std::size_t spans_after =
+      buffered_spans_.fetch_add(num_spans, std::memory_order_relaxed) +
+      num_spans;
+  const std::size_t bytes_after =
+      buffered_bytes_.fetch_add(size, std::memory_order_relaxed) + size;
+  if (spans_after <= max_buffered_spans_ &&
+      bytes_after <= max_buffered_bytes_) {
+    pending_chunks_.push(std::move(chunk));
+    maybe_flush_early(spans_after, bytes_after);
+    return;
+  }
+  buffered_spans_.fetch_sub(num_spans, std::memory_order_relaxed);
+  buffered_bytes_.fetch_sub(size, std::memory_order_relaxed);
+
+  // Otherwise, evicting buffered chunks might make room.  Spans evicted from
+  // the buffer are freed after `mutex_` is unlocked.
+  std::vector<std::unique_ptr<SpanData>> evicted;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    collect_pending_chunks();
+    if (!make_room(num_spans, size, chunk.keep, evicted)) {
+      count_dropped(1, num_spans);
+      return;
+    }
+    // Other threads reserve room without locking `mutex_`, so the room made
+    // by `make_room` might already be taken.
+    const std::size_t spans_reserved =
+        buffered_spans_.fetch_add(num_spans, std::memory_order_relaxed) +
+        num_spans;
+    const std::size_t bytes_reserved =
+        buffered_bytes_.fetch_add(size, std::memory_order_relaxed) + size;
+    if (spans_reserved > max_buffered_spans_ ||
+        bytes_reserved > max_buffered_bytes_) {
+      buffered_spans_.fetch_sub(num_spans, std::memory_order_relaxed);
+      buffered_bytes_.fetch_sub(size, std::memory_order_relaxed);
+      count_dropped(1, num_spans);
+      return;
+    }
+    collect(std::move(chunk));
+  }
+  maybe_flush_early(buffered_spans_.load(std::memory_order_relaxed),
+                    buffered_bytes_.load(std::memory_order_relaxed));
+}
+
+void DatadogAgent::collect_pending_chunks() {
+  pending_chunks_.pop_all(
+      [this](PendingChunk&& chunk) { collect(std::move(chunk)); });
+}
+
+void DatadogAgent::collect(PendingChunk&& chunk) {
+  const bool encoded = !chunk.encoded.empty();
+  const std::size_t index =
+      encoded ? encoded_chunk_info_.size() : trace_chunks_.size();
+  if (!chunk.keep) {
+    droppable_chunks_.push_back(
+        DroppableChunk{encoded, index, chunk.num_spans, chunk.size});
+    droppable_spans_ += chunk.num_spans;
+    droppable_bytes_ += chunk.size;
+  }
+  collected_spans_ += chunk.num_spans;
+  collected_bytes_ += chunk.size;
+  if (encoded) {
+    // The encoding becomes a segment of its own, so that it isn't copied
+    // while `mutex_` is locked.
+    encoded_chunks_.append_segment(std::move(chunk.encoded));
+    encoded_chunk_info_.push_back(EncodedChunk{chunk.size, false});
+    encoded_response_handlers_.insert(std::move(chunk.response_handler));
+  } else {
+    trace_chunks_.push_back(
+        TraceChunk{std::move(chunk.spans), std::move(chunk.response_handler)});
+  }
+}
+
+void DatadogAgent::maybe_flush_early(std::size_t num_spans,
+                                     std::size_t num_bytes) {
+  if ((num_spans >= early_flush_spans_ || num_bytes >= early_flush_bytes_) &&
+      !early_flush_requested_.load(std::memory_order_relaxed) &&
+      !early_flush_requested_.exchange(true, std::memory_order_relaxed) &&
+      scheduled_flush_.trigger) {
+    scheduled_flush_.trigger();
+  }
+}
+
+bool DatadogAgent::make_room(std::size_t num_spans, std::size_t size,
+                             bool keep,
+                             std::vector<std::unique_ptr<SpanData>>& evicted) {
+  // Chunks being queued by other threads count against the limits, but can't
+  // be evicted until they're collected.
+  const auto fits = [&]() {
+    return buffered_spans_.load(std::memory_order_relaxed) + num_spans <=
+               max_buffered_spans_ &&
+           buffered_bytes_.load(std::memory_order_relaxed) + size <=
+               max_buffered_bytes_;
+  };
+  if (fits()) {
+    return true;
+  }
+  // Evict nothing unless evicting every droppable chunk would make enough
+  // room.
+  if (!keep ||
+      buffered_spans_.load(std::memory_order_relaxed) - droppable_spans_ +
+              num_spans >
+          max_buffered_spans_ ||
+      buffered_bytes_.load(std::memory_order_relaxed) - droppable_bytes_ +
+              size >
+          max_buffered_bytes_) {
+    return false;
+  }
+
+  std::size_t num_evicted_chunks = 0;
+  std::size_t num_evicted_spans = 0;
+  bool made_room = true;
+  while (!fits()) {
+    // Room reserved concurrently by other threads, without locking `mutex_`,
+    // can exceed what evicting every droppable chunk frees.
+    if (droppable_chunks_.empty()) {
+      made_room = false;
+      break;
+    }
+    const DroppableChunk chunk = droppable_chunks_.front();
+    droppable_chunks_.pop_front();
+    if (chunk.encoded) {
+      encoded_chunk_info_[chunk.index].evicted = true;
+    } else {
+      // `flush` skips trace chunks that have no spans.
+      auto& spans = trace_chunks_[chunk.index].spans;
+      std::move(spans.begin(), spans.end(), std::back_inserter(evicted));
+      spans.clear();
+    }
+    droppable_spans_ -= chunk.num_spans;
+    droppable_bytes_ -= chunk.size;
+    buffered_spans_.fetch_sub(chunk.num_spans, std::memory_order_relaxed);
+    buffered_bytes_.fetch_sub(chunk.size, std::memory_order_relaxed);
+    collected_spans_ -= chunk.num_spans;
+    collected_bytes_ -= chunk.size;
+    ++num_evicted_chunks;
+    num_evicted_spans += chunk.num_spans;
+  }
+  count_dropped(num_evicted_chunks, num_evicted_spans);
+  return made_room;
+}
+
+void DatadogAgent::count_dropped(std::size_t num_chunks,
+                                 std::size_t num_spans) {
+  auto& metrics = tracer_telemetry_->metrics().tracer;
+  metrics.trace_chunks_dropped.add(num_chunks);
+  metrics.spans_dropped.add(num_spans);
+}
+
 nlohmann::json DatadogAgent::config_json() const {
+  const auto version = traces_api_version_->load(std::memory_order_relaxed);
+  const auto& traces_url = version == TracesAPIVersion::V0_5
+                               ? traces_v05_endpoint_
+                               : traces_endpoint_;
   // clang-format off
   return nlohmann::json::object({
     {"type", "datadog::tracing::DatadogAgent"},
     {"config", nlohmann::json::object({
-      {"traces_url", (traces_endpoint_.scheme + "://" + traces_endpoint_.authority + traces_endpoint_.path)},
+      {"traces_url", (traces_url.scheme + "://" + traces_url.authority + traces_url.path)},
+      {"traces_api_version", std::string(to_string(version))},
       {"telemetry_url", (telemetry_endpoint_.scheme + "://" + telemetry_endpoint_.authority + telemetry_endpoint_.path)},
       {"remote_configuration_url", (remote_configuration_endpoint_.scheme + "://" + remote_configuration_endpoint_.authority + remote_configuration_endpoint_.path)},
       {"flush_interval_milliseconds", std::chrono::duration_cast<std::chrono::milliseconds>(flush_interval_).count() },
       {"request_timeout_milliseconds", std::chrono::duration_cast<std::chrono::milliseconds>(request_timeout_).count() },
       {"shutdown_timeout_milliseconds", std::chrono::duration_cast<std::chrono::milliseconds>(shutdown_timeout_).count() },
+      {"eager_encoding", eager_encoding_},
+      {"max_payload_size_bytes", max_payload_size_},
+      {"max_retries", max_retries_},
+      {"retry_backoff_milliseconds", std::chrono::duration_cast<std::chrono::milliseconds>(retry_backoff_).count()},
+      {"max_resend_buffer_bytes", resend_buffer_->max_size()},
+      {"spool_path", spool_ ? spool_->path() : ""},
+      {"max_spool_bytes", spool_ ? spool_->file_size() : 0},
+      {"stats_computation_enabled", stats_concentrator_ != nullptr},
+      {"shared_memory_ring_bytes", shared_memory_ring_ ? shared_memory_ring_->capacity() : 0},
+      {"max_buffered_spans", max_buffered_spans_},
+      {"max_buffered_bytes", max_buffered_bytes_},
+      {"early_flush_spans", early_flush_spans_},
+      {"early_flush_bytes", early_flush_bytes_},
+      {"adaptive_flush_interval", adaptive_flush_interval_},
+      {"encoder_threads", encoder_pool_ ? encoder_pool_->num_workers() + 1 : 1},
       {"http_client", http_client_->config_json()},
       {"event_scheduler", event_scheduler_->config_json()},
     })},
@@ -252,50 +643,336 @@ nlohmann::json DatadogAgent::config_json() const {
   // clang-format on
 }
 
+void DatadogAgent::drain_shared_memory_ring() {
+  auto claimed = shared_memory_ring_->claim_consumer();
+  if (auto* error = claimed.if_error()) {
+    // Log the error only once, rather than at every flush.
+    if (!shared_memory_ring_claim_failed_) {
+      shared_memory_ring_claim_failed_ = true;
+      logger_->log_error(error->with_prefix(
+          "Trace chunks from other processes will not be sent: "));
+    }
+    return;
+  }
+  shared_memory_ring_claim_failed_ = false;
+
+  shared_memory_ring_->pop_all(
+      [this](StringView encoded, std::size_t num_spans, bool keep) {
+        // Other processes encode trace chunks in version 0.4, which is the
+        // only version that the configuration allows together with a ring.
+        PendingChunk chunk;
+        chunk.encoded = std::string(encoded);
+        chunk.num_spans = num_spans;
+        chunk.size = encoded.size();
+        chunk.keep = keep;
+        enqueue(std::move(chunk));
+      });
+
+  // Other processes drop trace chunks when the ring is full.  Their spans
+  // were never counted, so only the chunks are.
+  const std::uint64_t dropped = shared_memory_ring_->dropped_chunks();
+  if (dropped != shared_memory_ring_dropped_chunks_) {
+    const std::uint64_t newly_dropped =
+        dropped - shared_memory_ring_dropped_chunks_;
+    shared_memory_ring_dropped_chunks_ = dropped;
+    count_dropped(std::size_t(newly_dropped), 0);
+    logger_->log_error([&](auto& stream) {
+      stream << "Other processes dropped " << newly_dropped
+             << " trace chunks, because the shared memory ring was full or "
+                "because a process exited while writing to it.";
+    });
+  }
+}
+
 void DatadogAgent::flush() {
+  if (shared_memory_ring_) {
+    drain_shared_memory_ring();
+  }
+
   std::vector<TraceChunk> trace_chunks;
+  // Trace chunks that were encoded by `send` are already in `body`, and their
+  // sizes are in `chunk_sizes`.
+  BufferChain body;
+  std::vector<EncodedChunk> encoded_chunk_info;
+  // One HTTP request to the Agent could possibly involve trace chunks from
+  // multiple tracers, and thus multiple trace samplers might need to have
+  // their rates updated. Unlikely, but possible.
+  std::unordered_set<std::shared_ptr<TraceSampler>> response_handlers;
+  TracesAPIVersion version;
+  std::size_t num_buffered_spans;
+  std::size_t num_buffered_bytes;
+  bool triggered_early;
   {
     std::lock_guard<std::mutex> lock(mutex_);
+    collect_pending_chunks();
     using std::swap;
     swap(trace_chunks, trace_chunks_);
+    swap(body, encoded_chunks_);
+    swap(encoded_chunk_info, encoded_chunk_info_);
+    swap(response_handlers, encoded_response_handlers_);
+    num_buffered_spans = collected_spans_;
+    num_buffered_bytes = collected_bytes_;
+    triggered_early =
+        early_flush_requested_.exchange(false, std::memory_order_relaxed);
+    // Chunks for which `send` has reserved room, but hasn't yet queued,
+    // remain counted.
+    buffered_spans_.fetch_sub(collected_spans_, std::memory_order_relaxed);
+    buffered_bytes_.fetch_sub(collected_bytes_, std::memory_order_relaxed);
+    droppable_chunks_.clear();
+    collected_spans_ = collected_bytes_ = droppable_spans_ = droppable_bytes_ =
+        0;
+    // `send` encodes eagerly only when the version is 0.4, and the version
+    // never changes from 0.4, so if `body` is not empty then this is 0.4.
+    version = traces_api_version_->load(std::memory_order_relaxed);
   }
 
-  if (trace_chunks.empty()) {
+  if (adaptive_flush_interval_) {
+    adapt_flush_interval(num_buffered_spans, num_buffered_bytes,
+                         triggered_early);
+  }
+
+  // Requests that failed earlier are sent again once their backoff elapses.
+  for (auto& payload : resend_buffer_->take_due(clock_().tick)) {
+    send_traces(std::move(payload));
+  }
+
+  // Trace chunks evicted from the buffer by `make_room` have no spans.
+  trace_chunks.erase(std::remove_if(trace_chunks.begin(), trace_chunks.end(),
+                                    [](const TraceChunk& chunk) {
+                                      return chunk.spans.empty();
+                                    }),
+                     trace_chunks.end());
+
+  // Remove the bytes of evicted encoded trace chunks from `body`, and collect
+  // the sizes of the remaining encoded chunks.
+  std::vector<std::size_t> chunk_sizes;
+  BufferChain encoded_body;
+  std::size_t kept_run = 0;
+  for (const auto& chunk : encoded_chunk_info) {
+    if (!chunk.evicted) {
+      kept_run += chunk.size;
+      chunk_sizes.push_back(chunk.size);
+      continue;
+    }
+    encoded_body.append(body.take_front(kept_run));
+    kept_run = 0;
+    body.take_front(chunk.size);
+  }
+  encoded_body.append(std::move(body));
+  body = std::move(encoded_body);
+
+  if (trace_chunks.empty() && chunk_sizes.empty()) {
     return;
   }
 
-  std::string body;
-  auto encode_result = msgpack_encode(body, trace_chunks);
+  for (auto& chunk : trace_chunks) {
+    response_handlers.insert(std::move(chunk.response_handler));
+  }
+  // Every request made by this flush shares the response handlers, since the
+  // Datadog Agent's sampling rates apply to all of them.
+  const auto samplers =
+      std::make_shared<const std::unordered_set<std::shared_ptr<TraceSampler>>>(
+          std::move(response_handlers));
+
+  // The payload is divided into requests whose bodies are each at most
+  // `max_payload_size_` bytes, except that a trace chunk larger than that is
+  // sent by itself.  The requests are made concurrently.
+  if (version == TracesAPIVersion::V0_5) {
+    // The size of a trace chunk's version 0.5 encoding isn't known until the
+    // chunk is encoded, so the version 0.4 size, which is typically larger,
+    // is used instead.
+    chunk_sizes.resize(trace_chunks.size());
+    for (std::size_t i = 0; i < trace_chunks.size(); ++i) {
+      chunk_sizes[i] = msgpack_encoded_size(trace_chunks[i].spans);
+    }
+    std::size_t first = 0;
+    while (first < trace_chunks.size()) {
+      const std::size_t count =
+          count_within(chunk_sizes.data() + first, chunk_sizes.size() - first,
+                       2 * msgpack::array_header_size, max_payload_size_);
+      // The payload is an array of two elements: the string table, and the
+      // array of trace chunks.
+      StringTable strings;
+      BufferChain request_body;
+      std::string header;
+      auto result = msgpack_encode(request_body, trace_chunks.begin() + first,
+                                   trace_chunks.begin() + first + count,
+                                   strings);
+      if (result) {
+        result = msgpack::pack_array(header, 2);
+      }
+      if (result) {
+        result = msgpack_encode(header, strings);
+      }
+      if (result) {
+        result = msgpack::pack_array(header, count);
+      }
+      if (auto* error = result.if_error()) {
+        logger_->log_error(*error);
+        return;
+      }
+      request_body.prepend(std::move(header));
+      send_traces(ResendBuffer::Payload{
+          std::make_shared<BufferChain>(std::move(request_body)), count,
+          version, samplers, 0, {}});
+      first += count;
+    }
+    return;
+  }
+
+  const std::size_t num_encoded_chunks = chunk_sizes.size();
+  chunk_sizes.resize(num_encoded_chunks + trace_chunks.size());
+  BufferChain lazily_encoded;
+  auto encode_result =
+      msgpack_encode(lazily_encoded, trace_chunks,
+                     chunk_sizes.data() + num_encoded_chunks,
+                     encoder_pool_.get());
   if (auto* error = encode_result.if_error()) {
     logger_->log_error(*error);
     return;
   }
+  body.append(std::move(lazily_encoded));
+  // The spans are no longer needed.
+  trace_chunks.clear();
 
-  // One HTTP request to the Agent could possibly involve trace chunks from
-  // multiple tracers, and thus multiple trace samplers might need to have
-  // their rates updated. Unlikely, but possible.
-  std::unordered_set<std::shared_ptr<TraceSampler>> response_handlers;
-  for (auto& chunk : trace_chunks) {
-    response_handlers.insert(std::move(chunk.response_handler));
+  std::size_t first = 0;
+  while (first < chunk_sizes.size()) {
+    const std::size_t count =
+        count_within(chunk_sizes.data() + first, chunk_sizes.size() - first,
+                     msgpack::array_header_size, max_payload_size_);
+    std::size_t size = 0;
+    for (std::size_t i = first; i < first + count; ++i) {
+      size += chunk_sizes[i];
+    }
+    BufferChain request_body = body.take_front(size);
+    std::string header;
+    encode_result = msgpack::pack_array(header, count);
+    if (auto* error = encode_result.if_error()) {
+      logger_->log_error(*error);
+      return;
+    }
+    request_body.prepend(std::move(header));
+    send_traces(ResendBuffer::Payload{
+        std::make_shared<BufferChain>(std::move(request_body)), count, version,
+        samplers, 0, {}});
+    first += count;
   }
+}
+
+void DatadogAgent::adapt_flush_interval(std::size_t num_spans,
+                                        std::size_t num_bytes,
+                                        bool triggered_early) {
+  if (!scheduled_flush_.set_interval) {
+    return;
+  }
+
+  const auto base = flush_interval_;
+  auto interval = current_flush_interval_;
+  if (triggered_early || num_spans >= early_flush_spans_ / 2 ||
+      num_bytes >= early_flush_bytes_ / 2) {
+    // Under load, flush more often, so that each flush is smaller.
+    interval = std::max(interval / 2, min_flush_interval_);
+  } else if (num_spans == 0) {
+    // When idle, flush less often.
+    interval = std::min(interval * 2, max_flush_interval_);
+  } else if (interval < base) {
+    interval = std::min(interval * 2, base);
+  } else if (interval > base) {
+    interval = std::max(interval / 2, base);
+  }
+
+  if (interval != current_flush_interval_) {
+    current_flush_interval_ = interval;
+    scheduled_flush_.set_interval(interval);
+  }
+}
+
+void DatadogAgent::send_traces(ResendBuffer::Payload payload) {
+  const std::size_t num_chunks = payload.num_chunks;
+  const TracesAPIVersion version = payload.version;
+  // If the request can be retried or spooled, then keep the payload for the
+  // response handlers to use if the request fails.  The body is shared with
+  // the request, not copied.
+  std::shared_ptr<ResendBuffer::Payload> retry;
+  if (payload.attempts < max_retries_ || spool_) {
+    retry = std::make_shared<ResendBuffer::Payload>(payload);
+  }
+  // Add `retry`, if any, to the resend buffer, or to the spool if its retries
+  // are exhausted, and return whether it was added to the resend buffer.
+  // Payloads discarded from the resend buffer are spooled too.  The callbacks
+  // below can outlive this object, so they capture the state that this needs.
+  auto schedule_retry = [retry, resend_buffer = resend_buffer_, spool = spool_,
+                         clock = clock_, backoff = retry_backoff_,
+                         max_retries = max_retries_, logger = logger_]() {
+    if (!retry) {
+      return false;
+    }
+    std::vector<ResendBuffer::Payload> discarded;
+    const bool retrying = retry->attempts < max_retries;
+    if (retrying) {
+      ++retry->attempts;
+      retry->not_before =
+          clock().tick + retry_backoff(retry->attempts, backoff);
+      discarded = resend_buffer->push(std::move(*retry));
+    } else {
+      discarded.push_back(std::move(*retry));
+    }
+
+    if (spool) {
+      for (const auto& payload : discarded) {
+        spool_payload(*spool, *logger, payload);
+      }
+      return retrying;
+    }
+    std::size_t num_discarded = 0;
+    for (const auto& payload : discarded) {
+      num_discarded += payload.num_chunks;
+    }
+    if (num_discarded != 0) {
+      logger->log_error([&](auto& stream) {
+        stream << "Discarded " << num_discarded
+               << " trace chunks awaiting retry, because the resend buffer "
+                  "is full.";
+      });
+    }
+    return retrying;
+  };
 
   // This is the callback for setting request headers.
   // It's invoked synchronously (before `post` returns).
   auto set_request_headers = [&](DictWriter& headers) {
-    headers.set("Content-Type", "application/msgpack");
-    headers.set("Datadog-Meta-Lang", "cpp");
-    headers.set("Datadog-Meta-Lang-Version", std::to_string(__cplusplus));
-    headers.set("Datadog-Meta-Tracer-Version", tracer_version);
-    headers.set("X-Datadog-Trace-Count", std::to_string(trace_chunks.size()));
+    headers.set_constant("Content-Type", "application/msgpack");
+    headers.set_constant("Datadog-Meta-Lang", "cpp");
+    headers.set_constant("Datadog-Meta-Lang-Version", cplusplus_version);
+    headers.set_constant("Datadog-Meta-Tracer-Version", tracer_version);
+    headers.set("X-Datadog-Trace-Count", std::to_string(num_chunks));
+    if (stats_concentrator_) {
+      // The Datadog Agent must not compute stats for these traces again.
+      headers.set_constant("Datadog-Client-Computed-Stats", "yes");
+    }
   };
 
   // This is the callback for the HTTP response.  It's invoked
   // asynchronously.
   auto on_response = [telemetry = tracer_telemetry_,
-                      samplers = std::move(response_handlers),
-                      logger = logger_](int response_status,
-                                        const DictReader& /*response_headers*/,
-                                        std::string response_body) {
+                      samplers = payload.samplers, logger = logger_,
+                      api_version = traces_api_version_, version,
+                      available = agent_available_,
+                      schedule_retry](int response_status,
+                                      const DictReader& /*response_headers*/,
+                                      std::string response_body) {
+    if (version == TracesAPIVersion::V0_5 &&
+        (response_status == 404 || response_status == 415)) {
+      // This Datadog Agent predates version 0.5 of the traces API, or has it
+      // disabled.  Use version 0.4 from now on.
+      api_version->store(TracesAPIVersion::V0_4, std::memory_order_relaxed);
+      logger->log_error([&](auto& stream) {
+        stream << "Datadog Agent responded with status " << response_status
+               << " to traces sent to " << traces_v05_api_path
+               << ". Subsequent traces will be sent to " << traces_api_path
+               << " instead.";
+      });
+    }
     if (response_status >= 500) {
       telemetry->metrics().trace_api.responses_5xx.inc();
     } else if (response_status >= 400) {
@@ -307,12 +984,26 @@ void DatadogAgent::flush() {
     } else if (response_status >= 100) {
       telemetry->metrics().trace_api.responses_1xx.inc();
     }
+    if (response_status < 200 || response_status >= 300) {
+      telemetry->metrics().trace_api.errors_status_code.inc();
+    }
+    if (response_status >= 200 && response_status < 300) {
+      available->store(true, std::memory_order_relaxed);
+    }
     if (response_status != 200) {
+      bool retrying = false;
+      if (response_status >= 500) {
+        available->store(false, std::memory_order_relaxed);
+        retrying = schedule_retry();
+      }
       logger->log_error([&](auto& stream) {
         stream << "Unexpected response status " << response_status
                << " in Datadog Agent response with body of length "
                << response_body.size() << " (starts on next line):\n"
                << response_body;
+        if (retrying) {
+          stream << "\nThe request will be retried.";
+        }
       });
       return;
     }
@@ -332,7 +1023,7 @@ void DatadogAgent::flush() {
       return;
     }
     const auto& response = std::get<CollectorResponse>(result);
-    for (const auto& sampler : samplers) {
+    for (const auto& sampler : *samplers) {
       if (sampler) {
         sampler->handle_collector_response(response);
       }
@@ -342,24 +1033,108 @@ void DatadogAgent::flush() {
   // This is the callback for if something goes wrong sending the
   // request or retrieving the response.  It's invoked
   // asynchronously.
-  auto on_error = [telemetry = tracer_telemetry_,
-                   logger = logger_](Error error) {
-    telemetry->metrics().trace_api.errors_network.inc();
+  auto on_error = [telemetry = tracer_telemetry_, logger = logger_,
+                   available = agent_available_, schedule_retry](Error error) {
+    auto& metrics = telemetry->metrics().trace_api;
+    if (error.code == Error::CURL_REQUEST_TIMEOUT ||
+        error.code == Error::CURL_DEADLINE_EXCEEDED_BEFORE_REQUEST_START ||
+        error.code == Error::SOCKET_HTTP_REQUEST_TIMEOUT) {
+      metrics.errors_timeout.inc();
+    } else {
+      metrics.errors_network.inc();
+    }
+    available->store(false, std::memory_order_relaxed);
+    const bool retrying = schedule_retry();
     logger->log_error(error.with_prefix(
-        "Error occurred during HTTP request for submitting traces: "));
+        retrying ? "Error occurred during HTTP request for submitting traces, "
+                   "which will be retried: "
+                 : "Error occurred during HTTP request for submitting "
+                   "traces: "));
   };
 
   tracer_telemetry_->metrics().trace_api.requests.inc();
+  const auto& endpoint = version == TracesAPIVersion::V0_5
+                             ? traces_v05_endpoint_
+                             : traces_endpoint_;
   auto post_result =
-      http_client_->post(traces_endpoint_, std::move(set_request_headers),
-                         std::move(body), std::move(on_response),
-                         std::move(on_error), clock_().tick + request_timeout_);
+      http_client_->post_stream(endpoint, std::move(set_request_headers),
+                                payload.body, std::move(on_response),
+                                std::move(on_error),
+                                clock_().tick + request_timeout_);
   if (auto* error = post_result.if_error()) {
     logger_->log_error(
         error->with_prefix("Unexpected error submitting traces: "));
   }
 }
 
+void DatadogAgent::replay_spool() {
+  if (!spool_ || !agent_available_->load(std::memory_order_relaxed)) {
+    return;
+  }
+  auto records = spool_->take_oldest(max_payload_size_);
+  if (auto* error = records.if_error()) {
+    logger_->log_error(error->with_prefix("Unable to read spooled traces: "));
+    return;
+  }
+  if (records->empty()) {
+    return;
+  }
+  // The samplers that were waiting for the original responses are gone, so
+  // responses to spooled request bodies are not delivered to any sampler.
+  const auto samplers = std::make_shared<
+      const std::unordered_set<std::shared_ptr<TraceSampler>>>();
+  for (auto& record : *records) {
+    // A spooled request body is not retried, but is spooled again if it
+    // fails.
+    send_traces(ResendBuffer::Payload{
+        std::make_shared<BufferChain>(std::move(record.body)),
+        record.num_chunks, record.version, samplers, max_retries_,
+        std::chrono::steady_clock::time_point()});
+  }
+}
+
+void DatadogAgent::flush_stats(bool force) {
+  auto payloads = stats_concentrator_->flush(clock_().wall, force);
+  if (auto* error = payloads.if_error()) {
+    logger_->log_error(error->with_prefix("Unable to encode trace stats: "));
+    return;
+  }
+
+  const auto set_request_headers = [](DictWriter& headers) {
+    headers.set_constant("Content-Type", "application/msgpack");
+    headers.set_constant("Datadog-Meta-Lang", "cpp");
+    headers.set_constant("Datadog-Meta-Lang-Version", cplusplus_version);
+    headers.set_constant("Datadog-Meta-Tracer-Version", tracer_version);
+    headers.set_constant("Datadog-Client-Computed-Stats", "yes");
+  };
+  const auto on_response = [logger = logger_](
+                               int response_status,
+                               const DictReader& /*response_headers*/,
+                               std::string response_body) {
+    if (response_status < 200 || response_status >= 300) {
+      logger->log_error([&](auto& stream) {
+        stream << "Unexpected trace stats response status " << response_status
+               << " with body (if any, starts on next line):\n"
+               << response_body;
+      });
+    }
+  };
+  const auto on_error = [logger = logger_](Error error) {
+    logger->log_error(error.with_prefix(
+        "Error occurred during HTTP request for submitting trace stats: "));
+  };
+
+  for (auto& payload : *payloads) {
+    auto post_result = http_client_->post(
+        stats_endpoint_, set_request_headers, std::move(payload), on_response,
+        on_error, clock_().tick + request_timeout_);
+    if (auto* error = post_result.if_error()) {
+      logger_->log_error(
+          error->with_prefix("Unexpected error submitting trace stats: "));
+    }
+  }
+}
+
 void DatadogAgent::send_telemetry(std::string payload) {
   auto post_result =
       http_client_->post(telemetry_endpoint_, set_content_type_json,
@@ -376,6 +1151,16 @@ void DatadogAgent::send_app_started(
   send_telemetry(tracer_telemetry_->app_started(config_metadata));
 }
 
+void DatadogAgent::count_connections() {
+  const auto stats = http_client_->connection_stats();
+  auto& metrics = tracer_telemetry_->metrics().http_client;
+  metrics.connections_new.add(stats.new_connections -
+                              connection_stats_.new_connections);
+  metrics.connections_reused.add(stats.reused_connections -
+                                 connection_stats_.reused_connections);
+  connection_stats_ = stats;
+}
+
 void DatadogAgent::send_heartbeat_and_telemetry() {
   send_telemetry(tracer_telemetry_->heartbeat_and_telemetry());
 }
@@ -6,27 +6,42 @@
 // `DatadogAgent` is configured by `DatadogAgentConfig`.  See
 // `datadog_agent_config.h`.
 
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
 #include <memory>
 #include <mutex>
+#include <string>
+#include <unordered_set>
 #include <vector>
 
+#include "buffer_chain.h"
 #include "clock.h"
 #include "collector.h"
 #include "config_manager.h"
 #include "event_scheduler.h"
 #include "http_client.h"
 #include "metrics.h"
+#include "mpsc_queue.h"
 #include "remote_config.h"
+#include "resend_buffer.h"
+#include "spool.h"
+#include "stats_concentrator.h"
 #include "tracer_telemetry.h"
 
 namespace datadog {
 namespace tracing {
 
+class EncoderPool;
 class FinalizedDatadogAgentConfig;
 class Logger;
+class SharedMemoryRing;
 struct SpanData;
 class TraceSampler;
 struct TracerSignature;
+enum class TracesAPIVersion : char;
 
 class DatadogAgent : public Collector {
  public:
@@ -41,13 +56,131 @@ class DatadogAgent : public Collector {
   Clock clock_;
   std::shared_ptr<Logger> logger_;
   std::vector<TraceChunk> trace_chunks_;
+  // If `eager_encoding_`, then `send` encodes each trace chunk immediately
+  // and appends the result to `encoded_chunks_`, instead of adding the chunk
+  // to `trace_chunks_`.
+  bool eager_encoding_;
+  BufferChain encoded_chunks_;
+  // `EncodedChunk` describes a trace chunk encoded in `encoded_chunks_`.  If
+  // the chunk was evicted from the buffer (see below), then `flush` skips its
+  // `size` bytes.
+  struct EncodedChunk {
+    std::size_t size;
+    bool evicted;
+  };
+  // `encoded_chunk_info_` describes each trace chunk in `encoded_chunks_`, in
+  // order.
+  std::vector<EncodedChunk> encoded_chunk_info_;
+  std::unordered_set<std::shared_ptr<TraceSampler>> encoded_response_handlers_;
+  // The trace chunks buffered in `trace_chunks_` and `encoded_chunks_` are
+  // limited to `max_buffered_spans_` spans and `max_buffered_bytes_` bytes of
+  // MessagePack.  When a chunk would exceed the limits, buffered chunks whose
+  // sampling priority is not positive are evicted, oldest first, to make room
+  // for it.  If that isn't enough, then the new chunk is dropped.
+  //
+  // `buffered_spans_` and `buffered_bytes_` count every buffered trace chunk,
+  // including those in `pending_chunks_` (see below), and also chunks for
+  // which `send` has reserved room but not yet queued.  `collected_spans_` and
+  // `collected_bytes_` count only the chunks in `trace_chunks_` and
+  // `encoded_chunks_`, excluding evicted chunks.
+  std::size_t max_buffered_spans_;
+  std::size_t max_buffered_bytes_;
+  std::atomic<std::size_t> buffered_spans_;
+  std::atomic<std::size_t> buffered_bytes_;
+  std::size_t collected_spans_;
+  std::size_t collected_bytes_;
+  // `DroppableChunk` refers to a buffered trace chunk whose sampling priority
+  // is not positive: either the element at `index` in `trace_chunks_`, or, if
+  // `encoded`, the element at `index` in `encoded_chunk_info_`.
+  struct DroppableChunk {
+    bool encoded;
+    std::size_t index;
+    std::size_t num_spans;
+    std::size_t size;
+  };
+  std::deque<DroppableChunk> droppable_chunks_;
+  std::size_t droppable_spans_;
+  std::size_t droppable_bytes_;
+  // `PendingChunk` is a trace chunk that `send` has queued in
+  // `pending_chunks_`.  If it was encoded eagerly, then its encoding is
+  // `encoded` and `spans` is empty.
+  struct PendingChunk {
+    std::vector<std::unique_ptr<SpanData>> spans;
+    std::string encoded;
+    std::shared_ptr<TraceSampler> response_handler;
+    std::size_t num_spans;
+    std::size_t size;
+    bool keep;
+  };
+  // When there's room in the buffer, `send` pushes trace chunks onto
+  // `pending_chunks_` without locking `mutex_`.  `collect_pending_chunks`
+  // moves them into `trace_chunks_` or `encoded_chunks_` while `mutex_` is
+  // locked, either in `flush` or when `send` must evict chunks to make room.
+  MPSCQueue<PendingChunk> pending_chunks_;
+  // `send` triggers a flush before the end of the flush interval once at
+  // least `early_flush_spans_` spans or `early_flush_bytes_` bytes are
+  // buffered.  `early_flush_requested_` prevents repeated triggers before the
+  // flush occurs.
+  std::size_t early_flush_spans_;
+  std::size_t early_flush_bytes_;
+  std::atomic<bool> early_flush_requested_;
+  // If `adaptive_flush_interval_`, then `flush` adjusts the flush interval,
+  // `current_flush_interval_`, to load, within the range from
+  // `min_flush_interval_` to `max_flush_interval_`.
+  bool adaptive_flush_interval_;
+  std::chrono::steady_clock::duration current_flush_interval_;
+  std::chrono::steady_clock::duration min_flush_interval_;
+  std::chrono::steady_clock::duration max_flush_interval_;
+  // `flush` divides the trace chunks among requests whose bodies are each at
+  // most `max_payload_size_` bytes.
+  std::size_t max_payload_size_;
+  // A request that fails with a network error or a 5xx response is retried up
+  // to `max_retries_` times, after a delay computed by `retry_backoff` from
+  // `retry_backoff_`.  Its body waits in `resend_buffer_`, which is shared
+  // with the request's response handlers, and is sent again by a subsequent
+  // `flush`.
+  int max_retries_;
+  std::chrono::steady_clock::duration retry_backoff_;
+  std::shared_ptr<ResendBuffer> resend_buffer_;
+  // `spool_`, if not null, keeps on disk the request bodies whose retries are
+  // exhausted or that are discarded from `resend_buffer_`.  While
+  // `agent_available_`, i.e. until a request fails and again after a request
+  // succeeds, `replay_spool` sends them again.  Both are shared with the
+  // request's response handlers.
+  std::shared_ptr<Spool> spool_;
+  std::shared_ptr<std::atomic<bool>> agent_available_;
+  // If `shared_memory_ring_` is not null, then `flush` first moves into the
+  // buffer the trace chunks that other processes wrote to the ring.
+  // `shared_memory_ring_claim_failed_` is whether another process consumes
+  // the ring instead, so that the error is logged only once.
+  // `shared_memory_ring_dropped_chunks_` is the ring's count of dropped trace
+  // chunks as of the previous flush.
+  std::shared_ptr<SharedMemoryRing> shared_memory_ring_;
+  bool shared_memory_ring_claim_failed_;
+  std::uint64_t shared_memory_ring_dropped_chunks_;
+  // `encoder_pool_`, if not null, encodes trace chunks in parallel in `flush`.
+  std::unique_ptr<EncoderPool> encoder_pool_;
   HTTPClient::URL traces_endpoint_;
+  HTTPClient::URL traces_v05_endpoint_;
+  // `traces_api_version_` is shared with the handlers of traces responses,
+  // which revert it to version 0.4 if the Datadog Agent does not support
+  // version 0.5.
+  std::shared_ptr<std::atomic<TracesAPIVersion>> traces_api_version_;
+  // `stats_concentrator_`, if not null, computes trace stats from the trace
+  // chunks passed to `send`, and `flush_stats` sends them to
+  // `stats_endpoint_`.
+  std::unique_ptr<StatsConcentrator> stats_concentrator_;
+  HTTPClient::URL stats_endpoint_;
   HTTPClient::URL telemetry_endpoint_;
   HTTPClient::URL remote_configuration_endpoint_;
   std::shared_ptr<HTTPClient> http_client_;
+  // `connection_stats_` is what `http_client_` reported the last time that
+  // `count_connections` was called.
+  HTTPClient::ConnectionStats connection_stats_;
   std::shared_ptr<EventScheduler> event_scheduler_;
-  EventScheduler::Cancel cancel_scheduled_flush_;
+  EventScheduler::RecurringEvent scheduled_flush_;
   EventScheduler::Cancel cancel_telemetry_timer_;
+  EventScheduler::Cancel cancel_stats_timer_;
   EventScheduler::Cancel cancel_remote_configuration_task_;
   std::chrono::steady_clock::duration flush_interval_;
   // Callbacks for submitting telemetry data
@@ -59,6 +192,56 @@ class DatadogAgent : public Collector {
   RemoteConfigurationManager remote_config_;
 
   void flush();
+  // Move the trace chunks in `shared_memory_ring_` into the buffer, if this
+  // process is, or can become, the ring's consumer.
+  void drain_shared_memory_ring();
+  // Add the specified `chunk` to the buffer, or drop it if there isn't room.
+  void enqueue(PendingChunk&& chunk);
+  // Move the trace chunks in `pending_chunks_` into `trace_chunks_` and
+  // `encoded_chunks_`.  The behavior is undefined unless `mutex_` is locked.
+  void collect_pending_chunks();
+  // Add the specified `chunk` to `trace_chunks_` or `encoded_chunks_`.  Its
+  // room must already be reserved in `buffered_spans_` and `buffered_bytes_`.
+  // The behavior is undefined unless `mutex_` is locked.
+  void collect(PendingChunk&& chunk);
+  // Trigger an early flush if the specified `num_spans` or `num_bytes`
+  // buffered reach their thresholds, unless one is already requested.
+  void maybe_flush_early(std::size_t num_spans, std::size_t num_bytes);
+  // Adjust the flush interval according to the specified `num_spans` spans
+  // and `num_bytes` bytes that were buffered at the time of a flush, and to
+  // whether the flush was `triggered_early`.
+  void adapt_flush_interval(std::size_t num_spans, std::size_t num_bytes,
+                            bool triggered_early);
+  // Return whether the buffer has room for a trace chunk having the specified
+  // `num_spans` and encoded `size`.  If the chunk would exceed the buffer's
+  // limits, and the chunk's sampling priority is positive as indicated by the
+  // specified `keep`, then first evict buffered chunks that the Datadog Agent
+  // would drop, if that makes enough room.  Move the spans of evicted chunks
+  // into the specified `evicted`, so that the caller can free them after
+  // unlocking `mutex_`.  The behavior is undefined unless `mutex_` is locked.
+  bool make_room(std::size_t num_spans, std::size_t size, bool keep,
+                 std::vector<std::unique_ptr<SpanData>>& evicted);
+  // Count in telemetry the specified `num_chunks` trace chunks, having the
+  // specified `num_spans` spans in total, as dropped because the buffer was
+  // full.
+  void count_dropped(std::size_t num_chunks, std::size_t num_spans);
+  // Send to the Datadog Agent a request whose body is the body of the
+  // specified `payload`.  Pass the Agent's response to the payload's
+  // samplers.  If the request fails and the payload has been sent fewer than
+  // `max_retries_` times before, then add the payload to `resend_buffer_`, or
+  // otherwise to `spool_`, if any.
+  void send_traces(ResendBuffer::Payload payload);
+  // If there is a spool and the Datadog Agent is available, then send the
+  // oldest request bodies in the spool, up to `max_payload_size_` bytes.
+  // This is done by the event scheduler's thread after each flush, so that
+  // application threads never wait for the disk.
+  void replay_spool();
+  // Send to the Datadog Agent the trace stats of the buckets that have ended,
+  // or of every bucket if the specified `force` is true.
+  void flush_stats(bool force);
+  // Add to telemetry the requests that `http_client_` sent on new and on
+  // reused connections since the previous call.
+  void count_connections();
   void send_telemetry(std::string);
   void send_heartbeat_and_telemetry();
   void send_app_closing();
@@ -122,6 +122,123 @@ Expected<FinalizedDatadogAgentConfig> finalize_config(
                  "positive number of seconds."};
   }
 
+  result.eager_encoding = user_config.eager_encoding.value_or(false);
+  result.traces_api_version =
+      user_config.traces_api_version.value_or(TracesAPIVersion::V0_4);
+
+  if (const int encoder_threads = user_config.encoder_threads.value_or(1);
+      encoder_threads > 0) {
+    result.encoder_threads = std::size_t(encoder_threads);
+  } else {
+    return Error{Error::DATADOG_AGENT_INVALID_ENCODER_THREADS,
+                 "DatadogAgent: The number of encoder threads must be a "
+                 "positive number."};
+  }
+
+  if (const int max_payload_size_bytes =
+          user_config.max_payload_size_bytes.value_or(10 * 1024 * 1024);
+      max_payload_size_bytes > 0) {
+    result.max_payload_size = std::size_t(max_payload_size_bytes);
+  } else {
+    return Error{Error::DATADOG_AGENT_INVALID_MAX_PAYLOAD_SIZE,
+                 "DatadogAgent: The maximum payload size must be a positive "
+                 "number of bytes."};
+  }
+
+  if (const int max_buffered_spans =
+          user_config.max_buffered_spans.value_or(1000 * 1000);
+      max_buffered_spans > 0) {
+    result.max_buffered_spans = std::size_t(max_buffered_spans);
+  } else {
+    return Error{Error::DATADOG_AGENT_INVALID_MAX_BUFFERED_SPANS,
+                 "DatadogAgent: The maximum number of buffered spans must be "
+                 "a positive number."};
+  }
+
+  if (const int max_buffered_bytes =
+          user_config.max_buffered_bytes.value_or(128 * 1024 * 1024);
+      max_buffered_bytes > 0) {
+    result.max_buffered_bytes = std::size_t(max_buffered_bytes);
+  } else {
+    return Error{Error::DATADOG_AGENT_INVALID_MAX_BUFFERED_BYTES,
+                 "DatadogAgent: The maximum size of buffered spans must be a "
+                 "positive number of bytes."};
+  }
+
+  if (const int early_flush_spans =
+          user_config.early_flush_spans.value_or(100 * 1000);
+      early_flush_spans > 0) {
+    result.early_flush_spans = std::size_t(early_flush_spans);
+  } else {
+    return Error{Error::DATADOG_AGENT_INVALID_EARLY_FLUSH_SPANS,
+                 "DatadogAgent: The number of buffered spans that triggers an "
+                 "early flush must be a positive number."};
+  }
+
+  if (const int early_flush_bytes = user_config.early_flush_bytes.value_or(
+          int(result.max_payload_size));
+      early_flush_bytes > 0) {
+    result.early_flush_bytes = std::size_t(early_flush_bytes);
+  } else {
+    return Error{Error::DATADOG_AGENT_INVALID_EARLY_FLUSH_BYTES,
+                 "DatadogAgent: The size of buffered spans that triggers an "
+                 "early flush must be a positive number of bytes."};
+  }
+
+  result.adaptive_flush_interval =
+      user_config.adaptive_flush_interval.value_or(false);
+
+  result.max_retries = user_config.max_retries.value_or(3);
+  if (result.max_retries < 0) {
+    return Error{Error::DATADOG_AGENT_INVALID_MAX_RETRIES,
+                 "DatadogAgent: The maximum number of retries must not be "
+                 "negative."};
+  }
+
+  if (const int retry_backoff_milliseconds =
+          user_config.retry_backoff_milliseconds.value_or(1000);
+      retry_backoff_milliseconds > 0) {
+    result.retry_backoff =
+        std::chrono::milliseconds(retry_backoff_milliseconds);
+  } else {
+    return Error{Error::DATADOG_AGENT_INVALID_RETRY_BACKOFF,
+                 "DatadogAgent: The retry backoff must be a positive number of "
+                 "milliseconds."};
+  }
+
+  if (const int max_resend_buffer_bytes =
+          user_config.max_resend_buffer_bytes.value_or(32 * 1024 * 1024);
+      max_resend_buffer_bytes > 0) {
+    result.max_resend_buffer_size = std::size_t(max_resend_buffer_bytes);
+  } else {
+    return Error{Error::DATADOG_AGENT_INVALID_MAX_RESEND_BUFFER_SIZE,
+                 "DatadogAgent: The maximum size of the resend buffer must be "
+                 "a positive number of bytes."};
+  }
+
+  result.spool_path = user_config.spool_path.value_or("");
+  if (const int max_spool_bytes =
+          user_config.max_spool_bytes.value_or(64 * 1024 * 1024);
+      max_spool_bytes >= 4096) {
+    result.max_spool_size = std::size_t(max_spool_bytes);
+  } else {
+    return Error{Error::DATADOG_AGENT_INVALID_MAX_SPOOL_SIZE,
+                 "DatadogAgent: The size of the spool file must be at least "
+                 "4096 bytes."};
+  }
+
+  result.shared_memory_ring = user_config.shared_memory_ring;
+  if (result.shared_memory_ring &&
+      result.traces_api_version != TracesAPIVersion::V0_4) {
+    return Error{Error::DATADOG_AGENT_INCOMPATIBLE_TRACES_API_VERSION,
+                 "DatadogAgent: Trace chunks from a shared memory ring are "
+                 "encoded in version 0.4 of the traces API, so version 0.5 "
+                 "cannot be used with a ring."};
+  }
+  result.stats_computation_enabled =
+      user_config.stats_computation_enabled.value_or(false) &&
+      !result.shared_memory_ring;
+
   const auto [origin, url] =
       pick(env_config->url, user_config.url, "http://localhost:8126");
   auto parsed_url = HTTPClient::URL::parse(url);
@@ -12,6 +12,7 @@
 // See `tracer_config.h`.
 
 #include <chrono>
+#include <cstddef>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -28,6 +29,21 @@ namespace tracing {
 
 class EventScheduler;
 class Logger;
+class SharedMemoryRing;
+
+// `TracesAPIVersion` is the version of the Datadog Agent's traces API to which
+// `DatadogAgent` sends traces.
+enum class TracesAPIVersion : char {
+  // "/v0.4/traces" receives an array of traces, each of which is an array of
+  // spans, each of which is a map.
+  V0_4,
+  // "/v0.5/traces" receives a table of strings followed by an array of traces.
+  // Each span is an array of fields that refer to strings by their index in
+  // the table.  Payloads are smaller and faster to encode than version 0.4.
+  // If the Datadog Agent does not support version 0.5, then `DatadogAgent`
+  // falls back to version 0.4.
+  V0_5
+};
 
 struct DatadogAgentConfig {
   // The `HTTPClient` used to submit traces to the Datadog Agent.  If this
@@ -59,6 +75,92 @@ struct DatadogAgentConfig {
   // How often, in seconds, to query the Datadog Agent for remote configuration
   // updates.
   Optional<int> remote_configuration_poll_interval_seconds;
+  // Whether to encode each trace chunk as MessagePack on the thread that
+  // finishes it, rather than encoding all buffered trace chunks at once on the
+  // thread that sends them to the Datadog Agent.  Eager encoding spreads the
+  // cost of encoding across application threads, and frees the spans'
+  // memory as soon as they are encoded.  The default is false.
+  Optional<bool> eager_encoding;
+  // The version of the traces API used to send traces to the Datadog Agent.
+  // The default is `TracesAPIVersion::V0_4`.  Eager encoding (see above)
+  // applies to version 0.4 only, because a version 0.5 payload's string table
+  // is shared by all of its traces.
+  Optional<TracesAPIVersion> traces_api_version;
+  // The number of threads that MessagePack encode buffered trace chunks when
+  // they are sent to the Datadog Agent.  If greater than one, then disjoint
+  // ranges of trace chunks are encoded in parallel on a pool of
+  // `encoder_threads - 1` worker threads together with the sending thread.
+  // Parallel encoding applies to version 0.4 only.  The default is 1.
+  Optional<int> encoder_threads;
+  // The maximum size, in bytes, of the body of a request that sends traces to
+  // the Datadog Agent.  If the traces buffered since the previous request are
+  // larger, then they are divided among multiple requests that are made
+  // concurrently.  A single trace chunk larger than this is sent in a request
+  // by itself.  The default is 10 MiB, well under the Datadog Agent's own
+  // limit.
+  Optional<int> max_payload_size_bytes;
+  // The maximum number of spans, and the maximum size in bytes of their
+  // MessagePack encoding, that are buffered while waiting to be sent to the
+  // Datadog Agent.  If the Datadog Agent is slow or unreachable, then trace
+  // chunks that would exceed either limit are dropped.  Trace chunks whose
+  // sampling priority is not positive, which the Datadog Agent would drop
+  // anyway, are dropped before trace chunks that are kept.  The defaults are
+  // 1,000,000 spans and 128 MiB.
+  Optional<int> max_buffered_spans;
+  Optional<int> max_buffered_bytes;
+  // The number of buffered spans, and the size in bytes of their MessagePack
+  // encoding, at which traces are sent to the Datadog Agent before the flush
+  // interval has elapsed.  An early flush keeps a burst of traces from
+  // growing the buffer, and the request that sends it, until the next
+  // scheduled flush.  The defaults are 100,000 spans and the maximum payload
+  // size (see `max_payload_size_bytes`).  Early flushes require support from
+  // the `EventScheduler` (see `EventScheduler::schedule_adjustable_event`).
+  Optional<int> early_flush_spans;
+  Optional<int> early_flush_bytes;
+  // Whether to adjust the flush interval to the rate at which spans are
+  // produced.  If true, then the interval is halved after each flush that
+  // was triggered early or that sent at least half of an early flush
+  // threshold, down to a quarter of the configured flush interval.  The
+  // interval is doubled after each flush that had nothing to send, up to
+  // four times the configured flush interval.  Otherwise, the interval moves
+  // back toward the configured flush interval.  The default is false.
+  Optional<bool> adaptive_flush_interval;
+  // The maximum number of times that a request sending traces to the Datadog
+  // Agent is retried after it fails with a network error or a 5xx response.
+  // Each retry waits for an exponentially increasing backoff, starting at
+  // `retry_backoff_milliseconds`, with random jitter, and is sent by the first
+  // flush after the backoff elapses.  Retries resend the request body as it
+  // was encoded originally.  Zero disables retries.  The defaults are 3
+  // retries and 1000 milliseconds.
+  Optional<int> max_retries;
+  Optional<int> retry_backoff_milliseconds;
+  // The maximum total size, in bytes, of request bodies awaiting retry.  When
+  // a failed request would exceed this, the oldest request bodies awaiting
+  // retry are discarded.  The default is 32 MiB.
+  Optional<int> max_resend_buffer_bytes;
+  // If not empty, the path of a file in which request bodies are kept while
+  // the Datadog Agent is unavailable: those whose retries are exhausted, and
+  // those discarded from the full resend buffer.  They are sent again, oldest
+  // first, once the Agent responds successfully, even by a later process.
+  // The file is memory-mapped, and is `max_spool_bytes` in size.  When it is
+  // full, the oldest request bodies in it are discarded.  Not supported on
+  // Windows.  The default is no file, and 64 MiB, which must be at least 4096.
+  Optional<std::string> spool_path;
+  Optional<int> max_spool_bytes;
+  // If not null, then trace chunks that other processes write to this ring,
+  // using `SharedMemoryCollector`, are sent along with this process's own.
+  // Only one process at a time can consume a ring.  Trace chunks from other
+  // processes are encoded in version 0.4 of the traces API, so
+  // `traces_api_version` must not be 0.5.  See `shared_memory_ring.h`.
+  std::shared_ptr<SharedMemoryRing> shared_memory_ring;
+  // Whether to compute trace stats (hits, errors, and duration distributions
+  // per service, operation, and resource) in this process, and send them to
+  // the Datadog Agent's "/v0.6/stats" endpoint every ten seconds, rather than
+  // having the Agent compute them from the traces it receives.  Stats are
+  // computed for every trace chunk, whatever its sampling priority.  Stats are
+  // not computed for trace chunks from other processes, so this is ignored if
+  // `shared_memory_ring` is not null.  The default is false.
+  Optional<bool> stats_computation_enabled;
 
   static Expected<HTTPClient::URL> parse(StringView);
 };
@@ -78,6 +180,22 @@ class FinalizedDatadogAgentConfig {
   std::chrono::steady_clock::duration request_timeout;
   std::chrono::steady_clock::duration shutdown_timeout;
   std::chrono::steady_clock::duration remote_configuration_poll_interval;
+  bool eager_encoding;
+  TracesAPIVersion traces_api_version;
+  std::size_t encoder_threads;
+  std::size_t max_payload_size;
+  std::size_t max_buffered_spans;
+  std::size_t max_buffered_bytes;
+  std::size_t early_flush_spans;
+  std::size_t early_flush_bytes;
+  bool adaptive_flush_interval;
+  int max_retries;
+  std::chrono::steady_clock::duration retry_backoff;
+  std::size_t max_resend_buffer_size;
+  std::string spool_path;
+  std::size_t max_spool_size;
+  std::shared_ptr<SharedMemoryRing> shared_memory_ring;
+  bool stats_computation_enabled;
   std::unordered_map<ConfigName, ConfigMetadata> metadata;
 };
 
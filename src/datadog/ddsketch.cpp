@@ -0,0 +1,201 @@
+#include "ddsketch.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+namespace datadog {
+namespace tracing {
+namespace {
+
+// Protocol Buffers wire types.  See
+// <https://protobuf.dev/programming-guides/encoding/>.
+constexpr std::uint32_t WIRE_VARINT = 0;
+constexpr std::uint32_t WIRE_FIXED64 = 1;
+constexpr std::uint32_t WIRE_LENGTH_DELIMITED = 2;
+
+void write_varint(std::string& destination, std::uint64_t value) {
+  while (value >= 0x80) {
+    destination.push_back(static_cast<char>((value & 0x7F) | 0x80));
+    value >>= 7;
+  }
+  destination.push_back(static_cast<char>(value));
+}
+
+void write_tag(std::string& destination, std::uint32_t field,
+               std::uint32_t wire_type) {
+  write_varint(destination, (field << 3) | wire_type);
+}
+
+// Append the specified `value` in little endian order, as Protocol Buffers
+// encodes `double`.
+void write_double(std::string& destination, double value) {
+  std::uint64_t bits;
+  static_assert(sizeof bits == sizeof value);
+  std::memcpy(&bits, &value, sizeof bits);
+  for (int i = 0; i < 8; ++i) {
+    destination.push_back(static_cast<char>((bits >> (8 * i)) & 0xFF));
+  }
+}
+
+void write_length_delimited(std::string& destination, std::uint32_t field,
+                            const std::string& message) {
+  write_tag(destination, field, WIRE_LENGTH_DELIMITED);
+  write_varint(destination, message.size());
+  destination += message;
+}
+
+// Return the "zigzag" encoding of the specified `value`, as Protocol Buffers
+// encodes `sint32`.
+std::uint32_t zigzag(std::int32_t value) {
+  return (static_cast<std::uint32_t>(value) << 1) ^
+         static_cast<std::uint32_t>(value >> 31);
+}
+
+}  // namespace
+
+DDSketch::DDSketch(double relative_accuracy, std::size_t max_bins)
+    : relative_accuracy_(relative_accuracy),
+      gamma_((1 + relative_accuracy) / (1 - relative_accuracy)),
+      multiplier_(1 / std::log(gamma_)),
+      max_bins_(std::max<std::size_t>(max_bins, 1)),
+      offset_(0),
+      zero_count_(0),
+      count_(0) {
+  assert(relative_accuracy > 0 && relative_accuracy < 1);
+}
+
+std::int32_t DDSketch::index(double value) const {
+  return static_cast<std::int32_t>(std::floor(std::log(value) * multiplier_));
+}
+
+double DDSketch::value(std::int32_t index) const {
+  // The middle of the bin, in the sense that it is within `relative_accuracy_`
+  // of both of the bin's bounds.
+  return std::exp(index / multiplier_) * (1 + relative_accuracy_);
+}
+
+void DDSketch::add_to_bin(std::int32_t index, double count) {
+  if (bins_.empty()) {
+    offset_ = index;
+    bins_.push_back(count);
+    return;
+  }
+
+  const auto max_bins = static_cast<std::int32_t>(max_bins_);
+  const auto size = static_cast<std::int32_t>(bins_.size());
+  if (index < offset_) {
+    // Values below the lowest bin that fits are counted in that bin.
+    index = std::max(index, offset_ + size - max_bins);
+    if (index < offset_) {
+      bins_.insert(bins_.begin(), offset_ - index, 0.0);
+      offset_ = index;
+    }
+  } else if (index >= offset_ + size) {
+    // Make room for `index` by collapsing the lowest bins, if necessary.
+    const std::int32_t lowest = index - max_bins + 1;
+    if (lowest > offset_) {
+      const std::int32_t num_collapsed = std::min(lowest - offset_, size);
+      const double collapsed = std::accumulate(
+          bins_.begin(), bins_.begin() + num_collapsed, 0.0);
+      bins_.erase(bins_.begin(), bins_.begin() + num_collapsed);
+      if (bins_.empty()) {
+        bins_.push_back(0.0);
+      }
+      bins_.front() += collapsed;
+      offset_ = lowest;
+    }
+    bins_.resize(index - offset_ + 1, 0.0);
+  }
+  bins_[index - offset_] += count;
+}
+
+void DDSketch::add(double value) {
+  if (std::isnan(value) || std::isinf(value)) {
+    return;
+  }
+  ++count_;
+  if (value <= 0) {
+    ++zero_count_;
+    return;
+  }
+  add_to_bin(index(value), 1);
+}
+
+void DDSketch::merge(const DDSketch& other) {
+  assert(other.gamma_ == gamma_);
+  zero_count_ += other.zero_count_;
+  count_ += other.count_;
+  for (std::size_t i = 0; i < other.bins_.size(); ++i) {
+    if (other.bins_[i] != 0) {
+      add_to_bin(other.offset_ + static_cast<std::int32_t>(i), other.bins_[i]);
+    }
+  }
+}
+
+double DDSketch::quantile(double quantile) const {
+  if (count_ == 0) {
+    return 0;
+  }
+  const double rank = std::clamp(quantile, 0.0, 1.0) * (count_ - 1);
+  double seen = zero_count_;
+  if (rank < seen) {
+    return 0;
+  }
+  for (std::size_t i = 0; i < bins_.size(); ++i) {
+    seen += bins_[i];
+    if (rank < seen) {
+      return value(offset_ + static_cast<std::int32_t>(i));
+    }
+  }
+  return value(offset_ + static_cast<std::int32_t>(bins_.size()) - 1);
+}
+
+void DDSketch::encode_protobuf(std::string& destination) const {
+  // message IndexMapping {
+  //   double gamma = 1;
+  //   double indexOffset = 2;
+  //   Interpolation interpolation = 3;
+  // }
+  // The index offset is zero and the interpolation is `NONE`, which are the
+  // defaults, and so are omitted.
+  std::string mapping;
+  write_tag(mapping, 1, WIRE_FIXED64);
+  write_double(mapping, gamma_);
+
+  // message Store {
+  //   map<sint32, double> binCounts = 1;
+  //   repeated double contiguousBinCounts = 2 [packed = true];
+  //   sint32 contiguousBinIndexOffset = 3;
+  // }
+  std::string store;
+  if (!bins_.empty()) {
+    write_tag(store, 2, WIRE_LENGTH_DELIMITED);
+    write_varint(store, bins_.size() * sizeof(double));
+    for (const double count : bins_) {
+      write_double(store, count);
+    }
+    if (offset_ != 0) {
+      write_tag(store, 3, WIRE_VARINT);
+      write_varint(store, zigzag(offset_));
+    }
+  }
+
+  // message DDSketch {
+  //   IndexMapping mapping = 1;
+  //   Store positiveValues = 2;
+  //   Store negativeValues = 3;
+  //   double zeroCount = 4;
+  // }
+  write_length_delimited(destination, 1, mapping);
+  write_length_delimited(destination, 2, store);
+  if (zero_count_ != 0) {
+    write_tag(destination, 4, WIRE_FIXED64);
+    write_double(destination, zero_count_);
+  }
+}
+
+}  // namespace tracing
+}  // namespace datadog
@@ -0,0 +1,83 @@
+#pragma once
+
+// This component provides a class, `DDSketch`, that is a quantile sketch of
+// the distribution of non-negative values, such as span durations.
+//
+// [DDSketch][1] divides the positive numbers into bins whose bounds grow
+// geometrically, so that any quantile of the added values is estimated within
+// a relative error, `relative_accuracy`, of its true value.  A value `v` falls
+// into the bin whose index is `floor(log(v) / log(gamma))`, where
+// `gamma = (1 + relative_accuracy) / (1 - relative_accuracy)`.  Values that are
+// not positive are counted separately, as zeros.
+//
+// The bins are stored densely, from the lowest nonempty index to the highest.
+// The number of bins is limited to `max_bins`; if more would be needed, then
+// the lowest bins are collapsed into one, which sacrifices the accuracy of the
+// lowest quantiles.  With the default parameters, durations between one
+// nanosecond and several hours fit without collapsing.
+//
+// Sketches having the same parameters can be merged.  `DDSketch` is encoded
+// as the Protocol Buffers message that the Datadog Agent accepts in the
+// `OkSummary` and `ErrorSummary` of trace stats.  See `stats_concentrator.h`.
+//
+// [1]: https://arxiv.org/abs/1908.10693
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace datadog {
+namespace tracing {
+
+class DDSketch {
+  double relative_accuracy_;
+  double gamma_;
+  // `multiplier_` is `1 / log(gamma_)`.
+  double multiplier_;
+  std::size_t max_bins_;
+  // `bins_[i]` is the count of the bin whose index is `offset_ + i`.
+  std::vector<double> bins_;
+  std::int32_t offset_;
+  double zero_count_;
+  double count_;
+
+  std::int32_t index(double value) const;
+  double value(std::int32_t index) const;
+  // Add the specified `count` to the bin having the specified `index`,
+  // collapsing the lowest bins if necessary.
+  void add_to_bin(std::int32_t index, double count);
+
+ public:
+  static constexpr double default_relative_accuracy = 0.01;
+  static constexpr std::size_t default_max_bins = 2048;
+
+  explicit DDSketch(double relative_accuracy = default_relative_accuracy,
+                    std::size_t max_bins = default_max_bins);
+
+  // Add the specified `value` to this sketch.
+  void add(double value);
+  // Add the values of the specified `other` sketch to this sketch.  The
+  // behavior is undefined unless `other` has the same relative accuracy as
+  // this sketch.
+  void merge(const DDSketch& other);
+
+  // Return the number of values added to this sketch.
+  double count() const { return count_; }
+  bool empty() const { return count_ == 0; }
+  // Return the number of bins currently stored, excluding zeros.
+  std::size_t num_bins() const { return bins_.size(); }
+
+  // Return an estimate of the specified `quantile` of the values added to this
+  // sketch, where `quantile` is between zero and one.  Return zero if this
+  // sketch is empty.
+  double quantile(double quantile) const;
+
+  // Append to the specified `destination` the Protocol Buffers encoding of
+  // this sketch as a `DDSketch` message, as defined by the
+  // `github.com/DataDog/sketches-go` project.
+  void encode_protobuf(std::string& destination) const;
+};
+
+}  // namespace tracing
+}  // namespace datadog
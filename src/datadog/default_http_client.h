@@ -1,8 +1,8 @@
 #pragma once
 
-// This component defines a function, `default_http_client`, that returns either
-// a `Curl` instance or `nullptr` depending on whether libcurl was included in
-// the build.
+// This component defines a function, `default_http_client`, that returns a
+// `Curl` instance if libcurl was included in the build.  Otherwise, it returns
+// a `SocketHTTPClient` instance on Linux, and `nullptr` elsewhere.
 //
 // `default_http_client` is implemented in either `default_http_client_curl.cpp`
 // or `default_http_client_null.cpp`.
@@ -1,17 +1,25 @@
 #include "default_http_client.h"
 
 // This file is included in the build when libcurl is not included in the build.
-// It provides an implementation of `default_http_client` that returns null,
-// which means that a user configuring a tracer with `TracerConfig` must
-// either specify a custom `Collector`, or an `HTTPClient` within
-// `DatadogAgentConfig`.
+// It provides an implementation of `default_http_client` that returns a
+// `SocketHTTPClient` on Linux, where it is supported, and null elsewhere.  Null
+// means that a user configuring a tracer with `TracerConfig` must either
+// specify a custom `Collector`, or an `HTTPClient` within `DatadogAgentConfig`.
+
+#include "socket_http_client.h"
 
 namespace datadog {
 namespace tracing {
 
-std::shared_ptr<HTTPClient> default_http_client(const std::shared_ptr<Logger> &,
-                                                const Clock &) {
+std::shared_ptr<HTTPClient> default_http_client(
+    const std::shared_ptr<Logger> &logger, const Clock &clock) {
+#ifdef __linux__
+  return std::make_shared<SocketHTTPClient>(logger, clock);
+#else
+  (void)logger;
+  (void)clock;
   return nullptr;
+#endif
 }
 
 }  // namespace tracing
@@ -21,6 +21,14 @@ class DictWriter {
   // implementation may, but is not required to, overwrite any previous value at
   // `key`.
   virtual void set(StringView key, StringView value) = 0;
+
+  // Associate the specified `value` with the specified `key`, as `set` does,
+  // where the caller sets the same `key` and `value` every time.  An
+  // implementation may use this to keep a single copy of the pair.  The
+  // default implementation calls `set`.
+  virtual void set_constant(StringView key, StringView value) {
+    set(key, value);
+  }
 };
 
 }  // namespace tracing
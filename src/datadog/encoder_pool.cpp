@@ -0,0 +1,79 @@
+#include "encoder_pool.h"
+
+namespace datadog {
+namespace tracing {
+
+EncoderPool::EncoderPool(std::size_t num_workers)
+    : task_(nullptr),
+      num_tasks_(0),
+      next_task_(0),
+      unfinished_tasks_(0),
+      shutting_down_(false) {
+  workers_.reserve(num_workers);
+  for (std::size_t i = 0; i < num_workers; ++i) {
+    workers_.emplace_back([this]() { work(); });
+  }
+}
+
+EncoderPool::~EncoderPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutting_down_ = true;
+  }
+  work_available_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+void EncoderPool::run_tasks(std::unique_lock<std::mutex>& lock) {
+  while (task_ && next_task_ < num_tasks_) {
+    const auto& task = *task_;
+    const std::size_t index = next_task_++;
+    lock.unlock();
+    task(index);
+    lock.lock();
+    if (--unfinished_tasks_ == 0) {
+      batch_done_.notify_one();
+    }
+  }
+}
+
+void EncoderPool::work() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    work_available_.wait(lock, [this]() {
+      return shutting_down_ || (task_ && next_task_ < num_tasks_);
+    });
+    if (shutting_down_) {
+      return;
+    }
+    run_tasks(lock);
+  }
+}
+
+void EncoderPool::run(std::size_t num_tasks,
+                      const std::function<void(std::size_t)>& task) {
+  if (num_tasks == 0) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> batch_lock(batch_mutex_);
+  std::unique_lock<std::mutex> lock(mutex_);
+  task_ = &task;
+  num_tasks_ = num_tasks;
+  next_task_ = 0;
+  unfinished_tasks_ = num_tasks;
+  if (num_tasks > 1) {
+    work_available_.notify_all();
+  }
+
+  run_tasks(lock);
+  batch_done_.wait(lock, [this]() { return unfinished_tasks_ == 0; });
+  task_ = nullptr;
+}
+
+std::size_t EncoderPool::num_workers() const { return workers_.size(); }
+
+}  // namespace tracing
+}  // namespace datadog
@@ -0,0 +1,62 @@
+#pragma once
+
+// This component provides a `class`, `EncoderPool`, that runs a batch of
+// independent tasks on a fixed set of worker threads and on the calling
+// thread.
+//
+// `DatadogAgent` uses an `EncoderPool` to MessagePack encode disjoint ranges of
+// trace chunks in parallel when it flushes, so that the time taken by a large
+// flush does not grow linearly with the number of buffered trace chunks.  See
+// `DatadogAgentConfig::encoder_threads`.
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace datadog {
+namespace tracing {
+
+class EncoderPool {
+  // `batch_mutex_` serializes calls to `run`.
+  std::mutex batch_mutex_;
+  std::mutex mutex_;
+  std::condition_variable work_available_;
+  std::condition_variable batch_done_;
+  // `task_` is the task of the current batch, or null if there is no batch.
+  const std::function<void(std::size_t)>* task_;
+  std::size_t num_tasks_;
+  std::size_t next_task_;
+  std::size_t unfinished_tasks_;
+  bool shutting_down_;
+  std::vector<std::thread> workers_;
+
+  // Run tasks of the current batch, if any, until there are none left to
+  // start.  `lock` must hold `mutex_`.
+  void run_tasks(std::unique_lock<std::mutex>& lock);
+  void work();
+
+ public:
+  // Create a pool having the specified `num_workers` worker threads.  The pool
+  // runs tasks on at most `num_workers + 1` threads at a time, since the
+  // thread that calls `run` runs tasks as well.
+  explicit EncoderPool(std::size_t num_workers);
+  // Wait for each worker thread to finish.
+  ~EncoderPool();
+
+  EncoderPool(const EncoderPool&) = delete;
+  EncoderPool& operator=(const EncoderPool&) = delete;
+
+  // Invoke the specified `task` once for each index in `[0, num_tasks)`, in
+  // unspecified order and possibly concurrently, and return once every
+  // invocation has returned.  `task` must not throw an exception.
+  void run(std::size_t num_tasks,
+           const std::function<void(std::size_t)>& task);
+
+  std::size_t num_workers() const;
+};
+
+}  // namespace tracing
+}  // namespace datadog
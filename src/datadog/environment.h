@@ -43,6 +43,8 @@ namespace environment {
   MACRO(DD_TRACE_AGENT_URL)                     \
   MACRO(DD_TRACE_DEBUG)                         \
   MACRO(DD_TRACE_ENABLED)                       \
+  MACRO(DD_TRACE_PARTIAL_FLUSH_ENABLED)         \
+  MACRO(DD_TRACE_PARTIAL_FLUSH_MIN_SPANS)       \
   MACRO(DD_TRACE_RATE_LIMIT)                    \
   MACRO(DD_TRACE_REPORT_HOSTNAME)               \
   MACRO(DD_TRACE_SAMPLE_RATE)                   \
@@ -75,6 +75,25 @@ struct Error {
     DATADOG_AGENT_INVALID_SHUTDOWN_TIMEOUT = 50,
     DATADOG_AGENT_INVALID_REMOTE_CONFIG_POLL_INTERVAL = 51,
     SAMPLING_DELEGATION_RESPONSE_INVALID_JSON = 52,
+    PARTIAL_FLUSH_INVALID_MIN_SPANS = 53,
+    DATADOG_AGENT_INVALID_ENCODER_THREADS = 54,
+    DATADOG_AGENT_INVALID_MAX_PAYLOAD_SIZE = 55,
+    DATADOG_AGENT_INVALID_MAX_BUFFERED_SPANS = 56,
+    DATADOG_AGENT_INVALID_MAX_BUFFERED_BYTES = 57,
+    DATADOG_AGENT_INVALID_EARLY_FLUSH_SPANS = 58,
+    DATADOG_AGENT_INVALID_EARLY_FLUSH_BYTES = 59,
+    CURL_REQUEST_TIMEOUT = 60,
+    DATADOG_AGENT_INVALID_MAX_RETRIES = 61,
+    DATADOG_AGENT_INVALID_RETRY_BACKOFF = 62,
+    DATADOG_AGENT_INVALID_MAX_RESEND_BUFFER_SIZE = 63,
+    DATADOG_AGENT_INVALID_MAX_SPOOL_SIZE = 64,
+    SPOOL_FAILURE = 65,
+    SHARED_MEMORY_RING_FAILURE = 66,
+    SOCKET_HTTP_CLIENT_SETUP_FAILED = 67,
+    SOCKET_HTTP_CLIENT_UNSUPPORTED_URL = 68,
+    SOCKET_HTTP_REQUEST_FAILURE = 69,
+    SOCKET_HTTP_REQUEST_TIMEOUT = 70,
+    DATADOG_AGENT_INCOMPATIBLE_TRACES_API_VERSION = 71,
   };
 
   Code code;
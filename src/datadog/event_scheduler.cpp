@@ -0,0 +1,17 @@
+#include "event_scheduler.h"
+
+#include <utility>
+
+namespace datadog {
+namespace tracing {
+
+EventScheduler::RecurringEvent EventScheduler::schedule_adjustable_event(
+    std::chrono::steady_clock::duration interval,
+    std::function<void()> callback) {
+  RecurringEvent event;
+  event.cancel = schedule_recurring_event(interval, std::move(callback));
+  return event;
+}
+
+}  // namespace tracing
+}  // namespace datadog
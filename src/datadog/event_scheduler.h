@@ -6,6 +6,11 @@
 // `DatadogAgent` uses an `EventScheduler` to periodically send batches of
 // traces to the Datadog Agent.
 //
+// An `EventScheduler` may also support events that can be run early and whose
+// interval can be changed.  See `schedule_adjustable_event`.  `DatadogAgent`
+// uses them to send traces early when many are buffered, and to adapt its
+// flush interval to load.
+//
 // The default implementation is `ThreadedEventScheduler`.  See
 // `threaded_event_scheduler.h`.
 
@@ -22,6 +27,22 @@ class EventScheduler {
  public:
   using Cancel = std::function<void()>;
 
+  // `RecurringEvent` controls an event scheduled by
+  // `schedule_adjustable_event`.
+  struct RecurringEvent {
+    // `cancel` prevents subsequent invocations of the event's callback.  See
+    // `schedule_recurring_event`.
+    Cancel cancel;
+    // `trigger`, if not null, causes the callback to be invoked as soon as
+    // possible rather than at the end of the current interval.  The following
+    // invocation is one interval after that.
+    std::function<void()> trigger;
+    // `set_interval`, if not null, changes the interval between invocations
+    // to the specified duration.  The next invocation is one new interval
+    // after the call to `set_interval`.
+    std::function<void(std::chrono::steady_clock::duration)> set_interval;
+  };
+
   // Invoke the specified `callback` repeatedly, with the specified `interval`
   // elapsing between invocations.  The first invocation is after an initial
   // `interval`.  Return a function-like object that can be invoked without
@@ -30,6 +51,15 @@ class EventScheduler {
       std::chrono::steady_clock::duration interval,
       std::function<void()> callback) = 0;
 
+  // Invoke the specified `callback` as does `schedule_recurring_event`, but
+  // return a `RecurringEvent` that can also run the callback early or change
+  // the `interval`.  The default implementation calls
+  // `schedule_recurring_event` and supports neither, i.e. the returned
+  // `trigger` and `set_interval` are null.
+  virtual RecurringEvent schedule_adjustable_event(
+      std::chrono::steady_clock::duration interval,
+      std::function<void()> callback);
+
   // Return a JSON representation of this object's configuration. The JSON
   // representation is an object with the following properties:
   //
@@ -5,7 +5,6 @@
 
 #include <cstdint>
 #include <string>
-#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -13,6 +12,7 @@
 #include "expected.h"
 #include "optional.h"
 #include "propagation_style.h"
+#include "span_data.h"
 
 namespace datadog {
 namespace tracing {
@@ -28,20 +28,19 @@ Optional<std::uint64_t> parse_trace_id_high(const std::string& value);
 // Return trace information parsed from the specified `headers` in the Datadog
 // propagation style. Use the specified `span_tags` and `logger` to report
 // warnings. If an error occurs, return an `Error`.
-Expected<ExtractedData> extract_datadog(
-    const DictReader& headers,
-    std::unordered_map<std::string, std::string>& span_tags, Logger& logger);
+Expected<ExtractedData> extract_datadog(const DictReader& headers,
+                                        TagMap<std::string>& span_tags,
+                                        Logger& logger);
 
 // Return trace information parsed from the specified `headers` in the B3
 // multi-header propagation style. If an error occurs, return an `Error`.
-Expected<ExtractedData> extract_b3(
-    const DictReader& headers, std::unordered_map<std::string, std::string>&,
-    Logger&);
+Expected<ExtractedData> extract_b3(const DictReader& headers,
+                                   TagMap<std::string>&, Logger&);
 
 // Return an `ExtractedData` whose only non-default field is
 // `style = PropagationStyle::NONE`.
-Expected<ExtractedData> extract_none(
-    const DictReader&, std::unordered_map<std::string, std::string>&, Logger&);
+Expected<ExtractedData> extract_none(const DictReader&, TagMap<std::string>&,
+                                     Logger&);
 
 // Return a string that can be used as the argument to `Error::with_prefix` for
 // errors occurring while extracting trace information in the specified `style`
@@ -1,5 +1,7 @@
 #include "http_client.h"
 
+#include <utility>
+
 #include "parse_util.h"
 
 namespace datadog {
@@ -77,5 +79,15 @@ Expected<HTTPClient::URL> HTTPClient::URL::parse(StringView input) {
       std::string(range(after_authority, authority_and_path.end()))};
 }
 
+Expected<void> HTTPClient::post_stream(
+    const URL& url, HeadersSetter set_headers,
+    std::shared_ptr<const BufferChain> body, ResponseHandler on_response,
+    ErrorHandler on_error, std::chrono::steady_clock::time_point deadline) {
+  return post(url, std::move(set_headers), body->flatten(),
+              std::move(on_response), std::move(on_error), deadline);
+}
+
+HTTPClient::ConnectionStats HTTPClient::connection_stats() const { return {}; }
+
 }  // namespace tracing
 }  // namespace datadog
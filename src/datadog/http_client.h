@@ -9,8 +9,11 @@
 // `HTTPClient` in terms of libcurl.  See `curl.h`.
 
 #include <chrono>
+#include <cstdint>
 #include <functional>
+#include <memory>
 
+#include "buffer_chain.h"
 #include "error.h"
 #include "expected.h"
 #include "json_fwd.hpp"
@@ -39,6 +42,14 @@ class HTTPClient {
   // error-indicating HTTP responses.
   using ErrorHandler = std::function<void(Error)>;
 
+  // `ConnectionStats` counts the requests that were sent on a newly opened
+  // connection, and those that were sent on a connection kept alive from an
+  // earlier request.
+  struct ConnectionStats {
+    std::uint64_t new_connections = 0;
+    std::uint64_t reused_connections = 0;
+  };
+
   // Send a POST request to the specified `url`.  Set request headers by calling
   // the specified `set_headers` callback.  Include the specified `body` at the
   // end of the request.  Invoke the specified `on_response` callback if/when
@@ -52,10 +63,27 @@ class HTTPClient {
       ResponseHandler on_response, ErrorHandler on_error,
       std::chrono::steady_clock::time_point deadline) = 0;
 
+  // Send a POST request as `post` does, but take the request body from the
+  // specified `body` chain of segments.  An implementation can send the
+  // segments in pieces, without concatenating them.  `body` is shared with
+  // the caller, e.g. so that the caller can send it again, and so it is not
+  // modified.  The default implementation concatenates the segments and calls
+  // `post`.
+  virtual Expected<void> post_stream(
+      const URL& url, HeadersSetter set_headers,
+      std::shared_ptr<const BufferChain> body,
+      ResponseHandler on_response, ErrorHandler on_error,
+      std::chrono::steady_clock::time_point deadline);
+
   // Wait until there are no more outstanding requests, or until the specified
   // `deadline`.
   virtual void drain(std::chrono::steady_clock::time_point deadline) = 0;
 
+  // Return the number of requests sent so far on new connections and on
+  // reused connections.  The default implementation returns zeros, for
+  // clients that don't keep track.
+  virtual ConnectionStats connection_stats() const;
+
   // Return a JSON representation of this object's configuration. The JSON
   // representation is an object with the following properties:
   //
@@ -0,0 +1,250 @@
+#include "http_response_parser.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "parse_util.h"
+
+namespace datadog {
+namespace tracing {
+namespace {
+
+// A status line, header, or chunk size line longer than this is considered
+// malformed, so that a misbehaving server cannot make the parser buffer an
+// unbounded line.
+constexpr std::size_t max_line_size = 64 * 1024;
+
+}  // namespace
+
+HTTPResponseParser::HTTPResponseParser() { reset(); }
+
+void HTTPResponseParser::reset() {
+  state_ = State::STATUS_LINE;
+  started_ = false;
+  line_.clear();
+  status_ = 0;
+  http_1_0_ = false;
+  keep_alive_ = true;
+  until_close_ = false;
+  remaining_ = 0;
+  headers_.clear();
+  body_.clear();
+  error_.clear();
+}
+
+std::size_t HTTPResponseParser::parse(StringView data) {
+  if (!data.empty()) {
+    started_ = true;
+  }
+
+  std::size_t i = 0;
+  while (i < data.size() && state_ != State::DONE &&
+         state_ != State::FAILED) {
+    if (state_ == State::BODY || state_ == State::CHUNK_DATA) {
+      std::size_t count = data.size() - i;
+      if (!until_close_) {
+        count = std::size_t(std::min<std::uint64_t>(remaining_, count));
+        remaining_ -= count;
+      }
+      body_.append(data.data() + i, count);
+      i += count;
+      if (!until_close_ && remaining_ == 0) {
+        state_ = state_ == State::BODY ? State::DONE : State::CHUNK_END;
+      }
+      continue;
+    }
+
+    // Every other state consumes whole lines.
+    const std::size_t newline = data.find('\n', i);
+    const std::size_t end = newline == StringView::npos ? data.size() : newline;
+    if (line_.size() + (end - i) > max_line_size) {
+      fail("A line of the response is too long.");
+      break;
+    }
+    line_.append(data.data() + i, end - i);
+    if (newline == StringView::npos) {
+      i = data.size();
+      break;
+    }
+    i = newline + 1;
+    if (!line_.empty() && line_.back() == '\r') {
+      line_.pop_back();
+    }
+    parse_line(line_);
+    line_.clear();
+  }
+
+  return i;
+}
+
+void HTTPResponseParser::parse_line(StringView line) {
+  switch (state_) {
+    case State::STATUS_LINE:
+      // Tolerate empty lines before the status line, e.g. after an interim
+      // response.
+      if (!line.empty()) {
+        parse_status_line(line);
+      }
+      break;
+    case State::HEADERS:
+      if (line.empty()) {
+        end_headers();
+      } else {
+        parse_header(line);
+      }
+      break;
+    case State::CHUNK_SIZE: {
+      // Ignore chunk extensions, e.g. "1a;name=value".
+      const auto size =
+          parse_uint64(strip(line.substr(0, line.find(';'))), 16);
+      if (!size) {
+        fail("Invalid chunk size: " + std::string(line));
+      } else if (*size == 0) {
+        state_ = State::TRAILERS;
+      } else {
+        remaining_ = *size;
+        state_ = State::CHUNK_DATA;
+      }
+    } break;
+    case State::CHUNK_END:
+      if (!line.empty()) {
+        fail("Chunk data is longer than the chunk's size.");
+      } else {
+        state_ = State::CHUNK_SIZE;
+      }
+      break;
+    case State::TRAILERS:
+      // Trailer fields are ignored.
+      if (line.empty()) {
+        state_ = State::DONE;
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+void HTTPResponseParser::parse_status_line(StringView line) {
+  // For example, "HTTP/1.1 200 OK".  The reason phrase is optional.
+  if (!starts_with(line, "HTTP/1.") || line.size() < 12 || line[8] != ' ' ||
+      (line.size() > 12 && line[12] != ' ')) {
+    fail("Invalid status line: " + std::string(line));
+    return;
+  }
+  const auto status = parse_int(line.substr(9, 3), 10);
+  if (!status || *status < 100) {
+    fail("Invalid status line: " + std::string(line));
+    return;
+  }
+  status_ = *status;
+  http_1_0_ = line[7] == '0';
+  keep_alive_ = !http_1_0_;
+  state_ = State::HEADERS;
+}
+
+void HTTPResponseParser::parse_header(StringView line) {
+  const std::size_t colon = line.find(':');
+  if (colon == StringView::npos || colon == 0) {
+    fail("Invalid header: " + std::string(line));
+    return;
+  }
+  std::string name{line.substr(0, colon)};
+  to_lower(name);
+  const StringView value = strip(line.substr(colon + 1));
+  auto [entry, inserted] = headers_.emplace(std::move(name), std::string{});
+  if (!inserted) {
+    entry->second += ", ";
+  }
+  entry->second.append(value.data(), value.size());
+}
+
+void HTTPResponseParser::end_headers() {
+  const auto connection = headers_.find("connection");
+  if (connection != headers_.end()) {
+    std::string value = connection->second;
+    to_lower(value);
+    if (value.find("close") != std::string::npos) {
+      keep_alive_ = false;
+    } else if (value.find("keep-alive") != std::string::npos) {
+      keep_alive_ = true;
+    }
+  }
+
+  if (status_ < 200) {
+    // Skip the interim response, and parse the final response that follows.
+    headers_.clear();
+    keep_alive_ = !http_1_0_;
+    state_ = State::STATUS_LINE;
+    return;
+  }
+  if (status_ == 204 || status_ == 304) {
+    state_ = State::DONE;
+    return;
+  }
+
+  const auto transfer_encoding = headers_.find("transfer-encoding");
+  if (transfer_encoding != headers_.end()) {
+    std::string value = transfer_encoding->second;
+    to_lower(value);
+    if (value.find("chunked") != std::string::npos) {
+      state_ = State::CHUNK_SIZE;
+      return;
+    }
+  }
+
+  const auto content_length = headers_.find("content-length");
+  if (content_length != headers_.end()) {
+    const auto length = parse_uint64(content_length->second, 10);
+    if (!length) {
+      fail("Invalid Content-Length: " + content_length->second);
+      return;
+    }
+    remaining_ = *length;
+    state_ = remaining_ == 0 ? State::DONE : State::BODY;
+    return;
+  }
+
+  // The body is delimited by the end of the connection.
+  until_close_ = true;
+  keep_alive_ = false;
+  state_ = State::BODY;
+}
+
+void HTTPResponseParser::fail(std::string message) {
+  state_ = State::FAILED;
+  error_ = std::move(message);
+}
+
+void HTTPResponseParser::finish() {
+  if (state_ == State::BODY && until_close_) {
+    state_ = State::DONE;
+  } else if (state_ != State::DONE && state_ != State::FAILED) {
+    fail("The connection closed before the response was complete.");
+  }
+}
+
+HTTPResponseParser::State HTTPResponseParser::state() const { return state_; }
+
+bool HTTPResponseParser::done() const { return state_ == State::DONE; }
+
+bool HTTPResponseParser::failed() const { return state_ == State::FAILED; }
+
+bool HTTPResponseParser::started() const { return started_; }
+
+const std::string& HTTPResponseParser::error() const { return error_; }
+
+int HTTPResponseParser::status() const { return status_; }
+
+const std::unordered_map<std::string, std::string>&
+HTTPResponseParser::headers() const {
+  return headers_;
+}
+
+std::string& HTTPResponseParser::body() { return body_; }
+
+bool HTTPResponseParser::keep_alive() const {
+  return keep_alive_ && !until_close_;
+}
+
+}  // namespace tracing
+}  // namespace datadog
@@ -0,0 +1,97 @@
+#pragma once
+
+// This component provides a class, `HTTPResponseParser`, that parses an
+// HTTP/1.1 response incrementally, as its bytes arrive from a connection.
+//
+// `SocketHTTPClient` (see `socket_http_client.h`) reads whatever bytes are
+// available on a nonblocking socket and passes them to `parse`, which
+// consumes them and returns.  The bytes need not be split on any particular
+// boundary: a line, a header, or a chunk of the body may arrive in any number
+// of pieces.  `HTTPResponseParser` supports bodies delimited by
+// "Content-Length", by "Transfer-Encoding: chunked", and by the end of the
+// connection.  Interim (1xx) responses are skipped.
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+#include "string_view.h"
+
+namespace datadog {
+namespace tracing {
+
+class HTTPResponseParser {
+ public:
+  enum class State {
+    STATUS_LINE,
+    HEADERS,
+    BODY,
+    CHUNK_SIZE,
+    CHUNK_DATA,
+    CHUNK_END,
+    TRAILERS,
+    DONE,
+    FAILED
+  };
+
+ private:
+  State state_;
+  bool started_;
+  // `line_` accumulates the current line until its "\n" arrives.
+  std::string line_;
+  int status_;
+  bool http_1_0_;
+  bool keep_alive_;
+  bool until_close_;
+  // `remaining_` is the number of body bytes remaining in the body or chunk.
+  std::uint64_t remaining_;
+  std::unordered_map<std::string, std::string> headers_;
+  std::string body_;
+  std::string error_;
+
+  // Parse the specified complete `line`, without its line terminator.
+  void parse_line(StringView line);
+  void parse_status_line(StringView line);
+  void parse_header(StringView line);
+  void end_headers();
+  void fail(std::string message);
+
+ public:
+  HTTPResponseParser();
+
+  // Parse a prefix of the specified `data`, and return the number of bytes
+  // consumed.  Fewer than `data.size()` bytes are consumed only if the
+  // response ends, i.e. `state()` becomes `State::DONE`, or if the response
+  // is malformed, i.e. `state()` becomes `State::FAILED`.
+  std::size_t parse(StringView data);
+
+  // Indicate that the connection was closed.  If the response's body is
+  // delimited by the end of the connection, then the response is done.
+  // Otherwise, the response is incomplete, and so has failed.
+  void finish();
+
+  // Prepare to parse another response on the same connection.
+  void reset();
+
+  State state() const;
+  bool done() const;
+  bool failed() const;
+  // Return whether any bytes of a response have been parsed.
+  bool started() const;
+  // Return a description of why the response is malformed.
+  const std::string& error() const;
+
+  int status() const;
+  // Return the response's headers.  Keys are in lower case.  Repeated headers
+  // are joined by ", ".
+  const std::unordered_map<std::string, std::string>& headers() const;
+  std::string& body();
+  // Return whether the connection can be used for another request after this
+  // response, according to the response's HTTP version and "Connection"
+  // header, and how its body is delimited.
+  bool keep_alive() const;
+};
+
+}  // namespace tracing
+}  // namespace datadog
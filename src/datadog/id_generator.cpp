@@ -1,6 +1,5 @@
 #include "id_generator.h"
 
-#include <bitset>
 #include <chrono>
 
 #include "random.h"
@@ -9,6 +8,10 @@ namespace datadog {
 namespace tracing {
 namespace {
 
+// IDs have their most significant bit zeroed for compatibility with older
+// tracers that can't accept values above `numeric_limits<int64_t>::max()`.
+constexpr std::uint64_t id_mask = ~(std::uint64_t(1) << 63);
+
 class DefaultIDGenerator : public IDGenerator {
   const bool trace_id_128_bit_;
 
@@ -28,23 +31,13 @@ class DefaultIDGenerator : public IDGenerator {
       const std::uint64_t unsigned_seconds = seconds < 0 ? 0 : seconds;
       result.high = unsigned_seconds << 32;
     } else {
-      // In 64-bit mode, zero the most significant bit for compatibility with
-      // older tracers that can't accept values above
-      // `numeric_limits<int64_t>::max()`.
-      std::bitset<64> bits = result.low;
-      bits[63] = 0;
-      result.low = bits.to_ullong();
+      // In 64-bit mode, zero the most significant bit.
+      result.low &= id_mask;
     }
     return result;
   }
 
-  std::uint64_t span_id() const override {
-    // Zero the most significant bit for compatibility with older tracers that
-    // can't accept values above `numeric_limits<int64_t>::max()`.
-    std::bitset<64> bits = random_uint64();
-    bits[63] = 0;
-    return bits.to_ullong();
-  }
+  std::uint64_t span_id() const override { return random_uint64() & id_mask; }
 };
 
 }  // namespace
@@ -0,0 +1,111 @@
+#pragma once
+
+// This component provides a class template, `MPSCQueue`, that is a lock-free
+// queue to which any number of threads can push values, and from which a
+// single thread removes all of the values at once.
+//
+// `DatadogAgent` uses an `MPSCQueue` for the trace chunks that application
+// threads send to it.  Every finished trace passes through
+// `DatadogAgent::send`, so a lock there is contended by every thread that
+// produces traces.  Instead, `send` pushes each trace chunk onto an
+// `MPSCQueue`, and `flush` takes them all at once.
+//
+// The queue is a singly linked list of nodes, most recently pushed first.
+// `push` links a new node onto the head of the list using a compare-and-swap
+// loop.  `pop_all` detaches the entire list by exchanging the head with null,
+// and then reverses it, so that values are visited in the order in which they
+// were pushed.  Since nodes are never removed individually, the ABA problem
+// does not arise.
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+namespace datadog {
+namespace tracing {
+
+template <typename Value>
+class MPSCQueue {
+  struct Node {
+    Value value;
+    Node* next;
+  };
+
+  std::atomic<Node*> head_;
+
+ public:
+  MPSCQueue();
+  MPSCQueue(const MPSCQueue&) = delete;
+  MPSCQueue& operator=(const MPSCQueue&) = delete;
+  ~MPSCQueue();
+
+  // Add the specified `value` to the end of this queue.  `push` may be called
+  // by any number of threads concurrently.
+  void push(Value&& value);
+
+  // Remove every value from this queue, and invoke the specified `visit` with
+  // each of them, as an rvalue, in the order in which they were pushed.  Only
+  // one thread at a time may call `pop_all`.  Return the number of values
+  // visited.
+  template <typename Visitor>
+  std::size_t pop_all(Visitor&& visit);
+
+  // Return whether this queue has no values.  The result might be out of date
+  // if other threads are pushing concurrently.
+  bool empty() const;
+};
+
+template <typename Value>
+MPSCQueue<Value>::MPSCQueue() : head_(nullptr) {}
+
+template <typename Value>
+MPSCQueue<Value>::~MPSCQueue() {
+  Node* node = head_.load(std::memory_order_acquire);
+  while (node) {
+    Node* const next = node->next;
+    delete node;
+    node = next;
+  }
+}
+
+template <typename Value>
+void MPSCQueue<Value>::push(Value&& value) {
+  Node* const node =
+      new Node{std::move(value), head_.load(std::memory_order_relaxed)};
+  while (!head_.compare_exchange_weak(node->next, node,
+                                      std::memory_order_release,
+                                      std::memory_order_relaxed)) {
+  }
+}
+
+template <typename Value>
+template <typename Visitor>
+std::size_t MPSCQueue<Value>::pop_all(Visitor&& visit) {
+  Node* node = head_.exchange(nullptr, std::memory_order_acquire);
+  // Reverse the list, so that the least recently pushed value is first.
+  Node* reversed = nullptr;
+  while (node) {
+    Node* const next = node->next;
+    node->next = reversed;
+    reversed = node;
+    node = next;
+  }
+
+  std::size_t count = 0;
+  while (reversed) {
+    Node* const next = reversed->next;
+    visit(std::move(reversed->value));
+    delete reversed;
+    reversed = next;
+    ++count;
+  }
+  return count;
+}
+
+template <typename Value>
+bool MPSCQueue<Value>::empty() const {
+  return head_.load(std::memory_order_relaxed) == nullptr;
+}
+
+}  // namespace tracing
+}  // namespace datadog
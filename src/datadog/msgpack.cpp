@@ -14,10 +14,16 @@ namespace {
 // MessagePack values are prefixed by a byte naming their type.
 namespace types {
 constexpr auto ARRAY32 = std::byte(0xDD);
+constexpr auto BIN32 = std::byte(0xC6);
+constexpr auto BOOL_FALSE = std::byte(0xC2);
+constexpr auto BOOL_TRUE = std::byte(0xC3);
 constexpr auto DOUBLE = std::byte(0xCB);
 constexpr auto INT64 = std::byte(0xD3);
 constexpr auto MAP32 = std::byte(0xDF);
 constexpr auto STR32 = std::byte(0xDB);
+constexpr auto UINT8 = std::byte(0xCC);
+constexpr auto UINT16 = std::byte(0xCD);
+constexpr auto UINT32 = std::byte(0xCE);
 constexpr auto UINT64 = std::byte(0xCF);
 }  // namespace types
 
@@ -70,6 +76,22 @@ void pack_integer(std::string& buffer, std::uint64_t value) {
   push_number_big_endian(buffer, static_cast<std::uint64_t>(value));
 }
 
+void pack_compact_integer(std::string& buffer, std::uint32_t value) {
+  if (value < 0x80) {
+    // "positive fixint" is the value itself.
+    buffer.push_back(static_cast<char>(value));
+  } else if (value <= 0xFF) {
+    buffer.push_back(static_cast<char>(types::UINT8));
+    push_number_big_endian(buffer, static_cast<std::uint8_t>(value));
+  } else if (value <= 0xFFFF) {
+    buffer.push_back(static_cast<char>(types::UINT16));
+    push_number_big_endian(buffer, static_cast<std::uint16_t>(value));
+  } else {
+    buffer.push_back(static_cast<char>(types::UINT32));
+    push_number_big_endian(buffer, value);
+  }
+}
+
 void pack_double(std::string& buffer, double value) {
   buffer.push_back(static_cast<char>(types::DOUBLE));
 
@@ -94,6 +116,11 @@ void pack_double(std::string& buffer, double value) {
   push_number_big_endian(buffer, memory.as_integer);
 }
 
+void pack_bool(std::string& buffer, bool value) {
+  buffer.push_back(
+      static_cast<char>(value ? types::BOOL_TRUE : types::BOOL_FALSE));
+}
+
 Expected<void> pack_string(std::string& buffer, const char* begin,
                            std::size_t size) {
   const auto max = std::numeric_limits<std::uint32_t>::max();
@@ -107,6 +134,18 @@ Expected<void> pack_string(std::string& buffer, const char* begin,
   return {};
 }
 
+Expected<void> pack_binary(std::string& buffer, StringView value) {
+  const auto max = std::numeric_limits<std::uint32_t>::max();
+  if (value.size() > max) {
+    return Error{Error::MESSAGEPACK_ENCODE_FAILURE,
+                 make_overflow_message("binary", value.size(), max)};
+  }
+  buffer.push_back(static_cast<char>(types::BIN32));
+  push_number_big_endian(buffer, static_cast<std::uint32_t>(value.size()));
+  buffer.append(value.data(), value.size());
+  return {};
+}
+
 Expected<void> pack_array(std::string& buffer, std::size_t size) {
   const auto max = std::numeric_limits<std::uint32_t>::max();
   if (size > max) {
@@ -9,8 +9,15 @@
 // Only encoding is provided, and only for the types required by `SpanData` and
 // `DatadogAgent`.
 //
+// Constant strings, such as the keys of a span's fields, can be encoded at
+// compile time using `encode_string`, and then appended using `pack_encoded`.
+// The `..._size` functions and constants return the number of bytes appended
+// by the corresponding `pack_...` function, so that a caller can reserve the
+// exact size of an encoding before writing it.
+//
 // [1]: https://msgpack.org/index.html
 
+#include <array>
 #include <climits>
 #include <cstddef>
 #include <cstdint>
@@ -27,15 +34,53 @@ namespace msgpack {
 void pack_integer(std::string& buffer, std::int64_t value);
 void pack_integer(std::string& buffer, std::uint64_t value);
 void pack_integer(std::string& buffer, std::int32_t value);
+// Append the shortest MessagePack encoding of the specified `value`, whereas
+// `pack_integer` always uses the full width of its argument's type.
+void pack_compact_integer(std::string& buffer, std::uint32_t value);
 
 void pack_double(std::string& buffer, double value);
 
+void pack_bool(std::string& buffer, bool value);
+
 Expected<void> pack_string(std::string& buffer, StringView value);
 Expected<void> pack_string(std::string& buffer, const char* begin,
                            std::size_t size);
 
+// Append the specified `value` as a MessagePack byte array ("bin"), rather
+// than as a string.
+Expected<void> pack_binary(std::string& buffer, StringView value);
+
 Expected<void> pack_array(std::string& buffer, std::size_t size);
 
+// Return the MessagePack encoding of the specified string `literal`, excluding
+// its null terminator.  The encoding is the same as that appended by
+// `pack_string`, but is computed at compile time when `encode_string` is used
+// to initialize a `constexpr` variable.
+template <std::size_t Size>
+constexpr std::array<char, Size + 4> encode_string(const char (&literal)[Size]);
+
+// Return the MessagePack encoding of a map header for a map having the
+// specified `size` entries.  The encoding is the same as that appended by
+// `pack_map`.
+constexpr std::array<char, 5> encode_map_header(std::uint32_t size);
+
+// Append to the specified `buffer` the specified `encoded` bytes, e.g. as
+// returned by `encode_string` or `encode_map_header`.
+template <std::size_t Size>
+void pack_encoded(std::string& buffer, const std::array<char, Size>& encoded);
+
+// These are the sizes of the encodings appended by `pack_integer`,
+// `pack_double`, `pack_array(std::string&, std::size_t)`, and
+// `pack_map(std::string&, std::size_t)`, respectively.
+constexpr std::size_t integer_size = 9;
+constexpr std::size_t double_size = 9;
+constexpr std::size_t array_header_size = 5;
+constexpr std::size_t map_header_size = 5;
+
+// Return the size of the encoding appended by `pack_string` for a string of
+// the specified `length`.
+constexpr std::size_t string_size(std::size_t length);
+
 // Append to the specified `buffer` a MessagePack encoded array having the
 // specified `values`, where for each element of `values` the specified
 // `pack_value` function appends the value.  `pack_value` is invoked with two
@@ -155,6 +200,49 @@ inline Expected<void> pack_map_suffix(std::string&) {
   return {};
 }
 
+namespace detail {
+
+// Store the specified `value` in big endian order into the specified
+// `destination`, which is at least four bytes long.
+constexpr void store_uint32_big_endian(char* destination,
+                                       std::uint32_t value) {
+  destination[0] = static_cast<char>((value >> 24) & 0xFF);
+  destination[1] = static_cast<char>((value >> 16) & 0xFF);
+  destination[2] = static_cast<char>((value >> 8) & 0xFF);
+  destination[3] = static_cast<char>(value & 0xFF);
+}
+
+}  // namespace detail
+
+template <std::size_t Size>
+constexpr std::array<char, Size + 4> encode_string(
+    const char (&literal)[Size]) {
+  static_assert(Size >= 1, "A string literal includes a null terminator.");
+  static_assert(Size - 1 <= UINT32_MAX, "The string is too long to encode.");
+  std::array<char, Size + 4> result{};
+  result[0] = static_cast<char>(0xDB);  // str 32
+  detail::store_uint32_big_endian(&result[1],
+                                  static_cast<std::uint32_t>(Size - 1));
+  for (std::size_t i = 0; i < Size - 1; ++i) {
+    result[5 + i] = literal[i];
+  }
+  return result;
+}
+
+constexpr std::array<char, 5> encode_map_header(std::uint32_t size) {
+  std::array<char, 5> result{};
+  result[0] = static_cast<char>(0xDF);  // map 32
+  detail::store_uint32_big_endian(&result[1], size);
+  return result;
+}
+
+template <std::size_t Size>
+void pack_encoded(std::string& buffer, const std::array<char, Size>& encoded) {
+  buffer.append(encoded.data(), Size);
+}
+
+constexpr std::size_t string_size(std::size_t length) { return 5 + length; }
+
 inline void pack_integer(std::string& buffer, std::int32_t value) {
   pack_integer(buffer, std::int64_t(value));
 }
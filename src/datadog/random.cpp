@@ -1,6 +1,7 @@
 #include "random.h"
 
 #include <bitset>
+#include <cstddef>
 #include <random>
 
 #include "hex.h"
@@ -12,9 +13,62 @@ namespace {
 
 extern "C" void on_fork();
 
+// `splitmix64` expands seed material into the state of `Xoshiro256PlusPlus`,
+// as recommended by the authors of xoshiro.
+std::uint64_t splitmix64(std::uint64_t& state) {
+  std::uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+// `Xoshiro256PlusPlus` is the xoshiro256++ generator of Blackman and Vigna.
+// Its state is 32 bytes, whereas the state of `std::mt19937_64` is 2.5 KB.
+class Xoshiro256PlusPlus {
+  std::uint64_t state_[4];
+
+  static std::uint64_t rotl(std::uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+  }
+
+ public:
+  void seed(std::random_device& device) {
+    for (auto& word : state_) {
+      std::uint64_t material = device();
+      material = (material << 32) | device();
+      word = splitmix64(material);
+    }
+  }
+
+  std::uint64_t operator()() {
+    const std::uint64_t result = rotl(state_[0] + state_[3], 23) + state_[0];
+    const std::uint64_t t = state_[1] << 17;
+    state_[2] ^= state_[0];
+    state_[3] ^= state_[1];
+    state_[1] ^= state_[2];
+    state_[0] ^= state_[3];
+    state_[2] ^= t;
+    state_[3] = rotl(state_[3], 45);
+    return result;
+  }
+};
+
+// `Uint64Generator` produces values in batches, so that most calls are an
+// array access.
 class Uint64Generator {
-  std::mt19937_64 generator_;
-  std::uniform_int_distribution<std::uint64_t> distribution_;
+  static constexpr std::size_t batch_size = 16;
+
+  Xoshiro256PlusPlus generator_;
+  std::uint64_t batch_[batch_size];
+  // `next_` is the index of the next unused value in `batch_`.
+  std::size_t next_;
+
+  void refill() {
+    for (auto& value : batch_) {
+      value = generator_();
+    }
+    next_ = 0;
+  }
 
  public:
   Uint64Generator() {
@@ -25,13 +79,25 @@ class Uint64Generator {
     // A subsequent call to `exec` would remedy this, but nginx in particular
     // does not call `exec` after forking its worker processes.
     // So, we use `at_fork_in_child` to re-seed `generator_` in the child
-    // process after `fork`.
-    (void)at_fork_in_child(&on_fork);
+    // process after `fork`.  Only the forking thread exists in the child, so
+    // only its generator needs reseeding.
+    static const int registered = at_fork_in_child(&on_fork);
+    (void)registered;
   }
 
-  std::uint64_t operator()() { return distribution_(generator_); }
+  std::uint64_t operator()() {
+    if (next_ == batch_size) {
+      refill();
+    }
+    return batch_[next_++];
+  }
 
-  void seed_with_random() { generator_.seed(std::random_device{}()); }
+  // Seed `generator_` and discard any values already generated.
+  void seed_with_random() {
+    std::random_device device;
+    generator_.seed(device);
+    next_ = batch_size;
+  }
 };
 
 thread_local Uint64Generator thread_local_generator;
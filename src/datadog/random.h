@@ -9,8 +9,9 @@ namespace datadog {
 namespace tracing {
 
 // Return a pseudo-random unsigned 64-bit integer. The sequence generated is
-// thread-local and seeded randomly. The thread-local generator is reseeded when
-// this process forks.
+// thread-local and seeded randomly, using the xoshiro256++ algorithm. Values
+// are generated in small batches. The thread-local generator is reseeded, and
+// its batch discarded, when this process forks.
 std::uint64_t random_uint64();
 
 // Return a pseudo-random UUID in canonical string form as described in RFC
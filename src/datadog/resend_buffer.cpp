@@ -0,0 +1,79 @@
+#include "resend_buffer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+#include "random.h"
+
+namespace datadog {
+namespace tracing {
+
+ResendBuffer::ResendBuffer(std::size_t max_size)
+    : size_(0), max_size_(max_size) {}
+
+std::vector<ResendBuffer::Payload> ResendBuffer::push(Payload&& payload) {
+  std::vector<Payload> discarded;
+  const std::size_t size = payload.body->size();
+  if (size > max_size_) {
+    discarded.push_back(std::move(payload));
+    return discarded;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  while (size_ + size > max_size_) {
+    size_ -= entries_.front().size;
+    discarded.push_back(std::move(entries_.front().payload));
+    entries_.pop_front();
+  }
+  entries_.push_back(Entry{std::move(payload), size});
+  size_ += size;
+  return discarded;
+}
+
+std::vector<ResendBuffer::Payload> ResendBuffer::take_due(
+    std::chrono::steady_clock::time_point now) {
+  std::vector<Payload> result;
+  std::lock_guard<std::mutex> lock(mutex_);
+  const auto not_due = std::stable_partition(
+      entries_.begin(), entries_.end(),
+      [&](const Entry& entry) { return entry.payload.not_before <= now; });
+  for (auto entry = entries_.begin(); entry != not_due; ++entry) {
+    size_ -= entry->size;
+    result.push_back(std::move(entry->payload));
+  }
+  entries_.erase(entries_.begin(), not_due);
+  return result;
+}
+
+std::vector<ResendBuffer::Payload> ResendBuffer::take_all() {
+  std::vector<Payload> result;
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto& entry : entries_) {
+    result.push_back(std::move(entry.payload));
+  }
+  entries_.clear();
+  size_ = 0;
+  return result;
+}
+
+std::size_t ResendBuffer::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return size_;
+}
+
+std::size_t ResendBuffer::max_size() const { return max_size_; }
+
+std::chrono::steady_clock::duration retry_backoff(
+    int attempts, std::chrono::steady_clock::duration initial) {
+  const int doublings = std::min(attempts - 1, 5);
+  const auto delay = initial * (1 << doublings);
+  const auto half = delay / 2;
+  const auto jitter = std::chrono::steady_clock::duration::rep(
+      random_uint64() %
+      (std::uint64_t(half.count() > 0 ? half.count() : 0) + 1));
+  return delay - half + std::chrono::steady_clock::duration(jitter);
+}
+
+}  // namespace tracing
+}  // namespace datadog
@@ -0,0 +1,98 @@
+#pragma once
+
+// This component provides a class, `ResendBuffer`, that holds request bodies
+// of traces that the Datadog Agent failed to accept, until they are retried.
+//
+// When a request that sends traces to the Datadog Agent fails with a network
+// error or a 5xx response, `DatadogAgent` keeps the already encoded request
+// body in a `ResendBuffer`, together with the time before which it must not
+// be retried.  Each subsequent flush sends again the bodies whose time has
+// come.  Retried bodies are never re-encoded.
+//
+// The buffer is limited to a maximum total size of request bodies.  When a
+// body would exceed the limit, the oldest bodies are discarded to make room.
+// Discarded bodies are returned to the caller, which may keep them elsewhere,
+// e.g. in a `Spool`.
+//
+// This component also provides a function, `retry_backoff`, that computes the
+// delay before a retry using exponential backoff with jitter.
+
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+#include "buffer_chain.h"
+
+namespace datadog {
+namespace tracing {
+
+class TraceSampler;
+enum class TracesAPIVersion : char;
+
+class ResendBuffer {
+ public:
+  struct Payload {
+    // `body` is shared with the HTTP requests that send it, and so is not
+    // copied when it is kept for sending again.
+    std::shared_ptr<const BufferChain> body;
+    // The number of trace chunks encoded in `body`.
+    std::size_t num_chunks;
+    TracesAPIVersion version;
+    // The samplers to which the Datadog Agent's response is delivered.
+    std::shared_ptr<const std::unordered_set<std::shared_ptr<TraceSampler>>>
+        samplers;
+    // The number of times that `body` has been sent.
+    int attempts;
+    // `body` is not sent again before `not_before`.
+    std::chrono::steady_clock::time_point not_before;
+  };
+
+ private:
+  struct Entry {
+    Payload payload;
+    std::size_t size;
+  };
+
+  mutable std::mutex mutex_;
+  std::deque<Entry> entries_;
+  std::size_t size_;
+  std::size_t max_size_;
+
+ public:
+  // Create an empty buffer whose request bodies total at most the specified
+  // `max_size` bytes.
+  explicit ResendBuffer(std::size_t max_size);
+
+  // Add the specified `payload` to this buffer.  If its body would make the
+  // buffer exceed its maximum size, then first discard the oldest payloads
+  // until it fits.  If the body alone exceeds the maximum size, then discard
+  // `payload` instead.  Return the discarded payloads, oldest first.
+  std::vector<Payload> push(Payload&& payload);
+
+  // Remove from this buffer, and return in the order added, the payloads
+  // whose `not_before` is not after the specified `now`.
+  std::vector<Payload> take_due(std::chrono::steady_clock::time_point now);
+
+  // Remove from this buffer, and return in the order added, all payloads.
+  std::vector<Payload> take_all();
+
+  // Return the total size, in bytes, of the request bodies in this buffer.
+  std::size_t size() const;
+  std::size_t max_size() const;
+};
+
+// Return how long to wait before sending a request body again after the
+// specified `attempts` failed attempts, given the specified `initial` delay.
+// The delay doubles with each attempt, up to 32 times `initial`.  To keep
+// many tracers from retrying in lockstep, the result is chosen uniformly at
+// random between half of that delay and all of it.  The behavior is undefined
+// unless `attempts` is positive.
+std::chrono::steady_clock::duration retry_backoff(
+    int attempts, std::chrono::steady_clock::duration initial);
+
+}  // namespace tracing
+}  // namespace datadog
@@ -0,0 +1,159 @@
+#include "segment_clock.h"
+
+#include <thread>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define DD_TRACE_HAVE_TSC 1
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+#endif
+
+namespace datadog {
+namespace tracing {
+namespace {
+
+std::uint64_t read_tsc() {
+#ifdef DD_TRACE_HAVE_TSC
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+// Return whether the processor's time stamp counter runs at a constant rate,
+// regardless of frequency scaling and sleep states.
+bool has_invariant_tsc() {
+#ifdef DD_TRACE_HAVE_TSC
+#ifdef _MSC_VER
+  int registers[4];
+  __cpuid(registers, 0x80000000);
+  if (static_cast<unsigned>(registers[0]) < 0x80000007) {
+    return false;
+  }
+  __cpuid(registers, 0x80000007);
+  return registers[3] & (1 << 8);
+#else
+  unsigned eax, ebx, ecx, edx;
+  // `__get_cpuid` fails if the leaf is not supported.
+  if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)) {
+    return false;
+  }
+  return edx & (1u << 8);
+#endif
+#else
+  return false;
+#endif
+}
+
+// `nanoseconds_per_tick` is zero if the time stamp counter cannot be used.
+struct Calibration {
+  double nanoseconds_per_tick;
+};
+
+Calibration calibrate() {
+  if (!has_invariant_tsc()) {
+    return {0};
+  }
+
+  const auto steady_before = std::chrono::steady_clock::now();
+  const std::uint64_t ticks_before = read_tsc();
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  const auto steady_after = std::chrono::steady_clock::now();
+  const std::uint64_t ticks_after = read_tsc();
+
+  if (ticks_after <= ticks_before) {
+    return {0};
+  }
+  const double nanoseconds =
+      std::chrono::duration<double, std::nano>(steady_after - steady_before)
+          .count();
+  const double rate = nanoseconds / double(ticks_after - ticks_before);
+  // A counter running slower than 100 MHz or faster than 20 GHz indicates that
+  // something is wrong, e.g. a virtual machine that emulates the counter.
+  if (rate > 10.0 || rate < 0.05) {
+    return {0};
+  }
+  return {rate};
+}
+
+const Calibration& calibration() {
+  static const Calibration instance = calibrate();
+  return instance;
+}
+
+}  // namespace
+
+SegmentClock::SegmentClock(const Clock& clock, ClockMode mode)
+    : mode_(mode), anchor_ticks_(0) {
+  if (mode_ == ClockMode::TSC && !tsc_available()) {
+    mode_ = ClockMode::SEGMENT_ANCHORED;
+  }
+  if (mode_ == ClockMode::DEFAULT) {
+    clock_ = clock;
+    return;
+  }
+
+  anchor_.wall = std::chrono::system_clock::now();
+  anchor_.tick = std::chrono::steady_clock::now();
+  if (mode_ == ClockMode::TSC) {
+    anchor_ticks_ = read_tsc();
+  }
+}
+
+ClockMode SegmentClock::mode() const { return mode_; }
+
+TimePoint SegmentClock::now() const {
+  if (mode_ == ClockMode::DEFAULT) {
+    return clock_();
+  }
+
+  const auto steady = tick();
+  return TimePoint{
+      anchor_.wall +
+          std::chrono::duration_cast<std::chrono::system_clock::duration>(
+              steady - anchor_.tick),
+      steady};
+}
+
+std::chrono::steady_clock::time_point SegmentClock::tick() const {
+  switch (mode_) {
+    case ClockMode::DEFAULT:
+      return clock_().tick;
+    case ClockMode::SEGMENT_ANCHORED:
+      return std::chrono::steady_clock::now();
+    case ClockMode::TSC:
+      break;
+  }
+
+  // The counters of different processors might differ slightly, so the
+  // elapsed ticks might be negative.
+  const auto elapsed = static_cast<std::int64_t>(read_tsc() - anchor_ticks_);
+  const std::chrono::duration<double, std::nano> offset{
+      double(elapsed) * calibration().nanoseconds_per_tick};
+  return anchor_.tick +
+         std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+             offset);
+}
+
+std::chrono::steady_clock::time_point SegmentClock::convert(
+    std::chrono::steady_clock::time_point time) const {
+  if (mode_ != ClockMode::TSC) {
+    return time;
+  }
+  return time + (tick() - std::chrono::steady_clock::now());
+}
+
+TimePoint SegmentClock::convert(const TimePoint& time) const {
+  return TimePoint{time.wall, convert(time.tick)};
+}
+
+bool SegmentClock::tsc_available() {
+  return calibration().nanoseconds_per_tick != 0;
+}
+
+}  // namespace tracing
+}  // namespace datadog
@@ -0,0 +1,74 @@
+#pragma once
+
+// This component provides a class, `SegmentClock`, that measures the start
+// times and durations of the spans in a trace segment, according to a
+// `ClockMode` (see `clock.h`).
+//
+// In `ClockMode::DEFAULT`, `SegmentClock` calls the configured `Clock`, which
+// by default reads both the system clock and the steady clock, each time a
+// span starts or finishes.
+//
+// In the other modes, the system clock is read only once, when the trace
+// segment is created.  That reading, paired with a reading of the steady
+// clock, is the segment's _anchor_.  Span start times are the anchor plus the
+// steady time elapsed since the anchor, and span durations use only steady
+// time.  These modes ignore the configured `Clock`, and instead read the
+// system's clocks directly.
+//
+// In `ClockMode::TSC`, steady time within the segment is the anchor's steady
+// time plus the number of time stamp counter ticks since the anchor, converted
+// to nanoseconds using a rate that is measured once per process.  Since each
+// segment has its own anchor, the conversion error accumulates only over the
+// lifetime of a segment, rather than over the lifetime of the process.  Times
+// that the user reads from the steady clock, e.g. a span's explicit end time,
+// are converted using `convert`, so that they are consistent with the times
+// that this clock measures.
+
+#include <chrono>
+#include <cstdint>
+
+#include "clock.h"
+
+namespace datadog {
+namespace tracing {
+
+class SegmentClock {
+  Clock clock_;
+  ClockMode mode_;
+  TimePoint anchor_;
+  std::uint64_t anchor_ticks_;
+
+ public:
+  // Create a clock for a new trace segment that uses the specified `clock` or
+  // the specified `mode`.  Read the anchor now, unless `mode` is `DEFAULT`.
+  // If `mode` is `TSC` but `tsc_available()` is false, then use
+  // `SEGMENT_ANCHORED` instead.
+  SegmentClock(const Clock& clock, ClockMode mode);
+
+  // Return the mode that this clock uses.
+  ClockMode mode() const;
+
+  // Return the current time.
+  TimePoint now() const;
+
+  // Return the current time according to the steady clock.  This is
+  // equivalent to `now().tick`, but might be cheaper.
+  std::chrono::steady_clock::time_point tick() const;
+
+  // Return the specified `time`, which was read from the steady clock (or,
+  // in `ClockMode::DEFAULT`, from the configured `Clock`), as a time on this
+  // clock.  In `ClockMode::TSC`, `time` is shifted by the current difference
+  // between this clock and the steady clock.  In the other modes, `time` is
+  // returned unchanged.
+  std::chrono::steady_clock::time_point convert(
+      std::chrono::steady_clock::time_point time) const;
+  // Return the specified `time` with its steady time converted as above.
+  TimePoint convert(const TimePoint& time) const;
+
+  // Return whether this process can use `ClockMode::TSC`.  The first call
+  // calibrates the time stamp counter, which takes several milliseconds.
+  static bool tsc_available();
+};
+
+}  // namespace tracing
+}  // namespace datadog
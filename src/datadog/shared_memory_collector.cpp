@@ -0,0 +1,42 @@
+#include "shared_memory_collector.h"
+
+#include <string>
+#include <utility>
+
+#include "json.hpp"
+#include "shared_memory_ring.h"
+#include "span_data.h"
+
+namespace datadog {
+namespace tracing {
+
+SharedMemoryCollector::SharedMemoryCollector(
+    std::shared_ptr<SharedMemoryRing> ring)
+    : ring_(std::move(ring)) {}
+
+Expected<void> SharedMemoryCollector::send(
+    std::vector<std::unique_ptr<SpanData>>&& spans,
+    const std::shared_ptr<TraceSampler>& /*response_handler*/) {
+  std::string encoded;
+  encoded.reserve(msgpack_encoded_size(spans));
+  auto result = msgpack_encode(encoded, spans);
+  if (!result) {
+    return result;
+  }
+  ring_->push(encoded, spans.size(), is_kept(spans));
+  return {};
+}
+
+nlohmann::json SharedMemoryCollector::config_json() const {
+  // clang-format off
+  return nlohmann::json::object({
+    {"type", "datadog::tracing::SharedMemoryCollector"},
+    {"config", nlohmann::json::object({
+      {"capacity_bytes", ring_->capacity()},
+    })},
+  });
+  // clang-format on
+}
+
+}  // namespace tracing
+}  // namespace datadog
@@ -0,0 +1,39 @@
+#pragma once
+
+// This component provides a `class`, `SharedMemoryCollector`, that implements
+// the `Collector` interface by appending encoded trace chunks to a
+// `SharedMemoryRing`, from which another process sends them to the Datadog
+// Agent.  See `shared_memory_ring.h`.
+//
+// A `SharedMemoryCollector` has no threads and makes no requests of its own,
+// so it's suitable for the worker processes of a prefork server, e.g. nginx.
+// Trace chunks are encoded in version 0.4 of the Datadog Agent's traces API.
+// The Datadog Agent's sampling rates are not delivered to workers' samplers.
+
+#include <memory>
+
+#include "collector.h"
+
+namespace datadog {
+namespace tracing {
+
+class SharedMemoryRing;
+
+class SharedMemoryCollector : public Collector {
+  std::shared_ptr<SharedMemoryRing> ring_;
+
+ public:
+  explicit SharedMemoryCollector(std::shared_ptr<SharedMemoryRing> ring);
+
+  // Encode the specified `spans` and append them to the ring.  If the ring is
+  // full, then the spans are dropped and counted in the ring's
+  // `dropped_chunks()`.  `response_handler` is ignored.
+  Expected<void> send(
+      std::vector<std::unique_ptr<SpanData>>&& spans,
+      const std::shared_ptr<TraceSampler>& response_handler) override;
+
+  nlohmann::json config_json() const override;
+};
+
+}  // namespace tracing
+}  // namespace datadog
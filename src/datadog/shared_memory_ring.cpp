@@ -0,0 +1,303 @@
+#include "shared_memory_ring.h"
+
+#ifndef _MSC_VER
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <string>
+
+#include "error.h"
+
+namespace datadog {
+namespace tracing {
+namespace {
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free,
+              "SharedMemoryRing requires lock-free 64-bit atomics, so that "
+              "they work across processes.");
+static_assert(std::atomic<std::int64_t>::is_always_lock_free,
+              "SharedMemoryRing requires lock-free 64-bit atomics, so that "
+              "they work across processes.");
+
+// A record is an 8-byte header, followed by the number of spans in the trace
+// chunk (4 bytes), whether the chunk is kept (4 bytes), and then the chunk's
+// encoding.  Records are padded to a multiple of 8 bytes, so that headers are
+// aligned and never wrap around the end of the ring.
+//
+// The low 32 bits of the header are the size of the record after the header.
+// Bit 32 is set once the record is committed.  Bits 33 through 62 are the
+// process ID of the producer.  Bit 63 is never set in a header.  Instead, it
+// is set in the marker of a free word, whose other bits are the word's
+// logical position divided by 8.  Since the marker includes the position, a
+// producer that read the tail before the ring wrapped around cannot mistake
+// the word for free.
+constexpr std::size_t record_header_size = 8;
+constexpr std::size_t record_fields_size = 8;
+constexpr std::uint64_t committed_bit = std::uint64_t(1) << 32;
+constexpr int pid_shift = 33;
+constexpr std::uint64_t pid_mask = (std::uint64_t(1) << 30) - 1;
+constexpr std::uint64_t free_bit = std::uint64_t(1) << 63;
+
+std::uint64_t padded(std::uint64_t size) { return (size + 7) & ~7ULL; }
+
+// Return the marker of a free word at the specified logical `position`.
+std::uint64_t free_marker(std::uint64_t position) {
+  return free_bit | (position >> 3);
+}
+
+// Return whether the process having the specified `pid` exists.
+bool process_exists(std::uint64_t pid) {
+#ifdef _MSC_VER
+  (void)pid;
+  return true;
+#else
+  return ::kill(pid_t(pid), 0) == 0 || errno != ESRCH;
+#endif
+}
+
+}  // namespace
+
+// `Shared` is at the beginning of the shared mapping.  The producers' `tail`
+// and the consumer's `head` are on separate cache lines.  Positions are
+// logical: they only increase, and the byte at logical position `p` is at
+// offset `p % capacity` within the ring.
+struct SharedMemoryRing::Shared {
+  alignas(64) std::atomic<std::uint64_t> tail;
+  std::atomic<std::uint64_t> dropped_chunks;
+  alignas(64) std::atomic<std::uint64_t> head;
+  std::atomic<std::int64_t> consumer_pid;
+};
+
+Expected<std::shared_ptr<SharedMemoryRing>> SharedMemoryRing::create(
+    std::size_t size) {
+#ifdef _MSC_VER
+  (void)size;
+  return Error{Error::SHARED_MEMORY_RING_FAILURE,
+               "SharedMemoryRing: Shared memory is not supported on Windows."};
+#else
+  const std::size_t min_size = sizeof(Shared) + 4096;
+  if (size < min_size) {
+    std::string message;
+    message += "SharedMemoryRing: The size of the ring must be at least ";
+    message += std::to_string(min_size);
+    message += " bytes.";
+    return Error{Error::SHARED_MEMORY_RING_FAILURE, std::move(message)};
+  }
+  void* const mapping = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                               MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (mapping == MAP_FAILED) {
+    const int error_number = errno;
+    std::string message;
+    message += "SharedMemoryRing: Unable to map ";
+    message += std::to_string(size);
+    message += " bytes of shared memory: ";
+    message += std::strerror(error_number);
+    return Error{Error::SHARED_MEMORY_RING_FAILURE, std::move(message)};
+  }
+  return std::shared_ptr<SharedMemoryRing>(
+      new SharedMemoryRing(mapping, size));
+#endif
+}
+
+SharedMemoryRing::SharedMemoryRing(void* mapping, std::size_t mapping_size)
+    : shared_(new (mapping) Shared{}),
+      ring_(static_cast<char*>(mapping) + sizeof(Shared)),
+      capacity_((mapping_size - sizeof(Shared)) & ~std::size_t(7)),
+      mapping_size_(mapping_size) {
+  for (std::uint64_t position = 0; position < capacity_;
+       position += record_header_size) {
+    header_at(position).store(free_marker(position),
+                              std::memory_order_relaxed);
+  }
+}
+
+SharedMemoryRing::~SharedMemoryRing() {
+#ifndef _MSC_VER
+  // Each process unmaps its own view of the memory.  The memory itself is
+  // freed once every process has unmapped it.
+  ::munmap(shared_, mapping_size_);
+#endif
+}
+
+void SharedMemoryRing::write(std::uint64_t position, const char* source,
+                             std::size_t size) {
+  const std::size_t offset = std::size_t(position % capacity_);
+  const std::size_t first = std::min(size, capacity_ - offset);
+  std::memcpy(ring_ + offset, source, first);
+  std::memcpy(ring_, source + first, size - first);
+}
+
+void SharedMemoryRing::read(std::uint64_t position, char* destination,
+                            std::size_t size) const {
+  const std::size_t offset = std::size_t(position % capacity_);
+  const std::size_t first = std::min(size, capacity_ - offset);
+  std::memcpy(destination, ring_ + offset, first);
+  std::memcpy(destination + first, ring_, size - first);
+}
+
+std::atomic<std::uint64_t>& SharedMemoryRing::header_at(
+    std::uint64_t position) const {
+  return *reinterpret_cast<std::atomic<std::uint64_t>*>(
+      ring_ + position % capacity_);
+}
+
+void SharedMemoryRing::release(std::uint64_t position, std::size_t size) {
+  const std::uint64_t end = position + size;
+  for (; position != end; position += record_header_size) {
+    header_at(position).store(free_marker(position + capacity_),
+                              std::memory_order_relaxed);
+  }
+}
+
+bool SharedMemoryRing::push(StringView encoded_chunk, std::size_t num_spans,
+                            bool keep) {
+  const std::uint64_t size = record_fields_size + encoded_chunk.size();
+  const std::uint64_t record_size = padded(record_header_size + size);
+  if (size >= committed_bit || record_size > capacity_) {
+    shared_->dropped_chunks.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+#ifdef _MSC_VER
+  const std::uint64_t pid = 0;
+#else
+  const std::uint64_t pid = std::uint64_t(::getpid()) & pid_mask;
+#endif
+  const std::uint64_t reserved = size | (pid << pid_shift);
+
+  // Reserve the record by replacing the free marker at the tail with a header
+  // naming this process, so that the consumer can skip the record if this
+  // process dies before committing it.
+  std::uint64_t position = shared_->tail.load(std::memory_order_acquire);
+  for (;;) {
+    const std::uint64_t head = shared_->head.load(std::memory_order_acquire);
+    if (head > position) {
+      // The tail has moved on since it was loaded.
+      position = shared_->tail.load(std::memory_order_acquire);
+      continue;
+    }
+    if (position + record_size - head > capacity_) {
+      shared_->dropped_chunks.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    std::uint64_t value = free_marker(position);
+    if (header_at(position).compare_exchange_strong(
+            value, reserved, std::memory_order_acq_rel)) {
+      break;
+    }
+    if (value & free_bit) {
+      // `position` is a lap behind.
+      position = shared_->tail.load(std::memory_order_acquire);
+      continue;
+    }
+    // Another producer reserved `position`.  Advance the tail past its record
+    // on its behalf, in case it hasn't yet.  If `position` is no longer the
+    // tail, then `value` might not be a header, but then the exchange fails.
+    const std::uint64_t next =
+        position + padded(record_header_size + (value & (committed_bit - 1)));
+    if (shared_->tail.compare_exchange_strong(position, next,
+                                              std::memory_order_acq_rel)) {
+      position = next;
+    }
+  }
+  std::uint64_t expected_tail = position;
+  shared_->tail.compare_exchange_strong(expected_tail, position + record_size,
+                                        std::memory_order_acq_rel);
+
+  char fields[record_fields_size];
+  const auto num_spans32 = std::uint32_t(num_spans);
+  const std::uint32_t keep32 = keep;
+  std::memcpy(fields, &num_spans32, 4);
+  std::memcpy(fields + 4, &keep32, 4);
+  write(position + record_header_size, fields, sizeof fields);
+  write(position + record_header_size + sizeof fields, encoded_chunk.data(),
+        encoded_chunk.size());
+
+  header_at(position).store(reserved | committed_bit,
+                            std::memory_order_release);
+  return true;
+}
+
+Expected<void> SharedMemoryRing::claim_consumer() {
+#ifdef _MSC_VER
+  return Error{Error::SHARED_MEMORY_RING_FAILURE,
+               "SharedMemoryRing: Shared memory is not supported on Windows."};
+#else
+  const std::int64_t pid = ::getpid();
+  std::int64_t consumer = shared_->consumer_pid.load(std::memory_order_acquire);
+  while (consumer != pid) {
+    // A process that no longer exists can be replaced, e.g. when nginx
+    // restarts a worker.
+    if (consumer != 0 && process_exists(std::uint64_t(consumer))) {
+      std::string message;
+      message += "SharedMemoryRing: Process ";
+      message += std::to_string(consumer);
+      message += " is already consuming the ring.";
+      return Error{Error::SHARED_MEMORY_RING_FAILURE, std::move(message)};
+    }
+    if (shared_->consumer_pid.compare_exchange_weak(
+            consumer, pid, std::memory_order_acq_rel)) {
+      break;
+    }
+  }
+  return {};
+#endif
+}
+
+std::size_t SharedMemoryRing::pop_all(const Visitor& visit) {
+  std::uint64_t head = shared_->head.load(std::memory_order_relaxed);
+  const std::uint64_t tail = shared_->tail.load(std::memory_order_acquire);
+  const std::uint64_t start = head;
+  std::size_t count = 0;
+  std::string record;
+
+  while (head != tail) {
+    // Every record before the tail has a header, because the tail advances
+    // only past a record whose header has been read.
+    const std::uint64_t value =
+        header_at(head).load(std::memory_order_acquire);
+    const std::uint64_t size = value & (committed_bit - 1);
+    const std::uint64_t record_size = padded(record_header_size + size);
+    if (value & committed_bit) {
+      record.resize(std::size_t(size));
+      read(head + record_header_size, &record[0], record.size());
+      std::uint32_t num_spans;
+      std::uint32_t keep;
+      std::memcpy(&num_spans, record.data(), 4);
+      std::memcpy(&keep, record.data() + 4, 4);
+      visit(StringView(record).substr(record_fields_size), num_spans,
+            keep != 0);
+      ++count;
+    } else if (process_exists((value >> pid_shift) & pid_mask)) {
+      // The producer is still writing.  Try again next time.
+      break;
+    } else {
+      // The producer died before committing.  Skip its record.
+      shared_->dropped_chunks.fetch_add(1, std::memory_order_relaxed);
+    }
+    head += record_size;
+  }
+
+  // Mark the words of the records removed as free, and then release the room
+  // to producers.
+  if (head != start) {
+    release(start, std::size_t(head - start));
+    shared_->head.store(head, std::memory_order_release);
+  }
+  return count;
+}
+
+std::uint64_t SharedMemoryRing::dropped_chunks() const {
+  return shared_->dropped_chunks.load(std::memory_order_relaxed);
+}
+
+std::size_t SharedMemoryRing::capacity() const { return capacity_; }
+
+}  // namespace tracing
+}  // namespace datadog
@@ -0,0 +1,119 @@
+#pragma once
+
+// This component provides a class, `SharedMemoryRing`, that is a lock-free
+// ring buffer of encoded trace chunks in memory shared by several processes.
+//
+// In a prefork deployment, e.g. nginx, each worker process would otherwise
+// run its own `DatadogAgent`, with its own threads and connections, and each
+// would send its own small request to the Datadog Agent every flush interval.
+// Instead, the parent process creates a `SharedMemoryRing` before it forks
+// the workers.  Each worker's tracer uses a `SharedMemoryCollector` (see
+// `shared_memory_collector.h`), which encodes each trace chunk and appends it
+// to the ring.  One designated process configures its `DatadogAgent` with the
+// ring (see `DatadogAgentConfig::shared_memory_ring`), and each flush of that
+// `DatadogAgent` removes every trace chunk from the ring and sends them to
+// the Datadog Agent together with its own.
+//
+// The ring has any number of producers and a single consumer.  Every free
+// 8-byte word of the ring holds a marker of its own logical position.  A
+// producer reserves room for a record by replacing, using compare-and-swap,
+// the marker at the tail with the record's header, which contains the
+// record's size and the producer's process ID.  Then it advances the tail
+// past the record, writes the record, and commits it by setting a bit in the
+// header with release semantics.  A producer that finds the header of
+// another producer's record at the tail advances the tail past it on that
+// producer's behalf.  When there isn't room for a record, the producer drops
+// it and counts it in `dropped_chunks()`.
+//
+// The consumer visits committed records from the head, marks the words that
+// they occupied as free, and then advances the head, which releases the room
+// to producers.  Since every reserved record has a header that names its
+// producer, the consumer never has to guess at a record's size or owner: if
+// it finds an uncommitted record at the head of the ring whose process no
+// longer exists, then it skips the record and counts it in
+// `dropped_chunks()`, and otherwise it waits for the record to be committed.
+// A producer that stalls before reserving finds, when it resumes, that the
+// marker it expected is gone, and so it cannot overwrite other records.
+//
+// `SharedMemoryRing` is not supported on Windows.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include "expected.h"
+#include "string_view.h"
+
+namespace datadog {
+namespace tracing {
+
+class SharedMemoryRing {
+  struct Shared;
+
+  // `shared_` and `ring_` are in the shared mapping, which is `mapping_size_`
+  // bytes.
+  Shared* shared_;
+  char* ring_;
+  std::size_t capacity_;
+  std::size_t mapping_size_;
+
+  SharedMemoryRing(void* mapping, std::size_t mapping_size);
+
+  // Copy the specified `size` bytes from the specified `source` into the ring
+  // starting at the specified logical `position`, wrapping around the end of
+  // the ring.
+  void write(std::uint64_t position, const char* source, std::size_t size);
+  // Copy the specified `size` bytes from the ring starting at the specified
+  // logical `position` into the specified `destination`, wrapping around the
+  // end of the ring.
+  void read(std::uint64_t position, char* destination, std::size_t size) const;
+  // Return the header of the record at the specified logical `position`.
+  std::atomic<std::uint64_t>& header_at(std::uint64_t position) const;
+  // Mark as free the specified `size` bytes of the ring starting at the
+  // specified logical `position`, for their next use one lap later.
+  void release(std::uint64_t position, std::size_t size);
+
+ public:
+  // `Visitor` is invoked by `pop_all` with the encoding of a trace chunk, the
+  // number of spans in the chunk, and whether the chunk's sampling priority
+  // is positive.
+  using Visitor = std::function<void(StringView encoded_chunk,
+                                     std::size_t num_spans, bool keep)>;
+
+  // Return a ring that occupies the specified `size` bytes of memory that is
+  // shared with child processes that are subsequently forked.  Return an
+  // error if the memory cannot be mapped, or if `size` is too small.
+  static Expected<std::shared_ptr<SharedMemoryRing>> create(std::size_t size);
+
+  SharedMemoryRing(const SharedMemoryRing&) = delete;
+  SharedMemoryRing& operator=(const SharedMemoryRing&) = delete;
+  ~SharedMemoryRing();
+
+  // Append a record containing the specified `encoded_chunk`, `num_spans`,
+  // and `keep`.  Return whether there was room for it.  If there wasn't, then
+  // count the chunk in `dropped_chunks()`.  `push` may be called by any
+  // number of threads in any number of processes concurrently.
+  bool push(StringView encoded_chunk, std::size_t num_spans, bool keep);
+
+  // Make the calling process the ring's consumer, unless another process that
+  // is still running already is.  Return an error if it is.
+  Expected<void> claim_consumer();
+
+  // Remove every committed record from the ring, and invoke the specified
+  // `visit` with each of them in the order in which they were reserved.
+  // Return the number of records visited.  Only the consumer may call
+  // `pop_all`, from one thread at a time.
+  std::size_t pop_all(const Visitor& visit);
+
+  // Return the number of trace chunks that were dropped, because the ring was
+  // full or because their producer died before committing them.  This is
+  // the total for all processes using the ring.
+  std::uint64_t dropped_chunks() const;
+  // Return the number of bytes available for records.
+  std::size_t capacity() const;
+};
+
+}  // namespace tracing
+}  // namespace datadog
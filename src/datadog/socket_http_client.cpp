@@ -0,0 +1,867 @@
+#include "socket_http_client.h"
+
+#ifdef __linux__
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <unordered_map>
+#include <utility>
+
+#include "dict_reader.h"
+#include "dict_writer.h"
+#include "http_response_parser.h"
+#include "json.hpp"
+#include "logger.h"
+#include "parse_util.h"
+
+namespace datadog {
+namespace tracing {
+namespace {
+
+// `HeaderWriter` appends each header to the head of a request.
+class HeaderWriter : public DictWriter {
+  std::string& head_;
+
+ public:
+  explicit HeaderWriter(std::string& head) : head_(head) {}
+
+  void set(StringView key, StringView value) override {
+    head_.append(key.data(), key.size());
+    head_ += ": ";
+    head_.append(value.data(), value.size());
+    head_ += "\r\n";
+  }
+};
+
+// `HeaderReader` looks up response headers, whose keys are in lower case.
+class HeaderReader : public DictReader {
+  const std::unordered_map<std::string, std::string>& headers_;
+  mutable std::string buffer_;
+
+ public:
+  explicit HeaderReader(
+      const std::unordered_map<std::string, std::string>& headers)
+      : headers_(headers) {}
+
+  Optional<StringView> lookup(StringView key) const override {
+    buffer_.assign(key.data(), key.size());
+    to_lower(buffer_);
+    const auto found = headers_.find(buffer_);
+    if (found == headers_.end()) {
+      return nullopt;
+    }
+    return found->second;
+  }
+
+  void visit(const std::function<void(StringView key, StringView value)>&
+                 visitor) const override {
+    for (const auto& [key, value] : headers_) {
+      visitor(key, value);
+    }
+  }
+};
+
+bool is_unix_scheme(StringView scheme) {
+  return scheme == "unix" || scheme == "http+unix";
+}
+
+// Store in the specified `host` and `port` the host and port of the
+// specified `authority`, which is "host", "host:port", or
+// "[IPv6 address]:port".  The default port is 80.
+void split_authority(const std::string& authority, std::string& host,
+                     std::string& port) {
+  host = authority;
+  port = "80";
+  const std::size_t colon = authority.rfind(':');
+  if (colon != std::string::npos &&
+      authority.find(']', colon) == std::string::npos) {
+    host = authority.substr(0, colon);
+    port = authority.substr(colon + 1);
+  }
+  if (host.size() >= 2 && host.front() == '[' && host.back() == ']') {
+    host = host.substr(1, host.size() - 2);
+  }
+}
+
+}  // namespace
+
+struct SocketHTTPClient::Request {
+  std::string endpoint;
+  // `addresses` are the resolved addresses of a TCP endpoint.  They are null
+  // if the endpoint is a unix domain socket, or if resolution failed, in
+  // which case `resolve_error` describes the failure.
+  std::shared_ptr<const std::vector<Address>> addresses;
+  std::string resolve_error;
+  std::string head;
+  std::shared_ptr<const BufferChain> body;
+  ResponseHandler on_response;
+  ErrorHandler on_error;
+  std::chrono::steady_clock::time_point deadline;
+  // `resent` is whether the request was already sent again after a reused
+  // connection was found to be closed.
+  bool resent = false;
+};
+
+// An `Endpoint` is a socket path, or a host and port, together with its
+// connections and the requests waiting for one of them.
+struct SocketHTTPClient::Endpoint {
+  HTTPClient::URL url;
+  // `addresses` are the addresses of a TCP endpoint most recently resolved.
+  std::shared_ptr<const std::vector<Address>> addresses;
+  std::deque<std::unique_ptr<Request>> queue;
+  std::vector<Connection*> idle;
+  std::size_t num_connections = 0;
+};
+
+struct SocketHTTPClient::Connection {
+  // `fd` is -1 once the connection is closed.  Closed connections are
+  // destroyed after the current batch of events is handled, since later
+  // events in the batch might refer to them.
+  int fd;
+  Endpoint* endpoint;
+  // `connecting` is whether a nonblocking connect is in progress.
+  bool connecting;
+  // `reused` is whether a response was already received on the connection.
+  bool reused = false;
+  // `events` are the epoll events for which `fd` is registered.
+  unsigned events = 0;
+  // If the connection is over TCP, then `next_address` is the index within
+  // `addresses` of the address to try if connecting to the current one
+  // fails.
+  std::shared_ptr<const std::vector<Address>> addresses;
+  std::size_t next_address = 0;
+  std::unique_ptr<Request> request;
+  // `sent` is the number of bytes of the request's head and body written.
+  std::size_t sent = 0;
+  HTTPResponseParser parser;
+};
+
+#ifdef __linux__
+
+struct SocketHTTPClient::Address {
+  sockaddr_storage storage;
+  socklen_t length;
+  int family;
+  int protocol;
+};
+
+SocketHTTPClient::SocketHTTPClient(const std::shared_ptr<Logger>& logger,
+                                   const Clock& clock,
+                                   std::size_t max_connections_per_endpoint)
+    : logger_(logger),
+      clock_(clock),
+      max_connections_per_endpoint_(
+          std::max<std::size_t>(1, max_connections_per_endpoint)),
+      epoll_(::epoll_create1(EPOLL_CLOEXEC)),
+      wakeup_(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+      num_active_(0),
+      shutting_down_(false),
+      new_connections_(0),
+      reused_connections_(0) {
+  epoll_event event;
+  event.events = EPOLLIN;
+  event.data.ptr = nullptr;
+  if (epoll_ == -1 || wakeup_ == -1 ||
+      ::epoll_ctl(epoll_, EPOLL_CTL_ADD, wakeup_, &event) != 0) {
+    const int error_number = errno;
+    logger_->log_error(Error{
+        Error::SOCKET_HTTP_CLIENT_SETUP_FAILED,
+        std::string("SocketHTTPClient: Unable to create an event loop: ") +
+            std::strerror(error_number)});
+    if (epoll_ != -1) {
+      ::close(epoll_);
+      epoll_ = -1;
+    }
+    return;
+  }
+
+  event_loop_ = std::thread([this]() { run(); });
+}
+
+SocketHTTPClient::~SocketHTTPClient() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutting_down_ = true;
+  }
+  if (event_loop_.joinable()) {
+    wake();
+    event_loop_.join();
+  }
+  for (const auto& connection : connections_) {
+    if (connection->fd != -1) {
+      ::close(connection->fd);
+    }
+  }
+  if (epoll_ != -1) {
+    ::close(epoll_);
+  }
+  if (wakeup_ != -1) {
+    ::close(wakeup_);
+  }
+}
+
+Expected<void> SocketHTTPClient::start(
+    const URL& url, HeadersSetter set_headers,
+    std::shared_ptr<const BufferChain> body, ResponseHandler on_response,
+    ErrorHandler on_error, std::chrono::steady_clock::time_point deadline) {
+  if (epoll_ == -1) {
+    return Error{Error::SOCKET_HTTP_CLIENT_SETUP_FAILED,
+                 "SocketHTTPClient: The event loop is not running."};
+  }
+  const bool unix_socket = is_unix_scheme(url.scheme);
+  if (!unix_socket && url.scheme != "http") {
+    return Error{Error::SOCKET_HTTP_CLIENT_UNSUPPORTED_URL,
+                 "SocketHTTPClient: Unsupported URL scheme \"" + url.scheme +
+                     "\".  Supported schemes are unix, http+unix, and http."};
+  }
+
+  auto request = std::make_unique<Request>();
+  request->endpoint = (unix_socket ? "unix:" : "http:") + url.authority;
+  if (!unix_socket) {
+    // A failure is reported by the event loop, as connection failures are.
+    request->addresses = resolve(url.authority, request->resolve_error);
+  }
+  std::string& head = request->head;
+  head += "POST ";
+  head += url.path.empty() ? "/" : url.path;
+  head += " HTTP/1.1\r\nHost: ";
+  head += unix_socket ? "localhost" : url.authority;
+  head += "\r\n";
+  HeaderWriter writer{head};
+  set_headers(writer);
+  head += "Content-Length: ";
+  head += std::to_string(body->size());
+  head += "\r\n\r\n";
+  request->body = std::move(body);
+  request->on_response = std::move(on_response);
+  request->on_error = std::move(on_error);
+  request->deadline = deadline;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    new_requests_.push_back(std::move(request));
+    ++num_active_;
+  }
+  wake();
+  return {};
+}
+
+std::shared_ptr<const std::vector<SocketHTTPClient::Address>>
+SocketHTTPClient::resolve(const std::string& authority, std::string& error) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto found = addresses_.find(authority);
+    if (found != addresses_.end()) {
+      return found->second;
+    }
+  }
+
+  // Resolve without holding the lock, since it might take a while.
+  std::string host;
+  std::string port;
+  split_authority(authority, host, port);
+  addrinfo hints;
+  std::memset(&hints, 0, sizeof hints);
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo* list = nullptr;
+  const int rcode = ::getaddrinfo(host.c_str(), port.c_str(), &hints, &list);
+  if (rcode != 0) {
+    error = "Unable to resolve " + authority + ": " + ::gai_strerror(rcode);
+    return nullptr;
+  }
+  auto addresses = std::make_shared<std::vector<Address>>();
+  for (const addrinfo* info = list; info; info = info->ai_next) {
+    if (info->ai_addrlen > sizeof(sockaddr_storage)) {
+      continue;
+    }
+    Address address;
+    std::memcpy(&address.storage, info->ai_addr, info->ai_addrlen);
+    address.length = info->ai_addrlen;
+    address.family = info->ai_family;
+    address.protocol = info->ai_protocol;
+    addresses->push_back(address);
+  }
+  ::freeaddrinfo(list);
+  if (addresses->empty()) {
+    error = "Unable to resolve " + authority + ": No addresses.";
+    return nullptr;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  return addresses_.emplace(authority, std::move(addresses)).first->second;
+}
+
+void SocketHTTPClient::forget_addresses(const std::string& authority) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  addresses_.erase(authority);
+}
+
+void SocketHTTPClient::wake() {
+  const std::uint64_t one = 1;
+  // The only possible failure is that the counter would overflow, in which
+  // case the event loop is already due to wake up.
+  (void)!::write(wakeup_, &one, sizeof one);
+}
+
+void SocketHTTPClient::run() {
+  epoll_event events[64];
+  for (;;) {
+    // Wait until the earliest deadline of any request.
+    auto earliest = std::chrono::steady_clock::time_point::max();
+    for (const auto& connection : connections_) {
+      if (connection->request) {
+        earliest = std::min(earliest, connection->request->deadline);
+      }
+    }
+    for (const auto& [key, endpoint] : endpoints_) {
+      (void)key;
+      for (const auto& request : endpoint->queue) {
+        earliest = std::min(earliest, request->deadline);
+      }
+    }
+    int timeout_ms = -1;
+    if (earliest != std::chrono::steady_clock::time_point::max()) {
+      const auto remaining = std::chrono::ceil<std::chrono::milliseconds>(
+          earliest - clock_().tick);
+      timeout_ms = int(std::clamp<std::chrono::milliseconds::rep>(
+          remaining.count(), 0, 60 * 1000));
+    }
+
+    const int count = ::epoll_wait(epoll_, events, 64, timeout_ms);
+    for (int i = 0; i < count; ++i) {
+      auto* const connection = static_cast<Connection*>(events[i].data.ptr);
+      if (connection == nullptr) {
+        std::uint64_t value;
+        (void)!::read(wakeup_, &value, sizeof value);
+      } else if (connection->fd != -1) {
+        handle_events(*connection, events[i].events);
+      }
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (shutting_down_) {
+        return;
+      }
+    }
+    take_new_requests();
+    expire_requests();
+
+    connections_.erase(
+        std::remove_if(connections_.begin(), connections_.end(),
+                       [](const auto& connection) {
+                         return connection->fd == -1;
+                       }),
+        connections_.end());
+  }
+}
+
+void SocketHTTPClient::take_new_requests() {
+  std::vector<std::unique_ptr<Request>> requests;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    requests.swap(new_requests_);
+  }
+
+  const auto now = clock_().tick;
+  std::vector<Endpoint*> to_dispatch;
+  for (auto& request : requests) {
+    if (request->deadline <= now) {
+      fail(std::move(request),
+           Error{Error::SOCKET_HTTP_REQUEST_TIMEOUT,
+                 "Request deadline exceeded before request was even added "
+                 "to the event loop."});
+      continue;
+    }
+    if (!request->resolve_error.empty()) {
+      std::string message = std::move(request->resolve_error);
+      fail(std::move(request),
+           Error{Error::SOCKET_HTTP_REQUEST_FAILURE, std::move(message)});
+      continue;
+    }
+    auto& endpoint = endpoints_[request->endpoint];
+    if (!endpoint) {
+      endpoint = std::make_unique<Endpoint>();
+      const auto colon = request->endpoint.find(':');
+      endpoint->url.scheme = request->endpoint.substr(0, colon);
+      endpoint->url.authority = request->endpoint.substr(colon + 1);
+    }
+    if (request->addresses) {
+      endpoint->addresses = request->addresses;
+    }
+    endpoint->queue.push_back(std::move(request));
+    to_dispatch.push_back(endpoint.get());
+  }
+  for (Endpoint* endpoint : to_dispatch) {
+    dispatch(*endpoint);
+  }
+}
+
+void SocketHTTPClient::expire_requests() {
+  const auto now = clock_().tick;
+  // `fail` can open connections, so don't hold an iterator into
+  // `connections_`.
+  for (std::size_t i = 0; i < connections_.size(); ++i) {
+    Connection& connection = *connections_[i];
+    if (connection.fd == -1 || !connection.request ||
+        connection.request->deadline > now) {
+      continue;
+    }
+    auto request = std::move(connection.request);
+    Endpoint& endpoint = *connection.endpoint;
+    close(connection);
+    fail(std::move(request), Error{Error::SOCKET_HTTP_REQUEST_TIMEOUT,
+                                   "Request timed out."});
+    dispatch(endpoint);
+  }
+
+  for (const auto& [key, endpoint] : endpoints_) {
+    (void)key;
+    auto& queue = endpoint->queue;
+    const auto expired = std::stable_partition(
+        queue.begin(), queue.end(),
+        [&](const auto& request) { return request->deadline > now; });
+    std::vector<std::unique_ptr<Request>> requests;
+    std::move(expired, queue.end(), std::back_inserter(requests));
+    queue.erase(expired, queue.end());
+    for (auto& request : requests) {
+      fail(std::move(request),
+           Error{Error::SOCKET_HTTP_REQUEST_TIMEOUT,
+                 "Request timed out while waiting for a connection."});
+    }
+  }
+}
+
+void SocketHTTPClient::dispatch(Endpoint& endpoint) {
+  while (!endpoint.queue.empty()) {
+    Connection* connection = nullptr;
+    if (!endpoint.idle.empty()) {
+      connection = endpoint.idle.back();
+      endpoint.idle.pop_back();
+    } else if (endpoint.num_connections < max_connections_per_endpoint_) {
+      std::string error;
+      connection = open_connection(endpoint, error);
+      if (!connection) {
+        auto request = std::move(endpoint.queue.front());
+        endpoint.queue.pop_front();
+        fail(std::move(request),
+             Error{Error::SOCKET_HTTP_REQUEST_FAILURE, std::move(error)});
+        continue;
+      }
+    } else {
+      return;
+    }
+
+    auto request = std::move(endpoint.queue.front());
+    endpoint.queue.pop_front();
+    assign(*connection, std::move(request));
+  }
+}
+
+SocketHTTPClient::Connection* SocketHTTPClient::open_connection(
+    Endpoint& endpoint, std::string& error) {
+  auto connection = std::make_unique<Connection>();
+  connection->endpoint = &endpoint;
+  const std::string& authority = endpoint.url.authority;
+
+  if (endpoint.url.scheme == "unix") {
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof address);
+    address.sun_family = AF_UNIX;
+    if (authority.size() >= sizeof address.sun_path) {
+      error = "Unix domain socket path is too long: " + authority;
+      return nullptr;
+    }
+    std::memcpy(address.sun_path, authority.data(), authority.size());
+    const int fd =
+        ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd == -1 || ::connect(fd, reinterpret_cast<sockaddr*>(&address),
+                              sizeof address) != 0) {
+      error = "Unable to connect to unix domain socket " + authority + ": " +
+              std::strerror(errno);
+      if (fd != -1) {
+        ::close(fd);
+      }
+      return nullptr;
+    }
+    connection->fd = fd;
+    connection->connecting = false;
+  } else {
+    connection->addresses = endpoint.addresses;
+    error = "Unable to connect to " + authority;
+    if (!connection->addresses || !connect_next(*connection, error)) {
+      return nullptr;
+    }
+  }
+
+  epoll_event event;
+  event.events = connection->connecting ? EPOLLOUT : EPOLLIN;
+  event.data.ptr = connection.get();
+  if (::epoll_ctl(epoll_, EPOLL_CTL_ADD, connection->fd, &event) != 0) {
+    error = std::string("Unable to watch a connection: ") +
+            std::strerror(errno);
+    ::close(connection->fd);
+    return nullptr;
+  }
+  connection->events = event.events;
+  ++endpoint.num_connections;
+  connections_.push_back(std::move(connection));
+  return connections_.back().get();
+}
+
+bool SocketHTTPClient::connect_next(Connection& connection,
+                                    std::string& error) {
+  const std::vector<Address>& addresses = *connection.addresses;
+  while (connection.next_address < addresses.size()) {
+    const Address& address = addresses[connection.next_address++];
+    const int fd =
+        ::socket(address.family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                 address.protocol);
+    if (fd == -1) {
+      continue;
+    }
+    bool connecting = false;
+    if (::connect(fd, reinterpret_cast<const sockaddr*>(&address.storage),
+                  address.length) != 0) {
+      if (errno != EINPROGRESS) {
+        error = "Unable to connect to " + connection.endpoint->url.authority +
+                ": " + std::strerror(errno);
+        ::close(fd);
+        continue;
+      }
+      connecting = true;
+    }
+    // Requests are written whole, so there is nothing to gain from Nagle's
+    // algorithm.
+    const int enable = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof enable);
+    connection.fd = fd;
+    connection.connecting = connecting;
+    return true;
+  }
+
+  // None of the addresses worked.  Perhaps they have changed, so resolve the
+  // host name again for the next request.
+  forget_addresses(connection.endpoint->url.authority);
+  return false;
+}
+
+void SocketHTTPClient::assign(Connection& connection,
+                              std::unique_ptr<Request> request) {
+  ++(connection.reused ? reused_connections_ : new_connections_);
+  connection.request = std::move(request);
+  connection.sent = 0;
+  connection.parser.reset();
+  if (!connection.connecting) {
+    // Write optimistically, rather than waiting for the event loop to report
+    // that the socket is writable, which it almost always is.
+    send_request(connection);
+  }
+}
+
+void SocketHTTPClient::send_request(Connection& connection) {
+  const Request& request = *connection.request;
+  const std::size_t total = request.head.size() + request.body->size();
+  const auto& segments = request.body->segments();
+
+  while (connection.sent < total) {
+    // Gather the unsent remainder of the head and the body segments.
+    iovec pieces[64];
+    std::size_t num_pieces = 0;
+    std::size_t skip = connection.sent;
+    if (skip < request.head.size()) {
+      pieces[num_pieces].iov_base =
+          const_cast<char*>(request.head.data() + skip);
+      pieces[num_pieces].iov_len = request.head.size() - skip;
+      ++num_pieces;
+      skip = 0;
+    } else {
+      skip -= request.head.size();
+    }
+    for (auto segment = segments.begin();
+         segment != segments.end() && num_pieces < std::size(pieces);
+         ++segment) {
+      if (skip >= segment->size()) {
+        skip -= segment->size();
+        continue;
+      }
+      pieces[num_pieces].iov_base = const_cast<char*>(segment->data() + skip);
+      pieces[num_pieces].iov_len = segment->size() - skip;
+      ++num_pieces;
+      skip = 0;
+    }
+
+    // `sendmsg` is `writev` with flags.  `MSG_NOSIGNAL` prevents `SIGPIPE`
+    // if the peer has closed the connection.
+    msghdr message;
+    std::memset(&message, 0, sizeof message);
+    message.msg_iov = pieces;
+    message.msg_iovlen = num_pieces;
+    const ssize_t count = ::sendmsg(connection.fd, &message, MSG_NOSIGNAL);
+    if (count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        watch(connection, EPOLLIN | EPOLLOUT);
+        return;
+      }
+      fail(connection, std::string("Unable to send request: ") +
+                           std::strerror(errno));
+      return;
+    }
+    connection.sent += std::size_t(count);
+  }
+
+  watch(connection, EPOLLIN);
+}
+
+void SocketHTTPClient::receive_response(Connection& connection) {
+  char buffer[64 * 1024];
+  for (;;) {
+    const ssize_t count = ::recv(connection.fd, buffer, sizeof buffer, 0);
+    if (count < 0 && errno == EINTR) {
+      continue;
+    }
+    if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      return;
+    }
+    if (!connection.request) {
+      // An idle connection was closed by the server, or unexpectedly sent
+      // something.  Either way, it can't be reused.
+      close(connection);
+      return;
+    }
+    if (count < 0) {
+      fail(connection, std::string("Unable to receive response: ") +
+                           std::strerror(errno));
+      return;
+    }
+
+    HTTPResponseParser& parser = connection.parser;
+    if (count == 0) {
+      parser.finish();
+    } else {
+      parser.parse(StringView(buffer, std::size_t(count)));
+    }
+    if (parser.done()) {
+      complete(connection);
+      return;
+    }
+    if (parser.failed()) {
+      fail(connection, "Invalid response: " + parser.error());
+      return;
+    }
+  }
+}
+
+void SocketHTTPClient::handle_events(Connection& connection,
+                                     unsigned events) {
+  if (connection.connecting) {
+    int error_number = 0;
+    socklen_t length = sizeof error_number;
+    ::getsockopt(connection.fd, SOL_SOCKET, SO_ERROR, &error_number, &length);
+    if (error_number != 0) {
+      std::string error = "Unable to connect to " +
+                          connection.endpoint->url.authority + ": " +
+                          std::strerror(error_number);
+      // Try the endpoint's remaining addresses, if any, before giving up.
+      const int failed_fd = connection.fd;
+      if (!connection.addresses || !connect_next(connection, error)) {
+        fail(connection, std::move(error));
+        return;
+      }
+      ::close(failed_fd);
+      epoll_event event;
+      event.events = EPOLLOUT;
+      event.data.ptr = &connection;
+      if (::epoll_ctl(epoll_, EPOLL_CTL_ADD, connection.fd, &event) != 0) {
+        fail(connection, std::string("Unable to watch a connection: ") +
+                             std::strerror(errno));
+        return;
+      }
+      connection.events = event.events;
+      if (connection.connecting) {
+        return;
+      }
+    }
+    connection.connecting = false;
+    send_request(connection);
+    return;
+  }
+
+  if (events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+    receive_response(connection);
+    if (connection.fd == -1) {
+      return;
+    }
+  }
+  if ((events & EPOLLOUT) && connection.request) {
+    send_request(connection);
+  }
+}
+
+void SocketHTTPClient::watch(Connection& connection, unsigned events) {
+  if (connection.events == events) {
+    return;
+  }
+  epoll_event event;
+  event.events = events;
+  event.data.ptr = &connection;
+  ::epoll_ctl(epoll_, EPOLL_CTL_MOD, connection.fd, &event);
+  connection.events = events;
+}
+
+void SocketHTTPClient::complete(Connection& connection) {
+  auto request = std::move(connection.request);
+  HTTPResponseParser& parser = connection.parser;
+  Endpoint& endpoint = *connection.endpoint;
+
+  const bool keep_alive =
+      parser.keep_alive() &&
+      connection.sent == request->head.size() + request->body->size();
+  const HeaderReader reader{parser.headers()};
+  request->on_response(parser.status(), reader, std::move(parser.body()));
+  parser.reset();
+
+  if (keep_alive) {
+    connection.reused = true;
+    watch(connection, EPOLLIN);
+    endpoint.idle.push_back(&connection);
+  } else {
+    close(connection);
+  }
+  request.reset();
+  finish_request();
+  dispatch(endpoint);
+}
+
+void SocketHTTPClient::fail(Connection& connection, std::string message) {
+  auto request = std::move(connection.request);
+  Endpoint& endpoint = *connection.endpoint;
+  // A server may close a kept-alive connection at any time.  If it did so
+  // before sending any of the response, then the request can safely be sent
+  // again on a new connection.
+  const bool resend = request && connection.reused &&
+                      !connection.parser.started() && !request->resent;
+  close(connection);
+  if (resend) {
+    request->resent = true;
+    endpoint.queue.push_front(std::move(request));
+  } else if (request) {
+    fail(std::move(request),
+         Error{Error::SOCKET_HTTP_REQUEST_FAILURE, std::move(message)});
+  }
+  dispatch(endpoint);
+}
+
+void SocketHTTPClient::close(Connection& connection) {
+  ::close(connection.fd);
+  connection.fd = -1;
+  Endpoint& endpoint = *connection.endpoint;
+  const auto idle =
+      std::find(endpoint.idle.begin(), endpoint.idle.end(), &connection);
+  if (idle != endpoint.idle.end()) {
+    endpoint.idle.erase(idle);
+  }
+  --endpoint.num_connections;
+}
+
+#else
+
+SocketHTTPClient::SocketHTTPClient(const std::shared_ptr<Logger>& logger,
+                                   const Clock& clock,
+                                   std::size_t max_connections_per_endpoint)
+    : logger_(logger),
+      clock_(clock),
+      max_connections_per_endpoint_(max_connections_per_endpoint),
+      epoll_(-1),
+      wakeup_(-1),
+      num_active_(0),
+      shutting_down_(false),
+      new_connections_(0),
+      reused_connections_(0) {}
+
+SocketHTTPClient::~SocketHTTPClient() = default;
+
+Expected<void> SocketHTTPClient::start(const URL&, HeadersSetter,
+                                       std::shared_ptr<const BufferChain>,
+                                       ResponseHandler, ErrorHandler,
+                                       std::chrono::steady_clock::time_point) {
+  return Error{Error::SOCKET_HTTP_CLIENT_SETUP_FAILED,
+               "SocketHTTPClient: Only Linux is supported."};
+}
+
+#endif
+
+void SocketHTTPClient::fail(std::unique_ptr<Request> request, Error error) {
+  request->on_error(std::move(error));
+  request.reset();
+  finish_request();
+}
+
+void SocketHTTPClient::finish_request() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (--num_active_ == 0) {
+    no_requests_.notify_all();
+  }
+}
+
+Expected<void> SocketHTTPClient::post(
+    const URL& url, HeadersSetter set_headers, std::string body,
+    ResponseHandler on_response, ErrorHandler on_error,
+    std::chrono::steady_clock::time_point deadline) {
+  auto chain = std::make_shared<BufferChain>();
+  if (!body.empty()) {
+    chain->prepend(std::move(body));
+  }
+  return start(url, std::move(set_headers), std::move(chain),
+               std::move(on_response), std::move(on_error), deadline);
+}
+
+Expected<void> SocketHTTPClient::post_stream(
+    const URL& url, HeadersSetter set_headers,
+    std::shared_ptr<const BufferChain> body, ResponseHandler on_response,
+    ErrorHandler on_error, std::chrono::steady_clock::time_point deadline) {
+  return start(url, std::move(set_headers), std::move(body),
+               std::move(on_response), std::move(on_error), deadline);
+}
+
+void SocketHTTPClient::drain(std::chrono::steady_clock::time_point deadline) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  no_requests_.wait_until(lock, deadline,
+                          [this]() { return num_active_ == 0; });
+}
+
+HTTPClient::ConnectionStats SocketHTTPClient::connection_stats() const {
+  ConnectionStats stats;
+  stats.new_connections = new_connections_.load(std::memory_order_relaxed);
+  stats.reused_connections =
+      reused_connections_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+nlohmann::json SocketHTTPClient::config_json() const {
+  return nlohmann::json::object(
+      {{"type", "datadog::tracing::SocketHTTPClient"},
+       {"config", nlohmann::json::object({{"max_connections_per_endpoint",
+                                           max_connections_per_endpoint_}})}});
+}
+
+}  // namespace tracing
+}  // namespace datadog
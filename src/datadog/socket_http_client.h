@@ -0,0 +1,145 @@
+#pragma once
+
+// This component provides a class, `SocketHTTPClient`, that implements the
+// `HTTPClient` interface directly in terms of sockets, without libcurl.
+//
+// The Datadog Agent is usually on the same host, reachable over a unix
+// domain socket or the loopback interface, and `DatadogAgent` sends it only
+// POST requests with a known body size.  `SocketHTTPClient` implements just
+// that much of HTTP/1.1: it supports "unix", "http+unix", and "http" URLs, but
+// not TLS.
+//
+// `SocketHTTPClient` manages a thread that is an event loop over an epoll
+// instance.  Connections are kept alive and reused, up to
+// `max_connections_per_endpoint` per socket path or host and port.  Requests
+// beyond that wait for a connection to become idle.  A request's head and the
+// segments of its body are written with a single gathering write, without
+// being copied into contiguous storage, and the response is parsed
+// incrementally as it arrives (see `http_response_parser.h`).  If a reused
+// connection turns out to have been closed by the server before any of the
+// response arrived, then the request is sent again on a new connection.
+//
+// The event loop never blocks.  In particular, host names are resolved by
+// the thread that posts a request, and the addresses are cached per host and
+// port.  A connection is attempted to each of the addresses in turn, until
+// one succeeds.  If none does, then the cached addresses are discarded, so
+// that the next request resolves the host name again.
+//
+// `SocketHTTPClient` is supported only on Linux.  On other platforms, `post`
+// returns an error.
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <condition_variable>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "clock.h"
+#include "http_client.h"
+#include "json_fwd.hpp"
+
+namespace datadog {
+namespace tracing {
+
+class Logger;
+
+class SocketHTTPClient : public HTTPClient {
+  struct Request;
+  struct Connection;
+  struct Endpoint;
+  struct Address;
+
+  std::shared_ptr<Logger> logger_;
+  Clock clock_;
+  std::size_t max_connections_per_endpoint_;
+  int epoll_;
+  int wakeup_;
+
+  // The following are guarded by `mutex_`.  `new_requests_` are requests that
+  // have been posted but not yet taken by the event loop.  `num_active_` is
+  // the number of requests that have been posted but not yet completed.
+  // `addresses_` maps each "host:port" to its resolved addresses.
+  std::mutex mutex_;
+  std::condition_variable no_requests_;
+  std::vector<std::unique_ptr<Request>> new_requests_;
+  std::size_t num_active_;
+  bool shutting_down_;
+  std::map<std::string, std::shared_ptr<const std::vector<Address>>>
+      addresses_;
+
+  // `new_connections_` and `reused_connections_` count the requests sent on
+  // new and on kept-alive connections, respectively.
+  std::atomic<std::uint64_t> new_connections_;
+  std::atomic<std::uint64_t> reused_connections_;
+
+  // The following are used only by the event loop thread.
+  std::map<std::string, std::unique_ptr<Endpoint>> endpoints_;
+  std::vector<std::unique_ptr<Connection>> connections_;
+
+  std::thread event_loop_;
+
+  Expected<void> start(const URL& url, HeadersSetter set_headers,
+                       std::shared_ptr<const BufferChain> body,
+                       ResponseHandler on_response, ErrorHandler on_error,
+                       std::chrono::steady_clock::time_point deadline);
+  std::shared_ptr<const std::vector<Address>> resolve(
+      const std::string& authority, std::string& error);
+  void forget_addresses(const std::string& authority);
+  void wake();
+  void run();
+  void take_new_requests();
+  void expire_requests();
+  void dispatch(Endpoint&);
+  Connection* open_connection(Endpoint&, std::string& error);
+  bool connect_next(Connection&, std::string& error);
+  void assign(Connection&, std::unique_ptr<Request>);
+  void send_request(Connection&);
+  void receive_response(Connection&);
+  void handle_events(Connection&, unsigned events);
+  void watch(Connection&, unsigned events);
+  void complete(Connection&);
+  void fail(Connection&, std::string message);
+  void fail(std::unique_ptr<Request>, Error);
+  void close(Connection&);
+  void finish_request();
+
+ public:
+  static constexpr std::size_t default_max_connections_per_endpoint = 4;
+
+  SocketHTTPClient(
+      const std::shared_ptr<Logger>&, const Clock&,
+      std::size_t max_connections_per_endpoint =
+          default_max_connections_per_endpoint);
+  ~SocketHTTPClient();
+
+  SocketHTTPClient(const SocketHTTPClient&) = delete;
+  SocketHTTPClient& operator=(const SocketHTTPClient&) = delete;
+
+  Expected<void> post(const URL& url, HeadersSetter set_headers,
+                      std::string body, ResponseHandler on_response,
+                      ErrorHandler on_error,
+                      std::chrono::steady_clock::time_point deadline) override;
+
+  // Write the segments of `body` directly from the chain, so that they are
+  // never concatenated.
+  Expected<void> post_stream(
+      const URL& url, HeadersSetter set_headers,
+      std::shared_ptr<const BufferChain> body, ResponseHandler on_response,
+      ErrorHandler on_error,
+      std::chrono::steady_clock::time_point deadline) override;
+
+  void drain(std::chrono::steady_clock::time_point deadline) override;
+
+  ConnectionStats connection_stats() const override;
+
+  nlohmann::json config_json() const override;
+};
+
+}  // namespace tracing
+}  // namespace datadog
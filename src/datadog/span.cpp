@@ -15,18 +15,21 @@
 namespace datadog {
 namespace tracing {
 
-Span::Span(SpanData* data, const std::shared_ptr<TraceSegment>& trace_segment,
-           const std::function<std::uint64_t()>& generate_span_id,
-           const Clock& clock)
+Span::Span(SpanData* data, TraceSegment* trace_segment)
     : trace_segment_(trace_segment),
       data_(data),
-      generate_span_id_(generate_span_id),
-      clock_(clock),
       expecting_delegated_sampling_decision_(false) {
   assert(trace_segment_);
   assert(data_);
-  assert(generate_span_id_);
-  assert(clock_);
+}
+
+Span::Span(Span&& other)
+    : trace_segment_(other.trace_segment_),
+      data_(other.data_),
+      end_time_(other.end_time_),
+      expecting_delegated_sampling_decision_(
+          other.expecting_delegated_sampling_decision_) {
+  other.trace_segment_ = nullptr;
 }
 
 Span::~Span() {
@@ -38,23 +41,26 @@ Span::~Span() {
   if (end_time_) {
     data_->duration = *end_time_ - data_->start.tick;
   } else {
-    const auto now = clock_();
-    data_->duration = now - data_->start;
+    data_->duration = trace_segment_->clock().tick() - data_->start.tick;
   }
 
-  trace_segment_->span_finished();
+  trace_segment_->span_finished(*data_);
+  trace_segment_->release();
 }
 
 Span Span::create_child(const SpanConfig& config) const {
-  auto span_data = std::make_unique<SpanData>();
-  span_data->apply_config(trace_segment_->defaults(), config, clock_);
+  auto span_data = make_span_data(trace_segment_->arena());
+  span_data->apply_config(
+      trace_segment_->defaults(), config,
+      config.start ? trace_segment_->clock().convert(*config.start)
+                   : trace_segment_->clock().now());
   span_data->trace_id = data_->trace_id;
   span_data->parent_id = data_->span_id;
-  span_data->span_id = generate_span_id_();
+  span_data->span_id = trace_segment_->generate_span_id();
 
-  const auto span_data_ptr = span_data.get();
-  trace_segment_->register_span(std::move(span_data));
-  return Span(span_data_ptr, trace_segment_, generate_span_id_, clock_);
+  trace_segment_->register_span(*span_data);
+  trace_segment_->acquire();
+  return Span(span_data.release(), trace_segment_);
 }
 
 Span Span::create_child() const { return create_child(SpanConfig{}); }
@@ -92,20 +98,26 @@ TimePoint Span::start_time() const { return data_->start; }
 
 bool Span::error() const { return data_->error; }
 
-const std::string& Span::service_name() const { return data_->service; }
+const std::string& Span::service_name() const {
+  return data_->service.string();
+}
 
-const std::string& Span::service_type() const { return data_->service_type; }
+const std::string& Span::service_type() const {
+  return data_->service_type.string();
+}
 
-const std::string& Span::name() const { return data_->name; }
+const std::string& Span::name() const { return data_->name.string(); }
 
-const std::string& Span::resource_name() const { return data_->resource; }
+StringView Span::resource_name() const {
+  return data_->resource;
+}
 
 Optional<StringView> Span::lookup_tag(StringView name) const {
   if (tags::is_internal(name)) {
     return nullopt;
   }
 
-  const auto found = data_->tags.find(std::string(name));
+  const auto found = data_->tags.find(name);
   if (found == data_->tags.end()) {
     return nullopt;
   }
@@ -114,26 +126,29 @@ Optional<StringView> Span::lookup_tag(StringView name) const {
 
 void Span::set_tag(StringView name, StringView value) {
   if (!tags::is_internal(name)) {
-    data_->tags.insert_or_assign(std::string(name), std::string(value));
+    const auto [element, inserted] = data_->tags.emplace(name, value);
+    if (!inserted) {
+      assign(element->second, value);
+    }
   }
 }
 
 void Span::remove_tag(StringView name) {
   if (!tags::is_internal(name)) {
-    data_->tags.erase(std::string(name));
+    data_->tags.erase(name);
   }
 }
 
 void Span::set_service_name(StringView service) {
-  assign(data_->service, service);
+  data_->service = Symbol(service);
 }
 
 void Span::set_service_type(StringView type) {
-  assign(data_->service_type, type);
+  data_->service_type = Symbol(type);
 }
 
 void Span::set_resource_name(StringView resource) {
-  assign(data_->resource, resource);
+  data_->resource.assign(resource.data(), resource.size());
 }
 
 void Span::set_error(bool is_error) {
@@ -159,10 +174,10 @@ void Span::set_error_stack(StringView type) {
   data_->tags.insert_or_assign("error.stack", std::string(type));
 }
 
-void Span::set_name(StringView value) { assign(data_->name, value); }
+void Span::set_name(StringView value) { data_->name = Symbol(value); }
 
 void Span::set_end_time(std::chrono::steady_clock::time_point end_time) {
-  end_time_ = end_time;
+  end_time_ = trace_segment_->clock().convert(end_time);
 }
 
 TraceSegment& Span::trace_segment() { return *trace_segment_; }
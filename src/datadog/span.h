@@ -42,8 +42,6 @@
 
 #include <chrono>
 #include <cstdint>
-#include <functional>
-#include <memory>
 
 #include "clock.h"
 #include "error.h"
@@ -62,23 +60,19 @@ struct SpanData;
 class TraceSegment;
 
 class Span {
-  std::shared_ptr<TraceSegment> trace_segment_;
+  TraceSegment* trace_segment_;
   SpanData* data_;
-  std::function<std::uint64_t()> generate_span_id_;
-  Clock clock_;
   Optional<std::chrono::steady_clock::time_point> end_time_;
   mutable bool expecting_delegated_sampling_decision_;
 
  public:
-  // Create a span whose properties are stored in the specified `data`, that is
-  // associated with the specified `trace_segment`, that uses the specified
-  // `generate_span_id` to generate IDs of child spans, and that uses the
-  // specified `clock` to determine start and end times.
-  Span(SpanData* data, const std::shared_ptr<TraceSegment>& trace_segment,
-       const std::function<std::uint64_t()>& generate_span_id,
-       const Clock& clock);
+  // Create a span whose properties are stored in the specified `data`, and
+  // that is associated with the specified `trace_segment`.  The span adopts
+  // one of the segment's references (see `TraceSegment::acquire`).  The span
+  // uses the segment's span ID generator and clock.
+  Span(SpanData* data, TraceSegment* trace_segment);
   Span(const Span&) = delete;
-  Span(Span&&) = default;
+  Span(Span&&);
   Span& operator=(Span&&) = delete;
   Span& operator=(const Span&) = delete;
 
@@ -120,7 +114,7 @@ class Span {
   const std::string& name() const;
   // Return the name of the resource associated with the operation that this
   // span represents, e.g. "/api/v1/info" or "select count(*) from users".
-  const std::string& resource_name() const;
+  StringView resource_name() const;
 
   // Return the value of the tag having the specified `name`, or return null if
   // there is no such tag.
@@ -1,7 +1,9 @@
 #include "span_data.h"
 
 #include <cassert>
+#include <chrono>
 #include <cstddef>
+#include <new>
 
 #include "error.h"
 #include "msgpack.h"
@@ -14,9 +16,7 @@ namespace datadog {
 namespace tracing {
 namespace {
 
-Optional<StringView> lookup(
-    const std::string& key,
-    const std::unordered_map<std::string, std::string>& map) {
+Optional<StringView> lookup(StringView key, const TagMap<std::string>& map) {
   const auto found = map.find(key);
   if (found != map.end()) {
     return found->second;
@@ -24,8 +24,247 @@ Optional<StringView> lookup(
   return nullopt;
 }
 
+// Append to the specified `destination` the MessagePack encoding of the
+// specified `symbol`.  Use the encoding cached in `symbol`, if any.
+Expected<void> pack_symbol(std::string& destination, const Symbol& symbol) {
+  const StringView encoded = symbol.msgpack();
+  if (encoded.empty()) {
+    return msgpack::pack_string(destination, symbol);
+  }
+  append(destination, encoded);
+  return {};
+}
+
+Expected<void> pack_tag_value(std::string& destination,
+                              const std::string& value) {
+  return msgpack::pack_string(destination, value);
+}
+
+Expected<void> pack_tag_value(std::string& destination, double value) {
+  msgpack::pack_double(destination, value);
+  return {};
+}
+
+// Append to the specified `destination` a MessagePack encoded map containing
+// the specified `tags`, and the specified `shared` tags, if not null.  Copy the
+// already encoded `shared` tags from the specified `shared_encoded`.
+template <typename Value>
+Expected<void> pack_tags(std::string& destination, const TagMap<Value>& tags,
+                         const TagMap<Value>* shared,
+                         StringView shared_encoded) {
+  // Tags that are also in `shared` are omitted.
+  const auto is_omitted = [&](const Symbol& key) {
+    return shared && shared->count(key);
+  };
+
+  std::size_t size = tags.size();
+  if (shared) {
+    size += shared->size();
+    for (const auto& entry : tags) {
+      size -= is_omitted(entry.first);
+    }
+  }
+
+  Expected<void> result = msgpack::pack_map(destination, size);
+  for (const auto& [key, value] : tags) {
+    if (!result) {
+      return result;
+    }
+    if (is_omitted(key)) {
+      continue;
+    }
+    result = pack_symbol(destination, key);
+    if (result) {
+      result = pack_tag_value(destination, value);
+    }
+  }
+  if (result) {
+    append(destination, shared_encoded);
+  }
+  return result;
+}
+
+// Append to the specified `destination` the MessagePack encoded key/value
+// pairs of the specified `tags`.
+template <typename Value>
+Expected<void> pack_tag_pairs(std::string& destination,
+                              const TagMap<Value>& tags) {
+  for (const auto& [key, value] : tags) {
+    auto result = pack_symbol(destination, key);
+    if (result) {
+      result = pack_tag_value(destination, value);
+    }
+    if (!result) {
+      return result;
+    }
+  }
+  return {};
+}
+
+// The keys of the map that is the version 0.4 encoding of a span are encoded at
+// compile time.
+namespace span_keys {
+
+constexpr auto header = msgpack::encode_map_header(12);
+constexpr auto service = msgpack::encode_string("service");
+constexpr auto name = msgpack::encode_string("name");
+constexpr auto resource = msgpack::encode_string("resource");
+constexpr auto trace_id = msgpack::encode_string("trace_id");
+constexpr auto span_id = msgpack::encode_string("span_id");
+constexpr auto parent_id = msgpack::encode_string("parent_id");
+constexpr auto start = msgpack::encode_string("start");
+constexpr auto duration = msgpack::encode_string("duration");
+constexpr auto error = msgpack::encode_string("error");
+constexpr auto meta = msgpack::encode_string("meta");
+constexpr auto metrics = msgpack::encode_string("metrics");
+constexpr auto type = msgpack::encode_string("type");
+
+// `fixed_size` is the size of the parts of a span's encoding that are the same
+// size for every span: the map header, the keys, and the six integers.
+constexpr std::size_t fixed_size =
+    header.size() + service.size() + name.size() + resource.size() +
+    trace_id.size() + span_id.size() + parent_id.size() + start.size() +
+    duration.size() + error.size() + meta.size() + metrics.size() +
+    type.size() + 6 * msgpack::integer_size;
+
+}  // namespace span_keys
+
+// Return the size of the encoding appended by `pack_symbol` for the specified
+// `symbol`.
+std::size_t symbol_size(const Symbol& symbol) {
+  const std::size_t encoded = symbol.msgpack().size();
+  return encoded ? encoded : msgpack::string_size(symbol.string().size());
+}
+
+std::size_t tag_value_size(const std::string& value) {
+  return msgpack::string_size(value.size());
+}
+
+std::size_t tag_value_size(double) { return msgpack::double_size; }
+
+// Return the size of the encoding appended by `pack_tags` for the specified
+// `tags` and the specified `shared` tags, if not null, where the specified
+// `shared_encoded_size` is the size of the encoding of the `shared` tags.
+template <typename Value>
+std::size_t tags_size(const TagMap<Value>& tags, const TagMap<Value>* shared,
+                      std::size_t shared_encoded_size) {
+  std::size_t size = msgpack::map_header_size + shared_encoded_size;
+  for (const auto& [key, value] : tags) {
+    if (shared && shared->count(key)) {
+      continue;
+    }
+    size += symbol_size(key) + tag_value_size(value);
+  }
+  return size;
+}
+
+void pack_indexed_tag_value(std::string& destination, const std::string& value,
+                            StringTable& strings) {
+  msgpack::pack_compact_integer(destination, strings.index(value));
+}
+
+void pack_indexed_tag_value(std::string& destination, double value,
+                            StringTable&) {
+  msgpack::pack_double(destination, value);
+}
+
+// Append to the specified `destination` a MessagePack encoded map containing
+// the specified `tags` and the specified `shared` tags, if not null, where each
+// string is replaced by its index in the specified `strings`.  This is the
+// version 0.5 counterpart of `pack_tags`.
+template <typename Value>
+Expected<void> pack_indexed_tags(std::string& destination,
+                                 const TagMap<Value>& tags,
+                                 const TagMap<Value>* shared,
+                                 StringTable& strings) {
+  const auto is_omitted = [&](const Symbol& key) {
+    return shared && shared->count(key);
+  };
+
+  std::size_t size = tags.size();
+  if (shared) {
+    size += shared->size();
+    for (const auto& entry : tags) {
+      size -= is_omitted(entry.first);
+    }
+  }
+
+  Expected<void> result = msgpack::pack_map(destination, size);
+  if (!result) {
+    return result;
+  }
+  for (const auto& [key, value] : tags) {
+    if (is_omitted(key)) {
+      continue;
+    }
+    msgpack::pack_compact_integer(destination, strings.index(key));
+    pack_indexed_tag_value(destination, value, strings);
+  }
+  if (shared) {
+    for (const auto& [key, value] : *shared) {
+      msgpack::pack_compact_integer(destination, strings.index(key));
+      pack_indexed_tag_value(destination, value, strings);
+    }
+  }
+  return result;
+}
+
+// Every `SpanData` is preceded in memory by an `AllocationHeader` that records
+// the `Arena`, if any, from which the `SpanData` was allocated.
+struct alignas(alignof(std::max_align_t)) AllocationHeader {
+  Arena* arena;
+};
+
 }  // namespace
 
+SpanData::SpanData() : SpanData(nullptr) {}
+
+SpanData::SpanData(Arena* arena)
+    : resource(ArenaString::allocator_type(arena)),
+      tags(TagMap<std::string>::allocator_type(arena)),
+      numeric_tags(TagMap<double>::allocator_type(arena)) {}
+
+void* SpanData::operator new(std::size_t size) {
+  void* const memory = ::operator new(sizeof(AllocationHeader) + size);
+  auto* const header = new (memory) AllocationHeader{nullptr};
+  return header + 1;
+}
+
+void* SpanData::operator new(std::size_t size, Arena& arena) {
+  void* const memory = arena.allocate(sizeof(AllocationHeader) + size);
+  arena.acquire();
+  auto* const header = new (memory) AllocationHeader{&arena};
+  return header + 1;
+}
+
+void SpanData::operator delete(void* pointer) {
+  if (!pointer) {
+    return;
+  }
+  auto* const header = static_cast<AllocationHeader*>(pointer) - 1;
+  if (header->arena) {
+    header->arena->release();
+  } else {
+    ::operator delete(header);
+  }
+}
+
+void SpanData::operator delete(void* pointer, Arena&) {
+  // This overload is invoked only if `SpanData`'s constructor throws after
+  // allocating from an arena.
+  SpanData::operator delete(pointer);
+}
+
+Expected<void> SharedTags::encode() {
+  encoded_tags.clear();
+  encoded_numeric_tags.clear();
+  auto result = pack_tag_pairs(encoded_tags, tags);
+  if (result) {
+    result = pack_tag_pairs(encoded_numeric_tags, numeric_tags);
+  }
+  return result;
+}
+
 Optional<StringView> SpanData::environment() const {
   return lookup(tags::environment, tags);
 }
@@ -34,10 +273,39 @@ Optional<StringView> SpanData::version() const {
   return lookup(tags::version, tags);
 }
 
+Optional<StringView> SpanData::find_tag(StringView name) const {
+  if (shared_tags) {
+    if (auto value = lookup(name, shared_tags->tags)) {
+      return value;
+    }
+  }
+  return lookup(name, tags);
+}
+
+Optional<double> SpanData::find_numeric_tag(StringView name) const {
+  if (shared_tags) {
+    const auto found = shared_tags->numeric_tags.find(name);
+    if (found != shared_tags->numeric_tags.end()) {
+      return found->second;
+    }
+  }
+  const auto found = numeric_tags.find(name);
+  if (found != numeric_tags.end()) {
+    return found->second;
+  }
+  return nullopt;
+}
+
 void SpanData::apply_config(const SpanDefaults& defaults,
                             const SpanConfig& config, const Clock& clock) {
-  service = config.service.value_or(defaults.service);
-  name = config.name.value_or(defaults.name);
+  apply_config(defaults, config, config.start ? *config.start : clock());
+}
+
+void SpanData::apply_config(const SpanDefaults& defaults,
+                            const SpanConfig& config,
+                            TimePoint default_start) {
+  service = Symbol(config.service ? *config.service : defaults.service);
+  name = Symbol(config.name ? *config.name : defaults.name);
 
   for (const auto& item : defaults.tags) {
     tags.insert(item);
@@ -56,76 +324,87 @@ void SpanData::apply_config(const SpanDefaults& defaults,
     }
   }
 
-  resource = config.resource.value_or(name);
-  service_type = config.service_type.value_or(defaults.service_type);
-  if (config.start) {
-    start = *config.start;
+  if (config.resource) {
+    resource = *config.resource;
   } else {
-    start = clock();
+    resource = name.string();
   }
+  service_type = Symbol(config.service_type ? *config.service_type
+                                            : defaults.service_type);
+  start = config.start ? *config.start : default_start;
+}
+
+std::unique_ptr<SpanData> make_span_data(Arena& arena) {
+  return std::unique_ptr<SpanData>{new (arena) SpanData(&arena)};
+}
+
+bool is_kept(const std::vector<std::unique_ptr<SpanData>>& spans) {
+  for (const auto& span : spans) {
+    if (const auto priority =
+            span->find_numeric_tag(tags::internal::sampling_priority)) {
+      return *priority > 0;
+    }
+  }
+  return true;
 }
 
 Expected<void> msgpack_encode(std::string& destination, const SpanData& span) {
-  // clang-format off
-  msgpack::pack_map(
+  using namespace span_keys;
+  msgpack::pack_encoded(destination, header);
+
+  msgpack::pack_encoded(destination, service);
+  auto result = pack_symbol(destination, span.service);
+  if (!result) {
+    return result;
+  }
+  msgpack::pack_encoded(destination, name);
+  result = pack_symbol(destination, span.name);
+  if (!result) {
+    return result;
+  }
+  msgpack::pack_encoded(destination, resource);
+  result = msgpack::pack_string(destination, span.resource);
+  if (!result) {
+    return result;
+  }
+
+  using std::chrono::duration_cast;
+  using std::chrono::nanoseconds;
+  msgpack::pack_encoded(destination, trace_id);
+  msgpack::pack_integer(destination, span.trace_id.low);
+  msgpack::pack_encoded(destination, span_id);
+  msgpack::pack_integer(destination, span.span_id);
+  msgpack::pack_encoded(destination, parent_id);
+  msgpack::pack_integer(destination, span.parent_id);
+  msgpack::pack_encoded(destination, start);
+  msgpack::pack_integer(
       destination,
-      "service", [&](auto& destination) {
-         return msgpack::pack_string(destination, span.service);
-       },
-      "name", [&](auto& destination) {
-         return msgpack::pack_string(destination, span.name);
-       },
-      "resource", [&](auto& destination) {
-         return msgpack::pack_string(destination, span.resource);
-       },
-      "trace_id", [&](auto& destination) {
-         msgpack::pack_integer(destination, span.trace_id.low);
-         return Expected<void>{};
-       },
-      "span_id", [&](auto& destination) {
-         msgpack::pack_integer(destination, span.span_id);
-         return Expected<void>{};
-       },
-      "parent_id", [&](auto& destination) {
-         msgpack::pack_integer(destination, span.parent_id);
-         return Expected<void>{};
-       },
-      "start", [&](auto& destination) {
-         msgpack::pack_integer(
-             destination, std::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
-                              span.start.wall.time_since_epoch())
-                              .count()));
-         return Expected<void>{};
-       },
-      "duration", [&](auto& destination) {
-         msgpack::pack_integer(
-             destination,
-             std::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(span.duration)
-                 .count()));
-        return Expected<void>{};
-       },
-      "error", [&](auto& destination) {
-         msgpack::pack_integer(destination, std::int32_t(span.error));
-         return Expected<void>{};
-       },
-      "meta", [&](auto& destination) {
-         return msgpack::pack_map(destination, span.tags,
-                           [](std::string& destination, const auto& value) {
-                             return msgpack::pack_string(destination, value);
-                           });
-       }, "metrics",
-       [&](auto& destination) {
-         return msgpack::pack_map(destination, span.numeric_tags,
-                           [](std::string& destination, const auto& value) {
-                             msgpack::pack_double(destination, value);
-                             return Expected<void>{};
-                           });
-       }, "type", [&](auto& destination) {
-         return msgpack::pack_string(destination, span.service_type);
-       });
-  // clang-format on
+      std::uint64_t(
+          duration_cast<nanoseconds>(span.start.wall.time_since_epoch())
+              .count()));
+  msgpack::pack_encoded(destination, duration);
+  msgpack::pack_integer(
+      destination,
+      std::uint64_t(duration_cast<nanoseconds>(span.duration).count()));
+  msgpack::pack_encoded(destination, error);
+  msgpack::pack_integer(destination, std::int32_t(span.error));
 
-  return nullopt;
+  const SharedTags* shared = span.shared_tags.get();
+  msgpack::pack_encoded(destination, meta);
+  result = pack_tags(destination, span.tags, shared ? &shared->tags : nullptr,
+                     shared ? StringView(shared->encoded_tags) : "");
+  if (!result) {
+    return result;
+  }
+  msgpack::pack_encoded(destination, metrics);
+  result = pack_tags(destination, span.numeric_tags,
+                     shared ? &shared->numeric_tags : nullptr,
+                     shared ? StringView(shared->encoded_numeric_tags) : "");
+  if (!result) {
+    return result;
+  }
+  msgpack::pack_encoded(destination, type);
+  return pack_symbol(destination, span.service_type);
 }
 
 Expected<void> msgpack_encode(
@@ -138,5 +417,78 @@ Expected<void> msgpack_encode(
                              });
 }
 
+std::size_t msgpack_encoded_size(const SpanData& span) {
+  const SharedTags* shared = span.shared_tags.get();
+  return span_keys::fixed_size + symbol_size(span.service) +
+         symbol_size(span.name) + msgpack::string_size(span.resource.size()) +
+         symbol_size(span.service_type) +
+         tags_size(span.tags, shared ? &shared->tags : nullptr,
+                   shared ? shared->encoded_tags.size() : 0) +
+         tags_size(span.numeric_tags, shared ? &shared->numeric_tags : nullptr,
+                   shared ? shared->encoded_numeric_tags.size() : 0);
+}
+
+std::size_t msgpack_encoded_size(
+    const std::vector<std::unique_ptr<SpanData>>& spans) {
+  std::size_t size = msgpack::array_header_size;
+  for (const auto& span_ptr : spans) {
+    assert(span_ptr);
+    size += msgpack_encoded_size(*span_ptr);
+  }
+  return size;
+}
+
+Expected<void> msgpack_encode(std::string& destination, const SpanData& span,
+                              StringTable& strings) {
+  // The fields are, in order: service, name, resource, trace_id, span_id,
+  // parent_id, start, duration, error, meta, metrics, and type.
+  constexpr std::size_t num_fields = 12;
+  auto result = msgpack::pack_array(destination, num_fields);
+  if (!result) {
+    return result;
+  }
+  msgpack::pack_compact_integer(destination, strings.index(span.service));
+  msgpack::pack_compact_integer(destination, strings.index(span.name));
+  msgpack::pack_compact_integer(destination,
+                                strings.index(StringView(span.resource)));
+  msgpack::pack_integer(destination, span.trace_id.low);
+  msgpack::pack_integer(destination, span.span_id);
+  msgpack::pack_integer(destination, span.parent_id);
+  using std::chrono::duration_cast;
+  using std::chrono::nanoseconds;
+  msgpack::pack_integer(destination,
+                        std::int64_t(duration_cast<nanoseconds>(
+                                         span.start.wall.time_since_epoch())
+                                         .count()));
+  msgpack::pack_integer(
+      destination,
+      std::int64_t(duration_cast<nanoseconds>(span.duration).count()));
+  msgpack::pack_integer(destination, std::int32_t(span.error));
+
+  const SharedTags* shared = span.shared_tags.get();
+  result = pack_indexed_tags(destination, span.tags,
+                             shared ? &shared->tags : nullptr, strings);
+  if (result) {
+    result = pack_indexed_tags(destination, span.numeric_tags,
+                               shared ? &shared->numeric_tags : nullptr,
+                               strings);
+  }
+  if (result) {
+    msgpack::pack_compact_integer(destination,
+                                  strings.index(span.service_type));
+  }
+  return result;
+}
+
+Expected<void> msgpack_encode(
+    std::string& destination,
+    const std::vector<std::unique_ptr<SpanData>>& spans, StringTable& strings) {
+  return msgpack::pack_array(
+      destination, spans, [&](auto& destination, const auto& span_ptr) {
+        assert(span_ptr);
+        return msgpack_encode(destination, *span_ptr, strings);
+      });
+}
+
 }  // namespace tracing
-}  // namespace datadog
\ No newline at end of file
+}  // namespace datadog
@@ -2,17 +2,30 @@
 
 // This component provides a `struct`, `SpanData`, that contains all data fields
 // relevant to `Span`. `SpanData` is what is consumed by `Collector`.
+//
+// `SpanData` objects are usually allocated from the `Arena` of the trace
+// segment to which they belong (see `make_span_data`), and so are their tags.
+// Deleting a `SpanData` that was allocated from an `Arena` releases the
+// object's reference to the arena rather than freeing memory.
+//
+// The strings that repeat across spans, i.e. the service, operation name,
+// service type, and tag names, are interned `Symbol`s.  Resource names can
+// have high cardinality, so the resource is instead an `ArenaString`, which is
+// encoded when the span is serialized.
 
 #include <cstddef>
 #include <memory>
 #include <string>
-#include <unordered_map>
 #include <vector>
 
+#include "arena.h"
 #include "clock.h"
 #include "expected.h"
 #include "optional.h"
 #include "string_view.h"
+#include "string_table.h"
+#include "symbol.h"
+#include "tag_map.h"
 #include "trace_id.h"
 
 namespace datadog {
@@ -21,31 +34,86 @@ namespace tracing {
 struct SpanConfig;
 struct SpanDefaults;
 
+// `SharedTags` is a set of tags having the same values on many spans, such as
+// the tags that a `TraceSegment` adds to each of its spans.  The tags are
+// MessagePack encoded once, and the encoding is copied into the encoding of
+// each span that refers to them.  See `SpanData::shared_tags`.
+struct SharedTags {
+  TagMap<std::string> tags;
+  TagMap<double> numeric_tags;
+  // `encoded_tags` and `encoded_numeric_tags` are the MessagePack encoded
+  // key/value pairs of `tags` and `numeric_tags`, respectively, without a map
+  // header.  They are assigned by `encode`.
+  std::string encoded_tags;
+  std::string encoded_numeric_tags;
+
+  // Assign `encoded_tags` and `encoded_numeric_tags` from `tags` and
+  // `numeric_tags`.  Return an error if a tag cannot be encoded.
+  Expected<void> encode();
+};
+
 struct SpanData {
-  std::string service;
-  std::string service_type;
-  std::string name;
-  std::string resource;
+  Symbol service;
+  Symbol service_type;
+  Symbol name;
+  ArenaString resource;
   TraceID trace_id;
   std::uint64_t span_id = 0;
   std::uint64_t parent_id = 0;
   TimePoint start;
   Duration duration = Duration::zero();
   bool error = false;
-  std::unordered_map<std::string, std::string> tags;
-  std::unordered_map<std::string, double> numeric_tags;
+  TagMap<std::string> tags;
+  TagMap<double> numeric_tags;
+  // `shared_tags`, if not null, are additional tags of this span that it shares
+  // with other spans.  If a tag name appears both in `shared_tags` and in
+  // `tags` or `numeric_tags`, then the value in `shared_tags` is used.
+  std::shared_ptr<const SharedTags> shared_tags;
+
+  // Create a `SpanData` whose tags are allocated from the optionally specified
+  // `arena`, or from the global heap if `arena` is null.
+  SpanData();
+  explicit SpanData(Arena* arena);
+
+  // `SpanData` can be allocated either from the global heap or from an
+  // `Arena`.  In either case, it is deleted using `operator delete`.
+  static void* operator new(std::size_t size);
+  static void* operator new(std::size_t size, Arena& arena);
+  static void operator delete(void* pointer);
+  static void operator delete(void* pointer, Arena& arena);
 
   Optional<StringView> environment() const;
   Optional<StringView> version() const;
 
+  // Return the value of the string tag or the numeric tag, respectively,
+  // having the specified `name`, or return null if there is no such tag.
+  // Consider `shared_tags` as well as `tags` and `numeric_tags`.
+  Optional<StringView> find_tag(StringView name) const;
+  Optional<double> find_numeric_tag(StringView name) const;
+
   // Modify the properties of this object to honor the specified `config` and
   // `defaults`.  The properties of `config`, if set, override the properties of
   // `defaults`. Use the specified `clock` to provide a start none of none is
   // specified in `config`.
   void apply_config(const SpanDefaults& defaults, const SpanConfig& config,
                     const Clock& clock);
+  // Modify the properties of this object as above, but use the specified
+  // `default_start` if no start is specified in `config`.
+  void apply_config(const SpanDefaults& defaults, const SpanConfig& config,
+                    TimePoint default_start);
 };
 
+// Return a `SpanData` that is allocated, along with its tags, from the
+// specified `arena`.  The returned object holds a reference to `arena` until it
+// is deleted.
+std::unique_ptr<SpanData> make_span_data(Arena& arena);
+
+// Return whether the Datadog Agent would keep the trace chunk consisting of the
+// specified `spans`, i.e. whether its sampling priority is positive.  A chunk
+// without a sampling priority is considered kept.  The behavior is undefined
+// if any span is `nullptr`.
+bool is_kept(const std::vector<std::unique_ptr<SpanData>>& spans);
+
 // Append to the specified `destination` the MessagePack representation of the
 // specified `span`.
 Expected<void> msgpack_encode(std::string& destination, const SpanData& span);
@@ -57,5 +125,28 @@ Expected<void> msgpack_encode(
     std::string& destination,
     const std::vector<std::unique_ptr<SpanData>>& spans);
 
+// Return the number of bytes that `msgpack_encode` appends for the specified
+// `span`, so that the destination can be reserved ahead of time.
+std::size_t msgpack_encoded_size(const SpanData& span);
+
+// Return the number of bytes that `msgpack_encode` appends for the specified
+// `spans`.  The behavior is undefined if any span is `nullptr`.
+std::size_t msgpack_encoded_size(
+    const std::vector<std::unique_ptr<SpanData>>& spans);
+
+// Append to the specified `destination` the MessagePack representation of the
+// specified `span` in version 0.5 of the Datadog Agent's traces API: an array
+// of the span's fields, where each string is replaced by its index in the
+// specified `strings`.  Add strings to `strings` as necessary.
+Expected<void> msgpack_encode(std::string& destination, const SpanData& span,
+                              StringTable& strings);
+
+// Append to the specified `destination` the version 0.5 MessagePack
+// representation, as above, of an array containing each of the specified
+// `spans`.  The behavior is undefined if any span is `nullptr`.
+Expected<void> msgpack_encode(
+    std::string& destination,
+    const std::vector<std::unique_ptr<SpanData>>& spans, StringTable& strings);
+
 }  // namespace tracing
 }  // namespace datadog
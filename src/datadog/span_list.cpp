@@ -0,0 +1,62 @@
+#include "span_list.h"
+
+#include "span_data.h"
+
+namespace datadog {
+namespace tracing {
+
+SpanList::SpanList(Arena& arena) : arena_(arena), size_(0) {
+  chunks_[0].store(first_chunk_, std::memory_order_relaxed);
+  for (std::size_t i = 1; i < max_chunks; ++i) {
+    chunks_[i].store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+SpanList::~SpanList() { (void)release(); }
+
+SpanData*& SpanList::slot(std::size_t index) {
+  // Chunk `i` has capacity `first_chunk_capacity << i`.
+  std::size_t chunk = 0;
+  std::size_t capacity = first_chunk_capacity;
+  while (index >= capacity) {
+    index -= capacity;
+    capacity *= 2;
+    ++chunk;
+  }
+
+  SpanData** elements = chunks_[chunk].load(std::memory_order_acquire);
+  if (!elements) {
+    auto* const fresh = static_cast<SpanData**>(
+        arena_.allocate(capacity * sizeof(SpanData*)));
+    // If another thread installs a chunk first, then use that chunk instead.
+    // The memory allocated for `fresh` is reclaimed with the arena.
+    if (chunks_[chunk].compare_exchange_strong(elements, fresh,
+                                               std::memory_order_acq_rel,
+                                               std::memory_order_acquire)) {
+      elements = fresh;
+    }
+  }
+  return elements[index];
+}
+
+void SpanList::append(std::unique_ptr<SpanData> span) {
+  const std::size_t index = size_.fetch_add(1, std::memory_order_relaxed);
+  slot(index) = span.release();
+}
+
+std::size_t SpanList::size() const {
+  return size_.load(std::memory_order_relaxed);
+}
+
+std::vector<std::unique_ptr<SpanData>> SpanList::release() {
+  const std::size_t size = size_.exchange(0, std::memory_order_relaxed);
+  std::vector<std::unique_ptr<SpanData>> result;
+  result.reserve(size);
+  for (std::size_t i = 0; i < size; ++i) {
+    result.emplace_back(slot(i));
+  }
+  return result;
+}
+
+}  // namespace tracing
+}  // namespace datadog
@@ -0,0 +1,67 @@
+#pragma once
+
+// This component provides a class, `SpanList`, that is the sequence of
+// finished `SpanData` owned by a `TraceSegment`.
+//
+// Spans are appended to a `SpanList` concurrently and without locking, since
+// the spans of a trace segment might finish on many threads at once.
+// Elements are never removed individually.  Instead, `release` transfers all
+// of the elements out of the list once no more spans are being appended.
+//
+// The elements are stored in a sequence of chunks.  The first chunk is part of
+// the `SpanList` object, and each subsequent chunk is twice as large as the
+// previous one.  Additional chunks are allocated from an `Arena`.  Appending
+// is a `fetch_add` to claim an index, plus, at most once per chunk, a
+// compare-and-swap to install a new chunk.
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "arena.h"
+
+namespace datadog {
+namespace tracing {
+
+struct SpanData;
+
+class SpanList {
+  static constexpr std::size_t first_chunk_capacity = 8;
+  // With this many chunks, the capacity of the list exceeds any possible
+  // number of spans.
+  static constexpr std::size_t max_chunks = 48;
+
+  Arena& arena_;
+  std::atomic<std::size_t> size_;
+  std::atomic<SpanData**> chunks_[max_chunks];
+  SpanData* first_chunk_[first_chunk_capacity];
+
+  // Return a reference to the storage for the element at the specified
+  // `index`, allocating a chunk if necessary.
+  SpanData*& slot(std::size_t index);
+
+ public:
+  // Create an empty list that allocates chunks from the specified `arena`.
+  explicit SpanList(Arena& arena);
+  SpanList(const SpanList&) = delete;
+  SpanList& operator=(const SpanList&) = delete;
+  // Delete any elements that were not released.
+  ~SpanList();
+
+  // Take ownership of the specified `span` and append it to this list.  This
+  // function may be called concurrently with itself.
+  void append(std::unique_ptr<SpanData> span);
+
+  // Return the number of elements appended so far.
+  std::size_t size() const;
+
+  // Return ownership of all elements, in the order in which they were
+  // appended, and leave this list empty.  The behavior is undefined if this
+  // function is called concurrently with `append`, or before all appended
+  // elements are visible to the calling thread.
+  std::vector<std::unique_ptr<SpanData>> release();
+};
+
+}  // namespace tracing
+}  // namespace datadog
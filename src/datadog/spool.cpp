@@ -0,0 +1,265 @@
+#include "spool.h"
+
+#ifndef _MSC_VER
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+#include "datadog_agent_config.h"
+
+namespace datadog {
+namespace tracing {
+namespace {
+
+constexpr char magic[8] = {'D', 'D', 'S', 'P', 'O', 'O', 'L', '1'};
+
+// Return an error describing the failure of the specified `operation` on the
+// file at the specified `path`, according to `errno`.
+Error file_error(const char* operation, const std::string& path) {
+  const int error_number = errno;
+  std::string message;
+  message += "Spool: ";
+  message += operation;
+  message += " failed for \"";
+  message += path;
+  message += "\": ";
+  message += std::strerror(error_number);
+  return Error{Error::SPOOL_FAILURE, std::move(message)};
+}
+
+}  // namespace
+
+// `Header` is at the beginning of the file.  `head` and `tail` are logical
+// positions in the ring: they only increase, and the byte at logical position
+// `p` is at offset `p % capacity` within the ring.  The records are between
+// `head` and `tail`.
+struct Spool::Header {
+  char magic[8];
+  std::uint64_t capacity;
+  std::uint64_t head;
+  std::uint64_t tail;
+};
+
+const std::size_t Spool::header_size = 64;
+// A record begins with the size of its body (4 bytes), the number of trace
+// chunks in the body (4 bytes), and the traces API version (1 byte).
+const std::size_t Spool::record_header_size = 9;
+
+Spool::Spool(std::string path, std::size_t file_size)
+    : path_(std::move(path)),
+      file_size_(file_size),
+      open_attempted_(false),
+      fd_(-1),
+      map_(nullptr),
+      header_(nullptr),
+      ring_(nullptr),
+      capacity_(0) {
+  static_assert(sizeof(Header) <= 64, "Spool::Header must fit header_size");
+}
+
+Spool::~Spool() {
+#ifndef _MSC_VER
+  if (map_) {
+    ::munmap(map_, file_size_);
+  }
+  if (fd_ != -1) {
+    ::close(fd_);
+  }
+#endif
+}
+
+Expected<void> Spool::open() {
+  if (open_attempted_) {
+    if (open_error_) {
+      return *open_error_;
+    }
+    return {};
+  }
+  open_attempted_ = true;
+
+#ifdef _MSC_VER
+  open_error_ = Error{Error::SPOOL_FAILURE,
+                      "Spool: Spooling to disk is not supported on Windows."};
+  return *open_error_;
+#else
+  fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+  if (fd_ == -1) {
+    open_error_ = file_error("open", path_);
+    return *open_error_;
+  }
+  if (::flock(fd_, LOCK_EX | LOCK_NB) == -1) {
+    open_error_ = file_error("lock (is another process using the file?)",
+                             path_);
+    return *open_error_;
+  }
+  struct stat status;
+  if (::fstat(fd_, &status) == -1) {
+    open_error_ = file_error("stat", path_);
+    return *open_error_;
+  }
+  const bool resized = std::size_t(status.st_size) != file_size_;
+  if (resized && ::ftruncate(fd_, off_t(file_size_)) == -1) {
+    open_error_ = file_error("truncate", path_);
+    return *open_error_;
+  }
+#ifdef __linux__
+  // Allocate the file's blocks now, so that writing to the mapping can't fail
+  // for lack of disk space later.
+  if (const int rc = ::posix_fallocate(fd_, 0, off_t(file_size_))) {
+    errno = rc;
+    open_error_ = file_error("allocate", path_);
+    return *open_error_;
+  }
+#endif
+  void* const map = ::mmap(nullptr, file_size_, PROT_READ | PROT_WRITE,
+                           MAP_SHARED, fd_, 0);
+  if (map == MAP_FAILED) {
+    open_error_ = file_error("mmap", path_);
+    return *open_error_;
+  }
+  map_ = static_cast<char*>(map);
+  header_ = reinterpret_cast<Header*>(map_);
+  ring_ = map_ + header_size;
+  capacity_ = file_size_ - header_size;
+
+  // Reuse the records in an existing file only if its header is consistent
+  // with this spool.
+  if (resized || std::memcmp(header_->magic, magic, sizeof magic) != 0 ||
+      header_->capacity != capacity_ || header_->tail < header_->head ||
+      header_->tail - header_->head > capacity_) {
+    std::memcpy(header_->magic, magic, sizeof magic);
+    header_->capacity = capacity_;
+    header_->head = 0;
+    header_->tail = 0;
+  }
+  return {};
+#endif
+}
+
+void Spool::write(std::uint64_t position, const char* source,
+                  std::size_t size) {
+  const std::size_t offset = std::size_t(position % capacity_);
+  const std::size_t first = std::min(size, capacity_ - offset);
+  std::memcpy(ring_ + offset, source, first);
+  std::memcpy(ring_, source + first, size - first);
+}
+
+void Spool::read(std::uint64_t position, char* destination,
+                 std::size_t size) const {
+  const std::size_t offset = std::size_t(position % capacity_);
+  const std::size_t first = std::min(size, capacity_ - offset);
+  std::memcpy(destination, ring_ + offset, first);
+  std::memcpy(destination + first, ring_, size - first);
+}
+
+std::size_t Spool::discard_oldest() {
+  char fields[record_header_size];
+  read(header_->head, fields, sizeof fields);
+  std::uint32_t size;
+  std::uint32_t num_chunks;
+  std::memcpy(&size, fields, 4);
+  std::memcpy(&num_chunks, fields + 4, 4);
+  if (record_header_size + size > header_->tail - header_->head) {
+    // The record is corrupt.  Discard everything.
+    header_->head = header_->tail;
+    return 0;
+  }
+  header_->head += record_header_size + size;
+  return num_chunks;
+}
+
+Expected<std::size_t> Spool::append(const BufferChain& body,
+                                    std::size_t num_chunks,
+                                    TracesAPIVersion version) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto result = open();
+  if (auto* error = result.if_error()) {
+    return std::move(*error);
+  }
+
+  const std::size_t size = body.size();
+  const std::size_t record_size = record_header_size + size;
+  if (record_size > capacity_) {
+    return num_chunks;
+  }
+  std::size_t num_discarded = 0;
+  while (capacity_ - (header_->tail - header_->head) < record_size) {
+    num_discarded += discard_oldest();
+  }
+
+  char fields[record_header_size];
+  const auto size32 = std::uint32_t(size);
+  const auto num_chunks32 = std::uint32_t(num_chunks);
+  std::memcpy(fields, &size32, 4);
+  std::memcpy(fields + 4, &num_chunks32, 4);
+  fields[8] = char(version);
+  std::uint64_t position = header_->tail;
+  write(position, fields, sizeof fields);
+  position += sizeof fields;
+  for (const auto& segment : body.segments()) {
+    write(position, segment.data(), segment.size());
+    position += segment.size();
+  }
+  // The record becomes visible only after it is completely written.
+  header_->tail = position;
+  return num_discarded;
+}
+
+Expected<std::vector<Spool::Record>> Spool::take_oldest(std::size_t max_size) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto result = open();
+  if (auto* error = result.if_error()) {
+    return std::move(*error);
+  }
+
+  std::vector<Record> records;
+  std::size_t total = 0;
+  while (header_->head != header_->tail) {
+    char fields[record_header_size];
+    read(header_->head, fields, sizeof fields);
+    std::uint32_t size;
+    std::uint32_t num_chunks;
+    std::memcpy(&size, fields, 4);
+    std::memcpy(&num_chunks, fields + 4, 4);
+    const auto version = TracesAPIVersion(fields[8]);
+    if (record_header_size + size > header_->tail - header_->head ||
+        (version != TracesAPIVersion::V0_4 &&
+         version != TracesAPIVersion::V0_5)) {
+      // The record is corrupt.  Discard everything.
+      header_->head = header_->tail;
+      break;
+    }
+    if (!records.empty() && total + size > max_size) {
+      break;
+    }
+
+    Record record{BufferChain{size}, num_chunks, version};
+    std::string& segment = record.body.writable_segment();
+    segment.resize(size);
+    read(header_->head + record_header_size, &segment[0], size);
+    header_->head += record_header_size + size;
+    total += size;
+    records.push_back(std::move(record));
+  }
+  return records;
+}
+
+bool Spool::empty() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return !open() || header_->head == header_->tail;
+}
+
+const std::string& Spool::path() const { return path_; }
+
+std::size_t Spool::file_size() const { return file_size_; }
+
+}  // namespace tracing
+}  // namespace datadog
@@ -0,0 +1,115 @@
+#pragma once
+
+// This component provides a class, `Spool`, that stores request bodies of
+// traces on disk while the Datadog Agent is unavailable, e.g. while it is
+// being upgraded, so that they can be sent once it is available again.
+//
+// A `Spool` is a file of fixed size that is memory-mapped and used as a ring
+// buffer of records.  Each record is a request body together with the number
+// of trace chunks that it contains and the version of the traces API in which
+// they are encoded.  Records are appended at the tail of the ring and taken
+// from its head, oldest first.  When a record does not fit, the oldest
+// records are discarded to make room, so the file never exceeds its size.
+//
+// The file is created, or an existing file is reused, when the `Spool` is
+// first accessed rather than when it is constructed.  `DatadogAgent` accesses
+// its `Spool` only from the threads of its `HTTPClient` and `EventScheduler`,
+// so that application threads never wait for disk I/O.  Records that were
+// spooled by an earlier process, and not yet sent, are sent by a later process
+// that uses the same file.  A file can be used by only one process at a time.
+//
+// `Spool` is not supported on Windows.
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "buffer_chain.h"
+#include "error.h"
+#include "expected.h"
+#include "optional.h"
+
+namespace datadog {
+namespace tracing {
+
+enum class TracesAPIVersion : char;
+
+class Spool {
+ public:
+  struct Record {
+    BufferChain body;
+    std::size_t num_chunks;
+    TracesAPIVersion version;
+  };
+
+  // The size of the file header, which precedes the ring of records.
+  static const std::size_t header_size;
+  // The size of the fixed-size fields that precede each record's body.
+  static const std::size_t record_header_size;
+
+ private:
+  struct Header;
+
+  std::mutex mutex_;
+  std::string path_;
+  std::size_t file_size_;
+  // The file is opened by the first access.  If that fails, then
+  // `open_error_` is the reason, and subsequent accesses fail the same way.
+  bool open_attempted_;
+  Optional<Error> open_error_;
+  int fd_;
+  char* map_;
+  Header* header_;
+  char* ring_;
+  std::size_t capacity_;
+
+  // Open and map the file, if that hasn't been attempted yet, and return the
+  // result.  The behavior is undefined unless `mutex_` is locked.
+  Expected<void> open();
+  // Copy the specified `size` bytes from the specified `source` into the ring
+  // starting at the specified logical `position`, wrapping around the end of
+  // the ring.
+  void write(std::uint64_t position, const char* source, std::size_t size);
+  // Copy the specified `size` bytes from the ring starting at the specified
+  // logical `position` into the specified `destination`, wrapping around the
+  // end of the ring.
+  void read(std::uint64_t position, char* destination, std::size_t size) const;
+  // Remove the oldest record from the ring, and return the number of trace
+  // chunks that it contained.
+  std::size_t discard_oldest();
+
+ public:
+  // Create a spool that will use the file at the specified `path`, which is
+  // at most the specified `file_size` bytes, including the header.  The
+  // behavior is undefined unless `file_size` is greater than `header_size`.
+  Spool(std::string path, std::size_t file_size);
+  Spool(const Spool&) = delete;
+  Spool& operator=(const Spool&) = delete;
+  ~Spool();
+
+  // Append a record containing the specified `body`, `num_chunks`, and
+  // `version`.  If the record does not fit, then first discard the oldest
+  // records until it does.  If the record is larger than the ring, then
+  // discard it instead.  Return the number of trace chunks discarded, or
+  // return an error if the file cannot be used.
+  Expected<std::size_t> append(const BufferChain& body, std::size_t num_chunks,
+                               TracesAPIVersion version);
+
+  // Remove from this spool, and return oldest first, the oldest records whose
+  // bodies total at most the specified `max_size` bytes, but at least one
+  // record if this spool is not empty.  Return an error if the file cannot be
+  // used.
+  Expected<std::vector<Record>> take_oldest(std::size_t max_size);
+
+  // Return whether this spool contains no records.  A spool whose file
+  // cannot be used is empty.
+  bool empty();
+
+  const std::string& path() const;
+  std::size_t file_size() const;
+};
+
+}  // namespace tracing
+}  // namespace datadog
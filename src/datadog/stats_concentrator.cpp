@@ -0,0 +1,398 @@
+#include "stats_concentrator.h"
+
+#include <algorithm>
+#include <thread>
+#include <utility>
+
+#include "msgpack.h"
+#include "parse_util.h"
+#include "span_data.h"
+#include "string_util.h"
+#include "tags.h"
+#include "tracer_signature.h"
+#include "version.h"
+
+namespace datadog {
+namespace tracing {
+namespace {
+
+const StringView http_status_code_tag = "http.status_code";
+const StringView span_kind_tag = "span.kind";
+const StringView measured_tag = "_dd.measured";
+
+// Return an index that is unique to the calling thread, so that concurrent
+// threads usually use different shards.
+std::size_t thread_index() {
+  static std::atomic<std::size_t> next_index{0};
+  thread_local const std::size_t index =
+      next_index.fetch_add(1, std::memory_order_relaxed);
+  return index;
+}
+
+std::size_t hash(StringView text) {
+  return static_cast<std::size_t>(fnv1a_hash(text));
+}
+
+void hash_combine(std::size_t& seed, std::size_t value) {
+  seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+// Return whether the Datadog Agent computes stats for a span having the
+// specified `span_kind`, regardless of whether the span is top-level.
+bool is_stats_span_kind(StringView span_kind) {
+  return span_kind == "server" || span_kind == "client" ||
+         span_kind == "producer" || span_kind == "consumer";
+}
+
+// `SpanIndex` maps the ID of each span of a trace chunk to the span, so that
+// the parent of a span, if it is in the same chunk, can be found.
+class SpanIndex {
+  std::vector<std::pair<std::uint64_t, const SpanData*>> entries_;
+
+ public:
+  explicit SpanIndex(const std::vector<std::unique_ptr<SpanData>>& spans) {
+    entries_.reserve(spans.size());
+    for (const auto& span : spans) {
+      entries_.emplace_back(span->span_id, span.get());
+    }
+    std::sort(entries_.begin(), entries_.end(),
+              [](const auto& left, const auto& right) {
+                return left.first < right.first;
+              });
+  }
+
+  const SpanData* find(std::uint64_t span_id) const {
+    const auto found = std::lower_bound(
+        entries_.begin(), entries_.end(), span_id,
+        [](const auto& entry, std::uint64_t id) { return entry.first < id; });
+    if (found == entries_.end() || found->first != span_id) {
+      return nullptr;
+    }
+    return found->second;
+  }
+};
+
+// Return whether the specified `span` is top-level: it is the root of its
+// trace chunk, or its parent belongs to another service.  Use the specified
+// `index` to find the parent.
+bool is_top_level(const SpanData& span, const SpanIndex& index) {
+  if (span.parent_id == 0) {
+    return true;
+  }
+  const SpanData* parent = index.find(span.parent_id);
+  return parent == nullptr || parent->service != span.service;
+}
+
+using GroupIterator = StatsConcentrator::Bucket::const_iterator;
+
+// Append to the specified `destination` the MessagePack encoding of the stats
+// of the specified `group` of spans having the specified `key`.
+Expected<void> msgpack_encode_group(
+    std::string& destination, const StatsConcentrator::Key& key,
+    const StatsConcentrator::GroupStats& group) {
+  std::string ok_summary;
+  group.ok_summary.encode_protobuf(ok_summary);
+  std::string error_summary;
+  group.error_summary.encode_protobuf(error_summary);
+
+  // clang-format off
+  return msgpack::pack_map(
+      destination,
+      "Service", [&](auto& destination) {
+        return msgpack::pack_string(destination, key.service);
+      },
+      "Name", [&](auto& destination) {
+        return msgpack::pack_string(destination, key.name);
+      },
+      "Resource", [&](auto& destination) {
+        return msgpack::pack_string(destination, key.resource);
+      },
+      "HTTPStatusCode", [&](auto& destination) {
+        msgpack::pack_compact_integer(destination, key.http_status_code);
+        return Expected<void>{};
+      },
+      "Type", [&](auto& destination) {
+        return msgpack::pack_string(destination, key.type);
+      },
+      "SpanKind", [&](auto& destination) {
+        return msgpack::pack_string(destination, key.span_kind);
+      },
+      "Synthetics", [&](auto& destination) {
+        msgpack::pack_bool(destination, key.synthetics);
+        return Expected<void>{};
+      },
+      "Hits", [&](auto& destination) {
+        msgpack::pack_integer(destination, group.hits);
+        return Expected<void>{};
+      },
+      "TopLevelHits", [&](auto& destination) {
+        msgpack::pack_integer(destination, group.top_level_hits);
+        return Expected<void>{};
+      },
+      "Errors", [&](auto& destination) {
+        msgpack::pack_integer(destination, group.errors);
+        return Expected<void>{};
+      },
+      "Duration", [&](auto& destination) {
+        msgpack::pack_integer(destination, group.duration);
+        return Expected<void>{};
+      },
+      "OkSummary", [&](auto& destination) {
+        return msgpack::pack_binary(destination, ok_summary);
+      },
+      "ErrorSummary", [&](auto& destination) {
+        return msgpack::pack_binary(destination, error_summary);
+      });
+  // clang-format on
+}
+
+}  // namespace
+
+constexpr std::chrono::seconds StatsConcentrator::bucket_duration;
+
+bool operator==(const StatsConcentrator::Key& left,
+                const StatsConcentrator::Key& right) {
+  return left.service == right.service && left.name == right.name &&
+         left.resource == right.resource && left.type == right.type &&
+         left.span_kind == right.span_kind &&
+         left.http_status_code == right.http_status_code &&
+         left.synthetics == right.synthetics &&
+         left.environment == right.environment &&
+         left.version == right.version;
+}
+
+std::size_t StatsConcentrator::KeyHash::operator()(const Key& key) const {
+  std::size_t result = hash(key.service);
+  hash_combine(result, hash(key.name));
+  hash_combine(result, hash(key.resource));
+  hash_combine(result, hash(key.type));
+  hash_combine(result, hash(key.span_kind));
+  hash_combine(result, key.http_status_code);
+  hash_combine(result, key.synthetics);
+  hash_combine(result, hash(key.environment));
+  hash_combine(result, hash(key.version));
+  return result;
+}
+
+void StatsConcentrator::GroupStats::merge(const GroupStats& other) {
+  hits += other.hits;
+  top_level_hits += other.top_level_hits;
+  errors += other.errors;
+  duration += other.duration;
+  ok_summary.merge(other.ok_summary);
+  error_summary.merge(other.error_summary);
+}
+
+StatsConcentrator::StatsConcentrator(const TracerSignature& signature,
+                                     std::size_t num_shards)
+    : runtime_id_(signature.runtime_id.string()),
+      service_(signature.default_service),
+      environment_(signature.default_environment),
+      sequence_(0) {
+  shards_.resize(std::max<std::size_t>(num_shards, 1));
+  for (auto& shard : shards_) {
+    shard = std::make_unique<Shard>();
+  }
+}
+
+std::size_t StatsConcentrator::default_num_shards() {
+  return std::clamp<std::size_t>(std::thread::hardware_concurrency(), 1, 64);
+}
+
+StatsConcentrator::Shard& StatsConcentrator::shard() {
+  return *shards_[thread_index() % shards_.size()];
+}
+
+void StatsConcentrator::add(
+    const std::vector<std::unique_ptr<SpanData>>& spans) {
+  if (spans.empty()) {
+    return;
+  }
+  const SpanIndex index{spans};
+  // The origin is the same for every span in the chunk, but only the local
+  // root is sure to have it.
+  bool synthetics = false;
+  for (const auto& span : spans) {
+    if (auto origin = span->find_tag(tags::internal::origin)) {
+      synthetics = starts_with(*origin, "synthetics");
+      break;
+    }
+  }
+  const auto bucket_nanoseconds =
+      std::chrono::nanoseconds(bucket_duration).count();
+
+  Shard& shard = this->shard();
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  for (const auto& span_pointer : spans) {
+    const SpanData& span = *span_pointer;
+    const bool top_level = is_top_level(span, index);
+    const auto span_kind = span.find_tag(span_kind_tag);
+    if (!top_level && span.find_numeric_tag(measured_tag) != 1.0 &&
+        !(span_kind && is_stats_span_kind(*span_kind))) {
+      continue;
+    }
+
+    Key key;
+    key.service = span.service;
+    key.name = span.name;
+    key.resource.assign(span.resource.data(), span.resource.size());
+    key.type = span.service_type;
+    if (span_kind) {
+      assign(key.span_kind, *span_kind);
+    }
+    if (auto status = span.find_tag(http_status_code_tag)) {
+      auto code = parse_uint64(*status, 10);
+      if (code && *code <= UINT32_MAX) {
+        key.http_status_code = static_cast<std::uint32_t>(*code);
+      }
+    }
+    key.synthetics = synthetics;
+    if (auto environment = span.find_tag(tags::environment)) {
+      assign(key.environment, *environment);
+    }
+    if (auto version = span.find_tag(tags::version)) {
+      assign(key.version, *version);
+    }
+
+    const auto duration = std::max<std::int64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(span.duration)
+            .count(),
+        0);
+    const std::int64_t end =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            span.start.wall.time_since_epoch())
+            .count() +
+        duration;
+    const std::int64_t bucket_start = end - end % bucket_nanoseconds;
+
+    GroupStats& group = shard.buckets[bucket_start][std::move(key)];
+    ++group.hits;
+    group.duration += duration;
+    if (top_level) {
+      ++group.top_level_hits;
+    }
+    if (span.error) {
+      ++group.errors;
+      group.error_summary.add(double(duration));
+    } else {
+      group.ok_summary.add(double(duration));
+    }
+  }
+}
+
+Expected<std::vector<std::string>> StatsConcentrator::flush(
+    std::chrono::system_clock::time_point now, bool force) {
+  const auto bucket_nanoseconds =
+      std::chrono::nanoseconds(bucket_duration).count();
+  const std::int64_t now_nanoseconds =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          now.time_since_epoch())
+          .count();
+
+  // Merge the finished buckets of every shard.
+  std::map<std::int64_t, Bucket> buckets;
+  for (const auto& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    auto bucket = shard->buckets.begin();
+    while (bucket != shard->buckets.end() &&
+           (force || bucket->first + bucket_nanoseconds <= now_nanoseconds)) {
+      auto [destination, inserted] =
+          buckets.try_emplace(bucket->first, std::move(bucket->second));
+      if (!inserted) {
+        for (auto& [key, group] : bucket->second) {
+          auto [entry, added] = destination->second.try_emplace(key, group);
+          if (!added) {
+            entry->second.merge(group);
+          }
+        }
+      }
+      bucket = shard->buckets.erase(bucket);
+    }
+  }
+
+  // Divide the groups by environment and version, and then by bucket.
+  using Payload =
+      std::map<std::int64_t, std::vector<std::pair<const Key*, GroupIterator>>>;
+  std::map<std::pair<StringView, StringView>, Payload> payloads;
+  for (const auto& [start, bucket] : buckets) {
+    for (auto group = bucket.begin(); group != bucket.end(); ++group) {
+      const Key& key = group->first;
+      payloads[{key.environment, key.version}][start].emplace_back(&key,
+                                                                   group);
+    }
+  }
+
+  std::vector<std::string> result;
+  for (const auto& [environment_and_version, payload_buckets] : payloads) {
+    const auto& [environment, version] = environment_and_version;
+    const std::uint64_t sequence =
+        sequence_.fetch_add(1, std::memory_order_relaxed) + 1;
+    std::string& destination = result.emplace_back();
+    // clang-format off
+    auto encoded = msgpack::pack_map(
+        destination,
+        "Hostname", [&](auto& destination) {
+          return msgpack::pack_string(destination, "");
+        },
+        "Env", [&](auto& destination) {
+          return msgpack::pack_string(
+              destination, environment.empty() ? StringView(environment_)
+                                               : environment);
+        },
+        "Version", [&](auto& destination) {
+          return msgpack::pack_string(destination, version);
+        },
+        "Lang", [&](auto& destination) {
+          return msgpack::pack_string(destination, "cpp");
+        },
+        "TracerVersion", [&](auto& destination) {
+          return msgpack::pack_string(destination, tracer_version);
+        },
+        "RuntimeID", [&](auto& destination) {
+          return msgpack::pack_string(destination, runtime_id_);
+        },
+        "Sequence", [&](auto& destination) {
+          msgpack::pack_integer(destination, sequence);
+          return Expected<void>{};
+        },
+        "Service", [&](auto& destination) {
+          return msgpack::pack_string(destination, service_);
+        },
+        "Stats", [&](auto& destination) {
+          return msgpack::pack_array(
+              destination, payload_buckets,
+              [&](auto& destination, const auto& bucket) {
+                const auto& [start, groups] = bucket;
+                return msgpack::pack_map(
+                    destination,
+                    "Start", [&](auto& destination) {
+                      msgpack::pack_integer(destination,
+                                            std::uint64_t(start));
+                      return Expected<void>{};
+                    },
+                    "Duration", [&](auto& destination) {
+                      msgpack::pack_integer(
+                          destination, std::uint64_t(bucket_nanoseconds));
+                      return Expected<void>{};
+                    },
+                    "Stats", [&](auto& destination) {
+                      return msgpack::pack_array(
+                          destination, groups,
+                          [](auto& destination, const auto& group) {
+                            return msgpack_encode_group(
+                                destination, *group.first,
+                                group.second->second);
+                          });
+                    });
+              });
+        });
+    // clang-format on
+    if (auto* error = encoded.if_error()) {
+      return std::move(*error);
+    }
+  }
+  return result;
+}
+
+}  // namespace tracing
+}  // namespace datadog
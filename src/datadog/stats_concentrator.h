@@ -0,0 +1,132 @@
+#pragma once
+
+// This component provides a class, `StatsConcentrator`, that aggregates trace
+// stats from finished spans, so that the Datadog Agent need not compute them.
+//
+// The Datadog Agent derives APM stats (hits, errors, and the distribution of
+// durations) for each combination of service, operation name, resource, span
+// type, HTTP status code, and span kind.  When the tracer computes the stats
+// itself, and sends them to the Agent's "/v0.6/stats" endpoint, then the
+// stats are exact whether or not the traces themselves are kept.
+//
+// Stats are computed for the spans that the Agent would compute them for:
+// top-level spans (whose parent is in another service or another process),
+// spans tagged "_dd.measured", and spans whose "span.kind" is "server",
+// "client", "producer", or "consumer".  Each span is counted in the time bucket
+// that contains its end time.  Durations are summarized by `DDSketch`es, one
+// for successful spans and one for errors.
+//
+// `add` is called by each thread that finishes a trace chunk.  To keep those
+// threads from contending with each other, the concentrator is divided into
+// shards, each having its own mutex, and each thread adds to the shard
+// assigned to it.  `flush` merges the shards' buckets that have ended and
+// encodes them as MessagePack payloads.
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ddsketch.h"
+#include "expected.h"
+#include "symbol.h"
+
+namespace datadog {
+namespace tracing {
+
+struct SpanData;
+struct TracerSignature;
+
+class StatsConcentrator {
+ public:
+  // `Key` identifies the spans whose stats are aggregated together.
+  struct Key {
+    Symbol service;
+    Symbol name;
+    std::string resource;
+    Symbol type;
+    std::string span_kind;
+    std::uint32_t http_status_code = 0;
+    bool synthetics = false;
+    // The environment and version are not part of the aggregation key on the
+    // Datadog Agent; rather, `flush` produces a separate payload for each
+    // combination of them.
+    std::string environment;
+    std::string version;
+
+    friend bool operator==(const Key& left, const Key& right);
+  };
+
+  struct KeyHash {
+    std::size_t operator()(const Key& key) const;
+  };
+
+  // `GroupStats` are the stats of the spans having the same `Key` in the same
+  // time bucket.
+  struct GroupStats {
+    std::uint64_t hits = 0;
+    std::uint64_t top_level_hits = 0;
+    std::uint64_t errors = 0;
+    // `duration` is the sum of the durations of the spans, in nanoseconds.
+    std::uint64_t duration = 0;
+    DDSketch ok_summary;
+    DDSketch error_summary;
+
+    void merge(const GroupStats& other);
+  };
+
+  using Bucket = std::unordered_map<Key, GroupStats, KeyHash>;
+
+  // Spans are aggregated in buckets of this duration, aligned to the epoch.
+  static constexpr std::chrono::seconds bucket_duration{10};
+
+ private:
+  // `Shard` is aligned so that the mutexes of different shards are not in the
+  // same cache line.
+  struct alignas(64) Shard {
+    std::mutex mutex;
+    // `buckets` maps the start of each bucket, in nanoseconds since the epoch,
+    // to its stats.
+    std::map<std::int64_t, Bucket> buckets;
+  };
+
+  std::vector<std::unique_ptr<Shard>> shards_;
+  std::string runtime_id_;
+  std::string service_;
+  std::string environment_;
+  // `sequence_` numbers the payloads returned by `flush`.
+  std::atomic<std::uint64_t> sequence_;
+
+  Shard& shard();
+
+ public:
+  // Create a concentrator whose payloads identify the tracer having the
+  // specified `signature`, and that has the optionally specified `num_shards`
+  // shards.  By default, there is one shard for each hardware thread, up to
+  // 64.
+  explicit StatsConcentrator(const TracerSignature& signature,
+                             std::size_t num_shards = default_num_shards());
+
+  static std::size_t default_num_shards();
+
+  // Add to the stats the eligible spans among the specified `spans`, which are
+  // a trace chunk.  The behavior is undefined if any span is `nullptr`.
+  void add(const std::vector<std::unique_ptr<SpanData>>& spans);
+
+  // Remove from this concentrator the buckets that ended at or before the
+  // specified `now`, or every bucket if the specified `force` is true, and
+  // return their MessagePack encoding.  There is one payload for each
+  // combination of environment and version.  Return an empty vector if there
+  // are no stats to send.
+  Expected<std::vector<std::string>> flush(
+      std::chrono::system_clock::time_point now, bool force);
+};
+
+}  // namespace tracing
+}  // namespace datadog
@@ -0,0 +1,52 @@
+#include "string_table.h"
+
+#include "msgpack.h"
+#include "string_util.h"
+
+namespace datadog {
+namespace tracing {
+
+std::size_t StringTable::Hash::operator()(StringView text) const {
+  return static_cast<std::size_t>(fnv1a_hash(text));
+}
+
+StringTable::StringTable() { index(""); }
+
+std::uint32_t StringTable::index(StringView text) {
+  const auto found = indices_.find(text);
+  if (found != indices_.end()) {
+    return found->second;
+  }
+  const auto result = static_cast<std::uint32_t>(strings_.size());
+  strings_.emplace_back(text);
+  indices_.emplace(strings_.back(), result);
+  return result;
+}
+
+std::uint32_t StringTable::index(const Symbol& symbol) {
+  const std::string* const text = &symbol.string();
+  const auto found = symbol_indices_.find(text);
+  if (found != symbol_indices_.end()) {
+    return found->second;
+  }
+  const std::uint32_t result = index(StringView(*text));
+  symbol_indices_.emplace(text, result);
+  return result;
+}
+
+const std::deque<std::string>& StringTable::strings() const {
+  return strings_;
+}
+
+std::size_t StringTable::size() const { return strings_.size(); }
+
+Expected<void> msgpack_encode(std::string& destination,
+                              const StringTable& table) {
+  return msgpack::pack_array(destination, table.strings(),
+                             [](auto& destination, const std::string& text) {
+                               return msgpack::pack_string(destination, text);
+                             });
+}
+
+}  // namespace tracing
+}  // namespace datadog
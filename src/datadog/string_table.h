@@ -0,0 +1,63 @@
+#pragma once
+
+// This component provides a class, `StringTable`, that assigns an index to
+// each distinct string in a payload of traces.
+//
+// Version 0.5 of the Datadog Agent's traces API sends each distinct string
+// once, in a table at the front of the payload.  Spans then refer to their
+// service, operation name, resource, service type, tag names, and tag values
+// by index into the table.  Since those strings repeat across spans, the
+// payload is much smaller than the equivalent version 0.4 payload.
+//
+// The string at index zero is always the empty string.
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+
+#include "expected.h"
+#include "string_view.h"
+#include "symbol.h"
+
+namespace datadog {
+namespace tracing {
+
+class StringTable {
+  struct Hash {
+    std::size_t operator()(StringView text) const;
+  };
+
+  // `strings_` is a `deque` so that its elements, to which the keys of
+  // `indices_` refer, are never moved.
+  std::deque<std::string> strings_;
+  std::unordered_map<StringView, std::uint32_t, Hash> indices_;
+  // `symbol_indices_` maps the address of a `Symbol`'s text to its index, so
+  // that a `Symbol` seen before is found without hashing its text.
+  std::unordered_map<const std::string*, std::uint32_t> symbol_indices_;
+
+ public:
+  StringTable();
+
+  // Return the index of the specified `text`, adding `text` to this table if
+  // it is not already present.
+  std::uint32_t index(StringView text);
+  // Return the index of the text of the specified `symbol`, adding the text to
+  // this table if it is not already present.  The behavior is undefined if
+  // `symbol`'s text is freed before this table is destroyed, which can happen
+  // only if `symbol` is not interned (see `symbol.h`).
+  std::uint32_t index(const Symbol& symbol);
+
+  // Return the strings in this table, ordered by index.
+  const std::deque<std::string>& strings() const;
+  std::size_t size() const;
+};
+
+// Append to the specified `destination` the MessagePack representation of the
+// specified `table`: an array of its strings, ordered by index.
+Expected<void> msgpack_encode(std::string& destination,
+                              const StringTable& table);
+
+}  // namespace tracing
+}  // namespace datadog
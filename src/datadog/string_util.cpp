@@ -70,6 +70,15 @@ std::string join_tags(
   });
 }
 
+std::uint64_t fnv1a_hash(StringView text) {
+  std::uint64_t result = 14695981039346656037ULL;
+  for (const char ch : text) {
+    result ^= static_cast<unsigned char>(ch);
+    result *= 1099511628211ULL;
+  }
+  return result;
+}
+
 StringView trim(StringView str) {
   str.remove_prefix(std::min(str.find_first_not_of(' '), str.size()));
   const auto pos = str.find_last_not_of(' ');
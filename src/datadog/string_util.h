@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <unordered_map>
 
@@ -28,5 +29,10 @@ std::string join_tags(
 
 StringView trim(StringView);
 
+// Return the 64-bit FNV-1a hash of the specified `text`.  Hash tables keyed
+// by `StringView` use this instead of `std::hash`, because `StringView`
+// might be `absl::string_view`.
+std::uint64_t fnv1a_hash(StringView text);
+
 }  // namespace tracing
 }  // namespace datadog
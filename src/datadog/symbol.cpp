@@ -0,0 +1,199 @@
+#include "symbol.h"
+
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <shared_mutex>
+#include <unordered_map>
+#include <utility>
+
+#include "msgpack.h"
+#include "string_util.h"
+
+namespace datadog {
+namespace tracing {
+namespace {
+
+// The table is divided into shards, each having its own lock, so that threads
+// interning different strings seldom contend.
+constexpr std::size_t shard_count = 16;
+// The table stops accepting new strings once it contains this many.
+constexpr std::size_t max_interned_symbols = 8192;
+// Strings longer than this, e.g. SQL queries, are not added to the table.
+constexpr std::size_t max_interned_length = 128;
+// Each thread remembers its recently interned strings in a direct-mapped
+// cache, so that the common case takes no lock at all.
+constexpr std::size_t thread_cache_size = 64;
+// Once the table is full, each thread similarly remembers the entries that it
+// most recently created for strings that are not in the table.
+constexpr std::size_t overflow_cache_size = 64;
+
+struct Shard {
+  std::shared_mutex mutex;
+  // The key is the hash of the entry's text.
+  std::unordered_multimap<std::uint64_t, const Symbol::Entry*> entries;
+
+  const Symbol::Entry* find(std::uint64_t hash, StringView text) const {
+    const auto [begin, end] = entries.equal_range(hash);
+    for (auto iter = begin; iter != end; ++iter) {
+      if (StringView(iter->second->text) == text) {
+        return iter->second;
+      }
+    }
+    return nullptr;
+  }
+};
+
+struct Table {
+  Shard shards[shard_count];
+  std::atomic<std::size_t> size{0};
+};
+
+Table& table() {
+  // The table is never destroyed, so that `Symbol`s may outlive static
+  // destruction.
+  static Table* const instance = new Table;
+  return *instance;
+}
+
+struct CacheSlot {
+  std::uint64_t hash;
+  const Symbol::Entry* entry;
+};
+
+thread_local CacheSlot thread_cache[thread_cache_size];
+
+void release_entry(const Symbol::Entry* entry) {
+  if (entry->reference_count.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    delete entry;
+  }
+}
+
+// `OverflowCache` holds a reference to each of its entries, none of which are
+// in the table.
+struct OverflowCache {
+  CacheSlot slots[overflow_cache_size] = {};
+
+  ~OverflowCache() {
+    for (const CacheSlot& slot : slots) {
+      if (slot.entry) {
+        release_entry(slot.entry);
+      }
+    }
+  }
+};
+
+thread_local OverflowCache overflow_cache;
+
+// Return an entry having the specified `text`, whose hash is the specified
+// `text_hash`, that is not in the table.  The caller owns a reference to the
+// entry.  Reuse the entry in this thread's overflow cache, if it has `text`.
+const Symbol::Entry* overflow_entry(std::uint64_t text_hash, StringView text) {
+  CacheSlot& slot = overflow_cache.slots[text_hash % overflow_cache_size];
+  if (!slot.entry || slot.hash != text_hash ||
+      StringView(slot.entry->text) != text) {
+    if (slot.entry) {
+      release_entry(slot.entry);
+    }
+    slot.hash = text_hash;
+    slot.entry = new Symbol::Entry(text, false);
+  }
+  slot.entry->reference_count.fetch_add(1, std::memory_order_relaxed);
+  return slot.entry;
+}
+
+}  // namespace
+
+Symbol::Entry::Entry(StringView text, bool interned)
+    : text(text), interned(interned), reference_count(1) {
+  if (!msgpack::pack_string(msgpack, text)) {
+    msgpack.clear();
+  }
+}
+
+const Symbol::Entry* Symbol::intern(StringView text) {
+  if (text.size() > max_interned_length) {
+    return new Entry(text, false);
+  }
+
+  const std::uint64_t text_hash = fnv1a_hash(text);
+  CacheSlot& slot = thread_cache[text_hash % thread_cache_size];
+  if (slot.entry && slot.hash == text_hash &&
+      StringView(slot.entry->text) == text) {
+    return slot.entry;
+  }
+
+  Table& instance = table();
+  Shard& shard = instance.shards[(text_hash >> 32) % shard_count];
+  const Entry* entry;
+  {
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    entry = shard.find(text_hash, text);
+  }
+
+  if (!entry) {
+    if (instance.size.load(std::memory_order_relaxed) >=
+        max_interned_symbols) {
+      // The table is full.  Return an entry that is not in the table,
+      // without contending for the shard's exclusive lock.
+      return overflow_entry(text_hash, text);
+    }
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    entry = shard.find(text_hash, text);
+    if (!entry) {
+      entry = new Entry(text, true);
+      shard.entries.emplace(text_hash, entry);
+      instance.size.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  slot.hash = text_hash;
+  slot.entry = entry;
+  return entry;
+}
+
+const Symbol::Entry* Symbol::empty_entry() {
+  static const Entry* const entry = intern("");
+  return entry;
+}
+
+void Symbol::release(const Entry* entry) { release_entry(entry); }
+
+Symbol::Symbol() : entry_(empty_entry()) {}
+
+Symbol::Symbol(StringView text) : entry_(intern(text)) {}
+
+Symbol::Symbol(Symbol&& other) : entry_(other.entry_) {
+  other.entry_ = empty_entry();
+}
+
+Symbol& Symbol::operator=(const Symbol& other) {
+  other.acquire();
+  if (!entry_->interned) {
+    release(entry_);
+  }
+  entry_ = other.entry_;
+  return *this;
+}
+
+Symbol& Symbol::operator=(Symbol&& other) {
+  if (this != &other) {
+    if (!entry_->interned) {
+      release(entry_);
+    }
+    entry_ = other.entry_;
+    other.entry_ = empty_entry();
+  }
+  return *this;
+}
+
+std::size_t Symbol::interned_count() {
+  return table().size.load(std::memory_order_relaxed);
+}
+
+std::ostream& operator<<(std::ostream& stream, const Symbol& symbol) {
+  return stream << symbol.string();
+}
+
+}  // namespace tracing
+}  // namespace datadog
@@ -0,0 +1,113 @@
+#pragma once
+
+// This component provides a class, `Symbol`, that is a handle to an immutable
+// string stored in a process-wide interning table.
+//
+// `SpanData` uses `Symbol` for its service, operation name, and service type,
+// and for the keys of its tags.  Those strings repeat across many spans, so the
+// table stores each of them once, together with its MessagePack encoding.
+// When a span is serialized, the pre-encoded bytes are copied rather than
+// encoding the string again.
+//
+// Two `Symbol`s having the same text usually refer to the same table entry, in
+// which case comparing them is a pointer comparison.  The table has a bounded
+// size, however, since some strings can have unbounded cardinality.  Once the
+// table is full, a string that is not in the table gets a reference counted
+// entry, which is freed when the last `Symbol` referring to it is destroyed.
+// Each thread keeps its most recently used such entries in a small cache, so
+// that a string that repeats does not get a new entry each time.  Long strings
+// always get an entry of their own, so that they don't fill the table.
+
+#include <atomic>
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+
+#include "string_view.h"
+
+namespace datadog {
+namespace tracing {
+
+class Symbol {
+ public:
+  struct Entry {
+    std::string text;
+    // `msgpack` is the MessagePack encoding of `text`, or empty if `text`
+    // cannot be encoded.
+    std::string msgpack;
+    // `interned` entries belong to the table and are never freed.  The others
+    // are freed when `reference_count` reaches zero.
+    bool interned;
+    mutable std::atomic<std::size_t> reference_count;
+
+    Entry(StringView text, bool interned);
+  };
+
+ private:
+  const Entry* entry_;
+
+  static const Entry* intern(StringView text);
+  static const Entry* empty_entry();
+  static void release(const Entry* entry);
+
+  void acquire() const {
+    if (!entry_->interned) {
+      entry_->reference_count.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+ public:
+  // Create a `Symbol` having empty text.
+  Symbol();
+  // Create a `Symbol` having the specified `text`.
+  explicit Symbol(StringView text);
+
+  Symbol(const Symbol& other) : entry_(other.entry_) { acquire(); }
+  Symbol(Symbol&& other);
+  Symbol& operator=(const Symbol& other);
+  Symbol& operator=(Symbol&& other);
+  ~Symbol() {
+    if (!entry_->interned) {
+      release(entry_);
+    }
+  }
+
+  const std::string& string() const { return entry_->text; }
+  operator StringView() const { return entry_->text; }
+  bool empty() const { return entry_->text.empty(); }
+
+  // Return the MessagePack encoding of this symbol's text, or an empty string
+  // if the text cannot be encoded.
+  StringView msgpack() const { return entry_->msgpack; }
+
+  // Return the number of strings currently stored in the interning table.
+  static std::size_t interned_count();
+
+  friend bool operator==(const Symbol& left, const Symbol& right) {
+    // Interned entries are unique, so if both are interned, then comparing
+    // their addresses is enough.
+    return left.entry_ == right.entry_ ||
+           ((!left.entry_->interned || !right.entry_->interned) &&
+            left.entry_->text == right.entry_->text);
+  }
+  friend bool operator==(const Symbol& left, StringView right) {
+    return StringView(left.entry_->text) == right;
+  }
+  friend bool operator==(StringView left, const Symbol& right) {
+    return right == left;
+  }
+  friend bool operator!=(const Symbol& left, const Symbol& right) {
+    return !(left == right);
+  }
+  friend bool operator!=(const Symbol& left, StringView right) {
+    return !(left == right);
+  }
+  friend bool operator!=(StringView left, const Symbol& right) {
+    return !(right == left);
+  }
+};
+
+std::ostream& operator<<(std::ostream& stream, const Symbol& symbol);
+
+}  // namespace tracing
+}  // namespace datadog
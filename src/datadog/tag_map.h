@@ -0,0 +1,300 @@
+#pragma once
+
+// This component provides a class template, `TagMap`, that is the type of the
+// `tags` and `numeric_tags` members of `SpanData`.
+//
+// `TagMap` is an associative container of key/value pairs, where keys are
+// `Symbol`s (see `symbol.h`).  Unlike `std::unordered_map`, `TagMap` stores
+// its elements contiguously, in insertion order.  Lookup is a linear scan that
+// compares key lengths before comparing key characters.  Spans typically have
+// only a handful of tags, for which a linear scan over contiguous memory is
+// faster than hashing and following a node pointer.
+//
+// The first `InlineCapacity` elements are stored within the `TagMap` object
+// itself.  If more elements are added, then all of the elements are moved into
+// storage obtained from the map's `ArenaAllocator`, i.e. from the `Arena` of
+// the span's trace segment, or from the global heap if there is no arena.
+//
+// Iterators and references to elements are invalidated by any operation that
+// inserts or erases an element.
+
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "arena.h"
+#include "string_view.h"
+#include "symbol.h"
+
+namespace datadog {
+namespace tracing {
+
+template <typename Value, std::size_t InlineCapacity = 8>
+class TagMap {
+ public:
+  using key_type = Symbol;
+  using mapped_type = Value;
+  using value_type = std::pair<Symbol, Value>;
+  using size_type = std::size_t;
+  using allocator_type = ArenaAllocator<value_type>;
+  using iterator = value_type*;
+  using const_iterator = const value_type*;
+
+ private:
+  value_type* data_;
+  size_type size_;
+  size_type capacity_;
+  allocator_type allocator_;
+  alignas(value_type) unsigned char
+      inline_[InlineCapacity * sizeof(value_type)];
+
+  value_type* inline_data() {
+    return std::launder(reinterpret_cast<value_type*>(inline_));
+  }
+
+  bool is_inline() const {
+    return data_ == reinterpret_cast<const value_type*>(inline_);
+  }
+
+  // Move the elements into storage having room for at least the specified
+  // `capacity` elements.
+  void grow(size_type capacity) {
+    capacity = std::max(capacity, capacity_ * 2);
+    value_type* const data = allocator_.allocate(capacity);
+    for (size_type i = 0; i < size_; ++i) {
+      new (data + i) value_type(std::move(data_[i]));
+      data_[i].~value_type();
+    }
+    deallocate();
+    data_ = data;
+    capacity_ = capacity;
+  }
+
+  // Return this map's element storage to the allocator, if it didn't come from
+  // `inline_`.  Don't destroy any elements.
+  void deallocate() {
+    if (!is_inline()) {
+      allocator_.deallocate(data_, capacity_);
+    }
+  }
+
+  template <typename Key, typename... Args>
+  iterator emplace_back(Key&& key, Args&&... args) {
+    if (size_ == capacity_) {
+      grow(size_ + 1);
+    }
+    value_type* const element = data_ + size_;
+    new (element)
+        value_type(std::piecewise_construct,
+                   std::forward_as_tuple(std::forward<Key>(key)),
+                   std::forward_as_tuple(std::forward<Args>(args)...));
+    ++size_;
+    return element;
+  }
+
+ public:
+  TagMap() : TagMap(allocator_type()) {}
+
+  explicit TagMap(const allocator_type& allocator)
+      : data_(inline_data()),
+        size_(0),
+        capacity_(InlineCapacity),
+        allocator_(allocator) {}
+
+  // A copy allocates from the global heap, since it does not hold a reference
+  // to the `Arena` of `other`.
+  TagMap(const TagMap& other) : TagMap() {
+    reserve(other.size_);
+    for (const auto& [key, value] : other) {
+      emplace_back(key, value);
+    }
+  }
+
+  TagMap(TagMap&& other) : TagMap(other.allocator_) {
+    *this = std::move(other);
+  }
+
+  ~TagMap() {
+    clear();
+    deallocate();
+  }
+
+  TagMap& operator=(const TagMap& other) {
+    if (this != &other) {
+      clear();
+      reserve(other.size_);
+      for (const auto& [key, value] : other) {
+        emplace_back(key, value);
+      }
+    }
+    return *this;
+  }
+
+  TagMap& operator=(TagMap&& other) {
+    if (this == &other) {
+      return *this;
+    }
+
+    clear();
+    if (!other.is_inline() && allocator_ == other.allocator_) {
+      // Steal the storage of `other`.
+      deallocate();
+      data_ = other.data_;
+      capacity_ = other.capacity_;
+      size_ = other.size_;
+      other.data_ = other.inline_data();
+      other.capacity_ = InlineCapacity;
+      other.size_ = 0;
+      return *this;
+    }
+
+    reserve(other.size_);
+    for (auto& [key, value] : other) {
+      emplace_back(std::move(key), std::move(value));
+    }
+    other.clear();
+    return *this;
+  }
+
+  allocator_type get_allocator() const { return allocator_; }
+
+  iterator begin() { return data_; }
+  iterator end() { return data_ + size_; }
+  const_iterator begin() const { return data_; }
+  const_iterator end() const { return data_ + size_; }
+  const_iterator cbegin() const { return data_; }
+  const_iterator cend() const { return data_ + size_; }
+
+  size_type size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  size_type capacity() const { return capacity_; }
+
+  // Ensure that this map can contain at least the specified `capacity`
+  // elements without obtaining more storage.
+  void reserve(size_type capacity) {
+    if (capacity > capacity_) {
+      grow(capacity);
+    }
+  }
+
+  // Remove all elements from this map.  Keep its storage.
+  void clear() {
+    for (size_type i = 0; i < size_; ++i) {
+      data_[i].~value_type();
+    }
+    size_ = 0;
+  }
+
+  iterator find(StringView key) {
+    return const_cast<iterator>(static_cast<const TagMap&>(*this).find(key));
+  }
+
+  const_iterator find(StringView key) const {
+    const_iterator element = data_;
+    const const_iterator last = data_ + size_;
+    for (; element != last; ++element) {
+      const std::string& candidate = element->first.string();
+      if (candidate.size() == key.size() && StringView(candidate) == key) {
+        break;
+      }
+    }
+    return element;
+  }
+
+  size_type count(StringView key) const { return find(key) != end(); }
+
+  Value& at(StringView key) {
+    return const_cast<Value&>(static_cast<const TagMap&>(*this).at(key));
+  }
+
+  const Value& at(StringView key) const {
+    const auto found = find(key);
+    if (found == end()) {
+      throw std::out_of_range("TagMap::at: key not found");
+    }
+    return found->second;
+  }
+
+  // Return a reference to the value associated with the specified `key`.  If
+  // there is no such value, then first insert a default constructed value.
+  Value& operator[](StringView key) {
+    const auto found = find(key);
+    if (found != end()) {
+      return found->second;
+    }
+    return emplace_back(key)->second;
+  }
+
+  // If the specified `key` is not in this map, then insert an element
+  // constructed from `key` and the specified `args`.  Return the element
+  // having `key`, and whether the insertion took place.
+  template <typename Key, typename... Args>
+  std::pair<iterator, bool> emplace(Key&& key, Args&&... args) {
+    const auto found = find(key);
+    if (found != end()) {
+      return {found, false};
+    }
+    return {emplace_back(std::forward<Key>(key), std::forward<Args>(args)...),
+            true};
+  }
+
+  template <typename Pair>
+  std::pair<iterator, bool> insert(const Pair& item) {
+    return emplace(item.first, item.second);
+  }
+
+  std::pair<iterator, bool> insert(value_type&& item) {
+    return emplace(std::move(item.first), std::move(item.second));
+  }
+
+  // Insert each of the key/value pairs in the specified range
+  // `[first, last)` whose key is not already in this map.
+  template <typename InputIterator>
+  void insert(InputIterator first, InputIterator last) {
+    for (; first != last; ++first) {
+      insert(*first);
+    }
+  }
+
+  // Associate the specified `value` with the specified `key`, replacing any
+  // existing value.  Return the element having `key`, and whether an insertion
+  // took place.
+  template <typename Key, typename Arg>
+  std::pair<iterator, bool> insert_or_assign(Key&& key, Arg&& value) {
+    const auto found = find(key);
+    if (found != end()) {
+      found->second = std::forward<Arg>(value);
+      return {found, false};
+    }
+    return {emplace_back(std::forward<Key>(key), std::forward<Arg>(value)),
+            true};
+  }
+
+  // Remove the element at the specified `position`, preserving the order of
+  // the remaining elements.  Return an iterator to the element that followed
+  // the removed element.
+  iterator erase(const_iterator position) {
+    const iterator element = const_cast<iterator>(position);
+    std::move(element + 1, end(), element);
+    --size_;
+    data_[size_].~value_type();
+    return element;
+  }
+
+  // Remove the element having the specified `key`, if any.  Return the number
+  // of elements removed.
+  size_type erase(StringView key) {
+    const auto found = find(key);
+    if (found == end()) {
+      return 0;
+    }
+    erase(found);
+    return 1;
+  }
+};
+
+}  // namespace tracing
+}  // namespace datadog
@@ -10,7 +10,7 @@ namespace tracing {
 ThreadedEventScheduler::EventConfig::EventConfig(
     std::function<void()> callback,
     std::chrono::steady_clock::duration interval)
-    : callback(callback), interval(interval), cancelled(false) {}
+    : callback(callback), interval(interval), cancelled(false), generation(0) {}
 
 bool ThreadedEventScheduler::GreaterThan::operator()(
     const ScheduledRun& left, const ScheduledRun& right) const {
@@ -39,7 +39,7 @@ EventScheduler::Cancel ThreadedEventScheduler::schedule_recurring_event(
 
   {
     std::lock_guard<std::mutex> guard(mutex_);
-    upcoming_.push(ScheduledRun{now + interval, config});
+    upcoming_.push(ScheduledRun{now + interval, config, config->generation});
     schedule_or_shutdown_.notify_one();
   }
 
@@ -58,6 +58,57 @@ EventScheduler::Cancel ThreadedEventScheduler::schedule_recurring_event(
   };
 }
 
+EventScheduler::RecurringEvent
+ThreadedEventScheduler::schedule_adjustable_event(
+    std::chrono::steady_clock::duration interval,
+    std::function<void()> callback) {
+  const auto now = std::chrono::steady_clock::now();
+  auto config = std::make_shared<EventConfig>(std::move(callback), interval);
+
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    upcoming_.push(ScheduledRun{now + interval, config, config->generation});
+    schedule_or_shutdown_.notify_one();
+  }
+
+  RecurringEvent event;
+  event.trigger = [this, config]() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    reschedule(config, std::chrono::steady_clock::now());
+  };
+  event.set_interval = [this,
+                        config](std::chrono::steady_clock::duration interval) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    config->interval = interval;
+    reschedule(config, std::chrono::steady_clock::now() + interval);
+  };
+  // The cancellation function is the same as `schedule_recurring_event`'s.
+  event.cancel = [this, config = std::move(config)]() mutable {
+    if (!config) {
+      return;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    config->cancelled = true;
+    current_done_.wait(lock, [this, &config]() {
+      return !running_current_ || current_.config != config;
+    });
+    config.reset();
+  };
+  return event;
+}
+
+void ThreadedEventScheduler::reschedule(
+    const std::shared_ptr<EventConfig>& config,
+    std::chrono::steady_clock::time_point when) {
+  if (config->cancelled) {
+    return;
+  }
+  ++config->generation;
+  upcoming_.push(ScheduledRun{when, config, config->generation});
+  schedule_or_shutdown_.notify_one();
+}
+
 nlohmann::json ThreadedEventScheduler::config_json() const {
   return nlohmann::json::object(
       {{"type", "datadog::tracing::ThreadedEventScheduler"}});
@@ -75,14 +126,17 @@ void ThreadedEventScheduler::run() {
 
     current_ = upcoming_.top();
 
-    if (current_.config->cancelled) {
+    if (current_.config->cancelled ||
+        current_.generation != current_.config->generation) {
       upcoming_.pop();
       continue;
     }
 
     const bool changed =
         schedule_or_shutdown_.wait_until(lock, current_.when, [this]() {
-          return shutting_down_ || upcoming_.top().config != current_.config;
+          return shutting_down_ ||
+                 upcoming_.top().config != current_.config ||
+                 upcoming_.top().generation != current_.generation;
         });
 
     if (shutting_down_) {
@@ -96,12 +150,13 @@ void ThreadedEventScheduler::run() {
 
     // We waited for `current_` and now it's its turn.
     upcoming_.pop();
-    if (current_.config->cancelled) {
+    if (current_.config->cancelled ||
+        current_.generation != current_.config->generation) {
       continue;
     }
 
     upcoming_.push(ScheduledRun{current_.when + current_.config->interval,
-                                current_.config});
+                                current_.config, current_.generation});
     running_current_ = true;
     lock.unlock();
     current_.config->callback();
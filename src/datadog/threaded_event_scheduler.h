@@ -7,6 +7,7 @@
 
 #include <chrono>
 #include <condition_variable>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <mutex>
@@ -24,6 +25,10 @@ class ThreadedEventScheduler : public EventScheduler {
     std::function<void()> callback;
     std::chrono::steady_clock::duration interval;
     bool cancelled;
+    // `generation` is incremented whenever the event is rescheduled by
+    // `trigger` or `set_interval`.  A `ScheduledRun` from an earlier
+    // generation is stale, and is skipped.
+    std::uint64_t generation;
 
     EventConfig(std::function<void()> callback,
                 std::chrono::steady_clock::duration interval);
@@ -32,6 +37,7 @@ class ThreadedEventScheduler : public EventScheduler {
   struct ScheduledRun {
     std::chrono::steady_clock::time_point when;
     std::shared_ptr<const EventConfig> config;
+    std::uint64_t generation;
   };
 
   struct GreaterThan {
@@ -49,6 +55,10 @@ class ThreadedEventScheduler : public EventScheduler {
   std::thread dispatcher_;
 
   void run();
+  // Schedule the next run of the event having the specified `config` at the
+  // specified `when`, superseding any run already scheduled.
+  void reschedule(const std::shared_ptr<EventConfig>& config,
+                  std::chrono::steady_clock::time_point when);
 
  public:
   ThreadedEventScheduler();
@@ -57,6 +67,10 @@ class ThreadedEventScheduler : public EventScheduler {
   Cancel schedule_recurring_event(std::chrono::steady_clock::duration interval,
                                   std::function<void()> callback) override;
 
+  RecurringEvent schedule_adjustable_event(
+      std::chrono::steady_clock::duration interval,
+      std::function<void()> callback) override;
+
   nlohmann::json config_json() const override;
 };
 
@@ -60,7 +60,7 @@ void inject_trace_tags(
     DictWriter& writer,
     const std::vector<std::pair<std::string, std::string>>& trace_tags,
     std::size_t tags_header_max_size,
-    std::unordered_map<std::string, std::string>& local_root_tags,
+    TagMap<std::string>& local_root_tags,
     Logger& logger) {
   const std::string encoded_trace_tags = encode_tags(trace_tags);
 
@@ -108,51 +108,81 @@ TraceSegment::TraceSegment(
     const std::shared_ptr<SpanSampler>& span_sampler,
     const std::shared_ptr<const SpanDefaults>& defaults,
     const std::shared_ptr<ConfigManager>& config_manager,
-    const RuntimeID& runtime_id, bool sampling_delegation_enabled,
+    const std::shared_ptr<const IDGenerator>& generator,
+    const SegmentClock& clock, const RuntimeID& runtime_id,
+    bool sampling_delegation_enabled,
     bool sampling_decision_was_delegated_to_me,
     const std::vector<PropagationStyle>& injection_styles,
     const Optional<std::string>& hostname, Optional<std::string> origin,
-    std::size_t tags_header_max_size,
+    std::size_t tags_header_max_size, std::size_t partial_flush_min_spans,
     std::vector<std::pair<std::string, std::string>> trace_tags,
     Optional<SamplingDecision> sampling_decision,
     Optional<std::string> additional_w3c_tracestate,
-    Optional<std::string> additional_datadog_w3c_tracestate,
+    Optional<std::string> additional_datadog_w3c_tracestate, ArenaPtr arena,
     std::unique_ptr<SpanData> local_root)
-    : logger_(logger),
+    : reference_count_(1),
+      arena_(std::move(arena)),
+      logger_(logger),
       collector_(collector),
       tracer_telemetry_(tracer_telemetry),
       trace_sampler_(trace_sampler),
       span_sampler_(span_sampler),
       defaults_(defaults),
+      generator_(generator),
+      clock_(clock),
       runtime_id_(runtime_id),
       injection_styles_(injection_styles),
       hostname_(hostname),
       origin_(std::move(origin)),
       tags_header_max_size_(tags_header_max_size),
       trace_tags_(std::move(trace_tags)),
-      num_finished_spans_(0),
+      local_root_(std::move(local_root)),
+      finished_spans_(*arena_),
+      num_unfinished_spans_(1),
+      partial_flush_min_spans_(partial_flush_min_spans),
       sampling_decision_(std::move(sampling_decision)),
       additional_w3c_tracestate_(std::move(additional_w3c_tracestate)),
       additional_datadog_w3c_tracestate_(
           std::move(additional_datadog_w3c_tracestate)),
       config_manager_(config_manager) {
+  assert(arena_);
+  assert(local_root_);
   assert(logger_);
   assert(collector_);
   assert(tracer_telemetry_);
   assert(trace_sampler_);
   assert(span_sampler_);
   assert(defaults_);
+  assert(generator_);
   assert(config_manager_);
 
   sampling_delegation_.enabled = sampling_delegation_enabled;
   sampling_delegation_.decision_was_delegated_to_me =
       sampling_decision_was_delegated_to_me;
 
-  register_span(std::move(local_root));
+  tracer_telemetry_->metrics().tracer.spans_created.inc();
+}
+
+void TraceSegment::acquire() {
+  reference_count_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void TraceSegment::release() {
+  if (reference_count_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    delete this;
+  }
 }
 
 const SpanDefaults& TraceSegment::defaults() const { return *defaults_; }
 
+std::uint64_t TraceSegment::generate_span_id() const {
+  return generator_->span_id();
+}
+
+const SegmentClock& TraceSegment::clock() const { return clock_; }
+
+Arena& TraceSegment::arena() const { return *arena_; }
+
 const Optional<std::string>& TraceSegment::hostname() const {
   return hostname_;
 }
@@ -167,64 +197,72 @@ Optional<SamplingDecision> TraceSegment::sampling_decision() const {
 
 Logger& TraceSegment::logger() const { return *logger_; }
 
-void TraceSegment::register_span(std::unique_ptr<SpanData> span) {
+void TraceSegment::register_span(SpanData& /*span*/) {
   tracer_telemetry_->metrics().tracer.spans_created.inc();
-
-  std::lock_guard<std::mutex> lock(mutex_);
-  assert(spans_.empty() || num_finished_spans_ < spans_.size());
-  spans_.emplace_back(std::move(span));
+  num_unfinished_spans_.fetch_add(1, std::memory_order_relaxed);
 }
 
-void TraceSegment::span_finished() {
-  {
-    tracer_telemetry_->metrics().tracer.spans_finished.inc();
-    std::lock_guard<std::mutex> lock(mutex_);
-    ++num_finished_spans_;
-    assert(num_finished_spans_ <= spans_.size());
-    if (num_finished_spans_ < spans_.size()) {
-      return;
-    }
+void TraceSegment::span_finished(SpanData& span) {
+  tracer_telemetry_->metrics().tracer.spans_finished.inc();
+
+  std::unique_ptr<SpanData> owned;
+  if (&span != local_root_.get()) {
+    owned.reset(&span);
   }
-  // We don't need the lock anymore.  There's nobody left to call our methods.
-  // On the other hand, there's nobody left to contend for the mutex, so it
-  // doesn't make any difference.
-  make_sampling_decision_if_null();
-  assert(sampling_decision_);
 
-  // All of our spans are finished.  Run the span sampler, finalize the spans,
-  // and then send the spans to the collector.
-  if (sampling_decision_->priority <= 0) {
-    // Span sampling happens when the trace is dropped.
-    for (const auto& span_ptr : spans_) {
-      SpanData& span = *span_ptr;
-      auto* rule = span_sampler_->match(span);
-      if (!rule) {
-        continue;
+  if (partial_flush_min_spans_) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (owned) {
+      finished_spans_.append(std::move(owned));
+    }
+    if (num_unfinished_spans_.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+      if (finished_spans_.size() < partial_flush_min_spans_) {
+        return;
       }
-      const SamplingDecision decision = rule->decide(span);
-      if (decision.priority <= 0) {
-        continue;
-      }
-      span.numeric_tags[tags::internal::span_sampling_mechanism] =
-          *decision.mechanism;
-      span.numeric_tags[tags::internal::span_sampling_rule_rate] =
-          *decision.configured_rate;
-      if (decision.limiter_max_per_second) {
-        span.numeric_tags[tags::internal::span_sampling_limit] =
-            *decision.limiter_max_per_second;
+      // Send the finished spans now, rather than waiting for the rest of the
+      // segment.  The local root is not among them, since it is not in
+      // `finished_spans_`.
+      make_sampling_decision_if_null();
+      assert(sampling_decision_);
+      const SamplingDecision decision = *sampling_decision_;
+      auto spans = finished_spans_.release();
+      // `trace_tags_` is guarded by `mutex_`.
+      auto shared_tags = make_shared_tags();
+      if (shared_tags) {
+        spans.front()->shared_tags =
+            make_first_span_shared_tags(*shared_tags, *spans.front());
       }
+      lock.unlock();
+
+      tracer_telemetry_->metrics().tracer.trace_partial_flushes.inc();
+      // The agent reads a chunk's sampling priority from its spans, and the
+      // local root is not in this chunk, so tag the first span instead.
+      spans.front()->numeric_tags[tags::internal::sampling_priority] =
+          decision.priority;
+      send_chunk(std::move(spans), decision, shared_tags);
+      return;
+    }
+  } else {
+    if (owned) {
+      finished_spans_.append(std::move(owned));
+    }
+    // The release part of this operation publishes any modifications that
+    // this thread made to its span's data.  The acquire part, for the last
+    // span to finish, makes all such modifications visible to this thread.
+    if (num_unfinished_spans_.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+      return;
     }
   }
 
+  // This is the last span to finish, so there's nobody left to contend for
+  // `mutex_`.
+  make_sampling_decision_if_null();
+  assert(sampling_decision_);
   const SamplingDecision& decision = *sampling_decision_;
 
-  auto& local_root = *spans_.front();
-  local_root.tags.insert(trace_tags_.begin(), trace_tags_.end());
+  auto& local_root = *local_root_;
   local_root.numeric_tags[tags::internal::sampling_priority] =
       decision.priority;
-  if (hostname_) {
-    local_root.tags[tags::internal::hostname] = *hostname_;
-  }
   if (decision.origin == SamplingDecision::Origin::LOCAL) {
     if (decision.mechanism == int(SamplingMechanism::AGENT_RATE) ||
         decision.mechanism == int(SamplingMechanism::DEFAULT)) {
@@ -256,26 +294,104 @@ void TraceSegment::span_finished() {
     local_root.tags[tags::internal::sampling_decider] = "1";
   }
 
-  // Some tags are repeated on all spans.
-  for (const auto& span_ptr : spans_) {
-    SpanData& span = *span_ptr;
-    if (origin_) {
-      span.tags[tags::internal::origin] = *origin_;
+  // The local root additionally has the trace tags and the hostname.  If
+  // those cannot be encoded, then the local root has only the common tags,
+  // as do the other spans.
+  auto shared_tags = make_shared_tags();
+  if (shared_tags) {
+    local_root.shared_tags =
+        make_first_span_shared_tags(*shared_tags, local_root);
+  }
+
+  auto spans = finished_spans_.release();
+  spans.insert(spans.begin(), std::move(local_root_));
+  send_chunk(std::move(spans), decision, shared_tags);
+
+  tracer_telemetry_->metrics().tracer.trace_segments_closed.inc();
+}
+
+void TraceSegment::send_chunk(std::vector<std::unique_ptr<SpanData>>&& spans,
+                              const SamplingDecision& decision,
+                              const std::shared_ptr<SharedTags>& shared_tags) {
+  if (decision.priority <= 0) {
+    // Span sampling happens when the trace is dropped.
+    for (const auto& span_ptr : spans) {
+      SpanData& span = *span_ptr;
+      auto* rule = span_sampler_->match(span);
+      if (!rule) {
+        continue;
+      }
+      const SamplingDecision span_decision = rule->decide(span);
+      if (span_decision.priority <= 0) {
+        continue;
+      }
+      span.numeric_tags[tags::internal::span_sampling_mechanism] =
+          *span_decision.mechanism;
+      span.numeric_tags[tags::internal::span_sampling_rule_rate] =
+          *span_decision.configured_rate;
+      if (span_decision.limiter_max_per_second) {
+        span.numeric_tags[tags::internal::span_sampling_limit] =
+            *span_decision.limiter_max_per_second;
+      }
+    }
+  }
+
+  if (shared_tags) {
+    for (const auto& span_ptr : spans) {
+      if (!span_ptr->shared_tags) {
+        span_ptr->shared_tags = shared_tags;
+      }
     }
-    span.numeric_tags[tags::internal::process_id] = Cache::process_id;
-    span.tags[tags::internal::language] = "cpp";
-    span.tags[tags::internal::runtime_id] = runtime_id_.string();
   }
 
   if (config_manager_->report_traces()) {
-    const auto result = collector_->send(std::move(spans_), trace_sampler_);
+    const auto result = collector_->send(std::move(spans), trace_sampler_);
     if (auto* error = result.if_error()) {
       logger_->log_error(
           error->with_prefix("Error sending spans to collector: "));
     }
   }
+}
 
-  tracer_telemetry_->metrics().tracer.trace_segments_closed.inc();
+std::shared_ptr<SharedTags> TraceSegment::make_shared_tags() const {
+  // Some tags are repeated on all spans.  Rather than adding them to each
+  // span, encode them once and share them among the spans.
+  auto shared_tags = std::make_shared<SharedTags>();
+  if (origin_) {
+    shared_tags->tags.emplace(tags::internal::origin, *origin_);
+  }
+  shared_tags->numeric_tags.emplace(tags::internal::process_id,
+                                    Cache::process_id);
+  shared_tags->tags.emplace(tags::internal::language, "cpp");
+  shared_tags->tags.emplace(tags::internal::runtime_id, runtime_id_.string());
+
+  const auto encoded = shared_tags->encode();
+  if (auto* error = encoded.if_error()) {
+    logger_->log_error(error->with_prefix("Unable to encode span tags: "));
+    return nullptr;
+  }
+  return shared_tags;
+}
+
+std::shared_ptr<SharedTags> TraceSegment::make_first_span_shared_tags(
+    const SharedTags& common, const SpanData& first) const {
+  auto shared_tags = std::make_shared<SharedTags>(common);
+  if (hostname_) {
+    shared_tags->tags.emplace(tags::internal::hostname, *hostname_);
+  }
+  for (const auto& [key, value] : trace_tags_) {
+    // Tags already on the span take precedence over trace tags.
+    if (!first.tags.count(key)) {
+      shared_tags->tags.emplace(key, value);
+    }
+  }
+
+  const auto encoded = shared_tags->encode();
+  if (auto* error = encoded.if_error()) {
+    logger_->log_error(error->with_prefix("Unable to encode span tags: "));
+    return nullptr;
+  }
+  return shared_tags;
 }
 
 void TraceSegment::override_sampling_priority(int priority) {
@@ -296,8 +412,7 @@ void TraceSegment::make_sampling_decision_if_null() {
     return;
   }
 
-  const SpanData& local_root = *spans_.front();
-  sampling_decision_ = trace_sampler_->decide(local_root);
+  sampling_decision_ = trace_sampler_->decide(*local_root_);
 
   update_decision_maker_trace_tag();
 }
@@ -398,7 +513,7 @@ bool TraceSegment::inject(DictWriter& writer, const SpanData& span,
           writer.set("x-datadog-delegate-trace-sampling", "delegate");
         }
         inject_trace_tags(writer, trace_tags, tags_header_max_size_,
-                          spans_.front()->tags, *logger_);
+                          local_root_->tags, *logger_);
         break;
       case PropagationStyle::B3:
         if (span.trace_id.high) {
@@ -412,7 +527,7 @@ bool TraceSegment::inject(DictWriter& writer, const SpanData& span,
           writer.set("x-datadog-origin", *origin_);
         }
         inject_trace_tags(writer, trace_tags, tags_header_max_size_,
-                          spans_.front()->tags, *logger_);
+                          local_root_->tags, *logger_);
         break;
       case PropagationStyle::W3C:
         writer.set(
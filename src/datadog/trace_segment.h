@@ -23,21 +23,43 @@
 // child `Span` is created from a `Span`, the child and the parent share the
 // same `TraceSegment`.
 //
+// `TraceSegment` is reference counted.  Each `Span` in the segment holds one
+// reference, and the segment is destroyed when the last `Span` is destroyed.
+// The count is intrusive, rather than a `std::shared_ptr`, so that a `Span` is
+// a single pointer to its segment, and so that creating a child span doesn't
+// copy any `std::shared_ptr` or `std::function`.  The span ID generator and the
+// clock used by the segment's spans are accessed through the segment.
+//
 // When all of the `Span`s associated with `TraceSegment` have been destroyed,
 // the `TraceSegment` submits them in a payload to a `Collector`.
+//
+// If partial flushing is enabled, then whenever a configured number of spans
+// have finished while others remain unfinished, the finished spans are
+// submitted to the `Collector` as a separate chunk of the trace.  The local
+// root span is always submitted with the last chunk.
+//
+// The `SpanData` of each span in the segment is allocated from the segment's
+// `Arena`.  The arena is freed, all at once, after the `Collector` has
+// destroyed the last of the segment's spans.
 
+#include <atomic>
 #include <cstddef>
 #include <memory>
 #include <mutex>
 #include <utility>
 #include <vector>
 
+#include "arena.h"
+#include "clock.h"
 #include "config_manager.h"
 #include "expected.h"
+#include "id_generator.h"
 #include "metrics.h"
 #include "optional.h"
 #include "propagation_style.h"
 #include "sampling_decision.h"
+#include "segment_clock.h"
+#include "span_list.h"
 #include "tracer_telemetry.h"
 
 namespace datadog {
@@ -51,10 +73,14 @@ class Logger;
 struct SpanData;
 struct SpanDefaults;
 class SpanSampler;
+struct SharedTags;
 class TraceSampler;
 
 class TraceSegment {
   mutable std::mutex mutex_;
+  std::atomic<std::size_t> reference_count_;
+
+  ArenaPtr arena_;
 
   std::shared_ptr<Logger> logger_;
   std::shared_ptr<Collector> collector_;
@@ -63,6 +89,8 @@ class TraceSegment {
   std::shared_ptr<SpanSampler> span_sampler_;
 
   std::shared_ptr<const SpanDefaults> defaults_;
+  std::shared_ptr<const IDGenerator> generator_;
+  const SegmentClock clock_;
   RuntimeID runtime_id_;
   const std::vector<PropagationStyle> injection_styles_;
   const Optional<std::string> hostname_;
@@ -70,8 +98,18 @@ class TraceSegment {
   const std::size_t tags_header_max_size_;
   std::vector<std::pair<std::string, std::string>> trace_tags_;
 
-  std::vector<std::unique_ptr<SpanData>> spans_;
-  std::size_t num_finished_spans_;
+  // The local root span belongs to this segment until the last chunk is sent.
+  // Other spans belong to their `Span` until they finish, and then to
+  // `finished_spans_` until they are sent.
+  std::unique_ptr<SpanData> local_root_;
+  // `finished_spans_` and `num_unfinished_spans_` are modified without holding
+  // `mutex_`, since spans are created and finished concurrently.  If partial
+  // flushing is enabled, however, then spans finish while holding `mutex_`, so
+  // that a partial flush does not race with `finished_spans_.append`.
+  SpanList finished_spans_;
+  std::atomic<std::size_t> num_unfinished_spans_;
+  // `partial_flush_min_spans_` is zero if partial flushing is disabled.
+  const std::size_t partial_flush_min_spans_;
   Optional<SamplingDecision> sampling_decision_;
   Optional<std::string> additional_w3c_tracestate_;
   Optional<std::string> additional_datadog_w3c_tracestate_;
@@ -97,7 +135,11 @@ class TraceSegment {
     bool sent_response_header;
   } sampling_delegation_ = {};
 
+  // Destroy this segment.  See `release`.
+  ~TraceSegment() = default;
+
  public:
+  // Create a segment having a reference count of one.
   TraceSegment(const std::shared_ptr<Logger>& logger,
                const std::shared_ptr<Collector>& collector,
                const std::shared_ptr<TracerTelemetry>& tracer_telemetry,
@@ -105,18 +147,36 @@ class TraceSegment {
                const std::shared_ptr<SpanSampler>& span_sampler,
                const std::shared_ptr<const SpanDefaults>& defaults,
                const std::shared_ptr<ConfigManager>& config_manager,
-               const RuntimeID& runtime_id, bool sampling_delegation_enabled,
+               const std::shared_ptr<const IDGenerator>& generator,
+               const SegmentClock& clock, const RuntimeID& runtime_id,
+               bool sampling_delegation_enabled,
                bool sampling_decision_was_delegated_to_me,
                const std::vector<PropagationStyle>& injection_styles,
                const Optional<std::string>& hostname,
                Optional<std::string> origin, std::size_t tags_header_max_size,
+               std::size_t partial_flush_min_spans,
                std::vector<std::pair<std::string, std::string>> trace_tags,
                Optional<SamplingDecision> sampling_decision,
                Optional<std::string> additional_w3c_tracestate,
                Optional<std::string> additional_datadog_w3c_tracestate,
-               std::unique_ptr<SpanData> local_root);
+               ArenaPtr arena, std::unique_ptr<SpanData> local_root);
+  TraceSegment(const TraceSegment&) = delete;
+  TraceSegment& operator=(const TraceSegment&) = delete;
+
+  // Increment this segment's reference count.
+  void acquire();
+  // Decrement this segment's reference count.  If the count becomes zero, then
+  // destroy this segment.
+  void release();
 
   const SpanDefaults& defaults() const;
+  // Return a new span ID.
+  std::uint64_t generate_span_id() const;
+  // Return the clock used to determine the start and end times of this
+  // segment's spans.
+  const SegmentClock& clock() const;
+  // Return the arena from which this segment's `SpanData` are allocated.
+  Arena& arena() const;
   const Optional<std::string>& hostname() const;
   const Optional<std::string>& origin() const;
   Optional<SamplingDecision> sampling_decision() const;
@@ -138,11 +198,18 @@ class TraceSegment {
   // one, and use the resulting decision, if appropriate.
   Expected<void> read_sampling_delegation_response(const DictReader& reader);
 
-  // Take ownership of the specified `span`.
-  void register_span(std::unique_ptr<SpanData> span);
-  // Increment the number of finished spans.  If that number is equal to the
-  // number of registered spans, send all of the spans to the `Collector`.
-  void span_finished();
+  // Note that the specified `span` is part of this segment.  The caller retains
+  // ownership of `span` until it is passed to `span_finished`.  The behavior
+  // is undefined unless at least one of this segment's spans is unfinished.
+  void register_span(SpanData& span);
+  // Note that the specified `span`, which is the local root or was previously
+  // passed to `register_span`, has finished, and take ownership of it.  If it
+  // was the last unfinished span, then finalize the spans and send them to the
+  // `Collector`.  Otherwise, if partial flushing is enabled and enough spans
+  // have finished, send the finished spans to the `Collector`.  Unless
+  // partial flushing is enabled, neither this function nor `register_span`
+  // acquires a lock.
+  void span_finished(SpanData& span);
 
   // Set the sampling decision to be a local, manual decision with the specified
   // sampling `priority`.  Overwrite any previous sampling decision.
@@ -152,6 +219,23 @@ class TraceSegment {
   // If `sampling_decision_` is null, use `trace_sampler_` to make a
   // sampling decision and assign it to `sampling_decision_`.
   void make_sampling_decision_if_null();
+  // Send the specified `spans`, which are all finished, to the `Collector` as a
+  // chunk of this segment having the specified sampling `decision`.  The
+  // specified `shared_tags` are assigned to each span whose `shared_tags`
+  // are not already set.
+  void send_chunk(std::vector<std::unique_ptr<SpanData>>&& spans,
+                  const SamplingDecision& decision,
+                  const std::shared_ptr<SharedTags>& shared_tags);
+  // Return the tags that are shared by all spans of this segment, or return
+  // null if they could not be encoded.
+  std::shared_ptr<SharedTags> make_shared_tags() const;
+  // Return the tags of the specified `first` span of a chunk: the specified
+  // `common` tags, the hostname, and those trace tags that `first` does not
+  // already have.  Return null if the tags could not be encoded.  The agent
+  // reads the trace tags, e.g. the high 64 bits of the trace ID, from the
+  // first span of each chunk.
+  std::shared_ptr<SharedTags> make_first_span_shared_tags(
+      const SharedTags& common, const SpanData& first) const;
   // Set or remove the `tags::internal::decision_maker` trace tag in
   // `trace_tags_` according to either information extracted from trace context
   // or from a local sampling decision.
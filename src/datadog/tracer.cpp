@@ -15,6 +15,7 @@
 #include "logger.h"
 #include "parse_util.h"
 #include "platform_util.h"
+#include "segment_clock.h"
 #include "span.h"
 #include "span_config.h"
 #include "span_data.h"
@@ -29,6 +30,20 @@
 
 namespace datadog {
 namespace tracing {
+namespace {
+
+StringView to_string(ClockMode mode) {
+  switch (mode) {
+    case ClockMode::SEGMENT_ANCHORED:
+      return "segment_anchored";
+    case ClockMode::TSC:
+      return "tsc";
+    default:
+      return "default";
+  }
+}
+
+}  // namespace
 
 Tracer::Tracer(const FinalizedTracerConfig& config)
     : Tracer(config, default_id_generator(config.generate_128bit_trace_ids)) {}
@@ -49,11 +64,21 @@ Tracer::Tracer(const FinalizedTracerConfig& config,
           std::make_shared<SpanSampler>(config.span_sampler, config.clock)),
       generator_(generator),
       clock_(config.clock),
+      clock_mode_(config.clock_mode),
       injection_styles_(config.injection_styles),
       extraction_styles_(config.extraction_styles),
       hostname_(config.report_hostname ? get_hostname() : nullopt),
       tags_header_max_size_(config.tags_header_size),
+      partial_flush_min_spans_(config.partial_flush_enabled
+                                   ? config.partial_flush_min_spans
+                                   : 0),
       sampling_delegation_enabled_(config.delegate_trace_sampling) {
+  // Calibrate the time stamp counter now, rather than when the first trace
+  // segment is created.
+  if (clock_mode_ == ClockMode::TSC && !SegmentClock::tsc_available()) {
+    clock_mode_ = ClockMode::SEGMENT_ANCHORED;
+  }
+
   if (auto* collector =
           std::get_if<std::shared_ptr<Collector>>(&config.collector)) {
     collector_ = *collector;
@@ -88,6 +113,8 @@ nlohmann::json Tracer::config_json() const {
     {"injection_styles", to_json(injection_styles_)},
     {"extraction_styles", to_json(extraction_styles_)},
     {"tags_header_size", tags_header_max_size_},
+    {"clock_mode", to_string(clock_mode_)},
+    {"partial_flush_min_spans", partial_flush_min_spans_},
     {"environment_variables", environment::to_json()},
   });
   // clang-format on
@@ -105,8 +132,12 @@ Span Tracer::create_span() { return create_span(SpanConfig{}); }
 
 Span Tracer::create_span(const SpanConfig& config) {
   auto defaults = config_manager_->span_defaults();
-  auto span_data = std::make_unique<SpanData>();
-  span_data->apply_config(*defaults, config, clock_);
+  ArenaPtr arena{Arena::create()};
+  auto span_data = make_span_data(*arena);
+  const SegmentClock clock{clock_, clock_mode_};
+  span_data->apply_config(*defaults, config,
+                          config.start ? clock.convert(*config.start)
+                                       : clock.now());
   span_data->trace_id = generator_->trace_id(span_data->start);
   span_data->span_id = span_data->trace_id.low;
   span_data->parent_id = 0;
@@ -119,19 +150,17 @@ Span Tracer::create_span(const SpanConfig& config) {
 
   const auto span_data_ptr = span_data.get();
   tracer_telemetry_->metrics().tracer.trace_segments_created_new.inc();
-  const auto segment = std::make_shared<TraceSegment>(
+  auto* const segment = new TraceSegment(
       logger_, collector_, tracer_telemetry_, config_manager_->trace_sampler(),
-      span_sampler_, defaults, config_manager_, runtime_id_,
+      span_sampler_, defaults, config_manager_, generator_, clock, runtime_id_,
       sampling_delegation_enabled_,
       false /* sampling_decision_was_delegated_to_me */, injection_styles_,
       hostname_, nullopt /* origin */, tags_header_max_size_,
-      std::move(trace_tags), nullopt /* sampling_decision */,
-      nullopt /* additional_w3c_tracestate */,
-      nullopt /* additional_datadog_w3c_tracestate*/, std::move(span_data));
-  Span span{span_data_ptr, segment,
-            [generator = generator_]() { return generator->span_id(); },
-            clock_};
-  return span;
+      partial_flush_min_spans_, std::move(trace_tags),
+      nullopt /* sampling_decision */, nullopt /* additional_w3c_tracestate */,
+      nullopt /* additional_datadog_w3c_tracestate*/, std::move(arena),
+      std::move(span_data));
+  return Span{span_data_ptr, segment};
 }
 
 Expected<Span> Tracer::extract_span(const DictReader& reader) {
@@ -144,7 +173,8 @@ Expected<Span> Tracer::extract_span(const DictReader& reader,
 
   AuditedReader audited_reader{reader};
 
-  auto span_data = std::make_unique<SpanData>();
+  ArenaPtr arena{Arena::create()};
+  auto span_data = make_span_data(*arena);
   std::vector<ExtractedData> extracted_contexts;
 
   for (const auto style : extraction_styles_) {
@@ -240,7 +270,10 @@ Expected<Span> Tracer::extract_span(const DictReader& reader,
 
   // We're done extracting fields.  Now create the span.
   // This is similar to what we do in `create_span`.
-  span_data->apply_config(*config_manager_->span_defaults(), config, clock_);
+  const SegmentClock clock{clock_, clock_mode_};
+  span_data->apply_config(*config_manager_->span_defaults(), config,
+                          config.start ? clock.convert(*config.start)
+                                       : clock.now());
   span_data->span_id = generator_->span_id();
   span_data->trace_id = *trace_id;
   span_data->parent_id = *parent_id;
@@ -290,18 +323,17 @@ Expected<Span> Tracer::extract_span(const DictReader& reader,
 
   const auto span_data_ptr = span_data.get();
   tracer_telemetry_->metrics().tracer.trace_segments_created_continued.inc();
-  const auto segment = std::make_shared<TraceSegment>(
+  auto* const segment = new TraceSegment(
       logger_, collector_, tracer_telemetry_, config_manager_->trace_sampler(),
       span_sampler_, config_manager_->span_defaults(), config_manager_,
-      runtime_id_, sampling_delegation_enabled_, delegate_sampling_decision,
-      injection_styles_, hostname_, std::move(origin), tags_header_max_size_,
+      generator_, clock, runtime_id_, sampling_delegation_enabled_,
+      delegate_sampling_decision, injection_styles_, hostname_,
+      std::move(origin), tags_header_max_size_, partial_flush_min_spans_,
       std::move(trace_tags), std::move(sampling_decision),
       std::move(additional_w3c_tracestate),
-      std::move(additional_datadog_w3c_tracestate), std::move(span_data));
-  Span span{span_data_ptr, segment,
-            [generator = generator_]() { return generator->span_id(); },
-            clock_};
-  return span;
+      std::move(additional_datadog_w3c_tracestate), std::move(arena),
+      std::move(span_data));
+  return Span{span_data_ptr, segment};
 }
 
 Expected<Span> Tracer::extract_or_create_span(const DictReader& reader) {
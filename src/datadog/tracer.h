@@ -43,10 +43,13 @@ class Tracer {
   std::shared_ptr<SpanSampler> span_sampler_;
   std::shared_ptr<const IDGenerator> generator_;
   Clock clock_;
+  ClockMode clock_mode_;
   std::vector<PropagationStyle> injection_styles_;
   std::vector<PropagationStyle> extraction_styles_;
   Optional<std::string> hostname_;
   std::size_t tags_header_max_size_;
+  // `partial_flush_min_spans_` is zero if partial flushing is disabled.
+  std::size_t partial_flush_min_spans_;
   bool sampling_delegation_enabled_;
 
  public:
@@ -130,6 +130,21 @@ Expected<TracerConfig> load_tracer_env_config(Logger &logger) {
   if (auto enabled_env = lookup(environment::DD_TRACE_ENABLED)) {
     env_cfg.report_traces = !falsy(*enabled_env);
   }
+  if (auto enabled_env = lookup(environment::DD_TRACE_PARTIAL_FLUSH_ENABLED)) {
+    env_cfg.partial_flush_enabled = !falsy(*enabled_env);
+  }
+  if (auto min_spans_env =
+          lookup(environment::DD_TRACE_PARTIAL_FLUSH_MIN_SPANS)) {
+    auto min_spans = parse_uint64(*min_spans_env, 10);
+    if (auto *error = min_spans.if_error()) {
+      std::string prefix;
+      prefix += "Unable to parse ";
+      append(prefix, name(environment::DD_TRACE_PARTIAL_FLUSH_MIN_SPANS));
+      prefix += " environment variable: ";
+      return error->with_prefix(prefix);
+    }
+    env_cfg.partial_flush_min_spans = *min_spans;
+  }
   if (auto enabled_env =
           lookup(environment::DD_INSTRUMENTATION_TELEMETRY_ENABLED)) {
     env_cfg.report_telemetry = !falsy(*enabled_env);
@@ -261,6 +276,7 @@ Expected<FinalizedTracerConfig> finalize_config(const TracerConfig &user_config,
 
   FinalizedTracerConfig final_config;
   final_config.clock = clock;
+  final_config.clock_mode = user_config.clock_mode.value_or(ClockMode::DEFAULT);
   final_config.logger = logger;
 
   ConfigMetadata::Origin origin;
@@ -361,6 +377,19 @@ Expected<FinalizedTracerConfig> finalize_config(const TracerConfig &user_config,
   final_config.tags_header_size = value_or(
       env_config->max_tags_header_size, user_config.max_tags_header_size, 512);
 
+  // Partial Flush
+  final_config.partial_flush_enabled =
+      value_or(env_config->partial_flush_enabled,
+               user_config.partial_flush_enabled, false);
+  final_config.partial_flush_min_spans =
+      value_or(env_config->partial_flush_min_spans,
+               user_config.partial_flush_min_spans, 1000);
+  if (final_config.partial_flush_min_spans == 0) {
+    return Error{Error::PARTIAL_FLUSH_INVALID_MIN_SPANS,
+                 "The minimum number of spans in a partial flush must be "
+                 "positive."};
+  }
+
   // 128b Trace IDs
   std::tie(origin, final_config.generate_128bit_trace_ids) =
       pick(env_config->generate_128bit_trace_ids,
@@ -123,6 +123,27 @@ struct TracerConfig {
   // exceed `tags_header_size`, the header will be omitted instead.
   Optional<std::size_t> max_tags_header_size;
 
+  // `partial_flush_enabled` indicates whether the tracer sends the finished
+  // spans of a trace segment to the collector before the entire segment has
+  // finished, once at least `partial_flush_min_spans` of them have finished.
+  // This bounds the memory held by long-running traces having many spans.
+  // `partial_flush_enabled` is overridden by the
+  // `DD_TRACE_PARTIAL_FLUSH_ENABLED` environment variable.
+  Optional<bool> partial_flush_enabled;
+
+  // `partial_flush_min_spans` is the number of finished spans in a trace
+  // segment that triggers a partial flush, if partial flushing is enabled.  It
+  // must be positive, and defaults to 1000.  `partial_flush_min_spans` is
+  // overridden by the `DD_TRACE_PARTIAL_FLUSH_MIN_SPANS` environment variable.
+  Optional<std::size_t> partial_flush_min_spans;
+
+  // `clock_mode` selects how the tracer measures span start times and
+  // durations.  The default, `ClockMode::DEFAULT`, reads the system clock and
+  // the steady clock at the start and end of each span.  The other modes read
+  // the system clock once per trace segment, and ignore the `Clock` passed to
+  // `finalize_config` for span times.  See `clock.h` and `segment_clock.h`.
+  Optional<ClockMode> clock_mode;
+
   // `logger` specifies how the tracer will issue diagnostic messages.  If
   // `logger` is null, then it defaults to a logger that inserts into
   // `std::cerr`.
@@ -188,12 +209,15 @@ class FinalizedTracerConfig final {
 
   bool report_hostname;
   std::size_t tags_header_size;
+  bool partial_flush_enabled;
+  std::size_t partial_flush_min_spans;
   std::shared_ptr<Logger> logger;
   bool log_on_startup;
   bool generate_128bit_trace_ids;
   bool report_telemetry;
   Optional<RuntimeID> runtime_id;
   Clock clock;
+  ClockMode clock_mode;
   std::string integration_name;
   std::string integration_version;
   bool delegate_trace_sampling;
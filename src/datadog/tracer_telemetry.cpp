@@ -78,6 +78,12 @@ TracerTelemetry::TracerTelemetry(bool enabled, const Clock& clock,
         metrics_.tracer.trace_segments_created_continued, MetricSnapshot{});
     metrics_snapshots_.emplace_back(metrics_.tracer.trace_segments_closed,
                                     MetricSnapshot{});
+    metrics_snapshots_.emplace_back(metrics_.tracer.trace_partial_flushes,
+                                    MetricSnapshot{});
+    metrics_snapshots_.emplace_back(metrics_.tracer.trace_chunks_dropped,
+                                    MetricSnapshot{});
+    metrics_snapshots_.emplace_back(metrics_.tracer.spans_dropped,
+                                    MetricSnapshot{});
     metrics_snapshots_.emplace_back(metrics_.trace_api.requests,
                                     MetricSnapshot{});
     metrics_snapshots_.emplace_back(metrics_.trace_api.responses_1xx,
@@ -96,6 +102,10 @@ TracerTelemetry::TracerTelemetry(bool enabled, const Clock& clock,
                                     MetricSnapshot{});
     metrics_snapshots_.emplace_back(metrics_.trace_api.errors_status_code,
                                     MetricSnapshot{});
+    metrics_snapshots_.emplace_back(metrics_.http_client.connections_new,
+                                    MetricSnapshot{});
+    metrics_snapshots_.emplace_back(metrics_.http_client.connections_reused,
+                                    MetricSnapshot{});
   }
 }
 
@@ -71,6 +71,12 @@ class TracerTelemetry {
           "trace_segments_created", {"new_continued:continued"}, true};
       CounterMetric trace_segments_closed = {
           "trace_segments_closed", {"integration_name:datadog"}, true};
+      CounterMetric trace_partial_flushes = {
+          "trace_partial_flush.count", {"reason:large_trace"}, true};
+      CounterMetric trace_chunks_dropped = {
+          "trace_chunks_dropped", {"reason:overfull_buffer"}, true};
+      CounterMetric spans_dropped = {
+          "spans_dropped", {"reason:overfull_buffer"}, true};
     } tracer;
     struct {
       CounterMetric requests = {"trace_api.requests", {}, true};
@@ -94,6 +100,12 @@ class TracerTelemetry {
           "trace_api.errors", {"type:status_code"}, true};
 
     } trace_api;
+    struct {
+      CounterMetric connections_new = {
+          "http_client.requests", {"connection:new"}, false};
+      CounterMetric connections_reused = {
+          "http_client.requests", {"connection:reused"}, false};
+    } http_client;
   } metrics_;
   // Each metric has an associated MetricSnapshot that contains the data points,
   // represented as a timestamp and the value of that metric.
@@ -281,9 +281,8 @@ void extract_tracestate(ExtractedData& result, const DictReader& headers) {
 
 }  // namespace
 
-Expected<ExtractedData> extract_w3c(
-    const DictReader& headers,
-    std::unordered_map<std::string, std::string>& span_tags, Logger&) {
+Expected<ExtractedData> extract_w3c(const DictReader& headers,
+                                    TagMap<std::string>& span_tags, Logger&) {
   ExtractedData result;
   result.style = PropagationStyle::W3C;
 
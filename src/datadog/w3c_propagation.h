@@ -6,11 +6,11 @@
 
 #include <cstdint>
 #include <string>
-#include <unordered_map>
 
 #include "expected.h"
 #include "extracted_data.h"
 #include "optional.h"
+#include "span_data.h"
 #include "trace_id.h"
 
 namespace datadog {
@@ -24,9 +24,8 @@ class Logger;
 // `tags::internal::w3c_extraction_error` tag in the specified `span_tags`.
 // `extract_w3c` will not return an error; instead, it returns an empty
 // `ExtractedData` when extraction fails.
-Expected<ExtractedData> extract_w3c(
-    const DictReader& headers,
-    std::unordered_map<std::string, std::string>& span_tags, Logger&);
+Expected<ExtractedData> extract_w3c(const DictReader& headers,
+                                    TagMap<std::string>& span_tags, Logger&);
 
 // Return a value for the "traceparent" header consisting of the specified
 // `trace_id` or the optionally specified `full_w3c_trace_id_hex` as the trace
@@ -0,0 +1,226 @@
+#include "local_agent.h"
+
+#ifndef _MSC_VER
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <stdexcept>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+namespace {
+
+// Return the value of the header having the specified `name`, ignoring case,
+// in the specified `head` of an HTTP request, or return an empty string if
+// there isn't one.
+std::string header_value(const std::string& head, const std::string& name) {
+  std::size_t line = head.find("\r\n");
+  while (line != std::string::npos && line + 2 < head.size()) {
+    const std::size_t begin = line + 2;
+    const std::size_t end = head.find("\r\n", begin);
+    const std::size_t colon = head.find(':', begin);
+    if (colon != std::string::npos && colon < end &&
+        colon - begin == name.size() &&
+        std::equal(name.begin(), name.end(), head.begin() + begin,
+                   [](char left, char right) {
+                     return std::tolower(static_cast<unsigned char>(left)) ==
+                            std::tolower(static_cast<unsigned char>(right));
+                   })) {
+      std::size_t value = colon + 1;
+      while (value < end && head[value] == ' ') {
+        ++value;
+      }
+      return head.substr(value, end - value);
+    }
+    line = end;
+  }
+  return "";
+}
+
+}  // namespace
+
+LocalAgent::LocalAgent()
+    : listener_(::socket(AF_INET, SOCK_STREAM, 0)),
+      port_(0),
+      stopping_(false),
+      requests_(0),
+      trace_chunks_(0),
+      body_bytes_(0),
+      connections_accepted_(0) {
+  if (listener_ == -1) {
+    throw std::runtime_error("LocalAgent: unable to create a socket");
+  }
+  sockaddr_in address;
+  std::memset(&address, 0, sizeof address);
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = 0;
+  socklen_t length = sizeof address;
+  if (::bind(listener_, reinterpret_cast<sockaddr*>(&address), length) != 0 ||
+      ::listen(listener_, 128) != 0 ||
+      ::getsockname(listener_, reinterpret_cast<sockaddr*>(&address),
+                    &length) != 0) {
+    ::close(listener_);
+    throw std::runtime_error("LocalAgent: unable to listen");
+  }
+  port_ = ntohs(address.sin_port);
+  start();
+}
+
+LocalAgent::LocalAgent(std::string unix_socket_path)
+    : listener_(::socket(AF_UNIX, SOCK_STREAM, 0)),
+      port_(0),
+      unix_socket_path_(std::move(unix_socket_path)),
+      stopping_(false),
+      requests_(0),
+      trace_chunks_(0),
+      body_bytes_(0),
+      connections_accepted_(0) {
+  if (listener_ == -1) {
+    throw std::runtime_error("LocalAgent: unable to create a socket");
+  }
+  sockaddr_un address;
+  std::memset(&address, 0, sizeof address);
+  address.sun_family = AF_UNIX;
+  if (unix_socket_path_.size() >= sizeof address.sun_path) {
+    ::close(listener_);
+    throw std::runtime_error("LocalAgent: unix socket path is too long");
+  }
+  std::memcpy(address.sun_path, unix_socket_path_.data(),
+              unix_socket_path_.size());
+  if (::bind(listener_, reinterpret_cast<sockaddr*>(&address),
+             sizeof address) != 0 ||
+      ::listen(listener_, 128) != 0) {
+    ::close(listener_);
+    throw std::runtime_error("LocalAgent: unable to listen");
+  }
+  start();
+}
+
+void LocalAgent::start() {
+  acceptor_ = std::thread([this]() { accept_connections(); });
+}
+
+LocalAgent::~LocalAgent() {
+  stopping_ = true;
+  ::shutdown(listener_, SHUT_RDWR);
+  acceptor_.join();
+  ::close(listener_);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const int connection : connections_) {
+      ::shutdown(connection, SHUT_RDWR);
+    }
+  }
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+  for (const int connection : connections_) {
+    ::close(connection);
+  }
+  if (!unix_socket_path_.empty()) {
+    ::unlink(unix_socket_path_.c_str());
+  }
+}
+
+void LocalAgent::accept_connections() {
+  for (;;) {
+    const int connection = ::accept(listener_, nullptr, nullptr);
+    if (connection == -1) {
+      if (stopping_) {
+        return;
+      }
+      continue;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++connections_accepted_;
+    connections_.push_back(connection);
+    threads_.emplace_back([this, connection]() { serve(connection); });
+  }
+}
+
+void LocalAgent::serve(int connection) {
+  std::string received;
+  char buffer[64 * 1024];
+  for (;;) {
+    // Read the request's head, and then its body.
+    std::size_t head_end;
+    while ((head_end = received.find("\r\n\r\n")) == std::string::npos) {
+      const ssize_t count = ::recv(connection, buffer, sizeof buffer, 0);
+      if (count <= 0) {
+        return;
+      }
+      received.append(buffer, std::size_t(count));
+    }
+    const std::string head = received.substr(0, head_end + 2);
+    const std::string content_length = header_value(head, "Content-Length");
+    const std::size_t body_size =
+        content_length.empty() ? 0 : std::stoul(content_length);
+    const std::size_t request_size = head_end + 4 + body_size;
+    while (received.size() < request_size) {
+      const ssize_t count = ::recv(connection, buffer, sizeof buffer, 0);
+      if (count <= 0) {
+        return;
+      }
+      received.append(buffer, std::size_t(count));
+    }
+    received.erase(0, request_size);
+
+    const std::string trace_count =
+        header_value(head, "X-Datadog-Trace-Count");
+    if (!trace_count.empty()) {
+      trace_chunks_ += std::stoul(trace_count);
+    }
+    body_bytes_ += body_size;
+    ++requests_;
+
+    static const char response[] =
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: application/json\r\n"
+        "Content-Length: 2\r\n"
+        "\r\n"
+        "{}";
+    std::size_t sent = 0;
+    while (sent < sizeof response - 1) {
+      const ssize_t count = ::send(connection, response + sent,
+                                   sizeof response - 1 - sent, MSG_NOSIGNAL);
+      if (count <= 0) {
+        return;
+      }
+      sent += std::size_t(count);
+    }
+  }
+}
+
+std::string LocalAgent::url() const {
+  if (!unix_socket_path_.empty()) {
+    return "unix://" + unix_socket_path_;
+  }
+  return "http://127.0.0.1:" + std::to_string(port_);
+}
+
+void LocalAgent::close_connections() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const int connection : connections_) {
+    ::shutdown(connection, SHUT_RDWR);
+  }
+}
+
+std::size_t LocalAgent::requests() const { return requests_; }
+
+std::size_t LocalAgent::connections_accepted() const {
+  return connections_accepted_;
+}
+
+std::size_t LocalAgent::trace_chunks() const { return trace_chunks_; }
+
+std::size_t LocalAgent::body_bytes() const { return body_bytes_; }
+
+#endif
@@ -0,0 +1,63 @@
+#pragma once
+
+// This component provides a class, `LocalAgent`, that is a stand-in for the
+// Datadog Agent that listens for HTTP requests on a loopback TCP port or on a
+// unix domain socket, so that tests can send traces over a real connection.
+//
+// `LocalAgent` responds to every request with status 200 and the body "{}".
+// It counts the requests that it receives, and the trace chunks in them
+// according to their "X-Datadog-Trace-Count" header.  Each connection is
+// served by its own thread, and connections are kept alive.
+//
+// `LocalAgent` is not supported on Windows.
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class LocalAgent {
+  int listener_;
+  int port_;
+  std::string unix_socket_path_;
+  std::atomic<bool> stopping_;
+  std::mutex mutex_;
+  std::vector<int> connections_;
+  std::vector<std::thread> threads_;
+  std::thread acceptor_;
+  std::atomic<std::size_t> requests_;
+  std::atomic<std::size_t> trace_chunks_;
+  std::atomic<std::size_t> body_bytes_;
+  std::atomic<std::size_t> connections_accepted_;
+
+  void start();
+  void accept_connections();
+  void serve(int connection);
+
+ public:
+  // Listen on an ephemeral port of the loopback interface.  Throw an
+  // exception if that fails.
+  LocalAgent();
+  // Listen on a unix domain socket at the specified `unix_socket_path`, which
+  // must not exist.  Throw an exception if that fails.
+  explicit LocalAgent(std::string unix_socket_path);
+  LocalAgent(const LocalAgent&) = delete;
+  LocalAgent& operator=(const LocalAgent&) = delete;
+  // Close every connection and wait for the threads to finish.
+  ~LocalAgent();
+
+  // Return the URL of this agent, e.g. "http://127.0.0.1:34567" or
+  // "unix:///tmp/agent.sock".
+  std::string url() const;
+
+  // Close every connection that the agent has accepted so far, as an agent
+  // does when a kept-alive connection is idle for too long.
+  void close_connections();
+
+  std::size_t requests() const;
+  std::size_t connections_accepted() const;
+  std::size_t trace_chunks() const;
+  std::size_t body_bytes() const;
+};
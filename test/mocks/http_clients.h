@@ -10,6 +10,8 @@
 #include <sstream>
 #include <string>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "dict_readers.h"
 #include "dict_writers.h"
@@ -36,12 +38,14 @@ struct MockHTTPClient : public HTTPClient {
   std::unordered_map<std::string, std::string> response_headers;
   Optional<Error> response_error;
   MockDictWriter request_headers;
+  URL request_url;
+  std::string request_body;
   std::mutex mutex_;
   ResponseHandler on_response_;
   ErrorHandler on_error_;
 
   Expected<void> post(
-      const URL&, HeadersSetter set_headers, std::string /*body*/,
+      const URL& url, HeadersSetter set_headers, std::string body,
       ResponseHandler on_response, ErrorHandler on_error,
       std::chrono::steady_clock::time_point /*deadline*/) override {
     std::lock_guard<std::mutex> lock{mutex_};
@@ -49,6 +53,8 @@ struct MockHTTPClient : public HTTPClient {
       on_response_ = on_response;
       on_error_ = on_error;
       set_headers(request_headers);
+      request_url = url;
+      request_body = std::move(body);
     }
     return post_error;
   }
@@ -67,3 +73,60 @@ struct MockHTTPClient : public HTTPClient {
     return nlohmann::json::object({{"type", "MockHTTPClient"}});
   }
 };
+
+// `MockConcurrentHTTPClient` records every request made by `post`, and
+// responds to each request that hasn't yet been responded to in `drain`.  Each
+// response has the status `response_status` and the body `response_body`,
+// unless `response_error` is set, in which case the request fails with that
+// error instead.
+struct MockConcurrentHTTPClient : public HTTPClient {
+  struct Request {
+    URL url;
+    MockDictWriter headers;
+    std::string body;
+    ResponseHandler on_response;
+    ErrorHandler on_error;
+    bool responded = false;
+  };
+
+  int response_status = 200;
+  std::string response_body = "{}";
+  Optional<Error> response_error;
+  std::mutex mutex_;
+  std::vector<Request> requests;
+
+  Expected<void> post(
+      const URL& url, HeadersSetter set_headers, std::string body,
+      ResponseHandler on_response, ErrorHandler on_error,
+      std::chrono::steady_clock::time_point /*deadline*/) override {
+    std::lock_guard<std::mutex> lock{mutex_};
+    Request request;
+    request.url = url;
+    set_headers(request.headers);
+    request.body = std::move(body);
+    request.on_response = std::move(on_response);
+    request.on_error = std::move(on_error);
+    requests.push_back(std::move(request));
+    return {};
+  }
+
+  void drain(std::chrono::steady_clock::time_point /*deadline*/) override {
+    std::lock_guard<std::mutex> lock{mutex_};
+    const std::unordered_map<std::string, std::string> no_headers;
+    for (auto& request : requests) {
+      if (!request.responded) {
+        request.responded = true;
+        if (response_error) {
+          request.on_error(*response_error);
+          continue;
+        }
+        MockDictReader reader{no_headers};
+        request.on_response(response_status, reader, response_body);
+      }
+    }
+  }
+
+  nlohmann::json config_json() const override {
+    return nlohmann::json::object({{"type", "MockConcurrentHTTPClient"}});
+  }
+};
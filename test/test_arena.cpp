@@ -0,0 +1,141 @@
+#include <datadog/arena.h>
+#include <datadog/span_data.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test.h"
+
+using namespace datadog::tracing;
+
+TEST_CASE("arena") {
+  ArenaPtr arena{Arena::create()};
+
+  SECTION("allocations are aligned and do not overlap") {
+    std::set<std::uintptr_t> addresses;
+    for (std::size_t size = 1; size < 100; ++size) {
+      auto* pointer = static_cast<char*>(arena->allocate(size));
+      const auto address = reinterpret_cast<std::uintptr_t>(pointer);
+      REQUIRE(address % alignof(std::max_align_t) == 0);
+      // Writing to all of the memory would be reported by sanitizers if it
+      // overlapped with some other allocation.
+      std::fill(pointer, pointer + size, char(size));
+      REQUIRE(addresses.insert(address).second);
+    }
+  }
+
+  SECTION("grows when a block is full") {
+    const std::size_t before = arena->capacity();
+    (void)arena->allocate(before);
+    REQUIRE(arena->capacity() > before);
+  }
+
+  SECTION("allocations larger than a block are satisfied") {
+    const std::size_t size = 1024 * 1024;
+    auto* pointer = static_cast<char*>(arena->allocate(size));
+    std::fill(pointer, pointer + size, 'x');
+    REQUIRE(arena->capacity() >= size);
+  }
+
+  SECTION("concurrent allocation") {
+    const int num_threads = 4;
+    const int allocations_per_thread = 1000;
+    std::vector<std::vector<void*>> results(num_threads);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; ++i) {
+      threads.emplace_back([&, i]() {
+        for (int j = 0; j < allocations_per_thread; ++j) {
+          results[i].push_back(arena->allocate(24));
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+
+    std::set<void*> unique;
+    for (const auto& pointers : results) {
+      unique.insert(pointers.begin(), pointers.end());
+    }
+    REQUIRE(unique.size() == std::size_t(num_threads * allocations_per_thread));
+  }
+
+  SECTION("span data keeps its arena alive") {
+    auto span = make_span_data(*arena);
+    span->tags.emplace("long enough to avoid small string optimization",
+                       "also long enough to avoid small string optimization");
+    span->numeric_tags.emplace("metric", 42);
+    // Release the original reference. `span` still refers to the arena.
+    arena.reset();
+    REQUIRE(span->tags.size() == 1);
+    REQUIRE(span->numeric_tags.at("metric") == 42);
+    // Deleting `span` releases the last reference, freeing the arena.
+    span.reset();
+  }
+}
+
+TEST_CASE("arena blocks are recycled") {
+  SECTION("the first block is reused") {
+    Arena* const first = Arena::create();
+    const auto address = reinterpret_cast<std::uintptr_t>(first);
+    first->release();
+    Arena* const second = Arena::create();
+    REQUIRE(reinterpret_cast<std::uintptr_t>(second) == address);
+    second->release();
+  }
+
+  SECTION("the largest block is reused") {
+    ArenaPtr arena{Arena::create()};
+    // The arena has one block, which might itself have been recycled.  Fill
+    // it, so that the arena grows a larger block.
+    const std::size_t first_capacity = arena->capacity();
+    (void)arena->allocate(first_capacity);
+    const std::size_t total_capacity = arena->capacity();
+    REQUIRE(total_capacity > first_capacity);
+    const std::size_t largest =
+        std::max(first_capacity, total_capacity - first_capacity);
+
+    arena.reset();
+    arena.reset(Arena::create());
+    REQUIRE(arena->capacity() == largest);
+  }
+
+  SECTION("blocks released on another thread are reused") {
+    std::vector<Arena*> arenas;
+    for (int i = 0; i < 4; ++i) {
+      arenas.push_back(Arena::create());
+    }
+    std::thread releaser{[&]() {
+      for (Arena* arena : arenas) {
+        arena->release();
+      }
+    }};
+    releaser.join();
+    // The releasing thread has exited, so its cached blocks went to the
+    // process-wide depot, from which this thread takes them.
+    std::set<std::uintptr_t> addresses;
+    for (Arena* arena : arenas) {
+      addresses.insert(reinterpret_cast<std::uintptr_t>(arena));
+    }
+    std::vector<ArenaPtr> reused;
+    for (int i = 0; i < 4; ++i) {
+      reused.emplace_back(Arena::create());
+      REQUIRE(addresses.count(
+                  reinterpret_cast<std::uintptr_t>(reused.back().get())) == 1);
+    }
+  }
+}
+
+TEST_CASE("span data without an arena") {
+  auto span = std::make_unique<SpanData>();
+  span->service = Symbol("hello");
+  span->tags.emplace("foo", "bar");
+  REQUIRE(span->tags.get_allocator().arena() == nullptr);
+  REQUIRE(span->tags.at("foo") == "bar");
+}
@@ -0,0 +1,190 @@
+#include <datadog/buffer_chain.h>
+
+#include <cstddef>
+#include <string>
+#include <utility>
+
+#include "test.h"
+
+using namespace datadog::tracing;
+
+TEST_CASE("BufferChain") {
+  BufferChain chain{8};
+
+  SECTION("is initially empty") {
+    REQUIRE(chain.empty());
+    REQUIRE(chain.size() == 0);
+    REQUIRE(chain.segments().empty());
+    char buffer[4];
+    REQUIRE(chain.read(buffer, sizeof buffer) == 0);
+  }
+
+  SECTION("starts a new segment when the last one is full") {
+    chain.writable_segment() += "abc";
+    chain.writable_segment() += "defgh";
+    REQUIRE(chain.segments().size() == 1);
+    chain.writable_segment() += "ijk";
+    REQUIRE(chain.segments().size() == 2);
+    REQUIRE(chain.size() == 11);
+    REQUIRE(chain.flatten() == "abcdefghijk");
+  }
+
+  SECTION("existing segments are not moved") {
+    std::string& first = chain.writable_segment();
+    first += "abcdefgh";
+    const char* const data = first.data();
+    for (int i = 0; i < 100; ++i) {
+      chain.writable_segment() += "12345678";
+    }
+    REQUIRE(chain.segments().front().data() == data);
+  }
+
+  SECTION("a segment can exceed its capacity") {
+    chain.writable_segment() += "this is longer than eight bytes";
+    chain.writable_segment() += "!";
+    REQUIRE(chain.segments().size() == 2);
+    REQUIRE(chain.flatten() == "this is longer than eight bytes!");
+  }
+
+  SECTION("a segment can be requested with room for a given size") {
+    chain.writable_segment() += "abc";
+    // The last segment has room for at least five more bytes.
+    std::string& same = chain.writable_segment(3);
+    REQUIRE(chain.segments().size() == 1);
+    same += "def";
+
+    std::string& large = chain.writable_segment(100);
+    REQUIRE(chain.segments().size() == 2);
+    REQUIRE(large.capacity() >= 100);
+    const char* const data = large.data();
+    large.append(100, 'x');
+    REQUIRE(large.data() == data);
+  }
+
+  SECTION("append fills the last segment before adding segments") {
+    chain.writable_segment() += "abc";
+    chain.append("defghijklmnopqrstu");
+    REQUIRE(chain.segments().size() == 3);
+    for (const auto& segment : chain.segments()) {
+      REQUIRE(segment.size() <= chain.segment_capacity());
+    }
+    REQUIRE(chain.flatten() == "abcdefghijklmnopqrstu");
+  }
+
+  SECTION("another chain's segments can be moved to the end") {
+    chain.append("abc");
+    // `other`'s segment is large enough to be allocated on the heap, and so
+    // moving it does not move its bytes.
+    BufferChain other{64};
+    other.append("defghijklm");
+    const char* const data = other.segments().front().data();
+    chain.append(std::move(other));
+    REQUIRE(other.empty());
+    REQUIRE(chain.segments().size() == 2);
+    REQUIRE(chain.segments()[1].data() == data);
+    REQUIRE(chain.flatten() == "abcdefghijklm");
+  }
+
+  SECTION("a segment can be moved to the end") {
+    chain.append("abc");
+    std::string segment = "defghijklmnopqrstuvwxyz";
+    const char* const data = segment.data();
+    chain.append_segment(std::move(segment));
+    REQUIRE(chain.segments().size() == 2);
+    REQUIRE(chain.segments()[1].data() == data);
+    REQUIRE(chain.flatten() == "abcdefghijklmnopqrstuvwxyz");
+  }
+
+  SECTION("the front of the chain can be taken") {
+    chain.append("abcdefghijklmnopqrst");
+    REQUIRE(chain.segments().size() == 3);
+
+    // "abcdefgh" is moved, and "ij" is copied from the middle segment.
+    BufferChain front = chain.take_front(10);
+    REQUIRE(front.segment_capacity() == chain.segment_capacity());
+    REQUIRE(front.segments().size() == 2);
+    REQUIRE(front.flatten() == "abcdefghij");
+    REQUIRE(chain.size() == 10);
+    REQUIRE(chain.flatten() == "klmnopqrst");
+
+    char buffer[16];
+    REQUIRE(chain.read(buffer, sizeof buffer) == 10);
+    REQUIRE(std::string(buffer, 10) == "klmnopqrst");
+
+    // Taking whole segments doesn't split any.
+    BufferChain rest = chain.take_front(chain.size());
+    REQUIRE(rest.flatten() == "klmnopqrst");
+    REQUIRE(chain.empty());
+    REQUIRE(chain.segments().empty());
+  }
+
+  SECTION("prepend inserts a segment at the beginning") {
+    chain.append("world");
+    chain.prepend("hello, ");
+    REQUIRE(chain.segments().size() == 2);
+    REQUIRE(chain.flatten() == "hello, world");
+    char buffer[16];
+    REQUIRE(chain.read(buffer, sizeof buffer) == 12);
+    REQUIRE(std::string(buffer, 12) == "hello, world");
+  }
+
+  SECTION("reads across segments") {
+    const std::string expected = "The quick brown fox jumps over the lazy dog";
+    for (const char ch : expected) {
+      chain.writable_segment() += ch;
+    }
+
+    const std::size_t piece_size = GENERATE(1, 3, 8, 100);
+    CAPTURE(piece_size);
+    std::string actual;
+    char buffer[100];
+    std::size_t count;
+    while ((count = chain.read(buffer, piece_size)) != 0) {
+      REQUIRE(count <= piece_size);
+      actual.append(buffer, count);
+    }
+    REQUIRE(actual == expected);
+  }
+
+  SECTION("seek moves the read position") {
+    chain.writable_segment() += "01234567";
+    chain.writable_segment() += "89";
+    char buffer[16];
+    REQUIRE(chain.read(buffer, sizeof buffer) == 10);
+
+    REQUIRE(chain.seek(0));
+    REQUIRE(chain.read(buffer, sizeof buffer) == 10);
+    REQUIRE(std::string(buffer, 10) == "0123456789");
+
+    REQUIRE(chain.seek(7));
+    REQUIRE(chain.read(buffer, sizeof buffer) == 3);
+    REQUIRE(std::string(buffer, 3) == "789");
+
+    REQUIRE(chain.seek(10));
+    REQUIRE(chain.read(buffer, sizeof buffer) == 0);
+
+    REQUIRE_FALSE(chain.seek(11));
+  }
+
+  SECTION("readers of a shared chain have their own read positions") {
+    chain.writable_segment() += "01234567";
+    chain.writable_segment() += "89";
+    const BufferChain& shared = chain;
+    BufferChain::ReadPosition first;
+    BufferChain::ReadPosition second;
+    char buffer[16];
+
+    REQUIRE(shared.read(first, buffer, 4) == 4);
+    REQUIRE(std::string(buffer, 4) == "0123");
+    REQUIRE(shared.read(second, buffer, sizeof buffer) == 10);
+    REQUIRE(std::string(buffer, 10) == "0123456789");
+    REQUIRE(shared.read(first, buffer, sizeof buffer) == 6);
+    REQUIRE(std::string(buffer, 6) == "456789");
+
+    REQUIRE(shared.seek(second, 8));
+    REQUIRE(shared.read(second, buffer, sizeof buffer) == 2);
+    REQUIRE_FALSE(shared.seek(second, 11));
+    // The chain's own read position is unaffected.
+    REQUIRE(chain.read(buffer, sizeof buffer) == 10);
+  }
+}
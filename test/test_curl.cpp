@@ -1,15 +1,19 @@
 #include <curl/curl.h>
 #include <datadog/curl.h>
 #include <datadog/dict_reader.h>
+#include <datadog/dict_writer.h>
 #include <datadog/error.h>
 #include <datadog/optional.h>
 #include <datadog/tracer.h>
 #include <datadog/tracer_config.h>
 
 #include <chrono>
+#include <cstdio>
 #include <exception>
+#include <string>
 #include <system_error>
 #include <unordered_set>
+#include <vector>
 
 #include "datadog/clock.h"
 #include "mocks/loggers.h"
@@ -202,6 +206,100 @@ TEST_CASE("parse response headers and body", "[curl]") {
   }
 }
 
+TEST_CASE("stream request body", "[curl]") {
+  // `Curl::post_stream` sends the request body from a read callback.  This
+  // mock reads the body, in small pieces, when the request is performed.  It
+  // reads the body twice, as libcurl would if it had to resend the request.
+  class StreamingMockCurlLibrary : public SingleRequestMockCurlLibrary {
+   public:
+    long body_size_ = -1;
+    ReadCallback on_read_ = nullptr;
+    void *user_data_on_read_ = nullptr;
+    SeekCallback on_seek_ = nullptr;
+    void *user_data_on_seek_ = nullptr;
+    const char *post_fields_ = nullptr;
+    std::vector<std::string> bodies_read_;
+
+    CURLcode easy_setopt_postfields(CURL *, const char *data) override {
+      post_fields_ = data;
+      return CURLE_OK;
+    }
+    CURLcode easy_setopt_postfieldsize(CURL *, long size) override {
+      body_size_ = size;
+      return CURLE_OK;
+    }
+    CURLcode easy_setopt_readdata(CURL *, void *data) override {
+      user_data_on_read_ = data;
+      return CURLE_OK;
+    }
+    CURLcode easy_setopt_readfunction(CURL *, ReadCallback on_read) override {
+      on_read_ = on_read;
+      return CURLE_OK;
+    }
+    CURLcode easy_setopt_seekdata(CURL *, void *data) override {
+      user_data_on_seek_ = data;
+      return CURLE_OK;
+    }
+    CURLcode easy_setopt_seekfunction(CURL *, SeekCallback on_seek) override {
+      on_seek_ = on_seek;
+      return CURLE_OK;
+    }
+
+    CURLMcode multi_perform(CURLM *multi, int *running_handles) override {
+      if (added_handle_) {
+        REQUIRE(on_read_);
+        REQUIRE(on_seek_);
+        for (int i = 0; i < 2; ++i) {
+          REQUIRE(on_seek_(user_data_on_seek_, 0, SEEK_SET) ==
+                  CURL_SEEKFUNC_OK);
+          std::string body;
+          char buffer[5];
+          std::size_t count;
+          while ((count = on_read_(buffer, 1, sizeof buffer,
+                                   user_data_on_read_)) != 0) {
+            body.append(buffer, count);
+          }
+          bodies_read_.push_back(std::move(body));
+        }
+        REQUIRE(on_seek_(user_data_on_seek_, 1000, SEEK_SET) ==
+                CURL_SEEKFUNC_CANTSEEK);
+      }
+      return SingleRequestMockCurlLibrary::multi_perform(multi,
+                                                         running_handles);
+    }
+  };
+
+  const auto clock = default_clock;
+  const auto logger = std::make_shared<MockLogger>();
+  StreamingMockCurlLibrary library;
+  const auto client = std::make_shared<Curl>(logger, clock, library);
+
+  const std::string expected = "The quick brown fox jumps over the lazy dog";
+  BufferChain body{4};
+  for (const char ch : expected) {
+    body.writable_segment() += ch;
+  }
+
+  Optional<Error> post_error;
+  bool responded = false;
+  const HTTPClient::URL url = {"http", "whatever", ""};
+  const auto result = client->post_stream(
+      url, [](const auto &) {},
+      std::make_shared<BufferChain>(std::move(body)),
+      [&](int, const DictReader &, std::string) { responded = true; },
+      [&](const Error &error) { post_error = error; },
+      clock().tick + std::chrono::seconds(10));
+
+  REQUIRE(result);
+  client->drain(clock().tick + std::chrono::seconds(1));
+  REQUIRE_FALSE(post_error);
+  REQUIRE(responded);
+  REQUIRE(library.post_fields_ == nullptr);
+  REQUIRE(library.body_size_ == long(expected.size()));
+  REQUIRE(library.bodies_read_ ==
+          std::vector<std::string>{expected, expected});
+}
+
 TEST_CASE("bad multi-handle means error mode", "[curl]") {
   // If libcurl fails to allocate a multi-handle, then the HTTP client enters a
   // mode where calls to `post` always return an error.
@@ -440,6 +538,23 @@ TEST_CASE("handles are always cleaned up", "[curl]") {
     REQUIRE(result);
     client->drain(clock().tick + std::chrono::seconds(1));
     REQUIRE(post_error);
+    REQUIRE(post_error->code == Error::CURL_REQUEST_FAILURE);
+  }
+
+  SECTION("when the request times out") {
+    Optional<Error> post_error;
+    const HTTPClient::URL url = {"http", "whatever", ""};
+    const auto ignore = [](auto &&...) {};
+    const auto dummy_deadline = clock().tick + std::chrono::seconds(10);
+    library.message_result_ = CURLE_OPERATION_TIMEDOUT;
+    const auto result = client->post(
+        url, ignore, "whatever", ignore,
+        [&](const Error &error) { post_error = error; }, dummy_deadline);
+
+    REQUIRE(result);
+    client->drain(clock().tick + std::chrono::seconds(1));
+    REQUIRE(post_error);
+    REQUIRE(post_error->code == Error::CURL_REQUEST_TIMEOUT);
   }
 
   SECTION("when we shut down while a request is in flight") {
@@ -451,15 +566,102 @@ TEST_CASE("handles are always cleaned up", "[curl]") {
         client->post(url, ignore, "whatever", ignore, ignore, dummy_deadline);
 
     REQUIRE(result);
-    // Destroy the `Curl` object.
-    client.reset();
   }
 
+  // Handles of finished requests are kept for reuse until the `Curl` object
+  // is destroyed.
+  client.reset();
+
   // Here are the checks relevant to this test.
   REQUIRE(library.created_handles_.size() == 1);
   REQUIRE(library.created_handles_ == library.destroyed_handles_);
 }
 
+TEST_CASE("handles and header lines are reused", "[curl]") {
+  // `SingleRequestMockCurlLibrary` records the header list of each request,
+  // and reports that every request after the first reused a connection.
+  class MockCurlLibrary : public SingleRequestMockCurlLibrary {
+   public:
+    // `header_lists_` are the addresses of each request's header lines, and
+    // `header_texts_` are copies of the lines, since a line that is not
+    // shared is freed with its request.
+    std::vector<std::vector<const char *>> header_lists_;
+    std::vector<std::vector<std::string>> header_texts_;
+    int num_requests_ = 0;
+
+    CURLcode easy_setopt_httpheader(CURL *, curl_slist *headers) override {
+      auto &lines = header_lists_.emplace_back();
+      auto &texts = header_texts_.emplace_back();
+      for (; headers; headers = headers->next) {
+        lines.push_back(headers->data);
+        texts.emplace_back(headers->data);
+      }
+      return CURLE_OK;
+    }
+    CURLcode easy_getinfo_num_connects(CURL *, long *count) override {
+      *count = num_requests_++ == 0;
+      return CURLE_OK;
+    }
+    // Wait briefly, so that the event loop notices each finished request
+    // soon, rather than when it is next woken.
+    CURLMcode multi_poll(CURLM *multi_handle, curl_waitfd extra_fds[],
+                         unsigned extra_nfds, int, int *numfds) override {
+      return CurlLibrary::multi_poll(multi_handle, extra_fds, extra_nfds, 1,
+                                     numfds);
+    }
+  };
+
+  const auto clock = default_clock;
+  const auto logger = std::make_shared<MockLogger>();
+  MockCurlLibrary library;
+  auto client = std::make_shared<Curl>(logger, clock, library);
+
+  const auto ignore = [](auto &&...) {};
+  const HTTPClient::URL url = {"http", "whatever", ""};
+  // There are more requests than there are shared header lines, and so the
+  // header that appears only in the last requests is shared only if the
+  // varying header lines were not.
+  const int num_requests = 300;
+  for (int i = 0; i < num_requests; ++i) {
+    const auto result = client->post(
+        url,
+        [i](DictWriter &headers) {
+          headers.set_constant("Content-Type", "application/msgpack");
+          headers.set("X-Datadog-Trace-Count", std::to_string(i));
+          if (i >= num_requests - 2) {
+            headers.set_constant("Datadog-Meta-Lang", "cpp");
+          }
+        },
+        "whatever", ignore, ignore, clock().tick + std::chrono::seconds(10));
+    REQUIRE(result);
+    client->drain(clock().tick + std::chrono::seconds(1));
+  }
+
+  const auto stats = client->connection_stats();
+  REQUIRE(stats.new_connections == 1);
+  REQUIRE(stats.reused_connections == std::uint64_t(num_requests - 1));
+
+  // Each request used the same easy handle.
+  REQUIRE(library.created_handles_.size() == 1);
+  REQUIRE(library.destroyed_handles_.empty());
+
+  // A constant header line is shared by the requests that send it.
+  const auto &lists = library.header_lists_;
+  REQUIRE(lists.size() == std::size_t(num_requests));
+  const auto &texts = library.header_texts_;
+  for (int i = 0; i < num_requests; ++i) {
+    REQUIRE(texts[i].size() == (i >= num_requests - 2 ? 3u : 2u));
+    REQUIRE(lists[i][0] == lists[0][0]);
+    REQUIRE(texts[i][0] == "Content-Type: application/msgpack");
+    REQUIRE(texts[i][1] == "X-Datadog-Trace-Count: " + std::to_string(i));
+  }
+  REQUIRE(texts[num_requests - 1][2] == "Datadog-Meta-Lang: cpp");
+  REQUIRE(lists[num_requests - 1][2] == lists[num_requests - 2][2]);
+
+  client.reset();
+  REQUIRE(library.created_handles_ == library.destroyed_handles_);
+}
+
 TEST_CASE("post() deadline exceeded before request start", "[curl]") {
   const auto clock = default_clock;
   Curl client{std::make_shared<NullLogger>(), clock};
@@ -1,20 +1,67 @@
 #include <datadog/collector_response.h>
 #include <datadog/datadog_agent.h>
 #include <datadog/datadog_agent_config.h>
+#include <datadog/span_data.h>
+#include <datadog/symbol.h>
 #include <datadog/tracer.h>
 #include <datadog/tracer_config.h>
 
+#include <atomic>
 #include <chrono>
+#include <cstddef>
+#include <datadog/json.hpp>
+#include <filesystem>
 #include <iostream>
+#include <random>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <variant>
 
 #include "mocks/event_schedulers.h"
 #include "mocks/http_clients.h"
 #include "mocks/loggers.h"
 #include "test.h"
+#include "traces_v05.h"
 
 using namespace datadog::tracing;
 using namespace std::chrono_literals;
 
+namespace {
+
+// `AdjustableEventSchedulerSpy` records the flush event scheduled by
+// `DatadogAgent` and how it's adjusted, so that a test can flush by invoking
+// `flush`.  Other events are never run.
+struct AdjustableEventSchedulerSpy : public EventScheduler {
+  std::function<void()> flush;
+  std::atomic<int> trigger_count{0};
+  std::vector<std::chrono::steady_clock::duration> intervals;
+
+  Cancel schedule_recurring_event(std::chrono::steady_clock::duration,
+                                  std::function<void()>) override {
+    return []() {};
+  }
+
+  RecurringEvent schedule_adjustable_event(
+      std::chrono::steady_clock::duration,
+      std::function<void()> callback) override {
+    flush = std::move(callback);
+    RecurringEvent event;
+    event.cancel = []() {};
+    event.trigger = [this]() { ++trigger_count; };
+    event.set_interval = [this](std::chrono::steady_clock::duration interval) {
+      intervals.push_back(interval);
+    };
+    return event;
+  }
+
+  nlohmann::json config_json() const override {
+    return nlohmann::json::object({{"type", "AdjustableEventSchedulerSpy"}});
+  }
+};
+
+}  // namespace
+
 TEST_CASE("CollectorResponse", "[datadog_agent]") {
   TracerConfig config;
   config.service = "testsvc";
@@ -170,6 +217,859 @@ TEST_CASE("CollectorResponse", "[datadog_agent]") {
   }
 }
 
+TEST_CASE("eager encoding", "[datadog_agent]") {
+  TracerConfig config;
+  config.service = "testsvc";
+  const auto logger =
+      std::make_shared<MockLogger>(std::cerr, MockLogger::ERRORS_ONLY);
+  const auto event_scheduler = std::make_shared<MockEventScheduler>();
+  const auto http_client = std::make_shared<MockHTTPClient>();
+  config.logger = logger;
+  config.agent.event_scheduler = event_scheduler;
+  config.agent.http_client = http_client;
+  config.report_telemetry = false;
+
+  const bool eager = GENERATE(true, false);
+  CAPTURE(eager);
+  config.agent.eager_encoding = eager;
+  auto finalized = finalize_config(config);
+  REQUIRE(finalized);
+  const auto* const agent_config =
+      std::get_if<FinalizedDatadogAgentConfig>(&finalized->collector);
+  REQUIRE(agent_config);
+  REQUIRE(agent_config->eager_encoding == eager);
+
+  {
+    http_client->response_status = 200;
+    http_client->response_body << "{}";
+    Tracer tracer{*finalized};
+    REQUIRE(tracer.config_json()["collector"]["config"]["eager_encoding"] ==
+            eager);
+    for (int i = 0; i < 3; ++i) {
+      auto root = tracer.create_span();
+      root.set_name("root" + std::to_string(i));
+      auto child = root.create_child();
+      child.set_name("child" + std::to_string(i));
+    }
+    // The trace chunks are sent when the tracer is destroyed.
+  }
+  REQUIRE(logger->error_count() == 0);
+  REQUIRE(http_client->request_headers.items.at("X-Datadog-Trace-Count") ==
+          "3");
+
+  // Either way, the request body is an array of trace chunks, each of which
+  // is an array of spans.
+  const auto body = nlohmann::json::from_msgpack(http_client->request_body);
+  REQUIRE(body.is_array());
+  REQUIRE(body.size() == 3);
+  for (std::size_t i = 0; i < body.size(); ++i) {
+    const auto& chunk = body[i];
+    REQUIRE(chunk.size() == 2);
+    REQUIRE(chunk[0]["name"] == "root" + std::to_string(i));
+    REQUIRE(chunk[1]["name"] == "child" + std::to_string(i));
+    REQUIRE(chunk[1]["parent_id"] == chunk[0]["span_id"]);
+  }
+}
+
+TEST_CASE("parallel encoding", "[datadog_agent]") {
+  TracerConfig config;
+  config.service = "testsvc";
+  const auto logger =
+      std::make_shared<MockLogger>(std::cerr, MockLogger::ERRORS_ONLY);
+  const auto event_scheduler = std::make_shared<MockEventScheduler>();
+  const auto http_client = std::make_shared<MockHTTPClient>();
+  config.logger = logger;
+  config.agent.event_scheduler = event_scheduler;
+  config.agent.http_client = http_client;
+  config.report_telemetry = false;
+
+  const int encoder_threads = GENERATE(1, 2, 4);
+  // With fewer trace chunks than threads, encoding is not parallel.
+  const int num_traces = GENERATE(3, 100);
+  CAPTURE(encoder_threads);
+  CAPTURE(num_traces);
+  config.agent.encoder_threads = encoder_threads;
+  auto finalized = finalize_config(config);
+  REQUIRE(finalized);
+
+  {
+    http_client->response_status = 200;
+    http_client->response_body << "{}";
+    Tracer tracer{*finalized};
+    REQUIRE(tracer.config_json()["collector"]["config"]["encoder_threads"] ==
+            encoder_threads);
+    for (int i = 0; i < num_traces; ++i) {
+      auto root = tracer.create_span();
+      root.set_name("root" + std::to_string(i));
+      auto child = root.create_child();
+      child.set_name("child" + std::to_string(i));
+    }
+    // The trace chunks are sent when the tracer is destroyed.
+  }
+  REQUIRE(logger->error_count() == 0);
+  REQUIRE(http_client->request_headers.items.at("X-Datadog-Trace-Count") ==
+          std::to_string(num_traces));
+
+  // The trace chunks are encoded in the order in which they were sent.
+  const auto body = nlohmann::json::from_msgpack(http_client->request_body);
+  REQUIRE(body.is_array());
+  REQUIRE(body.size() == std::size_t(num_traces));
+  for (std::size_t i = 0; i < body.size(); ++i) {
+    const auto& chunk = body[i];
+    REQUIRE(chunk.size() == 2);
+    REQUIRE(chunk[0]["name"] == "root" + std::to_string(i));
+    REQUIRE(chunk[1]["name"] == "child" + std::to_string(i));
+  }
+}
+
+TEST_CASE("size-capped requests", "[datadog_agent]") {
+  const auto logger =
+      std::make_shared<MockLogger>(std::cerr, MockLogger::ERRORS_ONLY);
+  const auto event_scheduler = std::make_shared<MockEventScheduler>();
+  const auto http_client = std::make_shared<MockConcurrentHTTPClient>();
+  TracerConfig config;
+  config.service = "testsvc";
+  config.logger = logger;
+  config.agent.event_scheduler = event_scheduler;
+  config.agent.http_client = http_client;
+  config.report_telemetry = false;
+
+  const bool eager = GENERATE(true, false);
+  const auto version =
+      GENERATE(TracesAPIVersion::V0_4, TracesAPIVersion::V0_5);
+  CAPTURE(eager);
+  CAPTURE(int(version));
+  config.agent.eager_encoding = eager;
+  config.agent.traces_api_version = version;
+  const int max_payload_size = 2000;
+  config.agent.max_payload_size_bytes = max_payload_size;
+
+  auto finalized = finalize_config(config);
+  REQUIRE(finalized);
+  const TracerSignature signature(RuntimeID::generate(), "testsvc", "test");
+  auto config_manager = std::make_shared<ConfigManager>(*finalized);
+  auto telemetry = std::make_shared<TracerTelemetry>(
+      finalized->report_telemetry, finalized->clock, finalized->logger,
+      signature, "", "");
+  const auto& agent_config =
+      std::get<FinalizedDatadogAgentConfig>(finalized->collector);
+
+  // Each trace chunk has one span whose resource is `resource_size` bytes,
+  // so that a few of them exceed `max_payload_size`.  One trace chunk is
+  // larger than `max_payload_size` by itself.
+  const int num_chunks = 20;
+  const auto resource_size = [](int i) { return i == 7 ? 3000 : 300; };
+  {
+    DatadogAgent agent(agent_config, telemetry, config.logger, signature,
+                       config_manager);
+    REQUIRE(agent.config_json()["config"]["max_payload_size_bytes"] ==
+            max_payload_size);
+    for (int i = 0; i < num_chunks; ++i) {
+      std::vector<std::unique_ptr<SpanData>> spans;
+      auto span = std::make_unique<SpanData>();
+      span->service = Symbol("testsvc");
+      span->name = Symbol("chunk" + std::to_string(i));
+      span->resource = std::string(resource_size(i), 'x');
+      spans.push_back(std::move(span));
+      REQUIRE(agent.send(std::move(spans), nullptr));
+    }
+    // The trace chunks are sent, and the requests drained, when the agent is
+    // destroyed.
+  }
+  REQUIRE(logger->error_count() == 0);
+
+  const auto& requests = http_client->requests;
+  REQUIRE(requests.size() > 1);
+  std::vector<std::string> names;
+  for (const auto& request : requests) {
+    const auto chunks = version == TracesAPIVersion::V0_5
+                            ? decode_v05_traces(request.body)
+                            : nlohmann::json::from_msgpack(request.body);
+    REQUIRE(request.headers.items.at("X-Datadog-Trace-Count") ==
+            std::to_string(chunks.size()));
+    if (chunks.size() > 1) {
+      REQUIRE(request.body.size() <= std::size_t(max_payload_size));
+    }
+    for (const auto& chunk : chunks) {
+      names.push_back(chunk.at(0).at("name"));
+    }
+  }
+  // Every trace chunk is sent exactly once, in order.
+  REQUIRE(names.size() == std::size_t(num_chunks));
+  for (int i = 0; i < num_chunks; ++i) {
+    REQUIRE(names[i] == "chunk" + std::to_string(i));
+  }
+
+  // Each request is counted in telemetry.
+  auto& trace_api = telemetry->metrics().trace_api;
+  REQUIRE(trace_api.requests.value() == requests.size());
+  REQUIRE(trace_api.responses_2xx.value() == requests.size());
+}
+
+TEST_CASE("bounded buffer", "[datadog_agent]") {
+  const auto logger =
+      std::make_shared<MockLogger>(std::cerr, MockLogger::ERRORS_ONLY);
+  const auto event_scheduler = std::make_shared<MockEventScheduler>();
+  const auto http_client = std::make_shared<MockConcurrentHTTPClient>();
+  TracerConfig config;
+  config.service = "testsvc";
+  config.logger = logger;
+  config.agent.event_scheduler = event_scheduler;
+  config.agent.http_client = http_client;
+  config.report_telemetry = false;
+
+  const bool eager = GENERATE(true, false);
+  CAPTURE(eager);
+  config.agent.eager_encoding = eager;
+  config.agent.max_buffered_spans = 10;
+  config.agent.max_buffered_bytes = 100 * 1000;
+
+  auto finalized = finalize_config(config);
+  REQUIRE(finalized);
+  const TracerSignature signature(RuntimeID::generate(), "testsvc", "test");
+  auto config_manager = std::make_shared<ConfigManager>(*finalized);
+  auto telemetry = std::make_shared<TracerTelemetry>(
+      finalized->report_telemetry, finalized->clock, finalized->logger,
+      signature, "", "");
+  const auto& agent_config =
+      std::get<FinalizedDatadogAgentConfig>(finalized->collector);
+
+  // Return a trace chunk having the specified `num_spans` spans, each named
+  // `name`, whose first span has the specified sampling `priority`.
+  const auto make_chunk = [](const std::string& name, int num_spans,
+                             int priority, std::size_t resource_size = 0) {
+    std::vector<std::unique_ptr<SpanData>> spans;
+    for (int i = 0; i < num_spans; ++i) {
+      auto span = std::make_unique<SpanData>();
+      span->name = Symbol(name);
+      span->resource = std::string(resource_size, 'x');
+      spans.push_back(std::move(span));
+    }
+    spans.front()->numeric_tags.emplace("_sampling_priority_v1", priority);
+    return spans;
+  };
+
+  std::vector<std::string> expected_names;
+  {
+    DatadogAgent agent(agent_config, telemetry, config.logger, signature,
+                       config_manager);
+
+    SECTION("drops chunks that the agent would drop first") {
+      for (int i = 0; i < 5; ++i) {
+        REQUIRE(agent.send(make_chunk("drop" + std::to_string(i), 1, 0),
+                           nullptr));
+      }
+      for (int i = 0; i < 5; ++i) {
+        REQUIRE(agent.send(make_chunk("keep" + std::to_string(i), 1, 1),
+                           nullptr));
+      }
+      // The buffer is full.  A kept chunk evicts the three oldest chunks
+      // having priority zero.
+      REQUIRE(agent.send(make_chunk("big", 3, 2), nullptr));
+      // A chunk having priority zero doesn't evict anything.
+      REQUIRE(agent.send(make_chunk("drop5", 1, -1), nullptr));
+      // Evicting the remaining droppable chunks wouldn't make enough room
+      // for this kept chunk, so nothing is evicted, and it's dropped.
+      REQUIRE(agent.send(make_chunk("huge", 5, 1), nullptr));
+
+      expected_names = {"drop3", "drop4", "keep0", "keep1",
+                        "keep2", "keep3", "keep4", "big"};
+      // The evicted chunks "drop0", "drop1", and "drop2", and the dropped
+      // chunks "drop5" and "huge".
+      REQUIRE(telemetry->metrics().tracer.trace_chunks_dropped.value() == 5);
+      REQUIRE(telemetry->metrics().tracer.spans_dropped.value() == 9);
+    }
+
+    SECTION("limits the size of buffered spans") {
+      REQUIRE(agent.send(make_chunk("small", 1, 1, 1000), nullptr));
+      REQUIRE(agent.send(make_chunk("large", 1, 1, 200 * 1000), nullptr));
+      REQUIRE(agent.send(make_chunk("medium", 1, 1, 90 * 1000), nullptr));
+      expected_names = {"small", "medium"};
+      REQUIRE(telemetry->metrics().tracer.trace_chunks_dropped.value() == 1);
+      REQUIRE(telemetry->metrics().tracer.spans_dropped.value() == 1);
+    }
+    // The trace chunks are sent, and the requests drained, when the agent is
+    // destroyed.
+  }
+  REQUIRE(logger->error_count() == 0);
+
+  std::vector<std::string> names;
+  for (const auto& request : http_client->requests) {
+    const auto chunks = nlohmann::json::from_msgpack(request.body);
+    REQUIRE(request.headers.items.at("X-Datadog-Trace-Count") ==
+            std::to_string(chunks.size()));
+    for (const auto& chunk : chunks) {
+      names.push_back(chunk.at(0).at("name"));
+    }
+  }
+  REQUIRE(names == expected_names);
+}
+
+TEST_CASE("concurrent send and flush", "[datadog_agent]") {
+  const auto logger =
+      std::make_shared<MockLogger>(std::cerr, MockLogger::ERRORS_ONLY);
+  const auto event_scheduler = std::make_shared<AdjustableEventSchedulerSpy>();
+  const auto http_client = std::make_shared<MockConcurrentHTTPClient>();
+  TracerConfig config;
+  config.service = "testsvc";
+  config.logger = logger;
+  config.agent.event_scheduler = event_scheduler;
+  config.agent.http_client = http_client;
+  config.report_telemetry = false;
+
+  const bool eager = GENERATE(true, false);
+  CAPTURE(eager);
+  config.agent.eager_encoding = eager;
+  // With the smaller limit, the buffer is often full, and so `send` often
+  // locks the buffer to evict or drop chunks rather than queueing them.
+  const int max_buffered_spans = GENERATE(20, 1000 * 1000);
+  CAPTURE(max_buffered_spans);
+  config.agent.max_buffered_spans = max_buffered_spans;
+  // Early flushes are triggered concurrently with `send`.
+  config.agent.early_flush_spans = 10;
+
+  auto finalized = finalize_config(config);
+  REQUIRE(finalized);
+  const TracerSignature signature(RuntimeID::generate(), "testsvc", "test");
+  auto config_manager = std::make_shared<ConfigManager>(*finalized);
+  auto telemetry = std::make_shared<TracerTelemetry>(
+      finalized->report_telemetry, finalized->clock, finalized->logger,
+      signature, "", "");
+  const auto& agent_config =
+      std::get<FinalizedDatadogAgentConfig>(finalized->collector);
+
+  const int num_threads = 8;
+  const int chunks_per_thread = 500;
+  {
+    DatadogAgent agent(agent_config, telemetry, config.logger, signature,
+                       config_manager);
+    std::atomic<int> threads_done{0};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; ++i) {
+      threads.emplace_back([&]() {
+        for (int j = 0; j < chunks_per_thread; ++j) {
+          std::vector<std::unique_ptr<SpanData>> spans;
+          auto span = std::make_unique<SpanData>();
+          span->name = Symbol("concurrent");
+          span->numeric_tags.emplace("_sampling_priority_v1", j % 2);
+          spans.push_back(std::move(span));
+          // `send` can't fail here, and Catch2 assertions aren't thread-safe.
+          (void)agent.send(std::move(spans), nullptr);
+        }
+        ++threads_done;
+      });
+    }
+    while (threads_done != num_threads) {
+      event_scheduler->flush();
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    // The remaining trace chunks are sent when the agent is destroyed.
+  }
+  REQUIRE(logger->error_count() == 0);
+
+  // Every trace chunk is either sent or counted as dropped.
+  std::size_t num_sent = 0;
+  for (const auto& request : http_client->requests) {
+    const auto chunks = nlohmann::json::from_msgpack(request.body);
+    for (const auto& chunk : chunks) {
+      REQUIRE(chunk.size() == 1);
+      REQUIRE(chunk[0]["name"] == "concurrent");
+      ++num_sent;
+    }
+  }
+  const auto num_dropped =
+      telemetry->metrics().tracer.trace_chunks_dropped.value();
+  REQUIRE(num_sent + num_dropped == num_threads * chunks_per_thread);
+  if (max_buffered_spans != 20) {
+    REQUIRE(num_dropped == 0);
+  }
+}
+
+TEST_CASE("early flush", "[datadog_agent]") {
+  const auto logger =
+      std::make_shared<MockLogger>(std::cerr, MockLogger::ERRORS_ONLY);
+  const auto event_scheduler = std::make_shared<AdjustableEventSchedulerSpy>();
+  const auto http_client = std::make_shared<MockConcurrentHTTPClient>();
+  TracerConfig config;
+  config.service = "testsvc";
+  config.logger = logger;
+  config.agent.event_scheduler = event_scheduler;
+  config.agent.http_client = http_client;
+  config.agent.flush_interval_milliseconds = 2000;
+  config.agent.early_flush_spans = 4;
+  config.report_telemetry = false;
+
+  const bool eager = GENERATE(true, false);
+  CAPTURE(eager);
+  config.agent.eager_encoding = eager;
+
+  const auto make_chunk = [](int num_spans) {
+    std::vector<std::unique_ptr<SpanData>> spans;
+    for (int i = 0; i < num_spans; ++i) {
+      auto span = std::make_unique<SpanData>();
+      span->name = Symbol("chunk");
+      spans.push_back(std::move(span));
+    }
+    return spans;
+  };
+
+  const TracerSignature signature(RuntimeID::generate(), "testsvc", "test");
+
+  SECTION("is triggered once when the buffer reaches the threshold") {
+    auto finalized = finalize_config(config);
+    REQUIRE(finalized);
+    auto config_manager = std::make_shared<ConfigManager>(*finalized);
+    auto telemetry = std::make_shared<TracerTelemetry>(
+        finalized->report_telemetry, finalized->clock, finalized->logger,
+        signature, "", "");
+    const auto& agent_config =
+        std::get<FinalizedDatadogAgentConfig>(finalized->collector);
+    DatadogAgent agent(agent_config, telemetry, config.logger, signature,
+                       config_manager);
+    REQUIRE(agent.config_json()["config"]["early_flush_spans"] == 4);
+
+    REQUIRE(agent.send(make_chunk(3), nullptr));
+    REQUIRE(event_scheduler->trigger_count == 0);
+    REQUIRE(agent.send(make_chunk(1), nullptr));
+    REQUIRE(event_scheduler->trigger_count == 1);
+    // Until the flush occurs, the flush isn't triggered again.
+    REQUIRE(agent.send(make_chunk(2), nullptr));
+    REQUIRE(event_scheduler->trigger_count == 1);
+
+    event_scheduler->flush();
+    http_client->drain(std::chrono::steady_clock::now());
+    REQUIRE(http_client->requests.size() == 1);
+    REQUIRE(http_client->requests[0].headers.items.at(
+                "X-Datadog-Trace-Count") == "3");
+
+    // After the flush, the threshold applies anew.
+    REQUIRE(agent.send(make_chunk(3), nullptr));
+    REQUIRE(event_scheduler->trigger_count == 1);
+    REQUIRE(agent.send(make_chunk(5), nullptr));
+    REQUIRE(event_scheduler->trigger_count == 2);
+
+    // The flush interval is not adjusted by default.
+    event_scheduler->flush();
+    event_scheduler->flush();
+    REQUIRE(event_scheduler->intervals.empty());
+  }
+
+  SECTION("the flush interval adapts to load") {
+    config.agent.adaptive_flush_interval = true;
+    auto finalized = finalize_config(config);
+    REQUIRE(finalized);
+    auto config_manager = std::make_shared<ConfigManager>(*finalized);
+    auto telemetry = std::make_shared<TracerTelemetry>(
+        finalized->report_telemetry, finalized->clock, finalized->logger,
+        signature, "", "");
+    const auto& agent_config =
+        std::get<FinalizedDatadogAgentConfig>(finalized->collector);
+    DatadogAgent agent(agent_config, telemetry, config.logger, signature,
+                       config_manager);
+
+    // Under load, the interval is halved, down to a quarter of the configured
+    // interval.
+    for (int i = 0; i < 3; ++i) {
+      REQUIRE(agent.send(make_chunk(4), nullptr));
+      event_scheduler->flush();
+    }
+    // Light load moves the interval back toward the configured interval.
+    REQUIRE(agent.send(make_chunk(1), nullptr));
+    event_scheduler->flush();
+    // When idle, the interval is doubled, up to four times the configured
+    // interval.
+    for (int i = 0; i < 4; ++i) {
+      event_scheduler->flush();
+    }
+    http_client->drain(std::chrono::steady_clock::now());
+
+    const std::vector<std::chrono::steady_clock::duration> expected = {
+        1000ms, 500ms, 1000ms, 2000ms, 4000ms, 8000ms};
+    REQUIRE(event_scheduler->intervals == expected);
+  }
+
+  REQUIRE(logger->error_count() == 0);
+}
+
+TEST_CASE("retries", "[datadog_agent]") {
+  const auto logger =
+      std::make_shared<MockLogger>(std::cerr, MockLogger::ERRORS_ONLY);
+  // Failed requests are logged as errors.
+  logger->echo = nullptr;
+  const auto event_scheduler = std::make_shared<AdjustableEventSchedulerSpy>();
+  const auto http_client = std::make_shared<MockConcurrentHTTPClient>();
+  TracerConfig config;
+  config.service = "testsvc";
+  config.logger = logger;
+  config.agent.event_scheduler = event_scheduler;
+  config.agent.http_client = http_client;
+  config.agent.max_retries = 2;
+  config.agent.retry_backoff_milliseconds = 100;
+  config.report_telemetry = false;
+
+  TimePoint now;
+  const Clock clock = [&now]() { return now; };
+  auto finalized = finalize_config(config, clock);
+  REQUIRE(finalized);
+  const TracerSignature signature(RuntimeID::generate(), "testsvc", "test");
+  auto config_manager = std::make_shared<ConfigManager>(*finalized);
+  auto telemetry = std::make_shared<TracerTelemetry>(
+      finalized->report_telemetry, finalized->clock, finalized->logger,
+      signature, "", "");
+  const auto& agent_config =
+      std::get<FinalizedDatadogAgentConfig>(finalized->collector);
+  DatadogAgent agent(agent_config, telemetry, config.logger, signature,
+                     config_manager);
+  REQUIRE(agent.config_json()["config"]["max_retries"] == 2);
+
+  std::vector<std::unique_ptr<SpanData>> spans;
+  auto span = std::make_unique<SpanData>();
+  span->name = Symbol("retried");
+  spans.push_back(std::move(span));
+  REQUIRE(agent.send(std::move(spans), nullptr));
+
+  // Flush, and respond to the resulting requests, after waiting longer than
+  // any backoff.
+  const auto wait_and_flush = [&]() {
+    now.tick += 10s;
+    event_scheduler->flush();
+    http_client->drain(now.tick);
+  };
+  const auto& requests = http_client->requests;
+  auto& metrics = telemetry->metrics().trace_api;
+
+  SECTION("a 5xx response is retried without re-encoding") {
+    http_client->response_status = 503;
+    event_scheduler->flush();
+    http_client->drain(now.tick);
+    REQUIRE(requests.size() == 1);
+    // The retry waits for its backoff.
+    event_scheduler->flush();
+    REQUIRE(requests.size() == 1);
+
+    http_client->response_status = 200;
+    wait_and_flush();
+    REQUIRE(requests.size() == 2);
+    REQUIRE(requests[1].body == requests[0].body);
+    REQUIRE(requests[1].headers.items.at("X-Datadog-Trace-Count") == "1");
+
+    wait_and_flush();
+    REQUIRE(requests.size() == 2);
+    REQUIRE(metrics.requests.value() == 2);
+    REQUIRE(metrics.responses_5xx.value() == 1);
+    REQUIRE(metrics.responses_2xx.value() == 1);
+    REQUIRE(metrics.errors_status_code.value() == 1);
+  }
+
+  SECTION("retries are limited") {
+    http_client->response_status = 500;
+    for (int i = 0; i < 5; ++i) {
+      wait_and_flush();
+    }
+    // The original request and two retries.
+    REQUIRE(requests.size() == 3);
+    REQUIRE(metrics.errors_status_code.value() == 3);
+  }
+
+  SECTION("network errors and timeouts are retried") {
+    http_client->response_error =
+        Error{Error::CURL_REQUEST_FAILURE, "connection refused"};
+    wait_and_flush();
+    REQUIRE(metrics.errors_network.value() == 1);
+    http_client->response_error =
+        Error{Error::CURL_REQUEST_TIMEOUT, "timed out"};
+    wait_and_flush();
+    REQUIRE(metrics.errors_timeout.value() == 1);
+    http_client->response_error = nullopt;
+    wait_and_flush();
+    REQUIRE(requests.size() == 3);
+    REQUIRE(requests[2].body == requests[0].body);
+    REQUIRE(metrics.responses_2xx.value() == 1);
+  }
+
+  SECTION("4xx responses are not retried") {
+    http_client->response_status = 400;
+    for (int i = 0; i < 3; ++i) {
+      wait_and_flush();
+    }
+    REQUIRE(requests.size() == 1);
+    REQUIRE(metrics.errors_status_code.value() == 1);
+  }
+}
+
+#ifndef _MSC_VER
+TEST_CASE("spool", "[datadog_agent]") {
+  const auto logger =
+      std::make_shared<MockLogger>(std::cerr, MockLogger::ERRORS_ONLY);
+  // Failed requests are logged as errors.
+  logger->echo = nullptr;
+  const auto event_scheduler = std::make_shared<AdjustableEventSchedulerSpy>();
+  const auto http_client = std::make_shared<MockConcurrentHTTPClient>();
+  std::random_device random;
+  const auto spool_path =
+      std::filesystem::temp_directory_path() /
+      ("dd-trace-cpp-agent-spool-" + std::to_string(random()));
+  TracerConfig config;
+  config.service = "testsvc";
+  config.logger = logger;
+  config.agent.event_scheduler = event_scheduler;
+  config.agent.http_client = http_client;
+  config.agent.max_retries = 0;
+  config.agent.spool_path = spool_path.string();
+  config.agent.max_spool_bytes = 4096;
+  config.report_telemetry = false;
+
+  TimePoint now;
+  const Clock clock = [&now]() { return now; };
+  auto finalized = finalize_config(config, clock);
+  REQUIRE(finalized);
+  const TracerSignature signature(RuntimeID::generate(), "testsvc", "test");
+  auto config_manager = std::make_shared<ConfigManager>(*finalized);
+  auto telemetry = std::make_shared<TracerTelemetry>(
+      finalized->report_telemetry, finalized->clock, finalized->logger,
+      signature, "", "");
+  const auto& agent_config =
+      std::get<FinalizedDatadogAgentConfig>(finalized->collector);
+  auto agent = std::make_unique<DatadogAgent>(
+      agent_config, telemetry, config.logger, signature, config_manager);
+  REQUIRE(agent->config_json()["config"]["spool_path"] == spool_path.string());
+  REQUIRE(agent->config_json()["config"]["max_spool_bytes"] == 4096);
+
+  const auto send_span = [&](const char* name) {
+    std::vector<std::unique_ptr<SpanData>> spans;
+    auto span = std::make_unique<SpanData>();
+    span->name = Symbol(name);
+    spans.push_back(std::move(span));
+    REQUIRE(agent->send(std::move(spans), nullptr));
+  };
+  const auto flush = [&]() {
+    event_scheduler->flush();
+    http_client->drain(now.tick);
+  };
+  const auto& requests = http_client->requests;
+
+  // The Datadog Agent is unavailable, so the request body is spooled.
+  send_span("spooled");
+  http_client->response_status = 503;
+  flush();
+  REQUIRE(requests.size() == 1);
+  // Nothing is replayed while the Datadog Agent is unavailable.
+  flush();
+  REQUIRE(requests.size() == 1);
+
+  SECTION("is replayed once the Datadog Agent responds") {
+    http_client->response_status = 200;
+    send_span("fresh");
+    flush();
+    REQUIRE(requests.size() == 2);
+    REQUIRE(requests[1].body != requests[0].body);
+
+    flush();
+    REQUIRE(requests.size() == 3);
+    REQUIRE(requests[2].body == requests[0].body);
+    REQUIRE(requests[2].headers.items.at("X-Datadog-Trace-Count") == "1");
+
+    // Each spooled request body is sent once.
+    flush();
+    REQUIRE(requests.size() == 3);
+  }
+
+  SECTION("is replayed by a later agent") {
+    agent.reset();
+    REQUIRE(requests.size() == 1);
+    // The response handlers share the earlier agent's spool, which keeps the
+    // file locked.  Release them as if the earlier process had exited.
+    for (auto& request : http_client->requests) {
+      request.on_response = nullptr;
+      request.on_error = nullptr;
+    }
+    http_client->response_status = 200;
+    agent = std::make_unique<DatadogAgent>(agent_config, telemetry,
+                                           config.logger, signature,
+                                           config_manager);
+    flush();
+    REQUIRE(requests.size() == 2);
+    REQUIRE(requests[1].body == requests[0].body);
+  }
+
+  agent.reset();
+  std::error_code ignored;
+  std::filesystem::remove(spool_path, ignored);
+}
+#endif
+
+TEST_CASE("client-side stats", "[datadog_agent]") {
+  const auto logger =
+      std::make_shared<MockLogger>(std::cerr, MockLogger::ERRORS_ONLY);
+  const auto event_scheduler = std::make_shared<AdjustableEventSchedulerSpy>();
+  const auto http_client = std::make_shared<MockConcurrentHTTPClient>();
+  TracerConfig config;
+  config.service = "testsvc";
+  config.logger = logger;
+  config.agent.event_scheduler = event_scheduler;
+  config.agent.http_client = http_client;
+  config.report_telemetry = false;
+
+  const bool enabled = GENERATE(true, false);
+  CAPTURE(enabled);
+  config.agent.stats_computation_enabled = enabled;
+
+  TimePoint now;
+  const Clock clock = [&now]() { return now; };
+  auto finalized = finalize_config(config, clock);
+  REQUIRE(finalized);
+  const TracerSignature signature(RuntimeID::generate(), "testsvc", "test");
+  auto config_manager = std::make_shared<ConfigManager>(*finalized);
+  auto telemetry = std::make_shared<TracerTelemetry>(
+      finalized->report_telemetry, finalized->clock, finalized->logger,
+      signature, "", "");
+  const auto& agent_config =
+      std::get<FinalizedDatadogAgentConfig>(finalized->collector);
+  auto agent = std::make_unique<DatadogAgent>(
+      agent_config, telemetry, config.logger, signature, config_manager);
+  REQUIRE(agent->config_json()["config"]["stats_computation_enabled"] ==
+          enabled);
+
+  std::vector<std::unique_ptr<SpanData>> spans;
+  auto span = std::make_unique<SpanData>();
+  span->service = Symbol("testsvc");
+  span->name = Symbol("computed");
+  span->span_id = 1;
+  spans.push_back(std::move(span));
+  REQUIRE(agent->send(std::move(spans), nullptr));
+  event_scheduler->flush();
+
+  const auto& requests = http_client->requests;
+  REQUIRE(requests.size() == 1);
+  REQUIRE(requests[0].url.path == "/v0.4/traces");
+  REQUIRE(requests[0].headers.items.count("Datadog-Client-Computed-Stats") ==
+          (enabled ? 1 : 0));
+
+  // The stats of the current bucket are sent when the agent is destroyed.
+  agent.reset();
+  if (!enabled) {
+    REQUIRE(requests.size() == 1);
+    return;
+  }
+  REQUIRE(requests.size() == 2);
+  const auto& request = requests[1];
+  REQUIRE(request.url.path == "/v0.6/stats");
+  REQUIRE(request.headers.items.at("Content-Type") == "application/msgpack");
+  REQUIRE(request.headers.items.at("Datadog-Client-Computed-Stats") == "yes");
+  const auto payload = nlohmann::json::from_msgpack(request.body);
+  REQUIRE(payload["Service"] == "testsvc");
+  const auto& group = payload["Stats"][0]["Stats"][0];
+  REQUIRE(group["Name"] == "computed");
+  REQUIRE(group["Hits"] == 1);
+  REQUIRE(group["TopLevelHits"] == 1);
+}
+
+TEST_CASE("traces API version 0.5", "[datadog_agent]") {
+  // `EventSchedulerSpy` keeps every scheduled event, so that the test can
+  // trigger a flush by invoking the first one.
+  struct EventSchedulerSpy : public EventScheduler {
+    std::vector<std::function<void()>> callbacks;
+
+    Cancel schedule_recurring_event(std::chrono::steady_clock::duration,
+                                    std::function<void()> callback) override {
+      callbacks.push_back(std::move(callback));
+      return []() {};
+    }
+
+    nlohmann::json config_json() const override {
+      return nlohmann::json::object({{"type", "EventSchedulerSpy"}});
+    }
+  };
+
+  const auto logger =
+      std::make_shared<MockLogger>(std::cerr, MockLogger::ERRORS_ONLY);
+  const auto event_scheduler = std::make_shared<EventSchedulerSpy>();
+  const auto http_client = std::make_shared<MockHTTPClient>();
+  TracerConfig config;
+  config.service = "testsvc";
+  config.logger = logger;
+  config.agent.event_scheduler = event_scheduler;
+  config.agent.http_client = http_client;
+  config.agent.traces_api_version = TracesAPIVersion::V0_5;
+  config.report_telemetry = false;
+
+  auto finalized = finalize_config(config);
+  REQUIRE(finalized);
+
+  const TracerSignature signature(RuntimeID::generate(), "testsvc", "test");
+  auto config_manager = std::make_shared<ConfigManager>(*finalized);
+  auto telemetry = std::make_shared<TracerTelemetry>(
+      finalized->report_telemetry, finalized->clock, finalized->logger,
+      signature, "", "");
+  const auto& agent_config =
+      std::get<FinalizedDatadogAgentConfig>(finalized->collector);
+  DatadogAgent agent(agent_config, telemetry, config.logger, signature,
+                     config_manager);
+  REQUIRE(agent.config_json()["config"]["traces_api_version"] == "v0.5");
+
+  // Send two trace chunks having the specified `names`, and flush them.
+  const auto send_and_flush = [&](const std::vector<std::string>& names) {
+    for (const auto& name : names) {
+      std::vector<std::unique_ptr<SpanData>> spans;
+      auto span = std::make_unique<SpanData>();
+      span->service = Symbol("testsvc");
+      span->name = Symbol(name);
+      span->resource = name;
+      span->tags.emplace("http.method", "GET");
+      span->numeric_tags.emplace("_sampling_priority_v1", 1);
+      spans.push_back(std::move(span));
+      REQUIRE(agent.send(std::move(spans), nullptr));
+    }
+    REQUIRE(!event_scheduler->callbacks.empty());
+    // The first scheduled event is the flush.
+    event_scheduler->callbacks.front()();
+  };
+
+  SECTION("payload") {
+    http_client->response_status = 200;
+    http_client->response_body << "{}";
+    send_and_flush({"first", "second"});
+    http_client->drain(std::chrono::steady_clock::now());
+    REQUIRE(logger->error_count() == 0);
+
+    REQUIRE(http_client->request_url.path == "/v0.5/traces");
+    REQUIRE(http_client->request_headers.items.at("X-Datadog-Trace-Count") ==
+            "2");
+    const auto chunks = decode_v05_traces(http_client->request_body);
+    REQUIRE(chunks.size() == 2);
+    REQUIRE(chunks[0].size() == 1);
+    REQUIRE(chunks[0][0]["name"] == "first");
+    REQUIRE(chunks[1][0]["name"] == "second");
+    for (const auto& chunk : chunks) {
+      REQUIRE(chunk[0]["service"] == "testsvc");
+      REQUIRE(chunk[0]["meta"] == nlohmann::json{{"http.method", "GET"}});
+      REQUIRE(chunk[0]["metrics"] ==
+              nlohmann::json{{"_sampling_priority_v1", 1.0}});
+    }
+  }
+
+  SECTION("falls back to version 0.4") {
+    logger->echo = nullptr;
+    http_client->response_status = 404;
+    send_and_flush({"first"});
+    REQUIRE(http_client->request_url.path == "/v0.5/traces");
+    http_client->drain(std::chrono::steady_clock::now());
+    REQUIRE(logger->error_count() >= 1);
+    REQUIRE(agent.config_json()["config"]["traces_api_version"] == "v0.4");
+
+    http_client->response_status = 200;
+    http_client->response_body << "{}";
+    send_and_flush({"second"});
+    REQUIRE(http_client->request_url.path == "/v0.4/traces");
+    const auto chunks =
+        nlohmann::json::from_msgpack(http_client->request_body);
+    REQUIRE(chunks.size() == 1);
+    REQUIRE(chunks[0][0]["name"] == "second");
+  }
+}
+
 // NOTE: `report_telemetry` is too vague for now.
 // Does it mean no telemetry at all or just metrics are not generated?
 //
@@ -0,0 +1,132 @@
+#include <datadog/ddsketch.h>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "test.h"
+
+using namespace datadog::tracing;
+
+namespace {
+
+// Return the `double` encoded in little endian order at the specified `data`.
+double read_double(const char* data) {
+  std::uint64_t bits = 0;
+  for (int i = 0; i < 8; ++i) {
+    bits |= std::uint64_t(static_cast<unsigned char>(data[i])) << (8 * i);
+  }
+  double value;
+  std::memcpy(&value, &bits, sizeof value);
+  return value;
+}
+
+}  // namespace
+
+TEST_CASE("DDSketch") {
+  DDSketch sketch;
+
+  SECTION("is empty at first") {
+    REQUIRE(sketch.empty());
+    REQUIRE(sketch.count() == 0);
+    REQUIRE(sketch.quantile(0.5) == 0);
+  }
+
+  SECTION("estimates quantiles within its relative accuracy") {
+    for (int i = 1; i <= 10000; ++i) {
+      sketch.add(i);
+    }
+    REQUIRE(sketch.count() == 10000);
+    for (const double quantile : {0.0, 0.25, 0.5, 0.75, 0.9, 0.99, 1.0}) {
+      CAPTURE(quantile);
+      const double expected = 1 + quantile * 9999;
+      REQUIRE(std::abs(sketch.quantile(quantile) - expected) <=
+              expected * DDSketch::default_relative_accuracy * 1.01);
+    }
+  }
+
+  SECTION("counts values that are not positive as zeros") {
+    sketch.add(0);
+    sketch.add(-5);
+    sketch.add(100);
+    REQUIRE(sketch.count() == 3);
+    REQUIRE(sketch.num_bins() == 1);
+    REQUIRE(sketch.quantile(0.5) == 0);
+    REQUIRE(sketch.quantile(1) == Approx(100).epsilon(0.01));
+  }
+
+  SECTION("ignores values that are not finite") {
+    sketch.add(std::nan(""));
+    sketch.add(INFINITY);
+    REQUIRE(sketch.empty());
+  }
+
+  SECTION("merges with another sketch") {
+    DDSketch other;
+    DDSketch combined;
+    for (int i = 1; i <= 1000; ++i) {
+      sketch.add(i);
+      combined.add(i);
+    }
+    for (int i = 0; i < 1000; ++i) {
+      other.add(1e6 + i);
+      combined.add(1e6 + i);
+    }
+    other.add(0);
+    combined.add(0);
+
+    sketch.merge(other);
+    REQUIRE(sketch.count() == combined.count());
+    for (const double quantile : {0.0, 0.1, 0.5, 0.51, 0.9, 1.0}) {
+      CAPTURE(quantile);
+      REQUIRE(sketch.quantile(quantile) == combined.quantile(quantile));
+    }
+  }
+
+  SECTION("collapses its lowest bins") {
+    DDSketch small{DDSketch::default_relative_accuracy, 10};
+    small.add(1e9);
+    small.add(1);
+    small.add(1e-9);
+    REQUIRE(small.num_bins() <= 10);
+    REQUIRE(small.count() == 3);
+    // The lowest values are counted in the lowest remaining bin.
+    REQUIRE(small.quantile(0) == small.quantile(0.5));
+    REQUIRE(small.quantile(0) < 1e9);
+    REQUIRE(small.quantile(1) == Approx(1e9).epsilon(0.01));
+
+    for (int i = 0; i < 100; ++i) {
+      small.add(std::pow(10, i % 20));
+    }
+    REQUIRE(small.num_bins() <= 10);
+    REQUIRE(small.count() == 103);
+  }
+
+  SECTION("Protocol Buffers encoding") {
+    sketch.add(0);
+    sketch.add(1);
+    sketch.add(1);
+    std::string encoded;
+    sketch.encode_protobuf(encoded);
+
+    // mapping: field 1, length 9, containing gamma as field 1, fixed64
+    REQUIRE(encoded.size() >= 11);
+    REQUIRE(encoded[0] == 0x0A);
+    REQUIRE(encoded[1] == 9);
+    REQUIRE(encoded[2] == 0x09);
+    REQUIRE(read_double(&encoded[3]) == Approx(1.01 / 0.99));
+    // positiveValues: field 2, containing one packed bin count as field 2, and
+    // no index offset, since 1 is in the bin whose index is zero.
+    const std::string store = encoded.substr(11, 12);
+    REQUIRE(store[0] == 0x12);
+    REQUIRE(store[1] == 10);
+    REQUIRE(store[2] == 0x12);
+    REQUIRE(store[3] == 8);
+    REQUIRE(read_double(&store[4]) == 2);
+    // zeroCount: field 4, fixed64
+    REQUIRE(encoded.size() == 11 + 12 + 9);
+    REQUIRE(encoded[23] == 0x21);
+    REQUIRE(read_double(&encoded[24]) == 1);
+  }
+}
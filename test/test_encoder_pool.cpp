@@ -0,0 +1,60 @@
+#include <datadog/encoder_pool.h>
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "test.h"
+
+using namespace datadog::tracing;
+
+TEST_CASE("EncoderPool") {
+  const std::size_t num_workers = GENERATE(0, 1, 3);
+  CAPTURE(num_workers);
+  EncoderPool pool{num_workers};
+  REQUIRE(pool.num_workers() == num_workers);
+
+  SECTION("runs each task exactly once") {
+    const std::size_t num_tasks = GENERATE(0, 1, 2, 100);
+    CAPTURE(num_tasks);
+    std::vector<std::atomic<int>> counts(num_tasks);
+    pool.run(num_tasks, [&](std::size_t i) { ++counts[i]; });
+    for (const auto& count : counts) {
+      REQUIRE(count == 1);
+    }
+  }
+
+  SECTION("can be run repeatedly") {
+    std::atomic<std::size_t> total{0};
+    for (int batch = 0; batch < 50; ++batch) {
+      pool.run(10, [&](std::size_t i) { total += i; });
+    }
+    REQUIRE(total == 50 * 45);
+  }
+
+  SECTION("runs tasks on at most one more thread than it has workers") {
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+    pool.run(1000, [&](std::size_t) {
+      std::lock_guard<std::mutex> lock(mutex);
+      threads.insert(std::this_thread::get_id());
+    });
+    REQUIRE(threads.size() <= num_workers + 1);
+  }
+
+  SECTION("concurrent batches are serialized") {
+    std::atomic<int> total{0};
+    std::vector<std::thread> callers;
+    for (int i = 0; i < 4; ++i) {
+      callers.emplace_back(
+          [&]() { pool.run(25, [&](std::size_t) { ++total; }); });
+    }
+    for (auto& caller : callers) {
+      caller.join();
+    }
+    REQUIRE(total == 100);
+  }
+}
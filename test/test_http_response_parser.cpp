@@ -0,0 +1,183 @@
+#include <datadog/http_response_parser.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+
+#include "test.h"
+
+using namespace datadog::tracing;
+
+namespace {
+
+// Parse the specified `response` in pieces of at most the specified
+// `piece_size` bytes, and return the number of bytes consumed.
+std::size_t parse_in_pieces(HTTPResponseParser& parser,
+                            const std::string& response,
+                            std::size_t piece_size) {
+  std::size_t consumed = 0;
+  while (consumed < response.size() && !parser.done() && !parser.failed()) {
+    const std::size_t size = std::min(piece_size, response.size() - consumed);
+    const std::size_t count =
+        parser.parse(StringView(response).substr(consumed, size));
+    consumed += count;
+    if (count < size) {
+      break;
+    }
+  }
+  return consumed;
+}
+
+}  // namespace
+
+TEST_CASE("HTTPResponseParser") {
+  HTTPResponseParser parser;
+  const std::size_t piece_size = GENERATE(1, 2, 7, 1000);
+  CAPTURE(piece_size);
+
+  SECTION("body delimited by Content-Length") {
+    const std::string response =
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: application/json\r\n"
+        "Content-Length: 24\r\n"
+        "\r\n"
+        "{\"rate_by_service\": {}}\n";
+    REQUIRE(parse_in_pieces(parser, response, piece_size) == response.size());
+    REQUIRE(parser.done());
+    REQUIRE(parser.status() == 200);
+    REQUIRE(parser.headers().at("content-type") == "application/json");
+    REQUIRE(parser.body() == "{\"rate_by_service\": {}}\n");
+    REQUIRE(parser.keep_alive());
+  }
+
+  SECTION("bytes after the end of the response are not consumed") {
+    const std::string first =
+        "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\n{}";
+    const std::string response = first + "HTTP/1.1 500";
+    REQUIRE(parse_in_pieces(parser, response, piece_size) == first.size());
+    REQUIRE(parser.done());
+    REQUIRE(parser.body() == "{}");
+  }
+
+  SECTION("chunked body") {
+    const std::string response =
+        "HTTP/1.1 200 OK\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "\r\n"
+        "5\r\nhello\r\n"
+        "7;extension=ignored\r\n, world\r\n"
+        "0\r\n"
+        "Trailer: ignored\r\n"
+        "\r\n";
+    REQUIRE(parse_in_pieces(parser, response, piece_size) == response.size());
+    REQUIRE(parser.done());
+    REQUIRE(parser.body() == "hello, world");
+    REQUIRE(parser.keep_alive());
+  }
+
+  SECTION("body delimited by the end of the connection") {
+    const std::string response = "HTTP/1.1 200 OK\r\n\r\nall of it";
+    REQUIRE(parse_in_pieces(parser, response, piece_size) == response.size());
+    REQUIRE_FALSE(parser.done());
+    parser.finish();
+    REQUIRE(parser.done());
+    REQUIRE(parser.body() == "all of it");
+    REQUIRE_FALSE(parser.keep_alive());
+  }
+
+  SECTION("interim responses are skipped") {
+    const std::string response =
+        "HTTP/1.1 100 Continue\r\n"
+        "\r\n"
+        "HTTP/1.1 202 Accepted\r\n"
+        "Content-Length: 0\r\n"
+        "\r\n";
+    REQUIRE(parse_in_pieces(parser, response, piece_size) == response.size());
+    REQUIRE(parser.done());
+    REQUIRE(parser.status() == 202);
+    REQUIRE(parser.body().empty());
+  }
+
+  SECTION("no body") {
+    const std::string response = "HTTP/1.1 204 No Content\r\n\r\n";
+    REQUIRE(parse_in_pieces(parser, response, piece_size) == response.size());
+    REQUIRE(parser.done());
+    REQUIRE(parser.status() == 204);
+  }
+
+  SECTION("repeated headers are joined") {
+    const std::string response =
+        "HTTP/1.1 200 OK\r\n"
+        "Vary: Accept\r\n"
+        "VARY:  Accept-Encoding \r\n"
+        "Content-Length: 0\r\n"
+        "\r\n";
+    REQUIRE(parse_in_pieces(parser, response, piece_size) == response.size());
+    REQUIRE(parser.headers().at("vary") == "Accept, Accept-Encoding");
+  }
+
+  SECTION("whether the connection can be reused") {
+    struct TestCase {
+      std::string name;
+      std::string response;
+      bool expected;
+    };
+    const auto test_case = GENERATE(values<TestCase>({
+        {"HTTP/1.1 defaults to keep-alive",
+         "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n", true},
+        {"HTTP/1.1 with Connection: close",
+         "HTTP/1.1 200 OK\r\nConnection: Close\r\nContent-Length: 0\r\n\r\n",
+         false},
+        {"HTTP/1.0 defaults to close",
+         "HTTP/1.0 200 OK\r\nContent-Length: 0\r\n\r\n", false},
+        {"HTTP/1.0 with Connection: keep-alive",
+         "HTTP/1.0 200 OK\r\nConnection: keep-alive\r\n"
+         "Content-Length: 0\r\n\r\n",
+         true},
+    }));
+    CAPTURE(test_case.name);
+    parse_in_pieces(parser, test_case.response, piece_size);
+    REQUIRE(parser.done());
+    REQUIRE(parser.keep_alive() == test_case.expected);
+  }
+
+  SECTION("malformed responses fail") {
+    const auto response = GENERATE(
+        std::string("SMTP/1.1 200 OK\r\n\r\n"), std::string("HTTP/1.1 2x0\r\n"),
+        std::string("HTTP/1.1 200 OK\r\nno colon\r\n\r\n"),
+        std::string("HTTP/1.1 200 OK\r\nContent-Length: -1\r\n\r\n"),
+        std::string("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+                    "zz\r\n"),
+        std::string("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+                    "2\r\nabc\r\n"));
+    CAPTURE(response);
+    parse_in_pieces(parser, response, piece_size);
+    REQUIRE(parser.failed());
+    REQUIRE_FALSE(parser.error().empty());
+  }
+
+  SECTION("a response cut short fails") {
+    const std::string response =
+        "HTTP/1.1 200 OK\r\nContent-Length: 10\r\n\r\nshort";
+    parse_in_pieces(parser, response, piece_size);
+    REQUIRE_FALSE(parser.done());
+    parser.finish();
+    REQUIRE(parser.failed());
+  }
+
+  SECTION("reset prepares for another response") {
+    REQUIRE_FALSE(parser.started());
+    parse_in_pieces(parser, "HTTP/1.1 200 OK\r\nConnection: close\r\n",
+                    piece_size);
+    REQUIRE(parser.started());
+    parser.reset();
+    REQUIRE_FALSE(parser.started());
+    const std::string response =
+        "HTTP/1.1 404 Not Found\r\nContent-Length: 1\r\n\r\n?";
+    REQUIRE(parse_in_pieces(parser, response, piece_size) == response.size());
+    REQUIRE(parser.done());
+    REQUIRE(parser.status() == 404);
+    REQUIRE(parser.headers().count("connection") == 0);
+    REQUIRE(parser.keep_alive());
+  }
+}
@@ -0,0 +1,86 @@
+#include <datadog/mpsc_queue.h>
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "test.h"
+
+using namespace datadog::tracing;
+
+TEST_CASE("MPSCQueue") {
+  SECTION("is initially empty") {
+    MPSCQueue<int> queue;
+    REQUIRE(queue.empty());
+    REQUIRE(queue.pop_all([](int) { REQUIRE(false); }) == 0);
+  }
+
+  SECTION("visits values in the order in which they were pushed") {
+    MPSCQueue<std::unique_ptr<int>> queue;
+    for (int i = 0; i < 5; ++i) {
+      queue.push(std::make_unique<int>(i));
+    }
+    REQUIRE(!queue.empty());
+
+    std::vector<int> values;
+    REQUIRE(queue.pop_all([&](std::unique_ptr<int>&& value) {
+      values.push_back(*value);
+    }) == 5);
+    REQUIRE(values == std::vector<int>{0, 1, 2, 3, 4});
+    REQUIRE(queue.empty());
+  }
+
+  SECTION("frees values that are never popped") {
+    // A leak would be reported by a sanitizer.
+    MPSCQueue<std::unique_ptr<int>> queue;
+    queue.push(std::make_unique<int>(1));
+    queue.push(std::make_unique<int>(2));
+  }
+
+  SECTION("concurrent producers") {
+    // Each value identifies its producer and its position in that producer's
+    // sequence.
+    struct Value {
+      int producer;
+      int sequence;
+    };
+    const int num_producers = 8;
+    const int values_per_producer = 10000;
+    MPSCQueue<Value> queue;
+    std::atomic<int> producers_done{0};
+    std::vector<int> next_sequence(num_producers, 0);
+    std::size_t total = 0;
+    const auto consume = [&](Value&& value) {
+      // Values from one producer are visited in the order pushed.
+      REQUIRE(value.sequence == next_sequence[value.producer]);
+      ++next_sequence[value.producer];
+      ++total;
+    };
+
+    std::vector<std::thread> producers;
+    for (int producer = 0; producer < num_producers; ++producer) {
+      producers.emplace_back([&, producer]() {
+        for (int i = 0; i < values_per_producer; ++i) {
+          queue.push(Value{producer, i});
+        }
+        ++producers_done;
+      });
+    }
+    // The consumer pops concurrently with the producers.
+    while (producers_done != num_producers) {
+      queue.pop_all(consume);
+    }
+    for (auto& producer : producers) {
+      producer.join();
+    }
+    queue.pop_all(consume);
+
+    REQUIRE(total == std::size_t(num_producers) * values_per_producer);
+    for (const int sequence : next_sequence) {
+      REQUIRE(sequence == values_per_producer);
+    }
+  }
+}
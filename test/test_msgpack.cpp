@@ -1,9 +1,12 @@
 #include <datadog/error.h>
 #include <datadog/msgpack.h>
 
+#include <cstddef>
 #include <cstdint>
+#include <datadog/json.hpp>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "test.h"
 
@@ -55,6 +58,89 @@ TEST_CASE("map element fails to encode") {
   }
 }
 
+TEST_CASE("compact integers use the shortest encoding") {
+  struct TestCase {
+    std::uint32_t value;
+    std::size_t expected_size;
+  };
+
+  const auto test_case = GENERATE(values<TestCase>({{0, 1},
+                                                    {127, 1},
+                                                    {128, 2},
+                                                    {255, 2},
+                                                    {256, 3},
+                                                    {65535, 3},
+                                                    {65536, 5},
+                                                    {4294967295, 5}}));
+  CAPTURE(test_case.value);
+
+  std::string destination;
+  msgpack::pack_compact_integer(destination, test_case.value);
+  REQUIRE(destination.size() == test_case.expected_size);
+  REQUIRE(nlohmann::json::from_msgpack(destination) == test_case.value);
+}
+
+TEST_CASE("booleans and byte arrays") {
+  std::string destination;
+  REQUIRE(msgpack::pack_array(destination, 3));
+  msgpack::pack_bool(destination, true);
+  msgpack::pack_bool(destination, false);
+  REQUIRE(msgpack::pack_binary(destination, std::string("\x00\xFF", 2)));
+
+  const auto decoded = nlohmann::json::from_msgpack(destination);
+  REQUIRE(decoded[0] == true);
+  REQUIRE(decoded[1] == false);
+  REQUIRE(decoded[2].is_binary());
+  const std::vector<std::uint8_t>& bytes = decoded[2].get_binary();
+  REQUIRE(bytes == std::vector<std::uint8_t>{0x00, 0xFF});
+}
+
+TEST_CASE("compile-time encodings match runtime encodings") {
+  constexpr auto key = msgpack::encode_string("trace_id");
+  static_assert(key.size() == msgpack::string_size(8));
+  std::string expected;
+  REQUIRE(msgpack::pack_string(expected, "trace_id"));
+  std::string actual;
+  msgpack::pack_encoded(actual, key);
+  REQUIRE(actual == expected);
+
+  constexpr auto empty = msgpack::encode_string("");
+  expected.clear();
+  REQUIRE(msgpack::pack_string(expected, ""));
+  actual.clear();
+  msgpack::pack_encoded(actual, empty);
+  REQUIRE(actual == expected);
+
+  constexpr auto header = msgpack::encode_map_header(0x01020304);
+  expected.clear();
+  REQUIRE(msgpack::pack_map(expected, 0x01020304));
+  actual.clear();
+  msgpack::pack_encoded(actual, header);
+  REQUIRE(actual == expected);
+}
+
+TEST_CASE("encoding sizes") {
+  std::string destination;
+  msgpack::pack_integer(destination, std::uint64_t(1));
+  REQUIRE(destination.size() == msgpack::integer_size);
+
+  destination.clear();
+  msgpack::pack_double(destination, 1.5);
+  REQUIRE(destination.size() == msgpack::double_size);
+
+  destination.clear();
+  REQUIRE(msgpack::pack_array(destination, 3));
+  REQUIRE(destination.size() == msgpack::array_header_size);
+
+  destination.clear();
+  REQUIRE(msgpack::pack_map(destination, 3));
+  REQUIRE(destination.size() == msgpack::map_header_size);
+
+  destination.clear();
+  REQUIRE(msgpack::pack_string(destination, "hello"));
+  REQUIRE(destination.size() == msgpack::string_size(5));
+}
+
 // The following group of tests verify that encoding routines return an error
 // if the size of their input cannot fit in 32 bits.
 // This is impossible to do on a 32-bit system, so these tests are excluded by
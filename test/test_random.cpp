@@ -0,0 +1,93 @@
+// These are tests for the pseudo-random number generation in `random.h`.
+
+#include <datadog/random.h>
+
+#include <cstdint>
+#include <regex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#ifndef _MSC_VER
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "test.h"
+
+using namespace datadog::tracing;
+
+TEST_CASE("random_uint64") {
+  SECTION("values do not repeat") {
+    std::set<std::uint64_t> values;
+    for (int i = 0; i < 10000; ++i) {
+      REQUIRE(values.insert(random_uint64()).second);
+    }
+  }
+
+  SECTION("each thread has its own sequence") {
+    const int num_threads = 4;
+    const int values_per_thread = 100;
+    std::vector<std::vector<std::uint64_t>> results(num_threads);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; ++i) {
+      threads.emplace_back([&, i]() {
+        for (int j = 0; j < values_per_thread; ++j) {
+          results[i].push_back(random_uint64());
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+
+    std::set<std::uint64_t> values;
+    for (const auto& result : results) {
+      values.insert(result.begin(), result.end());
+    }
+    REQUIRE(values.size() == std::size_t(num_threads * values_per_thread));
+  }
+
+#ifndef _MSC_VER
+  SECTION("the child of a fork has a different sequence") {
+    // Consume part of a batch, so that the parent and child would otherwise
+    // produce the same remaining values.
+    (void)random_uint64();
+
+    int fds[2];
+    REQUIRE(pipe(fds) == 0);
+    const pid_t child = fork();
+    REQUIRE(child != -1);
+    if (child == 0) {
+      std::uint64_t values[4];
+      for (auto& value : values) {
+        value = random_uint64();
+      }
+      const auto written = write(fds[1], values, sizeof values);
+      _exit(written == sizeof values ? 0 : 1);
+    }
+
+    close(fds[1]);
+    std::uint64_t child_values[4];
+    REQUIRE(read(fds[0], child_values, sizeof child_values) ==
+            sizeof child_values);
+    close(fds[0]);
+    int status;
+    REQUIRE(waitpid(child, &status, 0) == child);
+    REQUIRE(WIFEXITED(status));
+    REQUIRE(WEXITSTATUS(status) == 0);
+
+    for (const std::uint64_t child_value : child_values) {
+      REQUIRE(child_value != random_uint64());
+    }
+  }
+#endif
+}
+
+TEST_CASE("uuid") {
+  const std::regex pattern{
+      "[0-9a-f]{8}-[0-9a-f]{4}-4[0-9a-f]{3}-[89ab][0-9a-f]{3}-[0-9a-f]{12}"};
+  for (int i = 0; i < 100; ++i) {
+    REQUIRE(std::regex_match(uuid(), pattern));
+  }
+}
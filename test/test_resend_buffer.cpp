@@ -0,0 +1,102 @@
+#include <datadog/datadog_agent_config.h>
+#include <datadog/resend_buffer.h>
+
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "test.h"
+
+using namespace datadog::tracing;
+using namespace std::chrono_literals;
+
+namespace {
+
+// Return a payload whose body is the specified `body`, containing the
+// specified `num_chunks` trace chunks, that is due at the specified
+// `not_before`.
+ResendBuffer::Payload make_payload(
+    const std::string& body, std::size_t num_chunks,
+    std::chrono::steady_clock::time_point not_before =
+        std::chrono::steady_clock::time_point()) {
+  auto chain = std::make_shared<BufferChain>();
+  chain->append(body);
+  return ResendBuffer::Payload{std::move(chain), num_chunks,
+                               TracesAPIVersion::V0_4, nullptr, 1,
+                               not_before};
+}
+
+std::vector<std::string> bodies(std::vector<ResendBuffer::Payload> payloads) {
+  std::vector<std::string> result;
+  for (const auto& payload : payloads) {
+    result.push_back(payload.body->flatten());
+  }
+  return result;
+}
+
+}  // namespace
+
+TEST_CASE("ResendBuffer") {
+  ResendBuffer buffer{10};
+  REQUIRE(buffer.size() == 0);
+  REQUIRE(buffer.max_size() == 10);
+
+  SECTION("returns payloads once they are due") {
+    const std::chrono::steady_clock::time_point start;
+    REQUIRE(buffer.push(make_payload("late", 1, start + 2s)).empty());
+    REQUIRE(buffer.push(make_payload("soon", 1, start + 1s)).empty());
+    REQUIRE(buffer.size() == 8);
+
+    REQUIRE(buffer.take_due(start).empty());
+    REQUIRE(bodies(buffer.take_due(start + 1s)) ==
+            std::vector<std::string>{"soon"});
+    REQUIRE(buffer.size() == 4);
+    REQUIRE(bodies(buffer.take_due(start + 5s)) ==
+            std::vector<std::string>{"late"});
+    REQUIRE(buffer.size() == 0);
+  }
+
+  SECTION("discards the oldest payloads to make room") {
+    REQUIRE(buffer.push(make_payload("aaaa", 1)).empty());
+    REQUIRE(buffer.push(make_payload("bbbb", 2)).empty());
+    // "aaaa" is discarded to make room for "cccccc", and then "bbbb" to make
+    // room for "dd".
+    REQUIRE(bodies(buffer.push(make_payload("cccccc", 3))) ==
+            std::vector<std::string>{"aaaa"});
+    REQUIRE(buffer.size() == 10);
+    REQUIRE(bodies(buffer.push(make_payload("dd", 4))) ==
+            std::vector<std::string>{"bbbb"});
+    REQUIRE(buffer.size() == 8);
+    REQUIRE(bodies(buffer.take_all()) ==
+            std::vector<std::string>{"cccccc", "dd"});
+    REQUIRE(buffer.size() == 0);
+  }
+
+  SECTION("discards a payload larger than the maximum size") {
+    REQUIRE(buffer.push(make_payload("aaaa", 1)).empty());
+    REQUIRE(bodies(buffer.push(make_payload("this is too large", 5))) ==
+            std::vector<std::string>{"this is too large"});
+    REQUIRE(bodies(buffer.take_all()) == std::vector<std::string>{"aaaa"});
+  }
+}
+
+TEST_CASE("retry_backoff") {
+  const auto initial = std::chrono::steady_clock::duration(1000ms);
+  for (int i = 0; i < 100; ++i) {
+    // The first retry waits between half of `initial` and all of it.
+    const auto first = retry_backoff(1, initial);
+    REQUIRE(first >= initial / 2);
+    REQUIRE(first <= initial);
+
+    // The delay doubles with each attempt.
+    const auto third = retry_backoff(3, initial);
+    REQUIRE(third >= initial * 2);
+    REQUIRE(third <= initial * 4);
+
+    // The delay stops growing at 32 times `initial`.
+    const auto many = retry_backoff(100, initial);
+    REQUIRE(many >= initial * 16);
+    REQUIRE(many <= initial * 32);
+  }
+}
@@ -0,0 +1,75 @@
+// These are tests for `SegmentClock`, which measures span times according to a
+// `ClockMode`.
+
+#include <datadog/segment_clock.h>
+
+#include <chrono>
+
+#include "test.h"
+
+using namespace datadog::tracing;
+using namespace std::chrono_literals;
+
+TEST_CASE("SegmentClock") {
+  SECTION("default mode uses the configured clock") {
+    TimePoint time;
+    time.wall += 1h;
+    time.tick += 2h;
+    const Clock clock = [&]() { return time; };
+    const SegmentClock segment_clock{clock, ClockMode::DEFAULT};
+    REQUIRE(segment_clock.mode() == ClockMode::DEFAULT);
+    REQUIRE(segment_clock.now().wall == time.wall);
+    REQUIRE(segment_clock.now().tick == time.tick);
+    time += 1s;
+    REQUIRE(segment_clock.tick() == time.tick);
+  }
+
+  SECTION("converts times read from the steady clock") {
+    const auto mode = GENERATE(ClockMode::DEFAULT, ClockMode::SEGMENT_ANCHORED,
+                               ClockMode::TSC);
+    const SegmentClock segment_clock{default_clock, mode};
+    const auto steady = std::chrono::steady_clock::now();
+    if (segment_clock.mode() != ClockMode::TSC) {
+      REQUIRE(segment_clock.convert(steady) == steady);
+      return;
+    }
+    // A time read from the steady clock converts to about the same time as
+    // this clock reads.
+    const auto converted = segment_clock.convert(steady);
+    const auto tick = segment_clock.tick();
+    REQUIRE(tick - converted < 1s);
+    REQUIRE(tick - converted > -1s);
+
+    TimePoint time;
+    time.tick = steady;
+    REQUIRE(segment_clock.convert(time).wall == time.wall);
+    REQUIRE(segment_clock.convert(time).tick - converted < 1s);
+    REQUIRE(segment_clock.convert(time).tick - converted > -1s);
+  }
+
+  SECTION("other modes derive wall time from the segment's anchor") {
+    const auto mode = GENERATE(ClockMode::SEGMENT_ANCHORED, ClockMode::TSC);
+    const auto wall_before = std::chrono::system_clock::now();
+    const auto tick_before = std::chrono::steady_clock::now();
+    const SegmentClock segment_clock{default_clock, mode};
+    if (mode == ClockMode::TSC && !SegmentClock::tsc_available()) {
+      REQUIRE(segment_clock.mode() == ClockMode::SEGMENT_ANCHORED);
+    } else {
+      REQUIRE(segment_clock.mode() == mode);
+    }
+
+    const TimePoint first = segment_clock.now();
+    const TimePoint second = segment_clock.now();
+    REQUIRE(second.tick >= first.tick);
+    // Wall time advances exactly as much as steady time.
+    REQUIRE(second.wall - first.wall ==
+            std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                second.tick - first.tick));
+    // The readings are close to those of the system's clocks.
+    REQUIRE(first.wall - wall_before < 1s);
+    REQUIRE(first.wall - wall_before > -1s);
+    REQUIRE(first.tick - tick_before < 1s);
+    REQUIRE(first.tick - tick_before > -1s);
+    REQUIRE(segment_clock.tick() - std::chrono::steady_clock::now() < 1s);
+  }
+}
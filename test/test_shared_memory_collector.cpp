@@ -0,0 +1,185 @@
+#include <datadog/datadog_agent_config.h>
+#include <datadog/json.hpp>
+#include <datadog/sampling_priority.h>
+#include <datadog/shared_memory_collector.h>
+#include <datadog/shared_memory_ring.h>
+#include <datadog/span_data.h>
+#include <datadog/tags.h>
+#include <datadog/tracer.h>
+#include <datadog/tracer_config.h>
+
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "local_agent.h"
+#include "mocks/http_clients.h"
+#include "mocks/loggers.h"
+#include "test.h"
+
+#ifndef _MSC_VER
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace datadog::tracing;
+using namespace std::chrono_literals;
+
+#ifndef _MSC_VER
+TEST_CASE("SharedMemoryCollector") {
+  auto ring = SharedMemoryRing::create(1024 * 1024);
+  REQUIRE(ring);
+  SharedMemoryCollector collector{*ring};
+  REQUIRE(collector.config_json()["type"] ==
+          "datadog::tracing::SharedMemoryCollector");
+
+  const auto make_chunk = [](const char* name, double priority) {
+    std::vector<std::unique_ptr<SpanData>> spans;
+    auto span = std::make_unique<SpanData>();
+    span->name = Symbol(name);
+    span->numeric_tags[tags::internal::sampling_priority] = priority;
+    spans.push_back(std::move(span));
+    spans.push_back(std::make_unique<SpanData>());
+    return spans;
+  };
+  REQUIRE(collector.send(make_chunk("kept", 1), nullptr));
+  REQUIRE(collector.send(make_chunk("dropped", -1), nullptr));
+
+  // The ring contains each trace chunk's version 0.4 encoding.
+  std::vector<nlohmann::json> chunks;
+  std::vector<bool> keeps;
+  (*ring)->pop_all([&](StringView encoded, std::size_t num_spans, bool keep) {
+    REQUIRE(num_spans == 2);
+    chunks.push_back(nlohmann::json::from_msgpack(std::string(encoded)));
+    keeps.push_back(keep);
+  });
+  REQUIRE(chunks.size() == 2);
+  REQUIRE(chunks[0].size() == 2);
+  REQUIRE(chunks[0][0]["name"] == "kept");
+  REQUIRE(keeps[0]);
+  REQUIRE(chunks[1][0]["name"] == "dropped");
+  REQUIRE_FALSE(keeps[1]);
+}
+
+TEST_CASE("shared memory ring requires traces API version 0.4") {
+  auto ring = SharedMemoryRing::create(1024 * 1024);
+  REQUIRE(ring);
+  TracerConfig config;
+  config.service = "designated";
+  config.agent.shared_memory_ring = *ring;
+  config.agent.traces_api_version = TracesAPIVersion::V0_5;
+  auto finalized = finalize_config(config);
+  REQUIRE(!finalized);
+  REQUIRE(finalized.error().code ==
+          Error::DATADOG_AGENT_INCOMPATIBLE_TRACES_API_VERSION);
+
+  config.agent.traces_api_version = TracesAPIVersion::V0_4;
+  REQUIRE(finalize_config(config));
+}
+
+TEST_CASE("trace chunks dropped by other processes are reported") {
+  auto ring = SharedMemoryRing::create(64 * 1024);
+  REQUIRE(ring);
+  // The chunk is larger than the ring, and so is dropped.
+  REQUIRE_FALSE((*ring)->push(std::string(128 * 1024, 'x'), 1, true));
+  REQUIRE((*ring)->dropped_chunks() == 1);
+
+  const auto logger =
+      std::make_shared<MockLogger>(std::cerr, MockLogger::ERRORS_ONLY);
+  TracerConfig config;
+  config.service = "designated";
+  config.logger = logger;
+  config.log_on_startup = false;
+  config.agent.http_client = std::make_shared<MockHTTPClient>();
+  config.agent.shared_memory_ring = *ring;
+  config.report_telemetry = false;
+  auto finalized = finalize_config(config);
+  REQUIRE(finalized);
+  {
+    // The tracer's `DatadogAgent` flushes when it's destroyed.
+    Tracer tracer{*finalized};
+  }
+  REQUIRE(logger->error_count() == 1);
+  REQUIRE(std::get<std::string>(logger->entries[0].payload).find(
+              "dropped 1 trace chunks") != std::string::npos);
+}
+
+TEST_CASE("SharedMemoryCollector multi-process throughput") {
+  // Like nginx, the parent creates the ring and then forks the workers.  The
+  // parent is the designated process that sends to the Datadog Agent, which
+  // is a local HTTP server.
+  auto ring = SharedMemoryRing::create(64 * 1024 * 1024);
+  REQUIRE(ring);
+
+  const int num_workers = 4;
+  const int traces_per_worker = 5000;
+  std::vector<pid_t> workers;
+  for (int i = 0; i < num_workers; ++i) {
+    const pid_t worker = ::fork();
+    REQUIRE(worker != -1);
+    if (worker == 0) {
+      TracerConfig config;
+      config.service = "worker";
+      config.log_on_startup = false;
+      config.collector = std::make_shared<SharedMemoryCollector>(*ring);
+      config.report_telemetry = false;
+      auto finalized = finalize_config(config);
+      if (!finalized) {
+        ::_exit(1);
+      }
+      {
+        Tracer tracer{*finalized};
+        for (int j = 0; j < traces_per_worker; ++j) {
+          auto root = tracer.create_span();
+          root.set_name("request");
+          auto child = root.create_child();
+          child.set_name("upstream");
+        }
+      }
+      ::_exit(0);
+    }
+    workers.push_back(worker);
+  }
+
+  LocalAgent local_agent;
+  const auto start = std::chrono::steady_clock::now();
+  {
+    TracerConfig config;
+    config.service = "designated";
+    config.log_on_startup = false;
+    config.agent.url = local_agent.url();
+    config.agent.flush_interval_milliseconds = 50;
+    config.agent.shared_memory_ring = *ring;
+    config.report_telemetry = false;
+    auto finalized = finalize_config(config);
+    REQUIRE(finalized);
+    Tracer tracer{*finalized};
+
+    for (const pid_t worker : workers) {
+      int status;
+      REQUIRE(::waitpid(worker, &status, 0) == worker);
+      REQUIRE(WIFEXITED(status));
+      REQUIRE(WEXITSTATUS(status) == 0);
+    }
+    const std::size_t expected = num_workers * traces_per_worker;
+    const auto deadline = start + 60s;
+    while (local_agent.trace_chunks() < expected &&
+           std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(10ms);
+    }
+  }
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  const double seconds = std::chrono::duration<double>(elapsed).count();
+  CAPTURE(local_agent.requests());
+  CAPTURE(local_agent.trace_chunks() / seconds);
+
+  // Every trace chunk arrived, batched into few requests.
+  REQUIRE((*ring)->dropped_chunks() == 0);
+  REQUIRE(local_agent.trace_chunks() == num_workers * traces_per_worker);
+  REQUIRE(local_agent.requests() * 100 <= local_agent.trace_chunks());
+}
+#endif
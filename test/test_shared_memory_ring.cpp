@@ -0,0 +1,191 @@
+#include <datadog/error.h>
+#include <datadog/shared_memory_ring.h>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "test.h"
+
+#ifndef _MSC_VER
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace datadog::tracing;
+
+namespace {
+
+struct Record {
+  std::string encoded;
+  std::size_t num_spans;
+  bool keep;
+};
+
+std::vector<Record> pop_all(SharedMemoryRing& ring) {
+  std::vector<Record> records;
+  ring.pop_all([&](StringView encoded, std::size_t num_spans, bool keep) {
+    records.push_back(Record{std::string(encoded), num_spans, keep});
+  });
+  return records;
+}
+
+}  // namespace
+
+#ifdef _MSC_VER
+TEST_CASE("SharedMemoryRing is not supported on Windows") {
+  auto ring = SharedMemoryRing::create(1024 * 1024);
+  REQUIRE(!ring);
+  REQUIRE(ring.error().code == Error::SHARED_MEMORY_RING_FAILURE);
+}
+#else
+TEST_CASE("SharedMemoryRing") {
+  SECTION("must not be too small") {
+    auto ring = SharedMemoryRing::create(100);
+    REQUIRE(!ring);
+    REQUIRE(ring.error().code == Error::SHARED_MEMORY_RING_FAILURE);
+  }
+
+  auto created = SharedMemoryRing::create(8192);
+  REQUIRE(created);
+  SharedMemoryRing& ring = **created;
+  REQUIRE(ring.capacity() <= 8192);
+  REQUIRE(ring.capacity() % 8 == 0);
+  REQUIRE(ring.claim_consumer());
+
+  SECTION("returns records in the order pushed") {
+    REQUIRE(ring.push("first", 1, true));
+    REQUIRE(ring.push("second", 2, false));
+    const auto records = pop_all(ring);
+    REQUIRE(records.size() == 2);
+    REQUIRE(records[0].encoded == "first");
+    REQUIRE(records[0].num_spans == 1);
+    REQUIRE(records[0].keep);
+    REQUIRE(records[1].encoded == "second");
+    REQUIRE(records[1].num_spans == 2);
+    REQUIRE_FALSE(records[1].keep);
+    REQUIRE(pop_all(ring).empty());
+  }
+
+  SECTION("drops records when full") {
+    const std::string chunk(1000, 'x');
+    std::size_t pushed = 0;
+    while (ring.push(chunk, 1, true)) {
+      ++pushed;
+    }
+    REQUIRE(pushed > 0);
+    REQUIRE(ring.dropped_chunks() == 1);
+    REQUIRE(pop_all(ring).size() == pushed);
+    // Popping makes room again.
+    REQUIRE(ring.push(chunk, 1, true));
+
+    // A record that could never fit is dropped too.
+    REQUIRE_FALSE(ring.push(std::string(ring.capacity(), 'y'), 1, true));
+    REQUIRE(ring.dropped_chunks() == 2);
+  }
+
+  SECTION("records wrap around the end of the ring") {
+    // Records of varying sizes land at every alignment relative to the end.
+    for (int i = 0; i < 1000; ++i) {
+      const std::string first(std::size_t(i % 97) * 13, char('a' + i % 26));
+      const std::string second = "#" + std::to_string(i);
+      REQUIRE(ring.push(first, std::size_t(i), i % 2 == 0));
+      REQUIRE(ring.push(second, 1, true));
+      const auto records = pop_all(ring);
+      REQUIRE(records.size() == 2);
+      REQUIRE(records[0].encoded == first);
+      REQUIRE(records[0].num_spans == std::size_t(i));
+      REQUIRE(records[0].keep == (i % 2 == 0));
+      REQUIRE(records[1].encoded == second);
+    }
+    REQUIRE(ring.dropped_chunks() == 0);
+  }
+
+  SECTION("only one running process can consume the ring") {
+    int ready[2];
+    int release[2];
+    REQUIRE(::pipe(ready) == 0);
+    REQUIRE(::pipe(release) == 0);
+    const pid_t child = ::fork();
+    REQUIRE(child != -1);
+    if (child == 0) {
+      // Become the consumer, and then wait until the parent says to exit.
+      const bool claimed = bool(ring.claim_consumer());
+      char byte = claimed;
+      (void)!::write(ready[1], &byte, 1);
+      (void)!::read(release[0], &byte, 1);
+      ::_exit(0);
+    }
+    char byte = 0;
+    REQUIRE(::read(ready[0], &byte, 1) == 1);
+    // The parent was the consumer, but the child claims the ring while the
+    // parent is running, so the claim fails.
+    REQUIRE(byte == 0);
+    REQUIRE(ring.claim_consumer());
+    REQUIRE(::write(release[1], &byte, 1) == 1);
+    int status;
+    REQUIRE(::waitpid(child, &status, 0) == child);
+    for (const int fd : {ready[0], ready[1], release[0], release[1]}) {
+      ::close(fd);
+    }
+  }
+}
+
+TEST_CASE("SharedMemoryRing with multiple processes") {
+  auto created = SharedMemoryRing::create(64 * 1024);
+  REQUIRE(created);
+  SharedMemoryRing& ring = **created;
+  REQUIRE(ring.claim_consumer());
+
+  const int num_processes = 4;
+  const int records_per_process = 5000;
+  std::vector<pid_t> children;
+  for (int i = 0; i < num_processes; ++i) {
+    const pid_t child = ::fork();
+    REQUIRE(child != -1);
+    if (child == 0) {
+      // Retry while the ring is full, so that no record is dropped.
+      for (int j = 0; j < records_per_process; ++j) {
+        const std::string encoded =
+            std::to_string(i) + ":" + std::to_string(j);
+        while (!ring.push(encoded, std::size_t(i), true)) {
+          ::usleep(100);
+        }
+      }
+      ::_exit(0);
+    }
+    children.push_back(child);
+  }
+
+  // Each process's records arrive in the order that it pushed them.  Pop
+  // until every child has exited, and then once more.
+  std::vector<int> next(num_processes, 0);
+  std::size_t received = 0;
+  bool in_order = true;
+  const auto visit = [&](StringView encoded, std::size_t process, bool) {
+    const std::string expected =
+        std::to_string(process) + ":" + std::to_string(next[process]++);
+    in_order = in_order && std::string(encoded) == expected;
+    ++received;
+  };
+  std::size_t running = children.size();
+  while (running != 0) {
+    if (ring.pop_all(visit) == 0) {
+      ::usleep(100);
+    }
+    for (pid_t& child : children) {
+      int status;
+      if (child != 0 && ::waitpid(child, &status, WNOHANG) == child) {
+        REQUIRE(WIFEXITED(status));
+        REQUIRE(WEXITSTATUS(status) == 0);
+        child = 0;
+        --running;
+      }
+    }
+  }
+  ring.pop_all(visit);
+  REQUIRE(in_order);
+  REQUIRE(received == std::size_t(num_processes * records_per_process));
+  REQUIRE(pop_all(ring).empty());
+}
+#endif
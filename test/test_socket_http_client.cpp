@@ -0,0 +1,280 @@
+#include <datadog/buffer_chain.h>
+#include <datadog/clock.h>
+#include <datadog/dict_reader.h>
+#include <datadog/dict_writer.h>
+#include <datadog/error.h>
+#include <datadog/json.hpp>
+#include <datadog/socket_http_client.h>
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "local_agent.h"
+#include "mocks/loggers.h"
+#include "test.h"
+
+#ifdef __linux__
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+using namespace datadog::tracing;
+using namespace std::chrono_literals;
+
+#ifdef __linux__
+namespace {
+
+// `Results` records the responses and errors delivered to the callbacks of
+// requests.
+struct Results {
+  std::mutex mutex;
+  std::vector<int> statuses;
+  std::vector<std::string> bodies;
+  std::vector<std::string> content_types;
+  std::vector<Error> errors;
+
+  HTTPClient::ResponseHandler on_response() {
+    return [this](int status, const DictReader& headers, std::string body) {
+      std::lock_guard<std::mutex> lock(mutex);
+      statuses.push_back(status);
+      bodies.push_back(std::move(body));
+      content_types.emplace_back(headers.lookup("Content-Type").value_or(""));
+    };
+  }
+
+  HTTPClient::ErrorHandler on_error() {
+    return [this](Error error) {
+      std::lock_guard<std::mutex> lock(mutex);
+      errors.push_back(std::move(error));
+    };
+  }
+};
+
+HTTPClient::URL parse_url(const std::string& url) {
+  auto result = HTTPClient::URL::parse(url);
+  REQUIRE(result);
+  return *result;
+}
+
+void set_trace_count(DictWriter& headers) {
+  headers.set("Content-Type", "application/msgpack");
+  headers.set("X-Datadog-Trace-Count", "1");
+}
+
+std::chrono::steady_clock::time_point in(std::chrono::milliseconds delay) {
+  return std::chrono::steady_clock::now() + delay;
+}
+
+}  // namespace
+
+TEST_CASE("SocketHTTPClient") {
+  const auto logger = std::make_shared<MockLogger>();
+  SocketHTTPClient client{logger, default_clock};
+  Results results;
+
+  SECTION("posts to an agent over TCP") {
+    LocalAgent agent;
+    auto url = parse_url(agent.url());
+    url.path = "/v0.4/traces";
+    REQUIRE(client.post(url, set_trace_count, "hello", results.on_response(),
+                        results.on_error(), in(5s)));
+    client.drain(in(5s));
+
+    REQUIRE(results.errors.empty());
+    REQUIRE(results.statuses == std::vector<int>{200});
+    REQUIRE(results.bodies == std::vector<std::string>{"{}"});
+    REQUIRE(results.content_types ==
+            std::vector<std::string>{"application/json"});
+    REQUIRE(agent.trace_chunks() == 1);
+    REQUIRE(agent.body_bytes() == 5);
+  }
+
+  SECTION("posts to an agent over a unix domain socket") {
+    const std::string path = "/tmp/dd-trace-cpp-test-socket-http-client-" +
+                             std::to_string(::getpid()) + ".sock";
+    LocalAgent agent{path};
+    const auto scheme = GENERATE(std::string("unix://"),
+                                 std::string("http+unix://"));
+    auto url = parse_url(scheme + path);
+    url.path = "/v0.4/traces";
+    REQUIRE(client.post(url, set_trace_count, "hello", results.on_response(),
+                        results.on_error(), in(5s)));
+    client.drain(in(5s));
+
+    REQUIRE(results.errors.empty());
+    REQUIRE(results.statuses == std::vector<int>{200});
+    REQUIRE(agent.requests() == 1);
+  }
+
+  SECTION("streams a chain of segments") {
+    LocalAgent agent;
+    BufferChain body{16};
+    std::string expected;
+    for (int i = 0; i < 1000; ++i) {
+      body.append("0123456789");
+      expected += "0123456789";
+    }
+    REQUIRE(body.segments().size() > 100);
+    REQUIRE(client.post_stream(
+        parse_url(agent.url()), set_trace_count,
+        std::make_shared<BufferChain>(std::move(body)), results.on_response(),
+        results.on_error(), in(5s)));
+    client.drain(in(5s));
+
+    REQUIRE(results.errors.empty());
+    REQUIRE(results.statuses == std::vector<int>{200});
+    REQUIRE(agent.body_bytes() == expected.size());
+  }
+
+  SECTION("reuses connections") {
+    LocalAgent agent;
+    const auto url = parse_url(agent.url());
+    for (int i = 0; i < 10; ++i) {
+      REQUIRE(client.post(url, set_trace_count, "hello",
+                          results.on_response(), results.on_error(), in(5s)));
+      client.drain(in(5s));
+    }
+    REQUIRE(results.statuses.size() == 10);
+    REQUIRE(agent.connections_accepted() == 1);
+    const auto stats = client.connection_stats();
+    REQUIRE(stats.new_connections == 1);
+    REQUIRE(stats.reused_connections == 9);
+  }
+
+  SECTION("limits the number of connections per endpoint") {
+    LocalAgent agent;
+    const auto url = parse_url(agent.url());
+    for (int i = 0; i < 100; ++i) {
+      REQUIRE(client.post(url, set_trace_count, "hello",
+                          results.on_response(), results.on_error(), in(5s)));
+    }
+    client.drain(in(5s));
+    REQUIRE(results.errors.empty());
+    REQUIRE(results.statuses.size() == 100);
+    REQUIRE(agent.trace_chunks() == 100);
+    REQUIRE(agent.connections_accepted() <=
+            SocketHTTPClient::default_max_connections_per_endpoint);
+  }
+
+  SECTION("reconnects after the agent closes an idle connection") {
+    LocalAgent agent;
+    const auto url = parse_url(agent.url());
+    REQUIRE(client.post(url, set_trace_count, "hello", results.on_response(),
+                        results.on_error(), in(5s)));
+    client.drain(in(5s));
+    agent.close_connections();
+    // Whether or not the client notices the closed connection before the
+    // next request, the next request succeeds.
+    const auto delay = GENERATE(0ms, 50ms);
+    std::this_thread::sleep_for(delay);
+    REQUIRE(client.post(url, set_trace_count, "hello", results.on_response(),
+                        results.on_error(), in(5s)));
+    client.drain(in(5s));
+
+    REQUIRE(results.errors.empty());
+    REQUIRE(results.statuses == std::vector<int>{200, 200});
+    REQUIRE(agent.connections_accepted() == 2);
+  }
+
+  SECTION("reports a connection failure") {
+    const auto url = parse_url("unix:///tmp/dd-trace-cpp-no-such-socket");
+    REQUIRE(client.post(url, set_trace_count, "hello", results.on_response(),
+                        results.on_error(), in(5s)));
+    client.drain(in(5s));
+    REQUIRE(results.statuses.empty());
+    REQUIRE(results.errors.size() == 1);
+    REQUIRE(results.errors[0].code == Error::SOCKET_HTTP_REQUEST_FAILURE);
+  }
+
+  SECTION("reports a connection failure over TCP") {
+    // Bind a port and release it without listening, so that connecting to
+    // the port is refused.
+    const int placeholder = ::socket(AF_INET, SOCK_STREAM, 0);
+    REQUIRE(placeholder != -1);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof address;
+    REQUIRE(::bind(placeholder, reinterpret_cast<sockaddr*>(&address),
+                   length) == 0);
+    REQUIRE(::getsockname(placeholder, reinterpret_cast<sockaddr*>(&address),
+                          &length) == 0);
+    ::close(placeholder);
+    const auto url = parse_url("http://127.0.0.1:" +
+                               std::to_string(ntohs(address.sin_port)));
+
+    // The failure discards the cached address, and the next request resolves
+    // the host again and fails the same way.
+    for (int i = 0; i < 2; ++i) {
+      REQUIRE(client.post(url, set_trace_count, "hello", results.on_response(),
+                          results.on_error(), in(5s)));
+      client.drain(in(5s));
+    }
+    REQUIRE(results.statuses.empty());
+    REQUIRE(results.errors.size() == 2);
+    for (const auto& error : results.errors) {
+      REQUIRE(error.code == Error::SOCKET_HTTP_REQUEST_FAILURE);
+      REQUIRE(error.message.find("Unable to connect to 127.0.0.1:") == 0);
+    }
+  }
+
+  SECTION("reports a timeout") {
+    // The listener never accepts, so the connection is established but the
+    // request is never answered.
+    const int listener = ::socket(AF_INET, SOCK_STREAM, 0);
+    REQUIRE(listener != -1);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof address;
+    REQUIRE(::bind(listener, reinterpret_cast<sockaddr*>(&address), length) ==
+            0);
+    REQUIRE(::listen(listener, 1) == 0);
+    REQUIRE(::getsockname(listener, reinterpret_cast<sockaddr*>(&address),
+                          &length) == 0);
+    const auto url = parse_url("http://127.0.0.1:" +
+                               std::to_string(ntohs(address.sin_port)));
+
+    REQUIRE(client.post(url, set_trace_count, "hello", results.on_response(),
+                        results.on_error(), in(100ms)));
+    client.drain(in(5s));
+    ::close(listener);
+
+    REQUIRE(results.statuses.empty());
+    REQUIRE(results.errors.size() == 1);
+    REQUIRE(results.errors[0].code == Error::SOCKET_HTTP_REQUEST_TIMEOUT);
+  }
+
+  SECTION("reports a deadline that has already passed") {
+    LocalAgent agent;
+    REQUIRE(client.post(parse_url(agent.url()), set_trace_count, "hello",
+                        results.on_response(), results.on_error(),
+                        std::chrono::steady_clock::now() - 1ms));
+    client.drain(in(5s));
+    REQUIRE(results.errors.size() == 1);
+    REQUIRE(results.errors[0].code == Error::SOCKET_HTTP_REQUEST_TIMEOUT);
+    REQUIRE(agent.requests() == 0);
+  }
+
+  SECTION("rejects TLS") {
+    const auto result =
+        client.post(parse_url("https://localhost:8126"), set_trace_count,
+                    "hello", results.on_response(), results.on_error(),
+                    in(5s));
+    REQUIRE_FALSE(result);
+    REQUIRE(result.error().code == Error::SOCKET_HTTP_CLIENT_UNSUPPORTED_URL);
+  }
+
+  SECTION("config_json") {
+    const auto json = client.config_json();
+    REQUIRE(json["type"] == "datadog::tracing::SocketHTTPClient");
+    REQUIRE(json["config"]["max_connections_per_endpoint"] ==
+            SocketHTTPClient::default_max_connections_per_endpoint);
+  }
+}
+#endif
@@ -0,0 +1,130 @@
+// These are tests for `SpanData`, in particular its MessagePack encoding.
+
+#include <datadog/json.hpp>
+#include <datadog/msgpack.h>
+#include <datadog/span_data.h>
+#include <datadog/string_table.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "test.h"
+#include "traces_v05.h"
+
+using namespace datadog::tracing;
+
+namespace {
+
+nlohmann::json encode(const SpanData& span) {
+  std::string buffer;
+  REQUIRE(msgpack_encode(buffer, span));
+  REQUIRE(buffer.size() == msgpack_encoded_size(span));
+  return nlohmann::json::from_msgpack(buffer);
+}
+
+// Return the JSON representation of the version 0.5 MessagePack encoding of
+// the specified `span`, in the same form as that returned by `encode`.
+nlohmann::json encode_v05(const SpanData& span) {
+  StringTable strings;
+  std::string spans;
+  REQUIRE(msgpack_encode(spans, span, strings));
+
+  std::string payload;
+  REQUIRE(msgpack::pack_array(payload, 2));
+  REQUIRE(msgpack_encode(payload, strings));
+  // one trace chunk containing one span
+  REQUIRE(msgpack::pack_array(payload, 1));
+  REQUIRE(msgpack::pack_array(payload, 1));
+  payload += spans;
+  return decode_v05_traces(payload).at(0).at(0);
+}
+
+}  // namespace
+
+TEST_CASE("span data encoding") {
+  SpanData span;
+  span.service = Symbol("testsvc");
+  span.name = Symbol("do.thing");
+  span.resource = "GET /";
+  span.service_type = Symbol("web");
+  span.trace_id = TraceID(0x1234);
+  span.span_id = 0x5678;
+  span.parent_id = 0x9ABC;
+  span.start.wall = std::chrono::system_clock::time_point(
+      std::chrono::seconds(1700000000));
+  span.duration = std::chrono::milliseconds(42);
+  span.error = true;
+  span.tags.emplace("color", "blue");
+  span.numeric_tags.emplace("count", 3);
+
+  SECTION("without shared tags") {
+    const auto json = encode(span);
+    REQUIRE(json.at("service") == "testsvc");
+    REQUIRE(json.at("name") == "do.thing");
+    REQUIRE(json.at("resource") == "GET /");
+    REQUIRE(json.at("type") == "web");
+    REQUIRE(json.at("meta") == nlohmann::json{{"color", "blue"}});
+    REQUIRE(json.at("metrics") == nlohmann::json{{"count", 3.0}});
+    REQUIRE(encode_v05(span) == json);
+  }
+
+  SECTION("with shared tags") {
+    auto shared = std::make_shared<SharedTags>();
+    shared->tags.emplace("language", "cpp");
+    shared->tags.emplace("color", "red");
+    shared->numeric_tags.emplace("process_id", 1234);
+    REQUIRE(shared->encode());
+    span.shared_tags = shared;
+
+    // Shared tags take precedence, and each key is encoded only once.
+    const auto json = encode(span);
+    REQUIRE(json.at("meta") ==
+            nlohmann::json{{"color", "red"}, {"language", "cpp"}});
+    REQUIRE(json.at("metrics") ==
+            nlohmann::json{{"count", 3.0}, {"process_id", 1234.0}});
+    REQUIRE(encode_v05(span) == json);
+
+    REQUIRE(span.find_tag("color") == "red");
+    REQUIRE(span.find_tag("language") == "cpp");
+    REQUIRE(span.find_numeric_tag("process_id") == 1234);
+    REQUIRE(span.find_numeric_tag("count") == 3);
+    REQUIRE_FALSE(span.find_tag("nope"));
+  }
+}
+
+TEST_CASE("span data encoded size") {
+  // `msgpack_encoded_size` must match `msgpack_encode` exactly, including for
+  // strings whose encoding is not cached in their `Symbol`.
+  std::vector<std::unique_ptr<SpanData>> spans;
+  for (int i = 0; i < 3; ++i) {
+    auto span = std::make_unique<SpanData>();
+    span->service = Symbol("testsvc");
+    span->name = Symbol(std::string(100 * i, 'x'));
+    span->resource = std::string(10000 * i, 'y');
+    for (int j = 0; j < 10 * i; ++j) {
+      span->tags.emplace("tag." + std::to_string(j), std::string(j, 'z'));
+      span->numeric_tags.emplace("metric." + std::to_string(j), j);
+    }
+    spans.push_back(std::move(span));
+  }
+  auto shared = std::make_shared<SharedTags>();
+  shared->tags.emplace("tag.1", "shared");
+  shared->numeric_tags.emplace("process_id", 1234);
+  REQUIRE(shared->encode());
+  spans.back()->shared_tags = shared;
+
+  std::string buffer;
+  for (const auto& span : spans) {
+    buffer.clear();
+    REQUIRE(msgpack_encode(buffer, *span));
+    REQUIRE(buffer.size() == msgpack_encoded_size(*span));
+  }
+
+  buffer.clear();
+  REQUIRE(msgpack_encode(buffer, spans));
+  REQUIRE(buffer.size() == msgpack_encoded_size(spans));
+  REQUIRE(nlohmann::json::from_msgpack(buffer).size() == spans.size());
+}
@@ -0,0 +1,71 @@
+// These are tests for `SpanList`, the lock-free sequence of spans owned by a
+// `TraceSegment`.
+
+#include <datadog/arena.h>
+#include <datadog/span_data.h>
+#include <datadog/span_list.h>
+
+#include <cstdint>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "test.h"
+
+using namespace datadog::tracing;
+
+TEST_CASE("span list") {
+  ArenaPtr arena{Arena::create()};
+  SpanList list{*arena};
+  REQUIRE(list.size() == 0);
+
+  SECTION("release yields spans in order") {
+    // Enough spans to require several chunks.
+    const std::uint64_t count = 100;
+    for (std::uint64_t i = 0; i < count; ++i) {
+      auto span = make_span_data(*arena);
+      span->span_id = i;
+      list.append(std::move(span));
+    }
+    REQUIRE(list.size() == count);
+
+    const auto spans = list.release();
+    REQUIRE(list.size() == 0);
+    REQUIRE(spans.size() == count);
+    for (std::uint64_t i = 0; i < count; ++i) {
+      REQUIRE(spans[i]->span_id == i);
+    }
+  }
+
+  SECTION("unreleased spans are deleted with the list") {
+    list.append(make_span_data(*arena));
+    list.append(std::make_unique<SpanData>());
+    // Sanitizers would report a leak otherwise.
+  }
+
+  SECTION("concurrent append") {
+    const int num_threads = 4;
+    const std::uint64_t spans_per_thread = 1000;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; ++i) {
+      threads.emplace_back([&, i]() {
+        for (std::uint64_t j = 0; j < spans_per_thread; ++j) {
+          auto span = make_span_data(*arena);
+          span->span_id = i * spans_per_thread + j;
+          list.append(std::move(span));
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+
+    const auto spans = list.release();
+    REQUIRE(spans.size() == num_threads * spans_per_thread);
+    std::set<std::uint64_t> ids;
+    for (const auto& span : spans) {
+      ids.insert(span->span_id);
+    }
+    REQUIRE(ids.size() == spans.size());
+  }
+}
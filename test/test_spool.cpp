@@ -0,0 +1,182 @@
+#include <datadog/datadog_agent_config.h>
+#include <datadog/error.h>
+#include <datadog/spool.h>
+
+#include <cstddef>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "test.h"
+
+using namespace datadog::tracing;
+
+namespace {
+
+// `TemporaryPath` is the path of a file in the temporary directory that does
+// not yet exist.  The file, if created, is removed on destruction.
+class TemporaryPath {
+  std::filesystem::path path_;
+
+ public:
+  TemporaryPath() {
+    std::random_device random;
+    path_ = std::filesystem::temp_directory_path() /
+            ("dd-trace-cpp-spool-" + std::to_string(random()) + "-" +
+             std::to_string(random()));
+  }
+
+  ~TemporaryPath() {
+    std::error_code ignored;
+    std::filesystem::remove(path_, ignored);
+  }
+
+  std::string string() const { return path_.string(); }
+};
+
+BufferChain chain(const std::string& bytes) {
+  // Small segments, so that bodies span several of them.
+  BufferChain result{4};
+  result.append(bytes);
+  return result;
+}
+
+// Append a record to the specified `spool`, and return the number of trace
+// chunks discarded.  The append must succeed.
+std::size_t append(Spool& spool, const std::string& body,
+                   std::size_t num_chunks, TracesAPIVersion version) {
+  auto result = spool.append(chain(body), num_chunks, version);
+  REQUIRE(result);
+  return *result;
+}
+
+std::vector<std::string> bodies(std::vector<Spool::Record> records) {
+  std::vector<std::string> result;
+  for (const auto& record : records) {
+    result.push_back(record.body.flatten());
+  }
+  return result;
+}
+
+}  // namespace
+
+#ifdef _MSC_VER
+TEST_CASE("Spool is not supported on Windows") {
+  TemporaryPath path;
+  Spool spool{path.string(), Spool::header_size + 64};
+  auto result = spool.append(chain("x"), 1, TracesAPIVersion::V0_4);
+  REQUIRE(!result);
+  REQUIRE(result.error().code == Error::SPOOL_FAILURE);
+}
+#else
+TEST_CASE("Spool") {
+  TemporaryPath path;
+  // The ring has room for 64 bytes of records.
+  const std::size_t file_size = Spool::header_size + 64;
+
+  SECTION("is initially empty") {
+    Spool spool{path.string(), file_size};
+    REQUIRE(spool.empty());
+    auto records = spool.take_oldest(1000);
+    REQUIRE(records);
+    REQUIRE(records->empty());
+    REQUIRE(std::filesystem::file_size(path.string()) == file_size);
+  }
+
+  SECTION("returns records oldest first") {
+    Spool spool{path.string(), file_size};
+    REQUIRE(append(spool, "first", 1, TracesAPIVersion::V0_4) == 0);
+    REQUIRE(append(spool, "second", 2, TracesAPIVersion::V0_5) == 0);
+    REQUIRE_FALSE(spool.empty());
+
+    auto records = spool.take_oldest(1000);
+    REQUIRE(records);
+    REQUIRE(records->size() == 2);
+    REQUIRE((*records)[0].body.flatten() == "first");
+    REQUIRE((*records)[0].num_chunks == 1);
+    REQUIRE((*records)[0].version == TracesAPIVersion::V0_4);
+    REQUIRE((*records)[1].body.flatten() == "second");
+    REQUIRE((*records)[1].num_chunks == 2);
+    REQUIRE((*records)[1].version == TracesAPIVersion::V0_5);
+    REQUIRE(spool.empty());
+  }
+
+  SECTION("takes records up to a maximum size, but at least one") {
+    Spool spool{path.string(), file_size};
+    REQUIRE(append(spool, "aaaa", 1, TracesAPIVersion::V0_4) == 0);
+    REQUIRE(append(spool, "bbbb", 1, TracesAPIVersion::V0_4) == 0);
+    REQUIRE(append(spool, "cccc", 1, TracesAPIVersion::V0_4) == 0);
+
+    REQUIRE(bodies(*spool.take_oldest(2)) == std::vector<std::string>{"aaaa"});
+    REQUIRE(bodies(*spool.take_oldest(8)) ==
+            std::vector<std::string>{"bbbb", "cccc"});
+    REQUIRE(spool.empty());
+  }
+
+  SECTION("discards the oldest records to make room, and wraps around") {
+    Spool spool{path.string(), file_size};
+    const std::string a(20, 'a');
+    const std::string b(20, 'b');
+    const std::string c(20, 'c');
+    const std::string d(20, 'd');
+    // Each record occupies `record_header_size + 20` bytes, so two fit.
+    REQUIRE(append(spool, a, 1, TracesAPIVersion::V0_4) == 0);
+    REQUIRE(append(spool, b, 2, TracesAPIVersion::V0_4) == 0);
+    REQUIRE(append(spool, c, 3, TracesAPIVersion::V0_4) == 1);
+    REQUIRE(append(spool, d, 4, TracesAPIVersion::V0_4) == 2);
+    REQUIRE(bodies(*spool.take_oldest(1000)) ==
+            std::vector<std::string>{c, d});
+  }
+
+  SECTION("discards a record larger than the ring") {
+    Spool spool{path.string(), file_size};
+    REQUIRE(append(spool, "keep", 1, TracesAPIVersion::V0_4) == 0);
+    const std::string large(64, 'x');
+    REQUIRE(append(spool, large, 5, TracesAPIVersion::V0_4) == 5);
+    REQUIRE(bodies(*spool.take_oldest(1000)) ==
+            std::vector<std::string>{"keep"});
+  }
+
+  SECTION("records persist after the spool is destroyed") {
+    {
+      Spool spool{path.string(), file_size};
+      REQUIRE(append(spool, "persistent", 1, TracesAPIVersion::V0_4) == 0);
+    }
+    Spool spool{path.string(), file_size};
+    REQUIRE(bodies(*spool.take_oldest(1000)) ==
+            std::vector<std::string>{"persistent"});
+  }
+
+  SECTION("records are discarded if the file's size changes") {
+    {
+      Spool spool{path.string(), file_size};
+      REQUIRE(append(spool, "stale", 1, TracesAPIVersion::V0_4) == 0);
+    }
+    Spool spool{path.string(), file_size * 2};
+    REQUIRE(spool.empty());
+    REQUIRE(std::filesystem::file_size(path.string()) == file_size * 2);
+  }
+
+  SECTION("a file can be used by only one spool at a time") {
+    Spool first{path.string(), file_size};
+    REQUIRE(first.empty());
+    Spool second{path.string(), file_size};
+    auto result = second.append(chain("x"), 1, TracesAPIVersion::V0_4);
+    REQUIRE(!result);
+    REQUIRE(result.error().code == Error::SPOOL_FAILURE);
+  }
+
+  SECTION("reports a file that cannot be opened") {
+    Spool spool{path.string() + "/not/a/directory", file_size};
+    auto result = spool.take_oldest(1000);
+    REQUIRE(!result);
+    REQUIRE(result.error().code == Error::SPOOL_FAILURE);
+    // Subsequent accesses fail the same way.
+    auto again = spool.append(chain("x"), 1, TracesAPIVersion::V0_4);
+    REQUIRE(!again);
+    REQUIRE(again.error().code == Error::SPOOL_FAILURE);
+  }
+}
+#endif
@@ -0,0 +1,209 @@
+#include <datadog/runtime_id.h>
+#include <datadog/span_data.h>
+#include <datadog/stats_concentrator.h>
+#include <datadog/symbol.h>
+#include <datadog/tracer_signature.h>
+
+#include <chrono>
+#include <cstdint>
+#include <datadog/json.hpp>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test.h"
+
+using namespace datadog::tracing;
+using namespace std::chrono_literals;
+
+namespace {
+
+const auto epoch = std::chrono::system_clock::time_point();
+
+struct SpanSpec {
+  std::uint64_t span_id;
+  std::uint64_t parent_id;
+  std::string service;
+  std::string name;
+  std::chrono::system_clock::time_point start;
+  std::chrono::nanoseconds duration;
+};
+
+std::unique_ptr<SpanData> make_span(const SpanSpec& spec) {
+  auto span = std::make_unique<SpanData>();
+  span->span_id = spec.span_id;
+  span->parent_id = spec.parent_id;
+  span->service = Symbol(spec.service);
+  span->name = Symbol(spec.name);
+  span->resource = spec.name;
+  span->start.wall = spec.start;
+  span->duration = spec.duration;
+  return span;
+}
+
+// Return the groups of stats in the specified `payload`, keyed by operation
+// name.
+std::unordered_map<std::string, nlohmann::json> groups_by_name(
+    const nlohmann::json& payload) {
+  std::unordered_map<std::string, nlohmann::json> result;
+  for (const auto& bucket : payload["Stats"]) {
+    for (const auto& group : bucket["Stats"]) {
+      result.emplace(group["Name"], group);
+    }
+  }
+  return result;
+}
+
+}  // namespace
+
+TEST_CASE("StatsConcentrator") {
+  const TracerSignature signature(RuntimeID::generate(), "testsvc", "test");
+  StatsConcentrator concentrator{signature, 4};
+
+  SECTION("computes stats for eligible spans") {
+    const auto start = epoch + 100s;
+    std::vector<std::unique_ptr<SpanData>> spans;
+    spans.push_back(make_span({1, 0, "web", "root", start, 5ms}));
+    spans.back()->tags.emplace("http.status_code", "200");
+    spans.back()->tags.emplace("_dd.origin", "synthetics-browser");
+    // not top-level, and so no stats
+    spans.push_back(make_span({2, 1, "web", "internal", start, 1ms}));
+    // measured
+    spans.push_back(make_span({3, 1, "web", "measured", start, 1ms}));
+    spans.back()->numeric_tags.emplace("_dd.measured", 1);
+    // top-level, because its parent has another service
+    spans.push_back(make_span({4, 1, "db", "query", start, 2ms}));
+    spans.back()->error = true;
+    // client
+    spans.push_back(make_span({5, 1, "web", "call", start, 3ms}));
+    spans.back()->tags.emplace("span.kind", "client");
+    // top-level, because its parent is in another chunk
+    spans.push_back(make_span({6, 99, "web", "orphan", start, 1ms}));
+    concentrator.add(spans);
+
+    // The bucket [100s, 110s) hasn't ended yet.
+    auto payloads = concentrator.flush(epoch + 109s, false);
+    REQUIRE(payloads);
+    REQUIRE(payloads->empty());
+
+    payloads = concentrator.flush(epoch + 110s, false);
+    REQUIRE(payloads);
+    REQUIRE(payloads->size() == 1);
+    const auto payload = nlohmann::json::from_msgpack((*payloads)[0]);
+    REQUIRE(payload["Service"] == "testsvc");
+    REQUIRE(payload["Env"] == "test");
+    REQUIRE(payload["Lang"] == "cpp");
+    REQUIRE(payload["RuntimeID"] == signature.runtime_id.string());
+    REQUIRE(payload["Sequence"] == 1);
+    REQUIRE(payload["Stats"].size() == 1);
+    const auto& bucket = payload["Stats"][0];
+    REQUIRE(bucket["Start"] == 100'000'000'000);
+    REQUIRE(bucket["Duration"] == 10'000'000'000);
+
+    const auto groups = groups_by_name(payload);
+    REQUIRE(groups.size() == 5);
+    REQUIRE(groups.count("internal") == 0);
+
+    const auto& root = groups.at("root");
+    REQUIRE(root["Service"] == "web");
+    REQUIRE(root["Resource"] == "root");
+    REQUIRE(root["HTTPStatusCode"] == 200);
+    REQUIRE(root["Synthetics"] == true);
+    REQUIRE(root["Hits"] == 1);
+    REQUIRE(root["TopLevelHits"] == 1);
+    REQUIRE(root["Errors"] == 0);
+    REQUIRE(root["Duration"] == 5'000'000);
+    REQUIRE(root["OkSummary"].is_binary());
+
+    REQUIRE(groups.at("measured")["Hits"] == 1);
+    REQUIRE(groups.at("measured")["TopLevelHits"] == 0);
+    REQUIRE(groups.at("query")["Service"] == "db");
+    REQUIRE(groups.at("query")["TopLevelHits"] == 1);
+    REQUIRE(groups.at("query")["Errors"] == 1);
+    REQUIRE(groups.at("call")["SpanKind"] == "client");
+    REQUIRE(groups.at("call")["TopLevelHits"] == 0);
+    REQUIRE(groups.at("orphan")["TopLevelHits"] == 1);
+
+    // Everything was flushed.
+    payloads = concentrator.flush(epoch + 1000s, true);
+    REQUIRE(payloads);
+    REQUIRE(payloads->empty());
+  }
+
+  SECTION("counts each span in the bucket of its end time") {
+    std::vector<std::unique_ptr<SpanData>> spans;
+    spans.push_back(make_span({1, 0, "web", "root", epoch + 8s, 3s}));
+    concentrator.add(spans);
+
+    auto payloads = concentrator.flush(epoch + 10s, false);
+    REQUIRE(payloads);
+    REQUIRE(payloads->empty());
+    payloads = concentrator.flush(epoch + 20s, false);
+    REQUIRE(payloads);
+    REQUIRE(payloads->size() == 1);
+    const auto payload = nlohmann::json::from_msgpack((*payloads)[0]);
+    REQUIRE(payload["Stats"][0]["Start"] == 10'000'000'000);
+  }
+
+  SECTION("aggregates spans having the same key") {
+    for (int i = 0; i < 10; ++i) {
+      std::vector<std::unique_ptr<SpanData>> spans;
+      spans.push_back(make_span({1, 0, "web", "root", epoch + 1s, 1ms}));
+      spans.back()->error = i % 2 == 0;
+      concentrator.add(spans);
+    }
+    const auto payloads = concentrator.flush(epoch, true);
+    REQUIRE(payloads);
+    REQUIRE(payloads->size() == 1);
+    const auto groups =
+        groups_by_name(nlohmann::json::from_msgpack((*payloads)[0]));
+    REQUIRE(groups.size() == 1);
+    REQUIRE(groups.at("root")["Hits"] == 10);
+    REQUIRE(groups.at("root")["Errors"] == 5);
+    REQUIRE(groups.at("root")["Duration"] == 10'000'000);
+  }
+
+  SECTION("sends a payload for each environment and version") {
+    for (const char* version : {"1.0", "2.0", "1.0"}) {
+      std::vector<std::unique_ptr<SpanData>> spans;
+      spans.push_back(make_span({1, 0, "web", "root", epoch + 1s, 1ms}));
+      spans.back()->tags.emplace("version", version);
+      concentrator.add(spans);
+    }
+    const auto payloads = concentrator.flush(epoch, true);
+    REQUIRE(payloads);
+    REQUIRE(payloads->size() == 2);
+    const auto first = nlohmann::json::from_msgpack((*payloads)[0]);
+    const auto second = nlohmann::json::from_msgpack((*payloads)[1]);
+    REQUIRE(first["Version"] == "1.0");
+    REQUIRE(groups_by_name(first).at("root")["Hits"] == 2);
+    REQUIRE(second["Version"] == "2.0");
+    REQUIRE(groups_by_name(second).at("root")["Hits"] == 1);
+    REQUIRE(first["Sequence"] != second["Sequence"]);
+  }
+
+  SECTION("merges the stats added by concurrent threads") {
+    const int num_threads = 8;
+    const int chunks_per_thread = 1000;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; ++i) {
+      threads.emplace_back([&]() {
+        for (int j = 0; j < chunks_per_thread; ++j) {
+          std::vector<std::unique_ptr<SpanData>> spans;
+          spans.push_back(make_span({1, 0, "web", "root", epoch + 1s, 1ms}));
+          concentrator.add(spans);
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    const auto payloads = concentrator.flush(epoch, true);
+    REQUIRE(payloads);
+    REQUIRE(payloads->size() == 1);
+    const auto groups =
+        groups_by_name(nlohmann::json::from_msgpack((*payloads)[0]));
+    REQUIRE(groups.at("root")["Hits"] == num_threads * chunks_per_thread);
+  }
+}
@@ -0,0 +1,39 @@
+#include <datadog/json.hpp>
+#include <datadog/string_table.h>
+#include <datadog/symbol.h>
+
+#include <string>
+
+#include "test.h"
+
+using namespace datadog::tracing;
+
+TEST_CASE("StringTable") {
+  StringTable table;
+
+  SECTION("begins with the empty string") {
+    REQUIRE(table.size() == 1);
+    REQUIRE(table.strings()[0] == "");
+    REQUIRE(table.index("") == 0);
+    REQUIRE(table.index(Symbol()) == 0);
+  }
+
+  SECTION("assigns each distinct string one index") {
+    REQUIRE(table.index("foo") == 1);
+    REQUIRE(table.index("bar") == 2);
+    REQUIRE(table.index(std::string("foo")) == 1);
+    REQUIRE(table.index(Symbol("bar")) == 2);
+    REQUIRE(table.index(Symbol("baz")) == 3);
+    REQUIRE(table.index("baz") == 3);
+    REQUIRE(table.size() == 4);
+  }
+
+  SECTION("encodes as an array of strings") {
+    table.index("foo");
+    table.index("bar");
+    std::string encoded;
+    REQUIRE(msgpack_encode(encoded, table));
+    REQUIRE(nlohmann::json::from_msgpack(encoded) ==
+            nlohmann::json{"", "foo", "bar"});
+  }
+}
@@ -0,0 +1,116 @@
+// These are tests for `Symbol`, the interned string type used by `SpanData`.
+
+#include <datadog/msgpack.h>
+#include <datadog/symbol.h>
+
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test.h"
+
+using namespace datadog::tracing;
+
+TEST_CASE("symbol") {
+  SECTION("default constructed symbol is empty") {
+    const Symbol symbol;
+    REQUIRE(symbol.empty());
+    REQUIRE(symbol == "");
+    REQUIRE(symbol == Symbol(""));
+  }
+
+  SECTION("equal text yields equal symbols") {
+    const Symbol first{"service.name"};
+    const std::string text = "service.name";
+    const Symbol second{text};
+    REQUIRE(first == second);
+    REQUIRE(first == text);
+    REQUIRE(text == first);
+    REQUIRE(first != Symbol("service.nam"));
+    REQUIRE(first != "other");
+    REQUIRE(first.string() == text);
+  }
+
+  SECTION("caches its MessagePack encoding") {
+    const Symbol symbol{"resource"};
+    std::string expected;
+    REQUIRE(msgpack::pack_string(expected, "resource"));
+    REQUIRE(std::string(symbol.msgpack()) == expected);
+  }
+
+  SECTION("copy and move") {
+    Symbol original{"copied"};
+    Symbol copy{original};
+    REQUIRE(copy == original);
+    Symbol moved{std::move(copy)};
+    REQUIRE(moved == "copied");
+    copy = moved;
+    REQUIRE(copy == "copied");
+    original = Symbol("reassigned");
+    REQUIRE(original == "reassigned");
+  }
+
+  SECTION("long symbols are not added to the table") {
+    const std::size_t before = Symbol::interned_count();
+    const std::string long_text(1000, 'x');
+    const Symbol first{long_text};
+    const Symbol second{long_text};
+    REQUIRE(Symbol::interned_count() == before);
+    REQUIRE(first == second);
+    REQUIRE(first == long_text);
+    std::string expected;
+    REQUIRE(msgpack::pack_string(expected, long_text));
+    REQUIRE(std::string(first.msgpack()) == expected);
+  }
+
+  SECTION("stream insertion") {
+    std::ostringstream stream;
+    stream << Symbol("hello");
+    REQUIRE(stream.str() == "hello");
+  }
+
+  SECTION("concurrent interning") {
+    const int num_threads = 4;
+    std::vector<std::vector<Symbol>> results(num_threads);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; ++i) {
+      threads.emplace_back([&, i]() {
+        for (int j = 0; j < 100; ++j) {
+          results[i].emplace_back("concurrent " + std::to_string(j));
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    for (int j = 0; j < 100; ++j) {
+      for (int i = 1; i < num_threads; ++i) {
+        REQUIRE(results[i][j] == results[0][j]);
+      }
+    }
+  }
+}
+
+TEST_CASE("symbols beyond the capacity of the interning table") {
+  // Fill the table.  Symbols created afterward own their text.
+  std::vector<Symbol> symbols;
+  for (int i = 0; Symbol::interned_count() < 8192; ++i) {
+    symbols.emplace_back("filler " + std::to_string(i));
+  }
+
+  const Symbol first{"not interned"};
+  const Symbol second{"not interned"};
+  REQUIRE(Symbol::interned_count() == 8192);
+  REQUIRE(first == second);
+  // The thread's overflow cache lets both symbols share one entry.
+  REQUIRE(first.msgpack().data() == second.msgpack().data());
+  REQUIRE(first == "not interned");
+  REQUIRE(first != symbols.front());
+
+  Symbol copy{first};
+  REQUIRE(copy == first);
+  std::string expected;
+  REQUIRE(msgpack::pack_string(expected, "not interned"));
+  REQUIRE(std::string(copy.msgpack()) == expected);
+}
@@ -0,0 +1,118 @@
+// These are tests for `TagMap`, the flat associative container used for the
+// tags of `SpanData`.
+
+#include <datadog/arena.h>
+#include <datadog/tag_map.h>
+
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "test.h"
+
+using namespace datadog::tracing;
+
+namespace {
+
+using Map = TagMap<std::string, 4>;
+
+std::vector<std::pair<std::string, std::string>> items(const Map& map) {
+  return {map.begin(), map.end()};
+}
+
+}  // namespace
+
+TEST_CASE("tag map") {
+  Map map;
+  REQUIRE(map.empty());
+
+  SECTION("lookup") {
+    map.emplace("foo", "bar");
+    map.emplace("fo", "short");
+    REQUIRE(map.size() == 2);
+    REQUIRE(map.count("foo") == 1);
+    REQUIRE(map.count("f") == 0);
+    REQUIRE(map.count("fooo") == 0);
+    REQUIRE(map.at("fo") == "short");
+    REQUIRE(map.find("nope") == map.end());
+    REQUIRE_THROWS_AS(map.at("nope"), std::out_of_range);
+  }
+
+  SECTION("emplace and insert don't overwrite") {
+    REQUIRE(map.emplace("key", "first").second);
+    REQUIRE_FALSE(map.emplace("key", "second").second);
+    REQUIRE_FALSE(map.insert(std::make_pair("key", "third")).second);
+    REQUIRE(map.at("key") == "first");
+  }
+
+  SECTION("insert_or_assign overwrites") {
+    REQUIRE(map.insert_or_assign("key", "first").second);
+    REQUIRE_FALSE(map.insert_or_assign("key", "second").second);
+    REQUIRE(map.at("key") == "second");
+    REQUIRE(map.size() == 1);
+  }
+
+  SECTION("subscript inserts a default value") {
+    REQUIRE(map["key"].empty());
+    map["key"] = "value";
+    REQUIRE(map.at("key") == "value");
+    REQUIRE(map.size() == 1);
+  }
+
+  SECTION("erase preserves insertion order") {
+    map.emplace("a", "1");
+    map.emplace("b", "2");
+    map.emplace("c", "3");
+    REQUIRE(map.erase("b") == 1);
+    REQUIRE(map.erase("b") == 0);
+    REQUIRE(items(map) == decltype(items(map)){{"a", "1"}, {"c", "3"}});
+  }
+
+  SECTION("spills beyond inline capacity") {
+    std::vector<std::pair<std::string, std::string>> expected;
+    for (int i = 0; i < 20; ++i) {
+      const std::string key = "key" + std::to_string(i);
+      // Long enough to defeat the small string optimization.
+      const std::string value = "some value that is long enough " + key;
+      map.emplace(key, value);
+      expected.emplace_back(key, value);
+    }
+    REQUIRE(map.capacity() >= 20);
+    REQUIRE(items(map) == expected);
+
+    SECTION("copy") {
+      Map copy{map};
+      REQUIRE(items(copy) == expected);
+    }
+
+    SECTION("move") {
+      Map moved{std::move(map)};
+      REQUIRE(items(moved) == expected);
+      REQUIRE(map.empty());
+    }
+  }
+
+  SECTION("move of inline elements") {
+    map.emplace("a", "1");
+    Map other;
+    other.emplace("b", "2");
+    other = std::move(map);
+    REQUIRE(items(other) == decltype(items(other)){{"a", "1"}});
+  }
+}
+
+TEST_CASE("tag map allocates from its arena") {
+  ArenaPtr arena{Arena::create()};
+  const auto capacity_before = arena->capacity();
+  Map map{Map::allocator_type(arena.get())};
+  REQUIRE(map.get_allocator().arena() == arena.get());
+  // The storage obtained while growing to this size exceeds the capacity of
+  // any one arena block, so the arena must grow.
+  for (int i = 0; i < 1000; ++i) {
+    map.emplace(std::to_string(i), "value");
+  }
+  REQUIRE(map.size() == 1000);
+  REQUIRE(map.at("999") == "value");
+  REQUIRE(arena->capacity() > capacity_before);
+}
@@ -0,0 +1,95 @@
+#include <datadog/threaded_event_scheduler.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "mocks/event_schedulers.h"
+#include "test.h"
+
+using namespace datadog::tracing;
+using namespace std::chrono_literals;
+
+namespace {
+
+// `CallCounter` counts the invocations of a scheduled callback, and allows a
+// test to wait for a number of them without depending on precise timing.
+class CallCounter {
+  std::mutex mutex_;
+  std::condition_variable changed_;
+  int count_ = 0;
+
+ public:
+  void increment() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++count_;
+    changed_.notify_all();
+  }
+
+  int count() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return count_;
+  }
+
+  // Return whether at least the specified `target` invocations occur within
+  // a generous timeout.
+  bool wait_for(int target) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return changed_.wait_for(lock, 10s, [&]() { return count_ >= target; });
+  }
+};
+
+}  // namespace
+
+TEST_CASE("ThreadedEventScheduler adjustable events") {
+  ThreadedEventScheduler scheduler;
+  CallCounter counter;
+  auto event = scheduler.schedule_adjustable_event(
+      1h, [&counter]() { counter.increment(); });
+  REQUIRE(event.cancel);
+  REQUIRE(event.trigger);
+  REQUIRE(event.set_interval);
+
+  SECTION("trigger runs the callback before the interval elapses") {
+    event.trigger();
+    REQUIRE(counter.wait_for(1));
+    event.trigger();
+    REQUIRE(counter.wait_for(2));
+  }
+
+  SECTION("set_interval changes the interval") {
+    event.set_interval(1ms);
+    REQUIRE(counter.wait_for(3));
+    // Lengthening the interval postpones the next invocation.
+    event.set_interval(1h);
+    const int count = counter.count();
+    std::this_thread::sleep_for(50ms);
+    REQUIRE(counter.count() <= count + 1);
+  }
+
+  SECTION("trigger has no effect after cancel") {
+    event.cancel();
+    event.trigger();
+    event.set_interval(1ms);
+    std::this_thread::sleep_for(50ms);
+    REQUIRE(counter.count() == 0);
+  }
+
+  event.cancel();
+}
+
+TEST_CASE("EventScheduler default adjustable event") {
+  // A scheduler that doesn't override `schedule_adjustable_event` supports
+  // neither `trigger` nor `set_interval`.
+  MockEventScheduler scheduler;
+  int calls = 0;
+  auto event = scheduler.schedule_adjustable_event(5s, [&calls]() { ++calls; });
+  REQUIRE(!event.trigger);
+  REQUIRE(!event.set_interval);
+  REQUIRE(scheduler.recurrence_interval == 5s);
+  scheduler.event_callback();
+  REQUIRE(calls == 1);
+  event.cancel();
+  REQUIRE(scheduler.cancelled);
+}
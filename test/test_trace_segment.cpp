@@ -1,13 +1,18 @@
+#include <datadog/hex.h>
+#include <datadog/json.hpp>
 #include <datadog/null_collector.h>
 #include <datadog/optional.h>
 #include <datadog/platform_util.h>
 #include <datadog/rate.h>
+#include <datadog/span_data.h>
 #include <datadog/tags.h>
 #include <datadog/trace_segment.h>
 #include <datadog/tracer.h>
 #include <datadog/tracer_config.h>
 
 #include <regex>
+#include <set>
+#include <thread>
 #include <vector>
 
 #include "matchers.h"
@@ -279,7 +284,7 @@ TEST_CASE("TraceSegment finalization of spans") {
         (void)root;
       }
       REQUIRE(collector->span_count() == 1);
-      REQUIRE(collector->first_span().tags.at(tags::internal::hostname) ==
+      REQUIRE(collector->first_span().find_tag(tags::internal::hostname) ==
               get_hostname());
     }
 
@@ -305,10 +310,12 @@ TEST_CASE("TraceSegment finalization of spans") {
       REQUIRE(collector->span_count() == 1);
       const auto& span = collector->first_span();
       // "three" will be discarded, but not the other two.
-      REQUIRE(span.tags.count("three") == 0);
-      REQUIRE_THAT(span.tags, ContainsSubset(filtered));
+      REQUIRE_FALSE(span.find_tag("three"));
+      for (const auto& [key, value] : filtered) {
+        REQUIRE(span.find_tag(key) == value);
+      }
       // "_dd.p.dm" will be added, because we made a sampling decision.
-      REQUIRE(span.tags.count("_dd.p.dm") == 1);
+      REQUIRE(span.find_tag("_dd.p.dm"));
     }
 
     SECTION("rate tags") {
@@ -436,29 +443,169 @@ TEST_CASE("TraceSegment finalization of spans") {
       for (const auto& span : chunk) {
         REQUIRE(span);
 
-        auto found_string = span->tags.find(tags::internal::origin);
-        REQUIRE(found_string != span->tags.end());
-        REQUIRE(found_string->second == "พัทยา");
-
-        found_string = span->tags.find(tags::internal::language);
-        REQUIRE(found_string != span->tags.end());
-        REQUIRE(found_string->second == "cpp");
+        // These tags are shared by the spans, rather than added to each.
+        REQUIRE(span->tags.count(tags::internal::origin) == 0);
+        REQUIRE(span->find_tag(tags::internal::origin) == "พัทยา");
+        REQUIRE(span->find_tag(tags::internal::language) == "cpp");
 
-        found_string = span->tags.find(tags::internal::runtime_id);
-        REQUIRE(found_string != span->tags.end());
-        const auto found_uuid = found_string->second;
-        CAPTURE(found_uuid);
-        REQUIRE(std::regex_match(found_uuid, uuid_regex));
+        const auto found_uuid = span->find_tag(tags::internal::runtime_id);
+        REQUIRE(found_uuid);
+        const std::string uuid{*found_uuid};
+        CAPTURE(uuid);
+        REQUIRE(std::regex_match(uuid, uuid_regex));
 
-        const auto found_number =
-            span->numeric_tags.find(tags::internal::process_id);
-        REQUIRE(found_number != span->numeric_tags.end());
-        REQUIRE(found_number->second == process_id);
+        REQUIRE(span->find_numeric_tag(tags::internal::process_id) ==
+                process_id);
       }
     }
   }
 }  // span finalizers
 
+TEST_CASE("spans created and finished on many threads") {
+  TracerConfig config;
+  config.service = "testsvc";
+  const auto collector = std::make_shared<MockCollector>();
+  config.collector = collector;
+  config.logger = std::make_shared<MockLogger>();
+  auto finalized = finalize_config(config);
+  REQUIRE(finalized);
+  Tracer tracer{*finalized};
+
+  const int num_threads = 4;
+  const int children_per_thread = 250;
+  {
+    auto root = tracer.create_span();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; ++i) {
+      threads.emplace_back([&]() {
+        for (int j = 0; j < children_per_thread; ++j) {
+          auto child = root.create_child();
+          auto grandchild = child.create_child();
+          grandchild.set_tag("depth", "2");
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    // The segment is finalized only after the root finishes.
+    REQUIRE(collector->chunks.empty());
+  }
+
+  REQUIRE(collector->chunks.size() == 1);
+  const auto& chunk = collector->chunks.front();
+  REQUIRE(chunk.size() == std::size_t(1 + 2 * num_threads * children_per_thread));
+  std::set<std::uint64_t> span_ids;
+  for (const auto& span : chunk) {
+    span_ids.insert(span->span_id);
+  }
+  REQUIRE(span_ids.size() == chunk.size());
+  // The local root is still first.
+  REQUIRE(chunk.front()->parent_id == 0);
+}
+
+TEST_CASE("partial flush") {
+  TracerConfig config;
+  config.service = "testsvc";
+  const auto collector = std::make_shared<MockCollector>();
+  config.collector = collector;
+  config.logger = std::make_shared<MockLogger>();
+  config.trace_sampler.sample_rate = 1.0;
+  config.partial_flush_min_spans = 3;
+
+  SECTION("is disabled by default") {
+    auto finalized = finalize_config(config);
+    REQUIRE(finalized);
+    Tracer tracer{*finalized};
+    {
+      auto root = tracer.create_span();
+      for (int i = 0; i < 10; ++i) {
+        root.create_child();
+      }
+      REQUIRE(collector->chunks.empty());
+    }
+    REQUIRE(collector->chunks.size() == 1);
+    REQUIRE(collector->chunks.front().size() == 11);
+  }
+
+  SECTION("sends finished spans and keeps unfinished spans") {
+    config.partial_flush_enabled = true;
+    config.report_hostname = true;
+    auto finalized = finalize_config(config);
+    REQUIRE(finalized);
+    Tracer tracer{*finalized};
+    {
+      auto root = tracer.create_span();
+      std::vector<Optional<Span>> children;
+      for (int i = 0; i < 7; ++i) {
+        children.emplace_back(root.create_child());
+      }
+
+      // Finishing two spans is not enough.
+      children[0].reset();
+      children[1].reset();
+      REQUIRE(collector->chunks.empty());
+      // The third finished span triggers a flush.
+      children[2].reset();
+      REQUIRE(collector->chunks.size() == 1);
+      REQUIRE(collector->chunks[0].size() == 3);
+      children[3].reset();
+      children[4].reset();
+      children[5].reset();
+      REQUIRE(collector->chunks.size() == 2);
+      REQUIRE(collector->chunks[1].size() == 3);
+      // One child remains, and the root.
+    }
+    REQUIRE(collector->chunks.size() == 3);
+    const auto& last = collector->chunks[2];
+    REQUIRE(last.size() == 2);
+    REQUIRE(last.front()->parent_id == 0);
+
+    std::set<std::uint64_t> span_ids;
+    for (const auto& chunk : collector->chunks) {
+      // Each chunk carries the trace's sampling decision on its first span,
+      // and each span has the tags common to the trace segment.
+      REQUIRE(chunk.front()->numeric_tags.at(
+                  tags::internal::sampling_priority) == 2);
+      // The first span of each chunk, as encoded for the agent, has the trace
+      // tags, including the high 64 bits of the trace ID, and the hostname.
+      std::string buffer;
+      REQUIRE(msgpack_encode(buffer, *chunk.front()));
+      const auto first = nlohmann::json::from_msgpack(buffer);
+      REQUIRE(first["meta"].contains(tags::internal::trace_id_high));
+      REQUIRE(first["meta"][tags::internal::trace_id_high] ==
+              hex_padded(last.front()->trace_id.high));
+      REQUIRE(first["meta"].contains(tags::internal::hostname));
+      for (const auto& span : chunk) {
+        REQUIRE(span->find_tag(tags::internal::language));
+        REQUIRE(span->trace_id == last.front()->trace_id);
+        span_ids.insert(span->span_id);
+      }
+    }
+    REQUIRE(span_ids.size() == 8);
+  }
+
+  SECTION("the local root is sent last even if it finishes first") {
+    config.partial_flush_enabled = true;
+    auto finalized = finalize_config(config);
+    REQUIRE(finalized);
+    Tracer tracer{*finalized};
+    std::vector<Span> children;
+    {
+      auto root = tracer.create_span();
+      for (int i = 0; i < 4; ++i) {
+        children.emplace_back(root.create_child());
+      }
+    }
+    REQUIRE(collector->chunks.empty());
+    children.clear();
+    REQUIRE(collector->chunks.size() == 2);
+    REQUIRE(collector->chunks[0].size() == 3);
+    REQUIRE(collector->chunks[1].size() == 2);
+    REQUIRE(collector->chunks[1].front()->parent_id == 0);
+  }
+}
+
 TEST_CASE("independent of Tracer") {
   // This test verifies that a `TraceSegment` (via the `Span`s that refer to it)
   // can continue to operate even after the `Tracer` that created it is
@@ -898,7 +898,7 @@ TEST_CASE("span extraction") {
     CAPTURE(test_case.traceparent);
     CAPTURE(test_case.tracestate);
 
-    std::unordered_map<std::string, std::string> span_tags;
+    TagMap<std::string> span_tags;
     MockLogger logger;
     CAPTURE(logger.entries);
     CAPTURE(span_tags);
@@ -1163,9 +1163,9 @@ TEST_CASE("128-bit trace IDs") {
   REQUIRE(logger->error_count() == 0);
   REQUIRE(collector->span_count() == 1);
   const auto& span = collector->first_span();
-  const auto found = span.tags.find(tags::internal::trace_id_high);
-  REQUIRE(found != span.tags.end());
-  const auto high = parse_uint64(found->second, 16);
+  const auto found = span.find_tag(tags::internal::trace_id_high);
+  REQUIRE(found);
+  const auto high = parse_uint64(*found, 16);
   REQUIRE(high);
   REQUIRE(*high == trace_id.high);
 }
@@ -1383,8 +1383,7 @@ TEST_CASE("_dd.is_sampling_decider") {
                 1);
         REQUIRE(span.numeric_tags.at(tags::internal::sampling_priority) ==
                 expected_sampling_priority);
-        REQUIRE(span.tags.count(tags::internal::decision_maker) == 1);
-        REQUIRE(span.tags.at(tags::internal::decision_maker) == expected_dm);
+        REQUIRE(span.find_tag(tags::internal::decision_maker) == expected_dm);
         continue;
       }
       if (span.service == "service1" && span.name == "child") {
@@ -1398,8 +1397,7 @@ TEST_CASE("_dd.is_sampling_decider") {
                 1);
         REQUIRE(span.numeric_tags.at(tags::internal::sampling_priority) ==
                 expected_sampling_priority);
-        REQUIRE(span.tags.count(tags::internal::decision_maker) == 1);
-        REQUIRE(span.tags.at(tags::internal::decision_maker) == expected_dm);
+        REQUIRE(span.find_tag(tags::internal::decision_maker) == expected_dm);
         continue;
       }
       if (span.service == "service2" && span.name == "child") {
@@ -1414,8 +1412,7 @@ TEST_CASE("_dd.is_sampling_decider") {
                 1);
         REQUIRE(span.numeric_tags.at(tags::internal::sampling_priority) ==
                 expected_sampling_priority);
-        REQUIRE(span.tags.count(tags::internal::decision_maker) == 1);
-        REQUIRE(span.tags.at(tags::internal::decision_maker) == expected_dm);
+        REQUIRE(span.find_tag(tags::internal::decision_maker) == expected_dm);
         continue;
       }
       if (span.service == "service3" && span.name == "child") {
@@ -1718,3 +1715,33 @@ TEST_CASE("move semantics") {
   Tracer tracer2{std::move(tracer1)};
   (void)tracer2;
 }
+
+TEST_CASE("clock modes") {
+  TracerConfig config;
+  config.service = "testsvc";
+  const auto collector = std::make_shared<MockCollector>();
+  config.collector = collector;
+  config.logger = std::make_shared<NullLogger>();
+  config.clock_mode = GENERATE(ClockMode::SEGMENT_ANCHORED, ClockMode::TSC);
+
+  auto finalized = finalize_config(config);
+  REQUIRE(finalized);
+  Tracer tracer{*finalized};
+  {
+    auto root = tracer.create_span();
+    auto child = root.create_child();
+  }
+
+  REQUIRE(collector->chunks.size() == 1);
+  const auto& chunk = collector->chunks.front();
+  REQUIRE(chunk.size() == 2);
+  const SpanData& root = *chunk[0];
+  const SpanData& child = *chunk[1];
+  // Both spans' wall times derive from the same anchor.
+  REQUIRE(child.start.wall - root.start.wall ==
+          std::chrono::duration_cast<std::chrono::system_clock::duration>(
+              child.start.tick - root.start.tick));
+  REQUIRE(child.start.tick >= root.start.tick);
+  REQUIRE(child.duration >= Duration::zero());
+  REQUIRE(root.duration >= child.duration);
+}
@@ -401,6 +401,44 @@ TEST_CASE("TracerConfig::report_traces") {
   }
 }
 
+TEST_CASE("TracerConfig::partial_flush") {
+  TracerConfig config;
+  config.service = "testsvc";
+  config.logger = std::make_shared<NullLogger>();
+
+  SECTION("is disabled by default") {
+    auto finalized = finalize_config(config);
+    REQUIRE(finalized);
+    REQUIRE(finalized->partial_flush_enabled == false);
+    REQUIRE(finalized->partial_flush_min_spans == 1000);
+  }
+
+  SECTION("min spans cannot be zero") {
+    config.partial_flush_min_spans = 0;
+    auto finalized = finalize_config(config);
+    REQUIRE(!finalized);
+    REQUIRE(finalized.error().code == Error::PARTIAL_FLUSH_INVALID_MIN_SPANS);
+  }
+
+  SECTION("overridden by environment variables") {
+    config.partial_flush_enabled = false;
+    config.partial_flush_min_spans = 10;
+    const EnvGuard enabled_guard{"DD_TRACE_PARTIAL_FLUSH_ENABLED", "true"};
+    const EnvGuard min_spans_guard{"DD_TRACE_PARTIAL_FLUSH_MIN_SPANS", "42"};
+    auto finalized = finalize_config(config);
+    REQUIRE(finalized);
+    REQUIRE(finalized->partial_flush_enabled == true);
+    REQUIRE(finalized->partial_flush_min_spans == 42);
+  }
+
+  SECTION("ill-formatted min spans environment variable is an error") {
+    const EnvGuard guard{"DD_TRACE_PARTIAL_FLUSH_MIN_SPANS", "lots"};
+    auto finalized = finalize_config(config);
+    REQUIRE(!finalized);
+    REQUIRE(finalized.error().code == Error::INVALID_INTEGER);
+  }
+}
+
 TEST_CASE("TracerConfig::agent") {
   TracerConfig config;
   config.service = "testsvc";
@@ -446,6 +484,190 @@ TEST_CASE("TracerConfig::agent") {
     }
   }
 
+  SECTION("encoder threads") {
+    SECTION("default to one") {
+      auto finalized = finalize_config(config);
+      REQUIRE(finalized);
+      const auto* const agent =
+          std::get_if<FinalizedDatadogAgentConfig>(&finalized->collector);
+      REQUIRE(agent);
+      REQUIRE(agent->encoder_threads == 1);
+    }
+
+    SECTION("must be positive") {
+      config.agent.encoder_threads = GENERATE(0, -4);
+      auto finalized = finalize_config(config);
+      REQUIRE(!finalized);
+      REQUIRE(finalized.error().code ==
+              Error::DATADOG_AGENT_INVALID_ENCODER_THREADS);
+    }
+  }
+
+  SECTION("max payload size") {
+    SECTION("defaults to 10 MiB") {
+      auto finalized = finalize_config(config);
+      REQUIRE(finalized);
+      const auto* const agent =
+          std::get_if<FinalizedDatadogAgentConfig>(&finalized->collector);
+      REQUIRE(agent);
+      REQUIRE(agent->max_payload_size == 10 * 1024 * 1024);
+    }
+
+    SECTION("must be positive") {
+      config.agent.max_payload_size_bytes = GENERATE(0, -1);
+      auto finalized = finalize_config(config);
+      REQUIRE(!finalized);
+      REQUIRE(finalized.error().code ==
+              Error::DATADOG_AGENT_INVALID_MAX_PAYLOAD_SIZE);
+    }
+  }
+
+  SECTION("buffer limits") {
+    SECTION("have defaults") {
+      auto finalized = finalize_config(config);
+      REQUIRE(finalized);
+      const auto* const agent =
+          std::get_if<FinalizedDatadogAgentConfig>(&finalized->collector);
+      REQUIRE(agent);
+      REQUIRE(agent->max_buffered_spans == 1000 * 1000);
+      REQUIRE(agent->max_buffered_bytes == 128 * 1024 * 1024);
+    }
+
+    SECTION("spans must be positive") {
+      config.agent.max_buffered_spans = GENERATE(0, -1);
+      auto finalized = finalize_config(config);
+      REQUIRE(!finalized);
+      REQUIRE(finalized.error().code ==
+              Error::DATADOG_AGENT_INVALID_MAX_BUFFERED_SPANS);
+    }
+
+    SECTION("bytes must be positive") {
+      config.agent.max_buffered_bytes = GENERATE(0, -1);
+      auto finalized = finalize_config(config);
+      REQUIRE(!finalized);
+      REQUIRE(finalized.error().code ==
+              Error::DATADOG_AGENT_INVALID_MAX_BUFFERED_BYTES);
+    }
+  }
+
+  SECTION("early flush") {
+    SECTION("defaults") {
+      auto finalized = finalize_config(config);
+      REQUIRE(finalized);
+      const auto* const agent =
+          std::get_if<FinalizedDatadogAgentConfig>(&finalized->collector);
+      REQUIRE(agent);
+      REQUIRE(agent->early_flush_spans == 100 * 1000);
+      REQUIRE(agent->early_flush_bytes == agent->max_payload_size);
+      REQUIRE(agent->adaptive_flush_interval == false);
+    }
+
+    SECTION("bytes default to the maximum payload size") {
+      config.agent.max_payload_size_bytes = 1234;
+      auto finalized = finalize_config(config);
+      REQUIRE(finalized);
+      const auto* const agent =
+          std::get_if<FinalizedDatadogAgentConfig>(&finalized->collector);
+      REQUIRE(agent);
+      REQUIRE(agent->early_flush_bytes == 1234);
+    }
+
+    SECTION("spans must be positive") {
+      config.agent.early_flush_spans = GENERATE(0, -1);
+      auto finalized = finalize_config(config);
+      REQUIRE(!finalized);
+      REQUIRE(finalized.error().code ==
+              Error::DATADOG_AGENT_INVALID_EARLY_FLUSH_SPANS);
+    }
+
+    SECTION("bytes must be positive") {
+      config.agent.early_flush_bytes = GENERATE(0, -1);
+      auto finalized = finalize_config(config);
+      REQUIRE(!finalized);
+      REQUIRE(finalized.error().code ==
+              Error::DATADOG_AGENT_INVALID_EARLY_FLUSH_BYTES);
+    }
+  }
+
+  SECTION("retries") {
+    SECTION("defaults") {
+      auto finalized = finalize_config(config);
+      REQUIRE(finalized);
+      const auto* const agent =
+          std::get_if<FinalizedDatadogAgentConfig>(&finalized->collector);
+      REQUIRE(agent);
+      REQUIRE(agent->max_retries == 3);
+      REQUIRE(agent->retry_backoff == std::chrono::seconds(1));
+      REQUIRE(agent->max_resend_buffer_size == 32 * 1024 * 1024);
+    }
+
+    SECTION("can be disabled") {
+      config.agent.max_retries = 0;
+      auto finalized = finalize_config(config);
+      REQUIRE(finalized);
+      const auto* const agent =
+          std::get_if<FinalizedDatadogAgentConfig>(&finalized->collector);
+      REQUIRE(agent);
+      REQUIRE(agent->max_retries == 0);
+    }
+
+    SECTION("count must not be negative") {
+      config.agent.max_retries = -1;
+      auto finalized = finalize_config(config);
+      REQUIRE(!finalized);
+      REQUIRE(finalized.error().code ==
+              Error::DATADOG_AGENT_INVALID_MAX_RETRIES);
+    }
+
+    SECTION("backoff must be positive") {
+      config.agent.retry_backoff_milliseconds = GENERATE(0, -1);
+      auto finalized = finalize_config(config);
+      REQUIRE(!finalized);
+      REQUIRE(finalized.error().code ==
+              Error::DATADOG_AGENT_INVALID_RETRY_BACKOFF);
+    }
+
+    SECTION("resend buffer size must be positive") {
+      config.agent.max_resend_buffer_bytes = GENERATE(0, -1);
+      auto finalized = finalize_config(config);
+      REQUIRE(!finalized);
+      REQUIRE(finalized.error().code ==
+              Error::DATADOG_AGENT_INVALID_MAX_RESEND_BUFFER_SIZE);
+    }
+  }
+
+  SECTION("spool") {
+    SECTION("defaults") {
+      auto finalized = finalize_config(config);
+      REQUIRE(finalized);
+      const auto* const agent =
+          std::get_if<FinalizedDatadogAgentConfig>(&finalized->collector);
+      REQUIRE(agent);
+      REQUIRE(agent->spool_path.empty());
+      REQUIRE(agent->max_spool_size == 64 * 1024 * 1024);
+    }
+
+    SECTION("can be enabled") {
+      config.agent.spool_path = "/var/tmp/traces.spool";
+      config.agent.max_spool_bytes = 4096;
+      auto finalized = finalize_config(config);
+      REQUIRE(finalized);
+      const auto* const agent =
+          std::get_if<FinalizedDatadogAgentConfig>(&finalized->collector);
+      REQUIRE(agent);
+      REQUIRE(agent->spool_path == "/var/tmp/traces.spool");
+      REQUIRE(agent->max_spool_size == 4096);
+    }
+
+    SECTION("size must be at least 4096 bytes") {
+      config.agent.max_spool_bytes = GENERATE(4095, 0, -1);
+      auto finalized = finalize_config(config);
+      REQUIRE(!finalized);
+      REQUIRE(finalized.error().code ==
+              Error::DATADOG_AGENT_INVALID_MAX_SPOOL_SIZE);
+    }
+  }
+
   SECTION("remote configuration poll interval") {
     SECTION("cannot be zero") {
       config.agent.remote_configuration_poll_interval_seconds = 0;
@@ -0,0 +1,204 @@
+#include "traces_v05.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+// `Decoder` decodes the subset of MessagePack that version 0.5 payloads use.
+// Maps are decoded as arrays of [key, value] pairs, since their keys need not
+// be strings.
+class Decoder {
+  const std::string& input_;
+  std::size_t position_ = 0;
+
+  std::uint8_t byte() {
+    if (position_ >= input_.size()) {
+      throw std::runtime_error("unexpected end of MessagePack input");
+    }
+    return static_cast<std::uint8_t>(input_[position_++]);
+  }
+
+  std::uint64_t big_endian(int size) {
+    std::uint64_t result = 0;
+    for (int i = 0; i < size; ++i) {
+      result = (result << 8) | byte();
+    }
+    return result;
+  }
+
+  nlohmann::json string(std::size_t size) {
+    if (input_.size() - position_ < size) {
+      throw std::runtime_error("MessagePack string exceeds input");
+    }
+    std::string result = input_.substr(position_, size);
+    position_ += size;
+    return result;
+  }
+
+  nlohmann::json array(std::size_t size) {
+    auto result = nlohmann::json::array();
+    for (std::size_t i = 0; i < size; ++i) {
+      result.push_back(value());
+    }
+    return result;
+  }
+
+  nlohmann::json map(std::size_t size) {
+    auto result = nlohmann::json::array();
+    for (std::size_t i = 0; i < size; ++i) {
+      auto key = value();
+      result.push_back(nlohmann::json::array({std::move(key), value()}));
+    }
+    return result;
+  }
+
+ public:
+  explicit Decoder(const std::string& input) : input_(input) {}
+
+  bool done() const { return position_ == input_.size(); }
+
+  nlohmann::json value() {
+    const std::uint8_t type = byte();
+    if (type <= 0x7F) {
+      return std::uint64_t(type);
+    }
+    if ((type & 0xF0) == 0x80) {
+      return map(type & 0x0F);
+    }
+    if ((type & 0xF0) == 0x90) {
+      return array(type & 0x0F);
+    }
+    if ((type & 0xE0) == 0xA0) {
+      return string(type & 0x1F);
+    }
+    if (type >= 0xE0) {
+      return std::int64_t(std::int8_t(type));
+    }
+    switch (type) {
+      case 0xC0:
+        return nullptr;
+      case 0xC2:
+        return false;
+      case 0xC3:
+        return true;
+      case 0xCB: {
+        const std::uint64_t bits = big_endian(8);
+        double result;
+        std::memcpy(&result, &bits, sizeof result);
+        return result;
+      }
+      case 0xCC:
+        return big_endian(1);
+      case 0xCD:
+        return big_endian(2);
+      case 0xCE:
+        return big_endian(4);
+      case 0xCF:
+        return big_endian(8);
+      case 0xD0:
+        return std::int64_t(std::int8_t(big_endian(1)));
+      case 0xD1:
+        return std::int64_t(std::int16_t(big_endian(2)));
+      case 0xD2:
+        return std::int64_t(std::int32_t(big_endian(4)));
+      case 0xD3:
+        return std::int64_t(big_endian(8));
+      case 0xD9:
+        return string(big_endian(1));
+      case 0xDA:
+        return string(big_endian(2));
+      case 0xDB:
+        return string(big_endian(4));
+      case 0xDC:
+        return array(big_endian(2));
+      case 0xDD:
+        return array(big_endian(4));
+      case 0xDE:
+        return map(big_endian(2));
+      case 0xDF:
+        return map(big_endian(4));
+    }
+    throw std::runtime_error("unsupported MessagePack type " +
+                             std::to_string(type));
+  }
+};
+
+const nlohmann::json& string_at(const nlohmann::json& strings,
+                                const nlohmann::json& index) {
+  if (!index.is_number_unsigned()) {
+    throw std::runtime_error("string index is not an unsigned integer: " +
+                             index.dump());
+  }
+  return strings.at(index.get<std::size_t>());
+}
+
+nlohmann::json decode_span(const nlohmann::json& span,
+                           const nlohmann::json& strings) {
+  if (!span.is_array() || span.size() != 12) {
+    throw std::runtime_error("span is not an array of 12 fields: " +
+                             span.dump());
+  }
+
+  auto meta = nlohmann::json::object();
+  for (const auto& pair : span[9]) {
+    meta[string_at(strings, pair.at(0)).get<std::string>()] =
+        string_at(strings, pair.at(1));
+  }
+  auto metrics = nlohmann::json::object();
+  for (const auto& pair : span[10]) {
+    metrics[string_at(strings, pair.at(0)).get<std::string>()] = pair.at(1);
+  }
+
+  return nlohmann::json{
+      {"service", string_at(strings, span[0])},
+      {"name", string_at(strings, span[1])},
+      {"resource", string_at(strings, span[2])},
+      {"trace_id", span[3]},
+      {"span_id", span[4]},
+      {"parent_id", span[5]},
+      {"start", span[6]},
+      {"duration", span[7]},
+      {"error", span[8]},
+      {"meta", std::move(meta)},
+      {"metrics", std::move(metrics)},
+      {"type", string_at(strings, span[11])},
+  };
+}
+
+}  // namespace
+
+nlohmann::json decode_v05_traces(const std::string& payload) {
+  Decoder decoder{payload};
+  const auto decoded = decoder.value();
+  if (!decoder.done()) {
+    throw std::runtime_error("unexpected data after version 0.5 payload");
+  }
+  if (!decoded.is_array() || decoded.size() != 2) {
+    throw std::runtime_error("payload is not an array of two elements");
+  }
+
+  const auto& strings = decoded[0];
+  if (strings.empty() || strings[0] != "") {
+    throw std::runtime_error("string table does not begin with \"\"");
+  }
+  for (const auto& text : strings) {
+    if (!text.is_string()) {
+      throw std::runtime_error("string table contains a non-string: " +
+                               text.dump());
+    }
+  }
+
+  auto chunks = nlohmann::json::array();
+  for (const auto& chunk : decoded[1]) {
+    auto spans = nlohmann::json::array();
+    for (const auto& span : chunk) {
+      spans.push_back(decode_span(span, strings));
+    }
+    chunks.push_back(std::move(spans));
+  }
+  return chunks;
+}
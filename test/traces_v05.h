@@ -0,0 +1,20 @@
+#pragma once
+
+// This component provides a decoder for version 0.5 of the Datadog Agent's
+// traces API, so that tests can inspect the payloads that `DatadogAgent` sends
+// to "/v0.5/traces".
+//
+// The decoder produces the same JSON as decoding the equivalent version 0.4
+// payload with `nlohmann::json::from_msgpack`: an array of trace chunks, each
+// of which is an array of span objects.
+//
+// `nlohmann::json::from_msgpack` can't be used for version 0.5 payloads,
+// because it requires map keys to be strings, while the keys of a version 0.5
+// span's "meta" and "metrics" maps are indices into the string table.
+
+#include <datadog/json.hpp>
+#include <string>
+
+// Return the trace chunks in the specified version 0.5 `payload`.  Throw an
+// exception if `payload` is not a valid version 0.5 payload.
+nlohmann::json decode_v05_traces(const std::string& payload);